@@ -1,6 +1,7 @@
 #include "artwork.h"
 #include "config.hpp"
 #include "deck.h"
+#include "deck_sync.h"
 #include "edit_flashcard.h"
 #include "flashcard_scene.h"
 #include "game_scene.h"
@@ -9,6 +10,7 @@
 #include "mainmenu_scene.h"
 #include "menu.h"
 #include "settings_scene.h"
+#include "statistics_scene.h"
 #include "util.h"
 #include <conio.h>
 #include <filesystem>
@@ -20,10 +22,31 @@
 #include <windows.h>
 
 
-int main()
+int main(int argc, char *argv[])
 {
     // Game settings
     StudySettings studySettings;
+
+    // "studydungeon --sync <other Decks directory>" syncs the libraries and exits without starting the game
+    if (argc == 3 && std::string(argv[1]) == "--sync")
+    {
+        try
+        {
+            SyncReport report = syncDeckLibraries(studySettings.getDeckDir(), argv[2]);
+            std::cout << "Scanned " << report.files_scanned << " decks: " << report.files_copied << " copied, "
+                      << report.files_merged << " merged, " << report.files_unchanged << " unchanged\n"
+                      << "Cards merged: " << report.cards_merged << ", cards added: " << report.cards_added << "\n"
+                      << "Transferred " << report.literal_bytes << " bytes, reused " << report.matched_bytes
+                      << " bytes" << std::endl;
+            return 0;
+        }
+        catch (...)
+        {
+            std::cerr << "\nSync failed" << std::endl;
+            return 1;
+        }
+    }
+
     enableVirtualTerminal();
     ShowConsoleCursor(false);
     try
@@ -37,6 +60,7 @@ int main()
         std::shared_ptr<FlashcardApp::BrowseDecksScene> browseDecksScene;
         std::shared_ptr<FlashcardApp::FlashcardScene> flashcardScene;
         std::shared_ptr<FlashcardApp::ResultsScene> resultsScene;
+        std::shared_ptr<FlashcardApp::StatisticsScene> statisticsScene;
         std::shared_ptr<GameScene> gameScene;
 
         // Create GameScene
@@ -52,6 +76,19 @@ int main()
             [&]() { uiManager.setCurrentScene(gameScene); },
             false); // Pass false for the initial ResultsScene
 
+        // Shows the results at the end of a study session
+        auto showResults = [&](const std::vector<int> &difficultyCount, int score, bool sessionComplete) {
+            resultsScene = std::make_shared<FlashcardApp::ResultsScene>(
+                uiManager,
+                difficultyCount,
+                score,
+                [&]() { uiManager.setCurrentScene(mainMenuScene); },
+                [&]() { uiManager.setCurrentScene(browseDecksScene); },
+                [&]() { uiManager.setCurrentScene(gameScene); },
+                sessionComplete); // Pass the sessionCompleted value
+            uiManager.setCurrentScene(resultsScene);
+        };
+
         // Create BrowseDecksScene
         auto createBrowseDecksScene = [&]() {
             browseDecksScene = std::make_shared<FlashcardApp::BrowseDecksScene>(
@@ -63,22 +100,31 @@ int main()
                         deck,
                         [&]() { uiManager.setCurrentScene(browseDecksScene); },
                         [&]() { uiManager.setCurrentScene(browseDecksScene); },
-                        [&](const std::vector<int> &difficultyCount, int score, bool sessionComplete) {
-                            resultsScene = std::make_shared<FlashcardApp::ResultsScene>(
-                                uiManager,
-                                difficultyCount,
-                                score,
-                                [&]() { uiManager.setCurrentScene(mainMenuScene); },
-                                [&]() { uiManager.setCurrentScene(browseDecksScene); },
-                                [&]() { uiManager.setCurrentScene(gameScene); },
-                                sessionComplete); // Pass the sessionCompleted value
-                            uiManager.setCurrentScene(resultsScene);
-                        },
+                        showResults,
+                        studySettings);
+                    flashcardScene->setStaticDrawn(false);
+                    uiManager.setCurrentScene(flashcardScene);
+                },
+                studySettings,
+                [&](DeckLibrary &library) {
+                    flashcardScene = std::make_shared<FlashcardApp::FlashcardScene>(
+                        uiManager,
+                        library,
+                        [&]() { uiManager.setCurrentScene(browseDecksScene); },
+                        [&]() { uiManager.setCurrentScene(browseDecksScene); },
+                        showResults,
                         studySettings);
                     flashcardScene->setStaticDrawn(false);
                     uiManager.setCurrentScene(flashcardScene);
                 },
-                studySettings);
+                [&](const DeckLibrary &library) {
+                    statisticsScene = std::make_shared<FlashcardApp::StatisticsScene>(
+                        uiManager,
+                        library,
+                        studySettings,
+                        [&]() { uiManager.setCurrentScene(browseDecksScene); });
+                    uiManager.setCurrentScene(statisticsScene);
+                });
             browseDecksScene->setStaticDrawn(false);
         };
 
@@ -0,0 +1,512 @@
+/**
+ * @file bitmap.cpp
+ * @author Green Alligators
+ * @brief Compressed bitmaps of card ids
+ * @version 1.0.0
+ * @date 2024-10-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "bitmap.h"
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+
+namespace
+{
+void setBit(std::vector<uint64_t> &words, uint16_t low)
+{
+    words[low >> 6] |= uint64_t{1} << (low & 63);
+}
+
+bool testBit(const std::vector<uint64_t> &words, uint16_t low)
+{
+    return (words[low >> 6] >> (low & 63)) & 1;
+}
+
+uint32_t countBits(const std::vector<uint64_t> &words)
+{
+    uint32_t count{0};
+    for (uint64_t word : words)
+    {
+        count += static_cast<uint32_t>(std::popcount(word));
+    }
+    return count;
+}
+
+void toBitmap(BitmapContainer &c)
+{
+    c.words.assign(CompressedBitmap::wordsPerContainer, 0);
+    for (uint16_t low : c.values)
+    {
+        setBit(c.words, low);
+    }
+    c.values.clear();
+    c.values.shrink_to_fit();
+}
+
+void toArray(BitmapContainer &c)
+{
+    c.values.clear();
+    c.values.reserve(c.cardinality);
+    for (size_t w = 0; w < c.words.size(); ++w)
+    {
+        uint64_t word = c.words[w];
+        while (word != 0)
+        {
+            c.values.push_back(static_cast<uint16_t>(w * 64 + std::countr_zero(word)));
+            word &= word - 1;
+        }
+    }
+    c.words.clear();
+    c.words.shrink_to_fit();
+}
+
+// pick the smaller representation after an operation has changed the contents
+void normalise(BitmapContainer &c)
+{
+    if (c.isBitmap() && c.cardinality <= CompressedBitmap::arrayLimit)
+    {
+        toArray(c);
+    }
+    else if (!c.isBitmap() && c.cardinality > CompressedBitmap::arrayLimit)
+    {
+        toBitmap(c);
+    }
+}
+
+bool containerContains(const BitmapContainer &c, uint16_t low)
+{
+    if (c.isBitmap())
+    {
+        return testBit(c.words, low);
+    }
+    return std::binary_search(c.values.begin(), c.values.end(), low);
+}
+
+BitmapContainer andContainers(const BitmapContainer &a, const BitmapContainer &b)
+{
+    BitmapContainer out{};
+    out.key = a.key;
+    if (a.isBitmap() && b.isBitmap())
+    {
+        out.words.resize(CompressedBitmap::wordsPerContainer);
+        const uint64_t *wa = a.words.data();
+        const uint64_t *wb = b.words.data();
+        uint64_t *wo = out.words.data();
+        for (size_t i = 0; i < CompressedBitmap::wordsPerContainer; ++i)
+        {
+            wo[i] = wa[i] & wb[i];
+        }
+        out.cardinality = countBits(out.words);
+    }
+    else if (!a.isBitmap() && !b.isBitmap())
+    {
+        std::set_intersection(a.values.begin(),
+                              a.values.end(),
+                              b.values.begin(),
+                              b.values.end(),
+                              std::back_inserter(out.values));
+        out.cardinality = static_cast<uint32_t>(out.values.size());
+    }
+    else
+    {
+        const BitmapContainer &array = a.isBitmap() ? b : a;
+        const BitmapContainer &bitmap = a.isBitmap() ? a : b;
+        for (uint16_t low : array.values)
+        {
+            if (testBit(bitmap.words, low))
+            {
+                out.values.push_back(low);
+            }
+        }
+        out.cardinality = static_cast<uint32_t>(out.values.size());
+    }
+    normalise(out);
+    return out;
+}
+
+BitmapContainer orContainers(const BitmapContainer &a, const BitmapContainer &b)
+{
+    BitmapContainer out{};
+    out.key = a.key;
+    if (a.isBitmap() && b.isBitmap())
+    {
+        out.words.resize(CompressedBitmap::wordsPerContainer);
+        const uint64_t *wa = a.words.data();
+        const uint64_t *wb = b.words.data();
+        uint64_t *wo = out.words.data();
+        for (size_t i = 0; i < CompressedBitmap::wordsPerContainer; ++i)
+        {
+            wo[i] = wa[i] | wb[i];
+        }
+        out.cardinality = countBits(out.words);
+    }
+    else if (!a.isBitmap() && !b.isBitmap())
+    {
+        std::set_union(a.values.begin(),
+                       a.values.end(),
+                       b.values.begin(),
+                       b.values.end(),
+                       std::back_inserter(out.values));
+        out.cardinality = static_cast<uint32_t>(out.values.size());
+    }
+    else
+    {
+        const BitmapContainer &array = a.isBitmap() ? b : a;
+        out.words = a.isBitmap() ? a.words : b.words;
+        for (uint16_t low : array.values)
+        {
+            setBit(out.words, low);
+        }
+        out.cardinality = countBits(out.words);
+    }
+    normalise(out);
+    return out;
+}
+
+BitmapContainer andNotContainers(const BitmapContainer &a, const BitmapContainer &b)
+{
+    BitmapContainer out{};
+    out.key = a.key;
+    if (a.isBitmap())
+    {
+        out.words = a.words;
+        if (b.isBitmap())
+        {
+            const uint64_t *wb = b.words.data();
+            uint64_t *wo = out.words.data();
+            for (size_t i = 0; i < CompressedBitmap::wordsPerContainer; ++i)
+            {
+                wo[i] &= ~wb[i];
+            }
+        }
+        else
+        {
+            for (uint16_t low : b.values)
+            {
+                out.words[low >> 6] &= ~(uint64_t{1} << (low & 63));
+            }
+        }
+        out.cardinality = countBits(out.words);
+    }
+    else
+    {
+        for (uint16_t low : a.values)
+        {
+            if (!containerContains(b, low))
+            {
+                out.values.push_back(low);
+            }
+        }
+        out.cardinality = static_cast<uint32_t>(out.values.size());
+    }
+    normalise(out);
+    return out;
+}
+} // namespace
+
+
+BitmapContainer &CompressedBitmap::containerFor(uint16_t key)
+{
+    // ids are nearly always added in increasing order so the last container is checked first
+    if (!m_containers.empty() && m_containers.back().key == key)
+    {
+        return m_containers.back();
+    }
+    auto it = std::lower_bound(m_containers.begin(),
+                               m_containers.end(),
+                               key,
+                               [](const BitmapContainer &c, uint16_t k) { return c.key < k; });
+    if (it == m_containers.end() || it->key != key)
+    {
+        BitmapContainer c{};
+        c.key = key;
+        it = m_containers.insert(it, std::move(c));
+    }
+    return *it;
+}
+
+void CompressedBitmap::add(uint32_t id)
+{
+    BitmapContainer &c = containerFor(static_cast<uint16_t>(id >> 16));
+    uint16_t low = static_cast<uint16_t>(id & 0xFFFF);
+    if (c.isBitmap())
+    {
+        if (!testBit(c.words, low))
+        {
+            setBit(c.words, low);
+            c.cardinality++;
+        }
+        return;
+    }
+    if (c.values.empty() || c.values.back() < low)
+    {
+        c.values.push_back(low);
+    }
+    else
+    {
+        auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+        if (it != c.values.end() && *it == low)
+        {
+            return;
+        }
+        c.values.insert(it, low);
+    }
+    c.cardinality++;
+    normalise(c);
+}
+
+void CompressedBitmap::addRange(uint32_t begin, uint32_t end)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    uint32_t last = end - 1;
+    for (uint32_t key = begin >> 16; key <= (last >> 16); ++key)
+    {
+        uint32_t lo = key == (begin >> 16) ? begin & 0xFFFF : 0;
+        uint32_t hi = key == (last >> 16) ? last & 0xFFFF : 0xFFFF;
+        BitmapContainer &c = containerFor(static_cast<uint16_t>(key));
+        if (!c.isBitmap() && c.cardinality + (hi - lo + 1) > arrayLimit)
+        {
+            toBitmap(c);
+        }
+        if (c.isBitmap())
+        {
+            // whole words at once, partial words at either end
+            for (uint32_t w = lo >> 6; w <= (hi >> 6); ++w)
+            {
+                uint32_t first_bit = w == (lo >> 6) ? lo & 63 : 0;
+                uint32_t last_bit = w == (hi >> 6) ? hi & 63 : 63;
+                uint64_t mask = ~uint64_t{0};
+                if (last_bit - first_bit < 63)
+                {
+                    mask = ((uint64_t{1} << (last_bit - first_bit + 1)) - 1) << first_bit;
+                }
+                c.words[w] |= mask;
+            }
+            c.cardinality = countBits(c.words);
+        }
+        else
+        {
+            std::vector<uint16_t> range(hi - lo + 1);
+            for (uint32_t i = 0; i < range.size(); ++i)
+            {
+                range[i] = static_cast<uint16_t>(lo + i);
+            }
+            std::vector<uint16_t> merged;
+            merged.reserve(c.values.size() + range.size());
+            std::set_union(c.values.begin(), c.values.end(), range.begin(), range.end(), std::back_inserter(merged));
+            c.values = std::move(merged);
+            c.cardinality = static_cast<uint32_t>(c.values.size());
+        }
+        normalise(c);
+        if (key == 0xFFFF)
+        {
+            break;
+        }
+    }
+}
+
+bool CompressedBitmap::contains(uint32_t id) const
+{
+    uint16_t key = static_cast<uint16_t>(id >> 16);
+    auto it = std::lower_bound(m_containers.begin(),
+                               m_containers.end(),
+                               key,
+                               [](const BitmapContainer &c, uint16_t k) { return c.key < k; });
+    return it != m_containers.end() && it->key == key && containerContains(*it, static_cast<uint16_t>(id & 0xFFFF));
+}
+
+size_t CompressedBitmap::cardinality() const
+{
+    size_t count{0};
+    for (const BitmapContainer &c : m_containers)
+    {
+        count += c.cardinality;
+    }
+    return count;
+}
+
+bool CompressedBitmap::empty() const
+{
+    return cardinality() == 0;
+}
+
+void CompressedBitmap::forEach(const std::function<void(uint32_t)> &fn) const
+{
+    for (const BitmapContainer &c : m_containers)
+    {
+        uint32_t high = static_cast<uint32_t>(c.key) << 16;
+        if (c.isBitmap())
+        {
+            for (size_t w = 0; w < c.words.size(); ++w)
+            {
+                uint64_t word = c.words[w];
+                while (word != 0)
+                {
+                    fn(high | static_cast<uint32_t>(w * 64 + std::countr_zero(word)));
+                    word &= word - 1;
+                }
+            }
+        }
+        else
+        {
+            for (uint16_t low : c.values)
+            {
+                fn(high | low);
+            }
+        }
+    }
+}
+
+void CompressedBitmap::fillMask(uint32_t begin, uint32_t end, uint8_t *mask) const
+{
+    if (end <= begin)
+    {
+        return;
+    }
+    std::fill(mask, mask + (end - begin), uint8_t{0});
+    uint16_t first_key = static_cast<uint16_t>(begin >> 16);
+    uint16_t last_key = static_cast<uint16_t>((end - 1) >> 16);
+    auto it = std::lower_bound(m_containers.begin(),
+                               m_containers.end(),
+                               first_key,
+                               [](const BitmapContainer &c, uint16_t k) { return c.key < k; });
+    for (; it != m_containers.end() && it->key <= last_key; ++it)
+    {
+        const BitmapContainer &c = *it;
+        uint32_t high = static_cast<uint32_t>(c.key) << 16;
+        // the part of the range in this container, as low 16 bit values
+        uint32_t low_begin = begin > high ? begin - high : 0;
+        uint32_t low_end = end - high < 0x10000 ? end - high : 0x10000;
+        uint8_t *out = mask + (high + low_begin - begin);
+        if (c.isBitmap())
+        {
+            for (uint32_t low = low_begin; low < low_end; ++low)
+            {
+                out[low - low_begin] = static_cast<uint8_t>((c.words[low / 64] >> (low % 64)) & 1);
+            }
+        }
+        else
+        {
+            auto value = std::lower_bound(c.values.begin(), c.values.end(), low_begin);
+            for (; value != c.values.end() && *value < low_end; ++value)
+            {
+                out[*value - low_begin] = 1;
+            }
+        }
+    }
+}
+
+std::vector<uint32_t> CompressedBitmap::toVector() const
+{
+    std::vector<uint32_t> ids;
+    ids.reserve(cardinality());
+    forEach([&ids](uint32_t id) { ids.push_back(id); });
+    return ids;
+}
+
+CompressedBitmap CompressedBitmap::operator&(const CompressedBitmap &other) const
+{
+    CompressedBitmap out{};
+    size_t i = 0;
+    size_t j = 0;
+    while (i < m_containers.size() && j < other.m_containers.size())
+    {
+        const BitmapContainer &a = m_containers[i];
+        const BitmapContainer &b = other.m_containers[j];
+        if (a.key < b.key)
+        {
+            i++;
+        }
+        else if (b.key < a.key)
+        {
+            j++;
+        }
+        else
+        {
+            BitmapContainer c = andContainers(a, b);
+            if (c.cardinality > 0)
+            {
+                out.m_containers.push_back(std::move(c));
+            }
+            i++;
+            j++;
+        }
+    }
+    return out;
+}
+
+CompressedBitmap CompressedBitmap::operator|(const CompressedBitmap &other) const
+{
+    CompressedBitmap out{};
+    size_t i = 0;
+    size_t j = 0;
+    while (i < m_containers.size() || j < other.m_containers.size())
+    {
+        if (j == other.m_containers.size() ||
+            (i < m_containers.size() && m_containers[i].key < other.m_containers[j].key))
+        {
+            out.m_containers.push_back(m_containers[i++]);
+        }
+        else if (i == m_containers.size() || other.m_containers[j].key < m_containers[i].key)
+        {
+            out.m_containers.push_back(other.m_containers[j++]);
+        }
+        else
+        {
+            out.m_containers.push_back(orContainers(m_containers[i++], other.m_containers[j++]));
+        }
+    }
+    return out;
+}
+
+CompressedBitmap CompressedBitmap::andNot(const CompressedBitmap &other) const
+{
+    CompressedBitmap out{};
+    size_t j = 0;
+    for (const BitmapContainer &a : m_containers)
+    {
+        while (j < other.m_containers.size() && other.m_containers[j].key < a.key)
+        {
+            j++;
+        }
+        if (j < other.m_containers.size() && other.m_containers[j].key == a.key)
+        {
+            BitmapContainer c = andNotContainers(a, other.m_containers[j]);
+            if (c.cardinality > 0)
+            {
+                out.m_containers.push_back(std::move(c));
+            }
+        }
+        else
+        {
+            out.m_containers.push_back(a);
+        }
+    }
+    return out;
+}
+
+bool CompressedBitmap::operator==(const CompressedBitmap &other) const
+{
+    // representations always match the cardinality so equal sets have equal containers
+    if (m_containers.size() != other.m_containers.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < m_containers.size(); ++i)
+    {
+        const BitmapContainer &a = m_containers[i];
+        const BitmapContainer &b = other.m_containers[i];
+        if (a.key != b.key || a.cardinality != b.cardinality || a.values != b.values || a.words != b.words)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file bitmap.h
+ * @author Green Alligators
+ * @brief Compressed bitmaps of card ids
+ * @details A roaring style bitmap. The 32 bit id space is split into chunks of 65536 ids keyed by the high 16 bits.
+ * A chunk holding few ids stores them as a sorted array of the low 16 bits, a chunk holding more than arrayLimit
+ * ids stores a plain 65536 bit bitmap. Sparse sets stay small and dense sets are combined a 64 bit word at a time
+ * in simple loops the compiler turns into SIMD instructions.
+ *
+ * @version 1.0.0
+ * @date 2024-10-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief The ids of one 65536 id chunk of a CompressedBitmap
+ * @details Exactly one of values and words is used. words is either empty or holds all 1024 words.
+ *
+ */
+struct BitmapContainer
+{
+    /** the high 16 bits shared by every id in the container */
+    uint16_t key{};
+    /** number of ids in the container */
+    uint32_t cardinality{};
+    /** sorted low 16 bits of each id, for sparse containers */
+    std::vector<uint16_t> values{};
+    /** one bit per id, for dense containers */
+    std::vector<uint64_t> words{};
+
+    /**
+     * @brief Whether the container uses the bitmap representation
+     *
+     * @return true if words holds the ids
+     */
+    bool isBitmap() const
+    {
+        return !words.empty();
+    }
+};
+
+/**
+ * @brief A compressed set of 32 bit card ids
+ *
+ */
+class CompressedBitmap
+{
+public:
+    /** containers with more ids than this switch to the bitmap representation */
+    static constexpr uint32_t arrayLimit{4096};
+    /** number of 64 bit words in a bitmap container */
+    static constexpr size_t wordsPerContainer{1024};
+
+    /**
+     * @brief Add an id, adding ids in increasing order is fastest
+     *
+     * @param id The id to add
+     */
+    void add(uint32_t id);
+
+    /**
+     * @brief Add every id in [begin, end)
+     *
+     * @param begin The first id
+     * @param end One past the last id
+     */
+    void addRange(uint32_t begin, uint32_t end);
+
+    /**
+     * @brief Check whether an id is in the set
+     *
+     * @param id The id to look for
+     * @return true if it is in the set
+     */
+    bool contains(uint32_t id) const;
+
+    /**
+     * @brief The number of ids in the set
+     *
+     * @return size_t
+     */
+    size_t cardinality() const;
+
+    /**
+     * @brief Check whether the set has no ids
+     *
+     * @return true if there are no ids
+     */
+    bool empty() const;
+
+    /**
+     * @brief Call a function for every id in increasing order
+     *
+     * @param fn The function to call
+     */
+    void forEach(const std::function<void(uint32_t)> &fn) const;
+
+    /**
+     * @brief Mark the ids of a range that are in the set
+     * @details Only the containers overlapping the range are visited, so filling a block of a mask costs about the
+     * block's length in bits plus the ids in it.
+     *
+     * @param begin The first id of the range
+     * @param end One past the last id of the range
+     * @param mask Set to 1 at mask[id - begin] for each id of the range in the set and 0 for the others
+     */
+    void fillMask(uint32_t begin, uint32_t end, uint8_t *mask) const;
+
+    /**
+     * @brief All ids in increasing order
+     *
+     * @return std::vector<uint32_t>
+     */
+    std::vector<uint32_t> toVector() const;
+
+    /**
+     * @brief Ids in both sets
+     *
+     */
+    CompressedBitmap operator&(const CompressedBitmap &other) const;
+
+    /**
+     * @brief Ids in either set
+     *
+     */
+    CompressedBitmap operator|(const CompressedBitmap &other) const;
+
+    /**
+     * @brief Ids in this set but not in other
+     *
+     * @param other The ids to remove
+     * @return CompressedBitmap
+     */
+    CompressedBitmap andNot(const CompressedBitmap &other) const;
+
+    bool operator==(const CompressedBitmap &other) const;
+
+    /**
+     * @brief The containers making up the bitmap, sorted by key
+     *
+     * @return const std::vector<BitmapContainer>&
+     */
+    const std::vector<BitmapContainer> &containers() const
+    {
+        return m_containers;
+    }
+
+private:
+    /**
+     * @brief Find the container for a key, creating an empty one if needed
+     *
+     * @param key The high 16 bits of an id
+     * @return BitmapContainer&
+     */
+    BitmapContainer &containerFor(uint16_t key);
+
+    std::vector<BitmapContainer> m_containers; ///< Non empty containers sorted by key
+};
+
+#endif // BITMAP_H
@@ -0,0 +1,679 @@
+/**
+ * @file card_query.cpp
+ * @author Green Alligators
+ * @brief A small query language for choosing which cards to study
+ * @version 1.0.0
+ * @date 2024-10-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "card_query.h"
+#include <algorithm>
+#include <cctype>
+
+
+namespace
+{
+std::string toLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+struct QueryToken
+{
+    enum Kind
+    {
+        WORD,
+        STRING,
+        OPERATOR,
+        LPAREN,
+        RPAREN
+    };
+    Kind kind{};
+    std::string text{};
+};
+
+bool tokenizeQuery(const std::string &text, std::vector<QueryToken> &tokens, std::string &error)
+{
+    size_t i = 0;
+    while (i < text.size())
+    {
+        char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            i++;
+        }
+        else if (c == '(' || c == ')')
+        {
+            tokens.push_back({c == '(' ? QueryToken::LPAREN : QueryToken::RPAREN, std::string(1, c)});
+            i++;
+        }
+        else if (c == '"')
+        {
+            size_t close = text.find('"', i + 1);
+            if (close == std::string::npos)
+            {
+                error = "Missing closing quote";
+                return false;
+            }
+            tokens.push_back({QueryToken::STRING, text.substr(i + 1, close - i - 1)});
+            i = close + 1;
+        }
+        else if (c == '=' || c == '<' || c == '>' || c == '!' || c == '~')
+        {
+            std::string op(1, c);
+            if (i + 1 < text.size() && (text[i + 1] == '=' || (c == '!' && text[i + 1] == '~')))
+            {
+                op += text[i + 1];
+            }
+            if (op == "!")
+            {
+                error = "Unknown operator '!'";
+                return false;
+            }
+            tokens.push_back({QueryToken::OPERATOR, op});
+            i += op.size();
+        }
+        else
+        {
+            size_t start = i;
+            while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i])) &&
+                   std::string("()\"=<>!~").find(text[i]) == std::string::npos)
+            {
+                i++;
+            }
+            tokens.push_back({QueryToken::WORD, text.substr(start, i - start)});
+        }
+    }
+    return true;
+}
+
+// recursive descent that emits the program in postfix order
+// or   := and ("or" and)*
+// and  := not ("and" not)*
+// not  := "not" not | "(" or ")" | field op value
+class QueryCompiler
+{
+public:
+    QueryCompiler(const CardColumns &columns,
+                  const std::vector<QueryToken> &tokens,
+                  std::vector<CardQuery::Instruction> &program,
+                  std::vector<std::vector<uint8_t>> &tables,
+                  std::vector<CompressedBitmap> &sets,
+                  std::string &error)
+        : m_columns(columns), m_tokens(tokens), m_program(program), m_tables(tables), m_sets(sets), m_error(error)
+    {
+    }
+
+    bool compile(size_t &stack_depth)
+    {
+        if (!parseOr())
+        {
+            return false;
+        }
+        if (m_pos != m_tokens.size())
+        {
+            m_error = "Unexpected '" + m_tokens[m_pos].text + "'";
+            return false;
+        }
+        stack_depth = m_maxDepth;
+        return true;
+    }
+
+private:
+    bool isKeyword(const char *keyword) const
+    {
+        return m_pos < m_tokens.size() && m_tokens[m_pos].kind == QueryToken::WORD &&
+               toLower(m_tokens[m_pos].text) == keyword;
+    }
+
+    // track how many masks the program needs as instructions are emitted
+    void emit(const CardQuery::Instruction &instruction)
+    {
+        m_program.push_back(instruction);
+        switch (instruction.op)
+        {
+        case CardQuery::Instruction::AND:
+        case CardQuery::Instruction::OR:
+            m_depth--;
+            break;
+        case CardQuery::Instruction::NOT:
+            break;
+        default:
+            m_depth++;
+            if (m_depth > m_maxDepth)
+            {
+                m_maxDepth = m_depth;
+            }
+        }
+    }
+
+    bool parseOr()
+    {
+        if (!parseAnd())
+        {
+            return false;
+        }
+        while (isKeyword("or"))
+        {
+            m_pos++;
+            if (!parseAnd())
+            {
+                return false;
+            }
+            emit({CardQuery::Instruction::OR});
+        }
+        return true;
+    }
+
+    bool parseAnd()
+    {
+        if (!parseNot())
+        {
+            return false;
+        }
+        while (isKeyword("and"))
+        {
+            m_pos++;
+            if (!parseNot())
+            {
+                return false;
+            }
+            emit({CardQuery::Instruction::AND});
+        }
+        return true;
+    }
+
+    bool parseNot()
+    {
+        if (m_pos >= m_tokens.size())
+        {
+            m_error = "Query ends early";
+            return false;
+        }
+        if (isKeyword("not"))
+        {
+            m_pos++;
+            if (!parseNot())
+            {
+                return false;
+            }
+            emit({CardQuery::Instruction::NOT});
+            return true;
+        }
+        if (m_tokens[m_pos].kind == QueryToken::LPAREN)
+        {
+            m_pos++;
+            if (!parseOr())
+            {
+                return false;
+            }
+            if (m_pos >= m_tokens.size() || m_tokens[m_pos].kind != QueryToken::RPAREN)
+            {
+                m_error = "Missing ')'";
+                return false;
+            }
+            m_pos++;
+            return true;
+        }
+        return parseComparison();
+    }
+
+    bool parseComparison()
+    {
+        if (m_pos + 3 > m_tokens.size())
+        {
+            m_error = "Incomplete comparison";
+            return false;
+        }
+        const QueryToken &field = m_tokens[m_pos];
+        const QueryToken &op = m_tokens[m_pos + 1];
+        const QueryToken &value = m_tokens[m_pos + 2];
+        if (field.kind != QueryToken::WORD || op.kind != QueryToken::OPERATOR ||
+            (value.kind != QueryToken::WORD && value.kind != QueryToken::STRING))
+        {
+            m_error = "Expected a comparison like answered<3 near '" + field.text + "'";
+            return false;
+        }
+        m_pos += 3;
+
+        std::string name = toLower(field.text);
+        if (name == "difficulty" || name == "answered")
+        {
+            return compileNumeric(name, op.text, value.text);
+        }
+        if (name == "deck")
+        {
+            return compileDeck(op.text, value.text);
+        }
+        if (name == "tag")
+        {
+            return compileTag(op.text, value.text);
+        }
+        m_error = "Unknown field '" + field.text + "'";
+        return false;
+    }
+
+    bool toCmp(const std::string &op, CardQuery::Instruction::Cmp &cmp)
+    {
+        using Instruction = CardQuery::Instruction;
+        static const std::pair<const char *, Instruction::Cmp> ops[] = {{"=", Instruction::EQ},
+                                                                        {"!=", Instruction::NE},
+                                                                        {"<", Instruction::LT},
+                                                                        {"<=", Instruction::LE},
+                                                                        {">", Instruction::GT},
+                                                                        {">=", Instruction::GE}};
+        for (const auto &[text, value] : ops)
+        {
+            if (op == text)
+            {
+                cmp = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool accepts(int32_t lhs, CardQuery::Instruction::Cmp cmp, int32_t rhs)
+    {
+        switch (cmp)
+        {
+        case CardQuery::Instruction::EQ:
+            return lhs == rhs;
+        case CardQuery::Instruction::NE:
+            return lhs != rhs;
+        case CardQuery::Instruction::LT:
+            return lhs < rhs;
+        case CardQuery::Instruction::LE:
+            return lhs <= rhs;
+        case CardQuery::Instruction::GT:
+            return lhs > rhs;
+        default:
+            return lhs >= rhs;
+        }
+    }
+
+    bool compileNumeric(const std::string &name, const std::string &op, const std::string &value)
+    {
+        CardQuery::Instruction instruction{};
+        if (!toCmp(op, instruction.cmp))
+        {
+            m_error = "'" + op + "' can not be used with " + name;
+            return false;
+        }
+        instruction.op = name == "difficulty" ? CardQuery::Instruction::DIFFICULTY : CardQuery::Instruction::ANSWERED;
+
+        std::string upper = value;
+        std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return std::toupper(c); });
+        if (instruction.op == CardQuery::Instruction::DIFFICULTY &&
+            (upper == "UNKNOWN" || strToCardDifficulty(upper) != UNKNOWN))
+        {
+            instruction.value = strToCardDifficulty(upper);
+        }
+        else
+        {
+            try
+            {
+                size_t used{0};
+                instruction.value = std::stoi(value, &used);
+                if (used != value.size())
+                {
+                    throw 0;
+                }
+            }
+            catch (...)
+            {
+                m_error = "'" + value + "' is not a valid " + name;
+                return false;
+            }
+        }
+        // difficulties are numbered UNKNOWN (0) to HARD (3) and answer counts are never negative
+        if (instruction.op == CardQuery::Instruction::DIFFICULTY &&
+            (instruction.value < UNKNOWN || instruction.value > HARD))
+        {
+            m_error = "Difficulty must be UNKNOWN, EASY, MEDIUM, HARD or 0 to 3, not '" + value + "'";
+            return false;
+        }
+        if (instruction.op == CardQuery::Instruction::ANSWERED && instruction.value < 0)
+        {
+            m_error = "The times a card was answered can not be negative, not '" + value + "'";
+            return false;
+        }
+        if (instruction.op == CardQuery::Instruction::DIFFICULTY)
+        {
+            // the cards of every difficulty the comparison accepts
+            CompressedBitmap cards{};
+            for (int32_t d = UNKNOWN; d <= HARD; ++d)
+            {
+                if (accepts(d, instruction.cmp, instruction.value))
+                {
+                    cards = cards | m_columns.index.withDifficulty(static_cast<CardDifficulty>(d));
+                }
+            }
+            instruction.table = static_cast<uint32_t>(m_sets.size());
+            m_sets.push_back(std::move(cards));
+        }
+        emit(instruction);
+        return true;
+    }
+
+    // text fields are matched once per distinct name here rather than once per card during evaluation
+    bool compileDeck(const std::string &op, const std::string &value)
+    {
+        bool glob = op == "~" || op == "!~";
+        bool negate = op == "!=" || op == "!~";
+        if (!glob && op != "=" && op != "!=")
+        {
+            m_error = "'" + op + "' can not be used with deck";
+            return false;
+        }
+        std::string lower = toLower(value);
+        std::vector<uint8_t> table(m_columns.deck_names.size());
+        for (size_t d = 0; d < table.size(); ++d)
+        {
+            bool match = glob ? globMatch(value, m_columns.deck_names[d]) : toLower(m_columns.deck_names[d]) == lower;
+            table[d] = match != negate;
+        }
+        CardQuery::Instruction instruction{CardQuery::Instruction::DECK_IN};
+        instruction.table = static_cast<uint32_t>(m_tables.size());
+        m_tables.push_back(std::move(table));
+        emit(instruction);
+        return true;
+    }
+
+    bool compileTag(const std::string &op, const std::string &value)
+    {
+        bool glob = op == "~" || op == "!~";
+        if (!glob && op != "=" && op != "!=")
+        {
+            m_error = "'" + op + "' can not be used with tag";
+            return false;
+        }
+        std::string lower = toLower(value);
+        CompressedBitmap cards{};
+        for (const std::string &tag : m_columns.index.tagNames())
+        {
+            if (glob ? globMatch(value, tag) : tag == lower)
+            {
+                cards = cards | m_columns.index.tagged(tag);
+            }
+        }
+        CardQuery::Instruction instruction{CardQuery::Instruction::TAG_IN};
+        instruction.table = static_cast<uint32_t>(m_sets.size());
+        m_sets.push_back(std::move(cards));
+        emit(instruction);
+        // a card without a matching tag, rather than a card with some other tag
+        if (op == "!=" || op == "!~")
+        {
+            emit({CardQuery::Instruction::NOT});
+        }
+        return true;
+    }
+
+    const CardColumns &m_columns;
+    const std::vector<QueryToken> &m_tokens;
+    std::vector<CardQuery::Instruction> &m_program;
+    std::vector<std::vector<uint8_t>> &m_tables;
+    std::vector<CompressedBitmap> &m_sets;
+    std::string &m_error;
+    size_t m_pos{0};
+    size_t m_depth{0};
+    size_t m_maxDepth{0};
+};
+
+template <typename T>
+void compareBlock(const T *values, size_t n, CardQuery::Instruction::Cmp cmp, T value, uint8_t *mask)
+{
+    // one loop per comparison keeps each loop branch free so it vectorises
+    switch (cmp)
+    {
+    case CardQuery::Instruction::EQ:
+        for (size_t i = 0; i < n; ++i)
+        {
+            mask[i] = values[i] == value;
+        }
+        break;
+    case CardQuery::Instruction::NE:
+        for (size_t i = 0; i < n; ++i)
+        {
+            mask[i] = values[i] != value;
+        }
+        break;
+    case CardQuery::Instruction::LT:
+        for (size_t i = 0; i < n; ++i)
+        {
+            mask[i] = values[i] < value;
+        }
+        break;
+    case CardQuery::Instruction::LE:
+        for (size_t i = 0; i < n; ++i)
+        {
+            mask[i] = values[i] <= value;
+        }
+        break;
+    case CardQuery::Instruction::GT:
+        for (size_t i = 0; i < n; ++i)
+        {
+            mask[i] = values[i] > value;
+        }
+        break;
+    case CardQuery::Instruction::GE:
+        for (size_t i = 0; i < n; ++i)
+        {
+            mask[i] = values[i] >= value;
+        }
+        break;
+    }
+}
+} // namespace
+
+
+CardColumns CardColumns::fromDecks(const std::vector<FlashCardDeck> &decks)
+{
+    CardColumns columns{};
+    size_t n_cards{0};
+    for (const FlashCardDeck &deck : decks)
+    {
+        n_cards += deck.cards.size();
+    }
+    columns.answered.reserve(n_cards);
+    columns.deck.reserve(n_cards);
+    columns.card.reserve(n_cards);
+    for (const FlashCardDeck &deck : decks)
+    {
+        columns.addDeck(deck);
+    }
+    return columns;
+}
+
+void CardColumns::addDeck(const FlashCardDeck &new_deck)
+{
+    uint32_t deck_index = static_cast<uint32_t>(deck_names.size());
+    deck_names.push_back(new_deck.name);
+    for (uint32_t c = 0; c < new_deck.cards.size(); ++c)
+    {
+        answered.push_back(new_deck.cards[c].n_times_answered);
+        deck.push_back(deck_index);
+        card.push_back(c);
+    }
+    index.addDeck(new_deck);
+}
+
+
+bool globMatch(const std::string &pattern, const std::string &text)
+{
+    // iterative matching that backtracks only to the most recent '*'
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = std::string::npos;
+    size_t star_t = 0;
+    auto same = [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    };
+    while (t < text.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || (pattern[p] != '*' && same(pattern[p], text[t]))))
+        {
+            p++;
+            t++;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            star_t = t;
+        }
+        else if (star != std::string::npos)
+        {
+            p = star + 1;
+            t = ++star_t;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+    {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+
+bool CardQuery::compile(const std::string &text, const CardColumns &columns, CardQuery &query, std::string &error)
+{
+    CardQuery compiled{};
+    std::vector<QueryToken> tokens;
+    if (!tokenizeQuery(text, tokens, error))
+    {
+        return false;
+    }
+    if (!tokens.empty())
+    {
+        QueryCompiler compiler{columns, tokens, compiled.m_program, compiled.m_tables, compiled.m_sets, error};
+        if (!compiler.compile(compiled.m_stackDepth))
+        {
+            return false;
+        }
+    }
+    query = std::move(compiled);
+    return true;
+}
+
+void CardQuery::evaluate(const CardColumns &columns, std::vector<uint8_t> &mask) const
+{
+    const size_t n_cards = columns.size();
+    mask.assign(n_cards, 1);
+    if (m_program.empty())
+    {
+        return;
+    }
+
+    std::vector<uint8_t> stack(m_stackDepth * blockSize);
+    for (size_t start = 0; start < n_cards; start += blockSize)
+    {
+        const size_t n = (n_cards - start) < blockSize ? n_cards - start : blockSize;
+        size_t sp{0};
+        for (const Instruction &instruction : m_program)
+        {
+            switch (instruction.op)
+            {
+            case Instruction::DIFFICULTY:
+            case Instruction::TAG_IN:
+            {
+                uint8_t *out = &stack[sp++ * blockSize];
+                const uint32_t first = static_cast<uint32_t>(start);
+                m_sets[instruction.table].fillMask(first, first + static_cast<uint32_t>(n), out);
+                break;
+            }
+            case Instruction::ANSWERED:
+            {
+                uint8_t *out = &stack[sp++ * blockSize];
+                compareBlock(columns.answered.data() + start, n, instruction.cmp, instruction.value, out);
+                break;
+            }
+            case Instruction::DECK_IN:
+            {
+                uint8_t *out = &stack[sp++ * blockSize];
+                const uint8_t *table = m_tables[instruction.table].data();
+                const uint32_t *decks = columns.deck.data() + start;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out[i] = table[decks[i]];
+                }
+                break;
+            }
+            case Instruction::AND:
+            {
+                sp--;
+                uint8_t *lhs = &stack[(sp - 1) * blockSize];
+                const uint8_t *rhs = &stack[sp * blockSize];
+                for (size_t i = 0; i < n; ++i)
+                {
+                    lhs[i] &= rhs[i];
+                }
+                break;
+            }
+            case Instruction::OR:
+            {
+                sp--;
+                uint8_t *lhs = &stack[(sp - 1) * blockSize];
+                const uint8_t *rhs = &stack[sp * blockSize];
+                for (size_t i = 0; i < n; ++i)
+                {
+                    lhs[i] |= rhs[i];
+                }
+                break;
+            }
+            case Instruction::NOT:
+            {
+                uint8_t *top = &stack[(sp - 1) * blockSize];
+                for (size_t i = 0; i < n; ++i)
+                {
+                    top[i] ^= 1;
+                }
+                break;
+            }
+            }
+        }
+        std::copy(stack.begin(), stack.begin() + n, mask.begin() + start);
+    }
+}
+
+std::vector<uint32_t> CardQuery::select(const CardColumns &columns) const
+{
+    std::vector<uint8_t> mask;
+    evaluate(columns, mask);
+    std::vector<uint32_t> rows;
+    for (size_t i = 0; i < mask.size(); ++i)
+    {
+        if (mask[i])
+        {
+            rows.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    return rows;
+}
+
+
+bool queryDeckCards(const FlashCardDeck &deck,
+                    const std::string &query_text,
+                    std::vector<size_t> &card_indices,
+                    std::string &error)
+{
+    CardColumns columns{};
+    columns.addDeck(deck);
+    CardQuery query{};
+    if (!CardQuery::compile(query_text, columns, query, error))
+    {
+        return false;
+    }
+    card_indices.clear();
+    for (uint32_t row : query.select(columns))
+    {
+        card_indices.push_back(columns.card[row]);
+    }
+    return true;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file card_query.h
+ * @author Green Alligators
+ * @brief A small query language for choosing which cards to study
+ * @details A query compares card fields with values and joins the comparisons with and, or, not and parentheses:
+ *
+ *     difficulty>=MEDIUM and answered<3 and deck~"cosc*"
+ *
+ * Fields are
+ * - difficulty: UNKNOWN < EASY < MEDIUM < HARD
+ * - answered: the number of times the card has been answered
+ * - deck: the deck name
+ * - tag: any of the card's or its deck's tags, true if one of them matches
+ *
+ * Operators are =, !=, <, <=, > and >=, plus ~ and !~ which match a glob pattern where * matches any text and ?
+ * any single character. Text comparisons are not case sensitive and values containing spaces are quoted.
+ *
+ * A query is compiled once against a CardColumns table into a short bytecode program. Deck and tag patterns are
+ * matched against each distinct name at compile time, so evaluating the program is a tight loop over plain arrays,
+ * a block of cards at a time. Difficulty and tag comparisons become the set of matching cards, the union of the
+ * TagIndex bitmaps of the difficulties or tags that match, and evaluating them only reads those bitmaps.
+ *
+ * @version 1.0.0
+ * @date 2024-10-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef CARD_QUERY_H
+#define CARD_QUERY_H
+
+#include "bitmap.h"
+#include "deck.h"
+#include "tag_index.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Column oriented copy of the card fields queries can use
+ * @details Row i describes card card[i] of deck deck[i]. Difficulties and tags are kept in a TagIndex in which
+ * the card of row i has id i.
+ *
+ */
+struct CardColumns
+{
+    /** n_times_answered of each card */
+    std::vector<int32_t> answered{};
+    /** index of the deck each card belongs to */
+    std::vector<uint32_t> deck{};
+    /** index of each card within its deck */
+    std::vector<uint32_t> card{};
+    /** name of each deck */
+    std::vector<std::string> deck_names{};
+    /** the cards by difficulty and by tag, including the tags of their deck */
+    TagIndex index{};
+
+    /**
+     * @brief Build the columns for the cards of some decks
+     *
+     * @param decks The decks, in the order their indices are recorded
+     * @return CardColumns
+     */
+    static CardColumns fromDecks(const std::vector<FlashCardDeck> &decks);
+
+    /**
+     * @brief Append the cards of a deck, giving it the next deck index
+     *
+     * @param deck The deck
+     */
+    void addDeck(const FlashCardDeck &deck);
+
+    /**
+     * @brief The number of cards
+     *
+     * @return size_t
+     */
+    size_t size() const
+    {
+        return answered.size();
+    }
+};
+
+/**
+ * @brief Match text against a glob pattern, ignoring case
+ *
+ * @param pattern The pattern, * matches any text and ? any single character
+ * @param text The text to match
+ * @return true if the whole text matches
+ */
+bool globMatch(const std::string &pattern, const std::string &text);
+
+/**
+ * @brief A compiled card query
+ *
+ */
+class CardQuery
+{
+public:
+    /** cards evaluated together, the size of the working masks */
+    static constexpr size_t blockSize{1024};
+
+    /**
+     * @brief Compile a query for a table of cards
+     * @details The result may only be evaluated against the columns it was compiled for. An empty query matches
+     * every card.
+     *
+     * @param text The query
+     * @param columns The cards the query will be evaluated against
+     * @param query Set to the compiled query on success
+     * @param error Set to a description of the problem on failure
+     * @return true if the query was compiled
+     */
+    static bool compile(const std::string &text, const CardColumns &columns, CardQuery &query, std::string &error);
+
+    /**
+     * @brief Evaluate the query for every card
+     *
+     * @param columns The cards the query was compiled for
+     * @param mask Set to 1 for each matching card and 0 otherwise
+     */
+    void evaluate(const CardColumns &columns, std::vector<uint8_t> &mask) const;
+
+    /**
+     * @brief The rows of the matching cards, in increasing order
+     *
+     * @param columns The cards the query was compiled for
+     * @return std::vector<uint32_t>
+     */
+    std::vector<uint32_t> select(const CardColumns &columns) const;
+
+    /**
+     * @brief One instruction of a compiled query
+     * @details Instructions run on a stack of masks. Comparisons push a mask, AND and OR pop two and push the
+     * result and NOT replaces the top mask.
+     *
+     */
+    struct Instruction
+    {
+        enum Op : uint8_t
+        {
+            DIFFICULTY,
+            ANSWERED,
+            DECK_IN,
+            TAG_IN,
+            AND,
+            OR,
+            NOT
+        };
+        enum Cmp : uint8_t
+        {
+            EQ,
+            NE,
+            LT,
+            LE,
+            GT,
+            GE
+        };
+
+        Op op{};
+        /** the comparison for DIFFICULTY and ANSWERED */
+        Cmp cmp{};
+        /** the value compared against */
+        int32_t value{};
+        /** index into the lookup tables for DECK_IN, or into the card sets for DIFFICULTY and TAG_IN */
+        uint32_t table{};
+    };
+
+private:
+    std::vector<Instruction> m_program{};         ///< The instructions in evaluation order
+    std::vector<std::vector<uint8_t>> m_tables{}; ///< Per deck match flags
+    std::vector<CompressedBitmap> m_sets{};       ///< Rows matching each difficulty or tag comparison
+    size_t m_stackDepth{0};                       ///< Masks needed to run the program
+};
+
+/**
+ * @brief Choose the cards of a deck matching a query
+ *
+ * @param deck The deck
+ * @param query_text The query, an empty query matches every card
+ * @param card_indices Set to the indices of the matching cards
+ * @param error Set to a description of the problem when the query is invalid
+ * @return true if the query was valid
+ */
+bool queryDeckCards(const FlashCardDeck &deck,
+                    const std::string &query_text,
+                    std::vector<size_t> &card_indices,
+                    std::string &error);
+
+#endif // CARD_QUERY_H
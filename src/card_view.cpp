@@ -0,0 +1,170 @@
+/**
+ * @file card_view.cpp
+ * @author Green Alligators
+ * @brief Alternate ways of studying a flashcard without copying it
+ * @version 1.0.0
+ * @date 2024-10-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "card_view.h"
+
+
+namespace
+{
+constexpr std::string_view clozeOpen{"{{"};
+constexpr std::string_view clozeClose{"}}"};
+constexpr std::string_view clozeHint{"::"};
+
+/**
+ * @brief Find the next complete cloze span at or after pos
+ *
+ * @param text The text to search
+ * @param pos Where to start, set to the start of the span's "{{"
+ * @param end Set to just past the span's "}}"
+ * @return true if a span was found
+ */
+bool nextClozeSpan(std::string_view text, size_t &pos, size_t &end)
+{
+    size_t open = text.find(clozeOpen, pos);
+    if (open == std::string_view::npos)
+    {
+        return false;
+    }
+    size_t close = text.find(clozeClose, open + clozeOpen.size());
+    if (close == std::string_view::npos)
+    {
+        return false;
+    }
+    pos = open;
+    end = close + clozeClose.size();
+    return true;
+}
+} // namespace
+
+
+std::string cardViewModeToStr(CardViewMode mode)
+{
+    switch (mode)
+    {
+    case REVERSE_VIEW:
+        return "Answer -> Question";
+    case CLOZE_VIEW:
+        return "Cloze (fill in the blank)";
+    default:
+        return "Question -> Answer";
+    }
+}
+
+size_t countClozeSpans(std::string_view text)
+{
+    size_t n_spans = 0;
+    size_t pos = 0;
+    size_t end = 0;
+    while (nextClozeSpan(text, pos, end))
+    {
+        n_spans++;
+        pos = end;
+    }
+    return n_spans;
+}
+
+std::string renderCloze(std::string_view text, size_t masked)
+{
+    std::string out;
+    out.reserve(text.size());
+    size_t copied = 0;
+    size_t pos = 0;
+    size_t end = 0;
+    for (size_t span = 0; nextClozeSpan(text, pos, end); ++span)
+    {
+        out.append(text.substr(copied, pos - copied));
+        std::string_view inner = text.substr(pos + clozeOpen.size(), end - pos - clozeOpen.size() - clozeClose.size());
+        size_t hint = inner.find(clozeHint);
+        if (span == masked)
+        {
+            out.append("[");
+            out.append(hint == std::string_view::npos ? std::string_view{"..."}
+                                                      : inner.substr(hint + clozeHint.size()));
+            out.append("]");
+        }
+        else
+        {
+            out.append(inner.substr(0, hint));
+        }
+        copied = end;
+        pos = end;
+    }
+    out.append(text.substr(copied));
+    return out;
+}
+
+
+CardView::CardView(const FlashCard &card, CardViewMode mode, size_t cloze_index)
+    : m_card(&card), m_mode(mode), m_clozeIndex(cloze_index)
+{
+}
+
+CardView CardView::forStudy(const FlashCard &card, CardViewMode mode)
+{
+    return CardView{card, mode, card.n_times_answered > 0 ? static_cast<size_t>(card.n_times_answered) : 0};
+}
+
+bool CardView::studiable() const
+{
+    return m_mode != CLOZE_VIEW || countClozeSpans(m_card->question) > 0 || countClozeSpans(m_card->answer) > 0;
+}
+
+std::string CardView::question() const
+{
+    switch (m_mode)
+    {
+    case REVERSE_VIEW:
+        return renderCloze(m_card->answer);
+    case CLOZE_VIEW:
+    {
+        size_t n_spans = countClozeSpans(m_card->question);
+        if (n_spans > 0)
+        {
+            return renderCloze(m_card->question, m_clozeIndex % n_spans);
+        }
+        // spans in the answer are blanked after the question, which gives them their context
+        n_spans = countClozeSpans(m_card->answer);
+        if (n_spans == 0)
+        {
+            return renderCloze(m_card->question);
+        }
+        std::string prompt = renderCloze(m_card->question);
+        prompt.append(prompt.empty() ? "" : " ");
+        prompt.append(renderCloze(m_card->answer, m_clozeIndex % n_spans));
+        return prompt;
+    }
+    default:
+        return renderCloze(m_card->question);
+    }
+}
+
+std::string CardView::answer() const
+{
+    switch (m_mode)
+    {
+    case REVERSE_VIEW:
+        return renderCloze(m_card->question);
+    case CLOZE_VIEW:
+        // the text that had the blank, shown in full
+        return countClozeSpans(m_card->question) > 0 ? renderCloze(m_card->question) : renderCloze(m_card->answer);
+    default:
+        return renderCloze(m_card->answer);
+    }
+}
+
+const FlashCard &CardView::card() const
+{
+    return *m_card;
+}
+
+CardViewMode CardView::mode() const
+{
+    return m_mode;
+}
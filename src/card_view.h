@@ -0,0 +1,134 @@
+/**
+ * @file card_view.h
+ * @author Green Alligators
+ * @brief Alternate ways of studying a flashcard without copying it
+ * @details A CardView points at a card in a deck and works out the question and answer to show when they are asked
+ * for, so studying a deck reversed or as cloze deletions needs no extra cards in memory or on disk.
+ *
+ * - forward: the card as written
+ * - reverse: the answer is shown as the question and the question as the answer
+ * - cloze: a span of the question or answer marked with {{ }} is blanked out, e.g. "{{Canberra}} is the capital of
+ *   Australia" is shown as "[...] is the capital of Australia". A hint can follow the text, "{{Canberra::city}}" is
+ *   shown as "[city]". Spans are taken from the question if it has any, otherwise from the answer. A card with
+ *   several spans blanks one at a time.
+ *
+ * Outside of a cloze view the {{ }} markers are removed so marked cards read normally.
+ *
+ * @version 1.0.0
+ * @date 2024-10-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef CARD_VIEW_H
+#define CARD_VIEW_H
+
+#include "deck.h"
+#include <string>
+#include <string_view>
+
+/**
+ * @brief The ways a card can be studied
+ *
+ */
+enum CardViewMode
+{
+    FORWARD_VIEW,
+    REVERSE_VIEW,
+    CLOZE_VIEW
+};
+
+/**
+ * @brief Convert a card view mode to a name for display
+ *
+ * @param mode The mode
+ * @return std::string
+ */
+std::string cardViewModeToStr(CardViewMode mode);
+
+/**
+ * @brief Count the cloze spans marked in some text
+ *
+ * @param text The question or answer of a card
+ * @return size_t The number of complete {{ }} spans
+ */
+size_t countClozeSpans(std::string_view text);
+
+/**
+ * @brief Write text with its cloze markers removed and optionally one span blanked
+ *
+ * @param text The question or answer of a card
+ * @param masked The span to blank, or std::string::npos to show them all
+ * @return std::string
+ */
+std::string renderCloze(std::string_view text, size_t masked = std::string::npos);
+
+/**
+ * @brief A flashcard as it is shown in one study mode
+ * @details The view refers to the card and must not outlive it.
+ *
+ */
+class CardView
+{
+public:
+    /**
+     * @brief View a card in a study mode
+     *
+     * @param card The card
+     * @param mode How to show the card
+     * @param cloze_index The span to blank in a cloze view, wrapped to the number of spans
+     */
+    CardView(const FlashCard &card, CardViewMode mode, size_t cloze_index = 0);
+
+    /**
+     * @brief View a card to study it, a cloze view blanks the next span each time the card is answered
+     *
+     * @param card The card
+     * @param mode How to show the card
+     * @return CardView
+     */
+    static CardView forStudy(const FlashCard &card, CardViewMode mode);
+
+    /**
+     * @brief Whether the card can be studied in this view, a cloze view needs a marked span
+     *
+     * @return true if the card can be shown
+     */
+    bool studiable() const;
+
+    /**
+     * @brief The text shown before the answer is revealed
+     *
+     * @return std::string
+     */
+    std::string question() const;
+
+    /**
+     * @brief The text revealed as the answer
+     *
+     * @return std::string
+     */
+    std::string answer() const;
+
+    /**
+     * @brief The card being viewed
+     *
+     * @return const FlashCard&
+     */
+    const FlashCard &card() const;
+
+    /**
+     * @brief How the card is shown
+     *
+     * @return CardViewMode
+     */
+    CardViewMode mode() const;
+
+private:
+    const FlashCard *m_card; ///< The card being viewed
+    CardViewMode m_mode;     ///< How the card is shown
+    size_t m_clozeIndex;     ///< The span blanked in a cloze view
+};
+
+#endif // CARD_VIEW_H
@@ -10,6 +10,13 @@
  */
 
 #include "deck.h"
+#include "deck_backup.h"
+#include "deck_compress.h"
+#include "deck_format.h"
+#include "deck_export.h"
+#include "deck_loader.h"
+#include <algorithm>
+#include <charconv>
 
 
 CardDifficulty strToCardDifficulty(const std::string &difficultyStr)
@@ -55,52 +62,188 @@ FlashCard::FlashCard() : FlashCard{"", "", UNKNOWN, 0}
 {
 }
 
+std::vector<std::string> strToTagList(const std::string &tagsStr)
+{
+    std::vector<std::string> tags;
+    size_t start = 0;
+    while (start <= tagsStr.size())
+    {
+        size_t end = tagsStr.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = tagsStr.size();
+        }
+        size_t first = tagsStr.find_first_not_of(" \t", start);
+        if (first != std::string::npos && first < end)
+        {
+            size_t last = tagsStr.find_last_not_of(" \t", end - 1);
+            tags.push_back(tagsStr.substr(first, last - first + 1));
+        }
+        start = end + 1;
+    }
+    return tags;
+}
+
+void mergeTagList(std::vector<std::string> &tags, const std::vector<std::string> &more)
+{
+    for (const std::string &tag : more)
+    {
+        if (std::find(tags.begin(), tags.end(), tag) == tags.end())
+        {
+            tags.push_back(tag);
+        }
+    }
+}
+
+std::string tagListToStr(const std::vector<std::string> &tags)
+{
+    std::string tagsStr{};
+    for (const std::string &tag : tags)
+    {
+        if (!tagsStr.empty())
+        {
+            tagsStr.append(", ");
+        }
+        tagsStr.append(tag);
+    }
+    return tagsStr;
+}
+
+std::string scheduleToStr(const CardSchedule &schedule)
+{
+    std::string scheduleStr = std::to_string(schedule.due) + ' ' + std::to_string(schedule.reviewed);
+    for (float value : {schedule.interval, schedule.ease, schedule.stability, schedule.difficulty})
+    {
+        // the shortest text that reads back as the same float
+        char buffer[32];
+        auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), value);
+        scheduleStr.push_back(' ');
+        scheduleStr.append(buffer, ec == std::errc{} ? end : buffer);
+    }
+    scheduleStr.append(" ").append(std::to_string(schedule.reps));
+    scheduleStr.append(" ").append(std::to_string(schedule.lapses));
+    scheduleStr.append(" ").append(std::to_string(schedule.failures));
+    return scheduleStr;
+}
+
+bool strToSchedule(std::string_view scheduleStr, CardSchedule &schedule)
+{
+    CardSchedule read{};
+    const char *pos = scheduleStr.data();
+    const char *end = scheduleStr.data() + scheduleStr.size();
+    auto field = [&pos, end](auto &value) {
+        while (pos < end && *pos == ' ')
+        {
+            pos++;
+        }
+        auto result = std::from_chars(pos, end, value);
+        pos = result.ptr;
+        return result.ec == std::errc{};
+    };
+    if (!field(read.due) || !field(read.reviewed) || !field(read.interval) || !field(read.ease) ||
+        !field(read.stability) || !field(read.difficulty) || !field(read.reps) || !field(read.lapses))
+    {
+        return false;
+    }
+    if (!field(read.failures))
+    {
+        read.failures = read.lapses;
+    }
+    schedule = read;
+    return true;
+}
+
 FlashCard::FlashCard(std::string question, std::string answer, CardDifficulty difficulty, int n_times_answered)
     : question(question), answer(answer), difficulty(difficulty), n_times_answered(n_times_answered) {};
 
-void FlashCard::printCard()
+void FlashCard::printCard() const
 {
     std::cout << question << '\n';
     std::cout << answer << '\n';
     std::cout << "\n";
 }
 
-void FlashCard::printCardAsTemplate()
+void FlashCard::printCardAsTemplate() const
 {
-    std::cout << "Q: " << question << '\n' << "A: " << answer << '\n';
-    std::cout << "D: " << cardDifficultyToStr(difficulty) << '\n' << "N: " << n_times_answered << '\n';
-    std::cout << "-" << '\n';
+    std::cout << stringCardAsTemplate();
 }
 
-std::string FlashCard::stringCardAsTemplate()
+std::string FlashCard::stringCardAsTemplate() const
 {
-    std::stringstream card_contents{};
-    card_contents << "Q: " << question << "\nA: " << answer << '\n';
-    card_contents << "D: " << cardDifficultyToStr(difficulty);
-    card_contents << "\nN: " << std::to_string(n_times_answered) << "\n";
-    card_contents << "-\n";
-    return card_contents.str();
+    std::string card_contents{};
+    card_contents.reserve(question.size() + answer.size() + 32);
+    appendDeckText(card_contents, "Q: ", question);
+    appendDeckText(card_contents, "A: ", answer);
+    card_contents.append("D: ").append(cardDifficultyToStr(difficulty));
+    card_contents.append("\nN: ").append(std::to_string(n_times_answered)).append("\n");
+    if (!tags.empty())
+    {
+        card_contents.append("T: ").append(tagListToStr(tags)).append("\n");
+    }
+    if (schedule.due != 0)
+    {
+        card_contents.append("S: ").append(scheduleToStr(schedule)).append("\n");
+    }
+    card_contents.append("-\n");
+    return card_contents;
 }
 
-void FlashCardDeck::printDeck()
+void FlashCardDeck::printDeck() const
 {
     std::cout << name << std::endl;
     std::cout << "File location: " << filename << std::endl;
     std::cout << "Deck size: " << cards.size() << " cards" << std::endl;
-    for (FlashCard card : cards)
+    for (const FlashCard &card : cards)
     {
         card.printCard();
     }
 }
 
 
-void FlashCardDeck::printDeckAsTemplate()
+void FlashCardDeck::printDeckAsTemplate() const
 {
-    std::cout << name << std::endl;
-    for (FlashCard card : cards)
+    NativeDeckExporter exporter{std::cout};
+    exportDeck(*this, exporter);
+}
+
+
+// read in blocks so only one block and the card being filled are held in memory, returns true if the stream held a
+// compressed deck, which is fed to the parser one decompressed block at a time
+static bool parseDeckStream(std::istream &in, DeckTextParser &parser)
+{
+    std::string block(64 * 1024, '\0');
+    // only a compressed deck can start with this byte, a text deck starts with valid UTF-8
+    if (in.peek() == 0x89)
+    {
+        in.read(block.data(), 8);
+        std::string_view start{block.data(), static_cast<size_t>(in.gcount())};
+        if (isCompressedDeck(start))
+        {
+            if (!streamCompressedDeck(in, [&parser](std::string_view text) { parser.feed(text); }))
+            {
+                std::cerr << "Compressed deck is damaged, only the cards before the damage were read" << std::endl;
+            }
+            parser.finish();
+            return true;
+        }
+        parser.feed(start);
+    }
+    while (in.read(block.data(), static_cast<std::streamsize>(block.size())) || in.gcount() > 0)
     {
-        card.printCardAsTemplate();
+        parser.feed(std::string_view{block.data(), static_cast<size_t>(in.gcount())});
     }
+    parser.finish();
+    return false;
+}
+
+void streamFlashCardDeck(std::istream &in,
+                         const std::function<void(const std::string &)> &on_name,
+                         const std::function<void(FlashCard &)> &on_card,
+                         const std::function<void(std::vector<std::string> &)> &on_deck_tags,
+                         Utf8Report *text_repairs)
+{
+    DeckTextParser parser{on_name, on_card, on_deck_tags, text_repairs};
+    parseDeckStream(in, parser);
 }
 
 
@@ -111,90 +254,92 @@ FlashCardDeck readFlashCardDeck(fs::path deck_file)
     /** The flashcard deck to store the flashcards in as read from the file */
     FlashCardDeck deck;
 
-    // Open file for reading
-    std::ifstream inf{deck_file};
-    // temporary variables to use for reading data
-    int lineCount{0};
-    std::string strInput{};
-    // keep track of current card in deck
-    int cardNum{0};
-
-    // Create a blank card and push it onto the deck ready to be filled
-    FlashCard fc{};
-    deck.cards.push_back(fc);
-
-    // Read each line of the deck file and process to make flashcards
-    while (std::getline(inf, strInput))
+    // stamped before the read, so a write that lands during it leaves the slots unused rather than trusted
+    std::error_code ec;
+    fs::file_time_type read_time = fs::last_write_time(deck_file, ec);
+
+    // Open file for reading, in binary so the card slots are byte offsets into the file
+    std::ifstream inf{deck_file, std::ios::binary};
+    DeckTextParser parser{[&deck](const std::string &name) { deck.name = name; },
+                          [&deck](FlashCard &card) { deck.cards.push_back(std::move(card)); },
+                          [&deck](std::vector<std::string> &tags) { mergeTagList(deck.tags, tags); },
+                          &deck.text_repairs,
+                          &deck.card_slots};
+    if (parseDeckStream(inf, parser))
     {
-        // First line of the file is the deck name
-        if (lineCount == 0)
-        {
-            deck.name = strInput;
-        }
-        else
-        {
-            // parse line
-            // if Q -> fc.question
-            // if A -> fc.answer
-            // if D -> fc.difficulty
-            // if N -> fc.num_times
-            // if '-' indicates the start of a new card
-            if (strInput.starts_with("-"))
-            {
-                cardNum++;
-                deck.cards.push_back(fc);
-            }
-            if (strInput.starts_with("Q: "))
-            {
-                size_t pos = strInput.find_first_not_of(" \t", 3);
-                deck.cards.at(cardNum).question = strInput.substr(pos);
-            }
-            if (strInput.starts_with("A: "))
-            {
-                size_t pos = strInput.find_first_not_of(" \t", 3);
-                deck.cards.at(cardNum).answer = strInput.substr(pos);
-            }
-            if (strInput.starts_with("D: "))
-            {
-                size_t pos = strInput.find_first_not_of(" \t", 3);
-                deck.cards.at(cardNum).difficulty = strToCardDifficulty(strInput.substr(pos));
-            }
-            if (strInput.starts_with("N: "))
-            {
-                deck.cards.at(cardNum).n_times_answered = std::stoi(strInput.substr(2));
-            }
-        }
-
-        lineCount++;
+        // the slots are offsets into the decompressed text, not the file
+        deck.compressed = true;
+        deck.card_slots.clear();
+    }
+    else
+    {
+        deck.indexed_size = parser.bytesParsed();
+        deck.indexed_time = read_time;
     }
 
+    return deck;
+};
 
-    // remove the empty card that should be at the end of the deck after reading in the files
-    if (deck.cards.at(cardNum).question == "" && deck.cards.at(cardNum).answer == "")
+FlashCardDeck parseFlashCardDeck(const std::string &contents)
+{
+    if (isCompressedDeck(contents))
     {
-        deck.cards.pop_back();
+        std::string text{};
+        if (!decompressDeckText(contents, text))
+        {
+            std::cerr << "Compressed deck is damaged and could not be read" << std::endl;
+            text.clear();
+        }
+        FlashCardDeck deck = parseFlashCardDeck(text);
+        deck.compressed = true;
+        deck.card_slots.clear();
+        deck.indexed_size = 0;
+        return deck;
     }
 
-
+    FlashCardDeck deck;
+    DeckTextParser parser{[&deck](const std::string &name) { deck.name = name; },
+                          [&deck](FlashCard &card) { deck.cards.push_back(std::move(card)); },
+                          [&deck](std::vector<std::string> &tags) { mergeTagList(deck.tags, tags); },
+                          &deck.text_repairs,
+                          &deck.card_slots};
+    parser.feed(contents);
+    parser.finish();
+    deck.indexed_size = contents.size();
     return deck;
-};
+}
 
 bool writeFlashCardDeck(const FlashCardDeck &deck, fs::path filename)
 {
 
     if (fs::is_directory(filename.parent_path()))
     {
-        // open file
-        std::ofstream outf{filename.string(), std::ios::trunc};
+        // open file, in binary so the file has the same bytes on every platform
+        std::ofstream outf{filename.string(), std::ios::binary | std::ios::trunc};
         // write contents to file
-        outf << deck.name << std::endl;
-        for (FlashCard fc : deck.cards)
+        if (deck.compressed)
         {
-            outf << fc.stringCardAsTemplate();
-            //outf << "-" << std::endl;
+            std::ostringstream text;
+            NativeDeckExporter exporter{text};
+            exportDeck(deck, exporter);
+            std::string data = compressDeckText(text.str());
+            outf.write(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+        else
+        {
+            NativeDeckExporter exporter{outf};
+            exportDeck(deck, exporter);
         }
         // close file
         outf.close();
+        if (!outf)
+        {
+            // a failed or cut short write must never become the latest snapshot
+            std::cerr << "Failed to write deck file " << filename << std::endl;
+            return false;
+        }
+        // every save becomes a snapshot that can be restored later
+        backupDeckFile(filename);
         return true;
     }
     else
@@ -258,33 +403,87 @@ bool writeFlashCardDeckWithChecks(const FlashCardDeck &deck, fs::path filename,
 };
 
 
-std::vector<FlashCardDeck> loadFlashCardDecks(fs::path deck_dir_path)
+bool rewriteFlashCardDeck(FlashCardDeck &deck)
 {
-    //std::cout << deck_dir_path << std::endl;
-    std::vector<FlashCardDeck> deck_array;
-    // Check the deck directory exists
-    if (fs::exists(deck_dir_path) && fs::is_directory(deck_dir_path))
-    {
-        //std::cout << deck_dir_path << " is a directory" << std::endl;
-        // list out the contents of the directory
-        for (const auto &entry : fs::directory_iterator(deck_dir_path))
-        {
-            if (entry.is_regular_file() && entry.path().string().ends_with(".deck"))
-            {
-                FlashCardDeck fd{};
-                fd = readFlashCardDeck(entry);
-                fd.filename = entry;
-                deck_array.push_back(fd);
-            }
-        }
+    if (!deck.filename.string().ends_with(".deck") || !fs::is_directory(deck.filename.parent_path()))
+    {
+        return false;
     }
-    else
+
+    if (deck.compressed)
     {
-        std::cerr << "Directory does not exist, or is not a directory";
-        throw 0;
+        deck.card_slots.clear();
+        deck.indexed_size = 0;
+        return writeFlashCardDeck(deck, deck.filename);
+    }
+
+    std::vector<CardSlot> slots;
+    std::ofstream outf{deck.filename, std::ios::binary | std::ios::trunc};
+    NativeDeckExporter exporter{outf, &slots, cardSlotPadding};
+    exportDeck(deck, exporter);
+    outf.close();
+    if (!outf)
+    {
+        deck.card_slots.clear();
+        return false;
+    }
+
+    deck.card_slots = std::move(slots);
+    deck.indexed_size = exporter.bytesWritten();
+    std::error_code ec;
+    deck.indexed_time = fs::last_write_time(deck.filename, ec);
+    backupDeckFile(deck.filename);
+    return true;
+}
+
+bool patchFlashCard(FlashCardDeck &deck, size_t card_index)
+{
+    // the index is only trusted while it matches the cards and the file
+    if (deck.compressed || card_index >= deck.cards.size() || deck.card_slots.size() != deck.cards.size())
+    {
+        return false;
+    }
+    const CardSlot &slot = deck.card_slots[card_index];
+    std::error_code ec;
+    if (slot.length == 0 || fs::file_size(deck.filename, ec) != deck.indexed_size || ec ||
+        fs::last_write_time(deck.filename, ec) != deck.indexed_time || ec)
+    {
+        return false;
+    }
+
+    std::string text = deck.cards[card_index].stringCardAsTemplate();
+    if (!padCardText(text, slot.length))
+    {
+        return false;
     }
 
-    return deck_array;
+    // a positioned write of the slot, the rest of the file is never read or written
+    std::fstream file{deck.filename, std::ios::in | std::ios::out | std::ios::binary};
+    if (!file)
+    {
+        return false;
+    }
+    file.seekp(static_cast<std::streamoff>(slot.offset));
+    file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    file.close();
+    if (!file)
+    {
+        return false;
+    }
+    deck.indexed_time = fs::last_write_time(deck.filename, ec);
+    return true;
+}
+
+bool saveEditedFlashCard(FlashCardDeck &deck, size_t card_index)
+{
+    return patchFlashCard(deck, card_index) || rewriteFlashCardDeck(deck);
+}
+
+
+std::vector<FlashCardDeck> loadFlashCardDecks(fs::path deck_dir_path)
+{
+    std::unique_ptr<DeckIoBackend> backend = createDefaultIoBackend();
+    return loadFlashCardDecks(deck_dir_path, *backend);
 };
 
 // This is used to create some eample decks if the decks directory doesn't exits
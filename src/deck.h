@@ -16,12 +16,17 @@
 #ifndef DECK_H
 #define DECK_H
 
+#include "utf8.h"
 #include "util.h"
 #include <algorithm>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <windows.h>
 
 
@@ -61,6 +66,80 @@ CardDifficulty strToCardDifficulty(const std::string &difficultyStr);
  */
 std::string cardDifficultyToStr(const CardDifficulty &difficulty);
 
+/**
+ * @brief Splits a comma separated list of tags
+ * @details Surrounding whitespace is removed from each tag and empty tags are dropped.
+ *
+ * @param tagsStr The tags as written in a deck file, e.g. "geography, capitals"
+ * @return std::vector<std::string>
+ */
+std::vector<std::string> strToTagList(const std::string &tagsStr);
+
+/**
+ * @brief Adds tags to a list, skipping those already in it
+ * @details A deck file can have several deck tag lines, the deck's tags are those of all of them.
+ *
+ * @param tags The list, added to in place
+ * @param more The tags to add, in order
+ */
+void mergeTagList(std::vector<std::string> &tags, const std::vector<std::string> &more);
+
+/**
+ * @brief Joins tags into the comma separated form used in deck files
+ *
+ * @param tags The tags
+ * @return std::string
+ */
+std::string tagListToStr(const std::vector<std::string> &tags);
+
+/**
+ * @brief When a card is next due for review and what its scheduler knows about it
+ * @details Every field is 0 for a card that has never been reviewed by a scheduler, see scheduler.h.
+ * Times are seconds since the epoch.
+ *
+ */
+struct CardSchedule
+{
+    /** when the card is next due, 0 for a new card */
+    int64_t due{0};
+    /** when the card was last reviewed */
+    int64_t reviewed{0};
+    /** days from the last review to due */
+    float interval{0};
+    /** SM-2 ease factor */
+    float ease{0};
+    /** FSRS memory stability, in days */
+    float stability{0};
+    /** FSRS difficulty, from 1 to 10 */
+    float difficulty{0};
+    /** reviews in a row the card was remembered */
+    uint32_t reps{0};
+    /** times the card was forgotten after being learnt */
+    uint32_t lapses{0};
+    /** times the card was answered again, whether or not it had been learnt */
+    uint32_t failures{0};
+};
+
+/**
+ * @brief Writes a card schedule in the form used by the "S: " line of deck files
+ * @details The fields are written in the order they are declared, separated by spaces.
+ *
+ * @param schedule The schedule
+ * @return std::string
+ */
+std::string scheduleToStr(const CardSchedule &schedule);
+
+/**
+ * @brief Reads a card schedule written by scheduleToStr
+ * @details Schedules written before failures were counted end at the lapses, their failures are taken to be their
+ * lapses.
+ *
+ * @param scheduleStr The value of an "S: " line
+ * @param schedule Set to the schedule if it could be read
+ * @return true if every field was read
+ */
+bool strToSchedule(std::string_view scheduleStr, CardSchedule &schedule);
+
 /**
  * @brief This structure holds the information for each flashcard
  *
@@ -85,25 +164,45 @@ public:
     /** The number of times the question has been answered */
     int n_times_answered{};
 
+    /** User defined tags, written as a "T: " line when not empty */
+    std::vector<std::string> tags{};
+
+    /** Spaced repetition schedule, written as an "S: " line once the card has been scheduled */
+    CardSchedule schedule{};
+
     /**
     * @brief Prints the card question and answer
     */
-    void printCard();
+    void printCard() const;
 
     /**
-    * @brief Used to
+    * @brief Prints the card to std::cout in the deck file template format
     */
-    void printCardAsTemplate();
+    void printCardAsTemplate() const;
 
     /**
      * @brief Returns the card in template form as a string
      *
      * @return std::string
      */
-    std::string stringCardAsTemplate();
+    std::string stringCardAsTemplate() const;
 };
 
 
+/**
+ * @brief The bytes a card takes up in its deck file
+ * @details A card's slot runs from its first field line to the end of its "-" line, including any padding lines.
+ * A length of 0 means the card cannot be rewritten in place.
+ *
+ */
+struct CardSlot
+{
+    /** offset of the slot from the start of the file */
+    uint64_t offset{0};
+    /** the number of bytes in the slot */
+    uint64_t length{0};
+};
+
 /**
  * @brief Class that defines a "deck" of flashcards
  *
@@ -118,17 +217,29 @@ public:
     std::filesystem::path filename{};
     /** Vector containing 0 or more flashcards */
     std::vector<FlashCard> cards{};
+    /** Tags that apply to every card in the deck, written as a "DT: " line when not empty */
+    std::vector<std::string> tags{};
+    /** Invalid UTF-8 replaced and accents composed while the deck was loaded */
+    Utf8Report text_repairs{};
+    /** Where each card is in the deck file, used to save an edited card without rewriting the file */
+    std::vector<CardSlot> card_slots{};
+    /** The size of the deck file card_slots refers to, the slots are not used if the file size has changed */
+    uint64_t indexed_size{0};
+    /** The last write time of the deck file card_slots refers to, the slots are not used if it was written since */
+    std::filesystem::file_time_type indexed_time{};
+    /** The deck file is a compressed container (see deck_compress.h), saves keep it compressed */
+    bool compressed{false};
 
     /**
      * @brief Prints flashcard deck information and then each card
      */
-    void printDeck();
+    void printDeck() const;
 
 
     /**
      * @brief Prints flashcard deck name and then each card as template for a deck file.
      */
-    void printDeckAsTemplate();
+    void printDeckAsTemplate() const;
 };
 
 
@@ -136,7 +247,7 @@ public:
  * @brief Load the decks from files stored with the ".deck" extension inside decks/
  * @details Will iterate through all files within the path directory that have a .deck suffix.
  * each deck file will be parsed and turned into a FlashCardDeck. All FlashCardDecks are added into
- * a vector and returned.
+ * a vector and returned. Files are read concurrently through the platform's default DeckIoBackend.
  *
  * @param deck_path Path on the file system to a directory where the deck files are located.
  * @return std::vector<FlashCardDeck>
@@ -152,10 +263,41 @@ std::vector<FlashCardDeck> loadFlashCardDecks(std::filesystem::path deck_dir_pat
  */
 FlashCardDeck readFlashCardDeck(std::filesystem::path deck_file);
 
+/**
+ * @brief Parse a deck from the contents of a deck file that has already been read into memory
+ * @details Compressed decks are decompressed first, their blocks in parallel.
+ *
+ * @param contents The deck file contents
+ * @return A FlashCardDeck after parsing the contents
+ */
+FlashCardDeck parseFlashCardDeck(const std::string &contents);
+
+/**
+ * @brief Parse deck contents from a stream one card at a time
+ * @details The deck name (first line) is passed to on_name and each card is passed to on_card as soon as its
+ * terminating '-' line has been read, so only a single card is held in memory regardless of the deck size.
+ * A trailing card without a question or answer is not reported, matching readFlashCardDeck.
+ * Both versions of the deck format are read with a DeckTextParser (see deck_format.h). Every text value is passed
+ * through sanitizeUtf8, so cards only ever hold valid, composed UTF-8. A compressed deck is decompressed one block
+ * at a time as it is parsed.
+ *
+ * @param in The stream containing the deck file contents
+ * @param on_name Called once with the deck name
+ * @param on_card Called for each card in file order
+ * @param on_deck_tags Called with the deck's tags if the deck has a "DT: " line, may be empty
+ * @param text_repairs If not null, the changes made to the text are added to it
+ */
+void streamFlashCardDeck(std::istream &in,
+                         const std::function<void(const std::string &)> &on_name,
+                         const std::function<void(FlashCard &)> &on_card,
+                         const std::function<void(std::vector<std::string> &)> &on_deck_tags = nullptr,
+                         Utf8Report *text_repairs = nullptr);
+
 /**
  * @brief Write a deck of flashcards to disk
  * @details This will check the parent directory exists and write to a file. It does
- * perform the additional checks on the filename that writeFlashCardWithChecks does
+ * perform the additional checks on the filename that writeFlashCardWithChecks does.
+ * The file is compressed if deck.compressed is set.
  *
  * @param deck The FlashCard deck to be written to file
  * @param filename The file path for the deck file
@@ -177,6 +319,39 @@ bool writeFlashCardDeck(const FlashCardDeck &deck, std::filesystem::path filenam
 bool writeFlashCardDeckWithChecks(const FlashCardDeck &deck, std::filesystem::path filename, bool force_overwrite);
 
 
+/**
+ * @brief Rewrite a deck's file and rebuild its card index
+ * @details Each card is given cardSlotPadding bytes of padding so later edits can usually be saved in place.
+ * The file must have a ".deck" suffix and its directory must exist. A compressed deck is written compressed and
+ * has no card index, its cards are never saved in place.
+ *
+ * @param deck The deck to write to deck.filename
+ * @return true if the file was written
+ */
+bool rewriteFlashCardDeck(FlashCardDeck &deck);
+
+/**
+ * @brief Overwrite one card's slot in the deck file without touching the rest of the file
+ * @details Only possible when the card's new text fits in its slot and the file still has the size and last write
+ * time it had when it was indexed. Any space left over is filled with a padding line. The deck's indexed_time is
+ * updated to the patched file's. Unlike the other saves no backup snapshot is taken, that would read the whole
+ * file, so the caller calls backupDeckFile() once it is done editing the deck.
+ *
+ * @param deck The deck the card belongs to
+ * @param card_index The index of the edited card
+ * @return true if the card was written in place
+ */
+bool patchFlashCard(FlashCardDeck &deck, size_t card_index);
+
+/**
+ * @brief Save an edited card, in place if possible and otherwise by rewriting the whole deck
+ *
+ * @param deck The deck the card belongs to
+ * @param card_index The index of the edited card
+ * @return true if the change was saved
+ */
+bool saveEditedFlashCard(FlashCardDeck &deck, size_t card_index);
+
 /**
  * @brief Create example deck files
  *
@@ -0,0 +1,375 @@
+/**
+ * @file deck_backup.cpp
+ * @author Green Alligators
+ * @brief Content-addressed incremental backups of deck files
+ * @version 1.0.0
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "deck_backup.h"
+#include "deck_loader.h"
+#include "hash.h"
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+
+namespace
+{
+// 256 pseudo random values for the gear hash, generated with splitmix64 so they are the same on every platform
+std::array<uint64_t, 256> makeGearTable()
+{
+    std::array<uint64_t, 256> table{};
+    uint64_t x = 0x5354554459ULL;
+    for (uint64_t &entry : table)
+    {
+        x += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        entry = z ^ (z >> 31);
+    }
+    return table;
+}
+
+const std::array<uint64_t, 256> gearTable = makeGearTable();
+
+// FastCDC style normalised chunking: a harder mask before the average size and an easier one after it pulls
+// chunk sizes towards the average. Masks use the high bits, which the gear hash mixes best.
+const uint64_t maskHard = 0xFFFF000000000000ULL; // 16 bits
+const uint64_t maskEasy = 0xFFC0000000000000ULL; // 10 bits
+
+int64_t secondsSinceEpoch()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+} // namespace
+
+
+std::vector<std::pair<size_t, size_t>> chunkBoundaries(const std::string &data)
+{
+    std::vector<std::pair<size_t, size_t>> chunks;
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data.data());
+    size_t start = 0;
+    while (start < data.size())
+    {
+        size_t remaining = data.size() - start;
+        if (remaining <= DeckBackupStore::minChunkSize)
+        {
+            chunks.emplace_back(start, remaining);
+            break;
+        }
+
+        size_t limit = remaining < DeckBackupStore::maxChunkSize ? remaining : DeckBackupStore::maxChunkSize;
+        size_t normal = limit < DeckBackupStore::avgChunkSize ? limit : DeckBackupStore::avgChunkSize;
+        size_t len = DeckBackupStore::minChunkSize;
+        uint64_t hash = 0;
+        bool cut = false;
+        for (; len < normal; ++len)
+        {
+            hash = (hash << 1) + gearTable[bytes[start + len]];
+            if ((hash & maskHard) == 0)
+            {
+                cut = true;
+                break;
+            }
+        }
+        if (!cut)
+        {
+            for (; len < limit; ++len)
+            {
+                hash = (hash << 1) + gearTable[bytes[start + len]];
+                if ((hash & maskEasy) == 0)
+                {
+                    break;
+                }
+            }
+        }
+        // the byte that matched belongs to this chunk
+        if (len < limit)
+        {
+            len++;
+        }
+        chunks.emplace_back(start, len);
+        start += len;
+    }
+    return chunks;
+}
+
+
+DeckBackupStore::DeckBackupStore(fs::path store_dir) : m_storeDir(std::move(store_dir))
+{
+    refresh();
+}
+
+void DeckBackupStore::refresh()
+{
+    std::error_code ec;
+    uint64_t index_size = fs::file_size(m_storeDir / "index", ec);
+    if (ec || index_size < m_indexSize)
+    {
+        // no index yet, or the store was removed since it was read
+        if (m_indexSize != 0)
+        {
+            m_snapshots.clear();
+            m_latest.clear();
+            m_indexSize = 0;
+        }
+        fs::create_directories(m_storeDir / "chunks");
+        fs::create_directories(m_storeDir / "snapshots");
+        if (ec)
+        {
+            return;
+        }
+    }
+    if (index_size == m_indexSize)
+    {
+        return;
+    }
+
+    std::ifstream index{m_storeDir / "index", std::ios::binary};
+    index.seekg(static_cast<std::streamoff>(m_indexSize));
+    std::string added(index_size - m_indexSize, '\0');
+    index.read(added.data(), static_cast<std::streamsize>(added.size()));
+    added.resize(static_cast<size_t>(index.gcount()));
+    // a line still being written is read once it is complete
+    size_t complete = added.rfind('\n') + 1;
+    std::istringstream lines{added.substr(0, complete)};
+    m_indexSize += complete;
+
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        std::istringstream iss{line};
+        BackupSnapshot snapshot{};
+        // snapshots this store added itself are already known
+        if (iss >> snapshot.id >> snapshot.time >> snapshot.size >> snapshot.mtime &&
+            (m_snapshots.empty() || snapshot.id > m_snapshots.back().id))
+        {
+            iss.get(); // the space before the file name
+            std::getline(iss, snapshot.deck_file);
+            m_latest[snapshot.deck_file] = m_snapshots.size();
+            m_snapshots.push_back(snapshot);
+        }
+    }
+}
+
+fs::path DeckBackupStore::storeDirFor(const fs::path &deck_dir)
+{
+    return deck_dir / ".backup";
+}
+
+fs::path DeckBackupStore::chunkPath(const std::string &hash) const
+{
+    return m_storeDir / "chunks" / hash.substr(0, 2) / hash;
+}
+
+uint64_t DeckBackupStore::snapshotFile(const fs::path &deck_file)
+{
+    std::error_code ec;
+    uint64_t size = fs::file_size(deck_file, ec);
+    if (ec)
+    {
+        return 0;
+    }
+    int64_t mtime = static_cast<int64_t>(fs::last_write_time(deck_file, ec).time_since_epoch().count());
+    std::string name = deck_file.filename().string();
+    refresh();
+
+    // unchanged files are recognised without reading them
+    BackupSnapshot latest{};
+    if (latestSnapshot(name, latest) && latest.size == size && latest.mtime == mtime)
+    {
+        return latest.id;
+    }
+
+    std::string contents{};
+    if (!readFileContents(deck_file, contents))
+    {
+        return 0;
+    }
+
+    std::ostringstream manifest;
+    for (const auto &[offset, len] : chunkBoundaries(contents))
+    {
+        std::string_view chunk{contents.data() + offset, len};
+        std::string hash = sha256Hex(chunk);
+        fs::path path = chunkPath(hash);
+        if (!fs::exists(path))
+        {
+            fs::create_directories(path.parent_path());
+            // write then rename so an interrupted backup never leaves a truncated chunk behind
+            fs::path tmp = path;
+            tmp += ".tmp";
+            std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            out.close();
+            if (!out)
+            {
+                fs::remove(tmp, ec);
+                return 0;
+            }
+            fs::rename(tmp, path);
+        }
+        manifest << hash << ' ' << len << '\n';
+    }
+
+    BackupSnapshot snapshot{};
+    snapshot.id = m_snapshots.empty() ? 1 : m_snapshots.back().id + 1;
+    snapshot.time = secondsSinceEpoch();
+    snapshot.size = contents.size();
+    snapshot.mtime = mtime;
+    snapshot.deck_file = name;
+
+    {
+        std::ofstream out{m_storeDir / "snapshots" / std::to_string(snapshot.id), std::ios::binary | std::ios::trunc};
+        out << manifest.str();
+        if (!out)
+        {
+            return 0;
+        }
+    }
+    // the index line is only added once the snapshot is complete
+    std::ofstream index{m_storeDir / "index", std::ios::binary | std::ios::app};
+    index << snapshot.id << ' ' << snapshot.time << ' ' << snapshot.size << ' ' << snapshot.mtime << ' '
+          << snapshot.deck_file << '\n';
+    if (!index)
+    {
+        return 0;
+    }
+
+    m_latest[name] = m_snapshots.size();
+    m_snapshots.push_back(snapshot);
+    return snapshot.id;
+}
+
+size_t DeckBackupStore::snapshotLibrary(const fs::path &deck_dir)
+{
+    size_t n_snapshots{0};
+    for (const fs::path &deck_file : listDeckFiles(deck_dir))
+    {
+        if (snapshotFile(deck_file) != 0)
+        {
+            n_snapshots++;
+        }
+    }
+    return n_snapshots;
+}
+
+std::vector<BackupSnapshot> DeckBackupStore::listSnapshots(const std::string &deck_file) const
+{
+    if (deck_file.empty())
+    {
+        return m_snapshots;
+    }
+    std::vector<BackupSnapshot> matching;
+    for (const BackupSnapshot &snapshot : m_snapshots)
+    {
+        if (snapshot.deck_file == deck_file)
+        {
+            matching.push_back(snapshot);
+        }
+    }
+    return matching;
+}
+
+bool DeckBackupStore::latestSnapshot(const std::string &deck_file, BackupSnapshot &snapshot) const
+{
+    auto found = m_latest.find(deck_file);
+    if (found == m_latest.end())
+    {
+        return false;
+    }
+    snapshot = m_snapshots[found->second];
+    return true;
+}
+
+bool DeckBackupStore::readSnapshot(uint64_t id, std::string &contents) const
+{
+    std::ifstream manifest{m_storeDir / "snapshots" / std::to_string(id)};
+    if (!manifest)
+    {
+        return false;
+    }
+    contents.clear();
+    std::string hash;
+    size_t len;
+    std::string chunk;
+    while (manifest >> hash >> len)
+    {
+        if (!readFileContents(chunkPath(hash), chunk) || chunk.size() != len)
+        {
+            return false;
+        }
+        contents.append(chunk);
+    }
+    return true;
+}
+
+bool DeckBackupStore::restoreSnapshot(uint64_t id, const fs::path &dest) const
+{
+    std::string contents{};
+    if (!readSnapshot(id, contents))
+    {
+        return false;
+    }
+    fs::path tmp = dest;
+    tmp += ".restore";
+    std::error_code ec;
+    std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+    out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    out.close();
+    if (!out)
+    {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    fs::rename(tmp, dest, ec);
+    return !ec;
+}
+
+size_t DeckBackupStore::chunkCount() const
+{
+    size_t n_chunks{0};
+    for (const auto &entry : fs::recursive_directory_iterator(m_storeDir / "chunks"))
+    {
+        if (entry.is_regular_file())
+        {
+            n_chunks++;
+        }
+    }
+    return n_chunks;
+}
+
+
+uint64_t backupDeckFile(const fs::path &deck_file)
+{
+    // one store per deck directory for the life of the program
+    static std::mutex stores_mutex;
+    static std::map<fs::path, DeckBackupStore> stores;
+    try
+    {
+        std::lock_guard<std::mutex> lock{stores_mutex};
+        fs::path store_dir = DeckBackupStore::storeDirFor(deck_file.parent_path());
+        auto found = stores.find(store_dir);
+        if (found == stores.end())
+        {
+            found = stores.emplace(store_dir, DeckBackupStore{store_dir}).first;
+        }
+        return found->second.snapshotFile(deck_file);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Failed to back up " << deck_file << ": " << e.what() << std::endl;
+        return 0;
+    }
+}
@@ -0,0 +1,185 @@
+/**
+ * @file deck_backup.h
+ * @author Green Alligators
+ * @brief Content-addressed incremental backups of deck files
+ * @details Deck files are split into chunks with content-defined chunking so that an edit only changes the chunks
+ * around it. Each chunk is stored once under its SHA-256 hash and a snapshot is just the list of chunk hashes
+ * that make up a file, so the store only grows by the chunks that actually changed.
+ *
+ * The store lives in a ".backup" directory inside the deck directory:
+ * - chunks/<first two hex digits>/<hash> holds the chunk contents
+ * - snapshots/<id> lists the "<hash> <length>" of each chunk of a snapshot in order
+ * - index has one "<id> <time> <size> <mtime> <filename>" line per snapshot
+ *
+ * @version 1.0.0
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef DECK_BACKUP_H
+#define DECK_BACKUP_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A recorded version of a single deck file
+ *
+ */
+struct BackupSnapshot
+{
+    /** unique, increasing snapshot number */
+    uint64_t id{};
+    /** seconds since the unix epoch when the snapshot was taken */
+    int64_t time{};
+    /** size of the file in bytes */
+    uint64_t size{};
+    /** the file's last write time when the snapshot was taken */
+    int64_t mtime{};
+    /** the name of the deck file (without its directory) */
+    std::string deck_file{};
+};
+
+/**
+ * @brief Split data into content-defined chunks
+ * @details Uses a gear rolling hash (as in FastCDC) to cut chunks where the content matches a pattern, so a
+ * change only moves the boundaries of the chunks near it. Chunks are between minChunkSize and maxChunkSize bytes
+ * and about avgChunkSize on average. The final chunk may be smaller than minChunkSize.
+ *
+ * @param data The data to split
+ * @return std::vector<std::pair<size_t, size_t>> (offset, length) of each chunk in order
+ */
+std::vector<std::pair<size_t, size_t>> chunkBoundaries(const std::string &data);
+
+/**
+ * @brief A content-addressed store of deck file snapshots
+ *
+ */
+class DeckBackupStore
+{
+public:
+    /** smallest chunk that will be cut, except at the end of a file */
+    static constexpr size_t minChunkSize{2 * 1024};
+    /** target average chunk size */
+    static constexpr size_t avgChunkSize{8 * 1024};
+    /** largest chunk that will be cut */
+    static constexpr size_t maxChunkSize{64 * 1024};
+
+    /**
+     * @brief Open (creating if needed) the store in a directory
+     *
+     * @param store_dir The directory holding the store
+     */
+    explicit DeckBackupStore(std::filesystem::path store_dir);
+
+    /**
+     * @brief The store directory used for the decks in a deck directory
+     *
+     * @param deck_dir The directory the deck files are in
+     * @return std::filesystem::path
+     */
+    static std::filesystem::path storeDirFor(const std::filesystem::path &deck_dir);
+
+    /**
+     * @brief Record a snapshot of a deck file
+     * @details If the file is unchanged since its latest snapshot (same size and last write time) nothing is read
+     * and the existing snapshot id is returned. Only chunks not already in the store are written. Snapshots added to
+     * the index by another store since it was last read are picked up first, so ids are never reused.
+     *
+     * @param deck_file The file to snapshot
+     * @return uint64_t The snapshot id, 0 if the file could not be read
+     */
+    uint64_t snapshotFile(const std::filesystem::path &deck_file);
+
+    /**
+     * @brief Snapshot every ".deck" file in a directory
+     *
+     * @param deck_dir The deck directory
+     * @return size_t The number of files snapshotted
+     */
+    size_t snapshotLibrary(const std::filesystem::path &deck_dir);
+
+    /**
+     * @brief List recorded snapshots, oldest first
+     *
+     * @param deck_file Only list snapshots of this file name, empty for all files
+     * @return std::vector<BackupSnapshot>
+     */
+    std::vector<BackupSnapshot> listSnapshots(const std::string &deck_file = "") const;
+
+    /**
+     * @brief Find the most recent snapshot of a file
+     *
+     * @param deck_file The file name
+     * @param snapshot Set to the snapshot if one exists
+     * @return true if the file has a snapshot
+     */
+    bool latestSnapshot(const std::string &deck_file, BackupSnapshot &snapshot) const;
+
+    /**
+     * @brief Write the contents of a snapshot to a file
+     * @details The contents are reassembled into a temporary file that then replaces dest, so dest is never
+     * left half written.
+     *
+     * @param id The snapshot to restore
+     * @param dest The file to write to
+     * @return true if the snapshot was restored
+     */
+    bool restoreSnapshot(uint64_t id, const std::filesystem::path &dest) const;
+
+    /**
+     * @brief Read the contents of a snapshot
+     *
+     * @param id The snapshot to read
+     * @param contents Set to the snapshot contents
+     * @return true if the snapshot exists and all its chunks were read
+     */
+    bool readSnapshot(uint64_t id, std::string &contents) const;
+
+    /**
+     * @brief The number of distinct chunks held by the store
+     *
+     * @return size_t
+     */
+    size_t chunkCount() const;
+
+private:
+    /**
+     * @brief The path a chunk is stored at
+     *
+     * @param hash The chunk's hash
+     * @return std::filesystem::path
+     */
+    std::filesystem::path chunkPath(const std::string &hash) const;
+
+    /**
+     * @brief Read the lines added to the index since it was last read
+     * @details The index is only ever appended to, so only its new bytes are parsed. A store that was removed or
+     * replaced is read again from the start.
+     *
+     */
+    void refresh();
+
+    std::filesystem::path m_storeDir;                 ///< Root directory of the store
+    std::vector<BackupSnapshot> m_snapshots;          ///< All snapshots from the index, oldest first
+    std::unordered_map<std::string, size_t> m_latest; ///< Position in m_snapshots of each file's latest snapshot
+    uint64_t m_indexSize{0};                          ///< Bytes of the index read so far
+};
+
+/**
+ * @brief Snapshot a deck file into the backup store of the directory it is in
+ * @details Errors are reported on std::cerr and otherwise ignored so that a failing backup never stops a save. The
+ * store of each directory is kept open between calls, so saving a deck does not read the whole index again.
+ *
+ * @param deck_file The deck file
+ * @return uint64_t The snapshot id, 0 on failure
+ */
+uint64_t backupDeckFile(const std::filesystem::path &deck_file);
+
+#endif // DECK_BACKUP_H
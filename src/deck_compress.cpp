@@ -0,0 +1,674 @@
+/**
+ * @file deck_compress.cpp
+ * @author Green Alligators
+ * @brief Compressed container for deck files
+ * @version 1.0.0
+ * @date 2024-10-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "deck_compress.h"
+#include "varint.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+constexpr std::string_view compressedDeckMagic{"\x89SDZ\r\n\x1A\n", 8};
+constexpr uint64_t containerVersion{1};
+
+enum BlockMethod : uint8_t
+{
+    STORED_BLOCK = 0,
+    LZ_BLOCK = 1,
+    LZ_HUFFMAN_BLOCK = 2
+};
+
+/*------LZ77------*/
+
+constexpr size_t minMatch{4};
+constexpr size_t maxOffset{65535};
+constexpr int lzHashBits{14};
+
+uint32_t read32(const char *p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t lzHash(uint32_t value)
+{
+    return (value * 2654435761U) >> (32 - lzHashBits);
+}
+
+// a length that does not fit in its 4 bits of the token continues in bytes of 255 and a final smaller byte
+void putLength(std::string &out, size_t length)
+{
+    for (length -= 15; length >= 255; length -= 255)
+    {
+        out.push_back(static_cast<char>(255));
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+void putSequence(std::string &out, std::string_view literals, size_t offset, size_t match_length)
+{
+    size_t match_code = match_length == 0 ? 0 : match_length - minMatch;
+    uint8_t token =
+        static_cast<uint8_t>((std::min<size_t>(literals.size(), 15) << 4) | std::min<size_t>(match_code, 15));
+    out.push_back(static_cast<char>(token));
+    if (literals.size() >= 15)
+    {
+        putLength(out, literals.size());
+    }
+    out.append(literals);
+    if (match_length == 0)
+    {
+        return;
+    }
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (match_code >= 15)
+    {
+        putLength(out, match_code);
+    }
+}
+
+// greedy LZ77 over a single block, the hash table keeps the latest position of each 4 byte sequence
+std::string lzCompress(std::string_view in)
+{
+    std::string out;
+    out.reserve(in.size() / 2 + 16);
+    std::vector<uint32_t> table(size_t{1} << lzHashBits, UINT32_MAX);
+    const char *data = in.data();
+    size_t n = in.size();
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + minMatch <= n)
+    {
+        uint32_t value = read32(data + i);
+        uint32_t &slot = table[lzHash(value)];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(i);
+        if (candidate == UINT32_MAX || i - candidate > maxOffset || read32(data + candidate) != value)
+        {
+            // step faster through data that is not matching
+            i += 1 + ((i - anchor) >> 6);
+            continue;
+        }
+
+        size_t length = minMatch;
+        while (i + length < n && data[candidate + length] == data[i + length])
+        {
+            length++;
+        }
+        while (i > anchor && candidate > 0 && data[i - 1] == data[candidate - 1])
+        {
+            i--;
+            candidate--;
+            length++;
+        }
+        putSequence(out, in.substr(anchor, i - anchor), i - candidate, length);
+        i += length;
+        anchor = i;
+        // index a position inside the match so that repeats of its end are found
+        if (i >= 2 && i - 2 + minMatch <= n)
+        {
+            table[lzHash(read32(data + i - 2))] = static_cast<uint32_t>(i - 2);
+        }
+    }
+    putSequence(out, in.substr(anchor), 0, 0);
+    return out;
+}
+
+bool getLength(std::string_view &in, size_t &length)
+{
+    uint8_t byte;
+    do
+    {
+        if (in.empty())
+        {
+            return false;
+        }
+        byte = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// decode into out[0, size), which must already be that size
+bool lzDecompress(std::string_view in, char *out, size_t size)
+{
+    size_t op = 0;
+    while (true)
+    {
+        if (in.empty())
+        {
+            return false;
+        }
+        uint8_t token = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !getLength(in, literals))
+        {
+            return false;
+        }
+        if (literals > in.size() || literals > size - op)
+        {
+            return false;
+        }
+        std::memcpy(out + op, in.data(), literals);
+        in.remove_prefix(literals);
+        op += literals;
+        if (op == size)
+        {
+            return in.empty();
+        }
+
+        if (in.size() < 2)
+        {
+            return false;
+        }
+        size_t offset = static_cast<uint8_t>(in[0]) | (static_cast<size_t>(static_cast<uint8_t>(in[1])) << 8);
+        in.remove_prefix(2);
+        size_t length = token & 0x0F;
+        if (length == 15 && !getLength(in, length))
+        {
+            return false;
+        }
+        length += minMatch;
+        if (offset == 0 || offset > op || length > size - op)
+        {
+            return false;
+        }
+        // matches may overlap the bytes they produce, which then repeat with period offset
+        const char *match = out + op - offset;
+        if (offset >= length)
+        {
+            std::memcpy(out + op, match, length);
+        }
+        else
+        {
+            for (size_t k = 0; k < length; ++k)
+            {
+                out[op + k] = match[k];
+            }
+        }
+        op += length;
+    }
+}
+
+/*------HUFFMAN------*/
+
+constexpr int maxCodeLength{11};
+
+// code lengths of a Huffman code for the byte frequencies, limited to maxCodeLength bits
+std::array<uint8_t, 256> huffmanLengths(std::array<uint64_t, 256> freq)
+{
+    std::array<uint8_t, 256> lengths{};
+    while (true)
+    {
+        // a leaf has no left child and keeps its symbol in right
+        struct Node
+        {
+            int left;
+            int right;
+        };
+        std::vector<Node> nodes;
+        using Entry = std::pair<uint64_t, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        for (int s = 0; s < 256; ++s)
+        {
+            if (freq[s] > 0)
+            {
+                heap.emplace(freq[s], static_cast<int>(nodes.size()));
+                nodes.push_back(Node{-1, s});
+            }
+        }
+        lengths.fill(0);
+        if (nodes.empty())
+        {
+            return lengths;
+        }
+        if (nodes.size() == 1)
+        {
+            lengths[nodes[0].right] = 1;
+            return lengths;
+        }
+        while (heap.size() > 1)
+        {
+            auto [w1, a] = heap.top();
+            heap.pop();
+            auto [w2, b] = heap.top();
+            heap.pop();
+            heap.emplace(w1 + w2, static_cast<int>(nodes.size()));
+            nodes.push_back(Node{a, b});
+        }
+
+        // walk down from the root to find the depth of each leaf
+        int max_length = 0;
+        std::vector<std::pair<int, int>> stack{{static_cast<int>(nodes.size()) - 1, 0}};
+        while (!stack.empty())
+        {
+            auto [node, depth] = stack.back();
+            stack.pop_back();
+            if (nodes[node].left < 0)
+            {
+                lengths[nodes[node].right] = static_cast<uint8_t>(depth);
+                max_length = (std::max)(max_length, depth);
+            }
+            else
+            {
+                stack.emplace_back(nodes[node].left, depth + 1);
+                stack.emplace_back(nodes[node].right, depth + 1);
+            }
+        }
+        if (max_length <= maxCodeLength)
+        {
+            return lengths;
+        }
+        // flatten the frequencies and try again, rare symbols then get shorter codes
+        for (uint64_t &f : freq)
+        {
+            if (f > 0)
+            {
+                f = (f >> 1) | 1;
+            }
+        }
+    }
+}
+
+// canonical codes for the lengths, bit reversed as they are written lowest bit first
+std::array<uint16_t, 256> huffmanCodes(const std::array<uint8_t, 256> &lengths)
+{
+    std::array<uint16_t, 256> codes{};
+    uint16_t code = 0;
+    for (int length = 1; length <= maxCodeLength; ++length)
+    {
+        for (int s = 0; s < 256; ++s)
+        {
+            if (lengths[s] == length)
+            {
+                uint16_t reversed = 0;
+                for (int b = 0; b < length; ++b)
+                {
+                    reversed |= static_cast<uint16_t>(((code >> b) & 1) << (length - 1 - b));
+                }
+                codes[s] = reversed;
+                code++;
+            }
+        }
+        code <<= 1;
+    }
+    return codes;
+}
+
+// the code lengths as 4 bit values, then the number of bytes, then the codes
+std::string huffmanEncode(std::string_view in)
+{
+    std::array<uint64_t, 256> freq{};
+    for (char c : in)
+    {
+        freq[static_cast<uint8_t>(c)]++;
+    }
+    std::array<uint8_t, 256> lengths = huffmanLengths(freq);
+    std::array<uint16_t, 256> codes = huffmanCodes(lengths);
+
+    std::string out;
+    out.reserve(128 + in.size());
+    for (int s = 0; s < 256; s += 2)
+    {
+        out.push_back(static_cast<char>(lengths[s] | (lengths[s + 1] << 4)));
+    }
+    putVarint(out, in.size());
+    uint64_t bits = 0;
+    int n_bits = 0;
+    for (char c : in)
+    {
+        uint8_t s = static_cast<uint8_t>(c);
+        bits |= static_cast<uint64_t>(codes[s]) << n_bits;
+        n_bits += lengths[s];
+        while (n_bits >= 8)
+        {
+            out.push_back(static_cast<char>(bits & 0xFF));
+            bits >>= 8;
+            n_bits -= 8;
+        }
+    }
+    if (n_bits > 0)
+    {
+        out.push_back(static_cast<char>(bits & 0xFF));
+    }
+    return out;
+}
+
+bool huffmanDecode(std::string_view in, std::string &out)
+{
+    if (in.size() < 128)
+    {
+        return false;
+    }
+    std::array<uint8_t, 256> lengths{};
+    for (int s = 0; s < 256; s += 2)
+    {
+        uint8_t packed = static_cast<uint8_t>(in[static_cast<size_t>(s / 2)]);
+        lengths[s] = packed & 0x0F;
+        lengths[s + 1] = packed >> 4;
+    }
+    in.remove_prefix(128);
+    uint64_t n_bytes{};
+    if (!getVarint(in, n_bytes) || n_bytes > 8 * in.size() + 8)
+    {
+        return false;
+    }
+
+    if (*std::max_element(lengths.begin(), lengths.end()) > maxCodeLength)
+    {
+        return false;
+    }
+    // every code fills the table entries that start with it, 0 marks bits no code starts with
+    std::array<uint16_t, 256> codes = huffmanCodes(lengths);
+    std::vector<uint16_t> table(size_t{1} << maxCodeLength, 0);
+    for (int s = 0; s < 256; ++s)
+    {
+        if (lengths[s] > 0)
+        {
+            for (size_t k = codes[s]; k < table.size(); k += size_t{1} << lengths[s])
+            {
+                table[k] = static_cast<uint16_t>((s << 4) | lengths[s]);
+            }
+        }
+    }
+
+    out.resize(static_cast<size_t>(n_bytes));
+    const uint8_t *ip = reinterpret_cast<const uint8_t *>(in.data());
+    const uint8_t *end = ip + in.size();
+    uint64_t bits = 0;
+    int n_bits = 0;
+    size_t i = 0;
+    while (i < out.size())
+    {
+        // top the bit buffer up to at least 56 bits, a whole word at a time away from the end of the data
+        if (std::endian::native == std::endian::little && end - ip >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, ip, sizeof(word));
+            bits |= word << n_bits;
+            ip += (63 - n_bits) >> 3;
+            n_bits |= 56;
+        }
+        else
+        {
+            // bits past the end read as zero, running out is caught by the check after the loop
+            while (n_bits <= 56)
+            {
+                bits |= static_cast<uint64_t>(ip < end ? *ip : 0) << n_bits;
+                ip++;
+                n_bits += 8;
+            }
+        }
+        // 56 bits always hold 5 codes
+        for (int k = 0; k < 56 / maxCodeLength && i < out.size(); ++k)
+        {
+            uint16_t entry = table[bits & ((1U << maxCodeLength) - 1)];
+            int length = entry & 0x0F;
+            if (length == 0)
+            {
+                return false;
+            }
+            out[i++] = static_cast<char>(entry >> 4);
+            bits >>= length;
+            n_bits -= length;
+        }
+    }
+    // the bits loaded but not used must not reach past the end of the data
+    return ip <= end || static_cast<size_t>(ip - end) <= static_cast<size_t>(n_bits / 8);
+}
+
+/*------BLOCKS------*/
+
+struct BlockEntry
+{
+    uint8_t method{};
+    uint64_t compressed_size{};
+    size_t data_offset{};
+};
+
+bool decompressBlock(uint8_t method, std::string_view data, char *out, size_t size)
+{
+    switch (method)
+    {
+    case STORED_BLOCK:
+        if (data.size() != size)
+        {
+            return false;
+        }
+        std::memcpy(out, data.data(), size);
+        return true;
+    case LZ_BLOCK:
+        return lzDecompress(data, out, size);
+    case LZ_HUFFMAN_BLOCK: {
+        std::string lz;
+        return huffmanDecode(data, lz) && lzDecompress(lz, out, size);
+    }
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief The most text a block's compressed bytes can hold
+ * @details An LZ sequence of n bytes produces at most 255 n bytes, each length byte adding at most 255, and Huffman
+ * codes are at least one bit. A table entry that claims more text is damaged, which is caught before the text is
+ * allocated.
+ */
+uint64_t maxBlockTextSize(uint8_t method, uint64_t compressed_size)
+{
+    switch (method)
+    {
+    case STORED_BLOCK:
+        return compressed_size;
+    case LZ_BLOCK:
+        return 255 * compressed_size;
+    case LZ_HUFFMAN_BLOCK:
+        return 255 * (8 * compressed_size + 8);
+    default:
+        return 0;
+    }
+}
+
+struct ContainerHeader
+{
+    uint64_t block_size{};
+    uint64_t text_size{};
+    uint64_t n_blocks{};
+};
+
+bool validHeader(uint64_t version, const ContainerHeader &header)
+{
+    return version == containerVersion && header.block_size > 0 && header.block_size <= 16 * deckBlockSize &&
+           header.n_blocks == (header.text_size + header.block_size - 1) / header.block_size;
+}
+
+size_t blockTextSize(const ContainerHeader &header, uint64_t block)
+{
+    return static_cast<size_t>((std::min)(header.block_size, header.text_size - block * header.block_size));
+}
+} // namespace
+
+
+bool isCompressedDeck(std::string_view data)
+{
+    return data.starts_with(compressedDeckMagic);
+}
+
+std::string compressDeckText(std::string_view text)
+{
+    size_t n_blocks = (text.size() + deckBlockSize - 1) / deckBlockSize;
+    std::string table;
+    std::string blocks;
+    for (size_t b = 0; b < n_blocks; ++b)
+    {
+        std::string_view block = text.substr(b * deckBlockSize, deckBlockSize);
+        std::string lz = lzCompress(block);
+        std::string huffman = huffmanEncode(lz);
+
+        uint8_t method = STORED_BLOCK;
+        std::string_view best = block;
+        if (lz.size() < best.size())
+        {
+            method = LZ_BLOCK;
+            best = lz;
+        }
+        if (huffman.size() < best.size())
+        {
+            method = LZ_HUFFMAN_BLOCK;
+            best = huffman;
+        }
+        table.push_back(static_cast<char>(method));
+        putVarint(table, best.size());
+        blocks.append(best);
+    }
+
+    std::string out{compressedDeckMagic};
+    putVarint(out, containerVersion);
+    putVarint(out, deckBlockSize);
+    putVarint(out, text.size());
+    putVarint(out, n_blocks);
+    out.append(table);
+    out.append(blocks);
+    return out;
+}
+
+bool decompressDeckText(std::string_view data, std::string &text, unsigned int n_threads)
+{
+    if (!isCompressedDeck(data))
+    {
+        return false;
+    }
+    data.remove_prefix(compressedDeckMagic.size());
+    uint64_t version{};
+    ContainerHeader header{};
+    if (!getVarint(data, version) || !getVarint(data, header.block_size) || !getVarint(data, header.text_size) ||
+        !getVarint(data, header.n_blocks) || !validHeader(version, header) || header.n_blocks > data.size())
+    {
+        return false;
+    }
+
+    std::vector<BlockEntry> entries(static_cast<size_t>(header.n_blocks));
+    for (BlockEntry &entry : entries)
+    {
+        if (data.empty())
+        {
+            return false;
+        }
+        entry.method = static_cast<uint8_t>(data.front());
+        data.remove_prefix(1);
+        if (!getVarint(data, entry.compressed_size))
+        {
+            return false;
+        }
+    }
+    size_t offset = 0;
+    for (size_t b = 0; b < entries.size(); ++b)
+    {
+        BlockEntry &entry = entries[b];
+        // the table must account for all of the text before it is allocated
+        uint64_t block_text = blockTextSize(header, b);
+        if (entry.compressed_size > data.size() - offset ||
+            (entry.method == STORED_BLOCK && entry.compressed_size != block_text) ||
+            block_text > maxBlockTextSize(entry.method, entry.compressed_size))
+        {
+            return false;
+        }
+        entry.data_offset = offset;
+        offset += static_cast<size_t>(entry.compressed_size);
+    }
+
+    text.resize(static_cast<size_t>(header.text_size));
+    std::atomic<size_t> next{0};
+    std::atomic<bool> ok{true};
+    auto worker = [&]() {
+        size_t b;
+        while (ok && (b = next.fetch_add(1)) < entries.size())
+        {
+            const BlockEntry &entry = entries[b];
+            std::string_view block = data.substr(entry.data_offset, static_cast<size_t>(entry.compressed_size));
+            if (!decompressBlock(entry.method, block, text.data() + b * header.block_size, blockTextSize(header, b)))
+            {
+                ok = false;
+            }
+        }
+    };
+
+    if (n_threads == 0)
+    {
+        n_threads = (std::max)(1U, std::thread::hardware_concurrency());
+    }
+    size_t n_workers = std::min<size_t>(n_threads, entries.size());
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < n_workers; ++t)
+    {
+        workers.emplace_back(worker);
+    }
+    // the calling thread decompresses blocks too
+    worker();
+    for (std::thread &t : workers)
+    {
+        t.join();
+    }
+    return ok;
+}
+
+bool streamCompressedDeck(std::istream &in, const std::function<void(std::string_view)> &on_block)
+{
+    uint64_t version{};
+    ContainerHeader header{};
+    if (!getVarint(in, version) || !getVarint(in, header.block_size) || !getVarint(in, header.text_size) ||
+        !getVarint(in, header.n_blocks) || !validHeader(version, header))
+    {
+        return false;
+    }
+
+    // the table is small, read it before any block
+    std::vector<BlockEntry> entries;
+    for (uint64_t b = 0; b < header.n_blocks; ++b)
+    {
+        BlockEntry entry{};
+        int method = in.get();
+        if (method == std::char_traits<char>::eof() || !getVarint(in, entry.compressed_size) ||
+            entry.compressed_size > header.block_size ||
+            blockTextSize(header, b) > maxBlockTextSize(static_cast<uint8_t>(method), entry.compressed_size))
+        {
+            return false;
+        }
+        entry.method = static_cast<uint8_t>(method);
+        entries.push_back(entry);
+    }
+
+    std::string compressed;
+    std::string text;
+    for (size_t b = 0; b < entries.size(); ++b)
+    {
+        compressed.resize(static_cast<size_t>(entries[b].compressed_size));
+        text.resize(blockTextSize(header, b));
+        if (!in.read(compressed.data(), static_cast<std::streamsize>(compressed.size())) ||
+            !decompressBlock(entries[b].method, compressed, text.data(), text.size()))
+        {
+            return false;
+        }
+        on_block(text);
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file deck_compress.h
+ * @author Green Alligators
+ * @brief Compressed container for deck files
+ * @details A compressed deck is still a ".deck" file, recognised by the 8 byte magic string at its start, which a
+ * text deck can never begin with since its first byte is not valid UTF-8. The deck text is cut into blocks of
+ * deckBlockSize bytes that are compressed independently, so they can be decompressed in parallel or one at a time
+ * straight into a DeckTextParser. The container is:
+ *
+ * - magic: "\x89SDZ\r\n\x1A\n"
+ * - format version, block size, text size and number of blocks: varints
+ * - for each block, its method byte and its compressed size as a varint
+ * - the compressed blocks, one after another
+ *
+ * A block is stored as is, compressed with an LZ77 codec in the style of LZ4, or LZ77 compressed and then Huffman
+ * coded, whichever is smallest. The LZ77 sequences are a token byte holding 4 bits of literal length and 4 bits of
+ * match length (extended by further bytes while they are 255), the literals, then a 2 byte offset and any further
+ * match length bytes. A block ends with a sequence of literals only.
+ *
+ * @version 1.0.0
+ * @date 2024-10-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef DECK_COMPRESS_H
+#define DECK_COMPRESS_H
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+
+/** The number of bytes of deck text in each compressed block, except the last */
+constexpr size_t deckBlockSize{64 * 1024};
+
+/**
+ * @brief Check whether data starts with the compressed deck magic string
+ *
+ * @param data The start of a deck file, at least the first 8 bytes
+ * @return true if the data is a compressed deck
+ */
+bool isCompressedDeck(std::string_view data);
+
+/**
+ * @brief Compress the text of a deck into a compressed deck container
+ *
+ * @param text The deck text
+ * @return std::string The container
+ */
+std::string compressDeckText(std::string_view text);
+
+/**
+ * @brief Decompress a whole compressed deck container
+ * @details Blocks are independent so they are decompressed by several threads at once.
+ *
+ * @param data The container, starting with the magic string
+ * @param text Set to the deck text
+ * @param n_threads Number of threads to use, 0 picks one per hardware thread
+ * @return true if the container was complete and valid
+ */
+bool decompressDeckText(std::string_view data, std::string &text, unsigned int n_threads = 0);
+
+/**
+ * @brief Decompress a compressed deck from a stream one block at a time
+ * @details Only one compressed and one decompressed block are held in memory.
+ *
+ * @param in The stream, positioned just after the magic string
+ * @param on_block Called with the text of each block in order
+ * @return true if every block was read and decompressed
+ */
+bool streamCompressedDeck(std::istream &in, const std::function<void(std::string_view)> &on_block);
+
+#endif // DECK_COMPRESS_H
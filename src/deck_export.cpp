@@ -0,0 +1,531 @@
+/**
+ * @file deck_export.cpp
+ * @author Green Alligators
+ * @brief Streaming exporters that write flashcard decks to other formats
+ * @version 1.0.0
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "deck_export.h"
+#include "deck_format.h"
+
+
+bool strToExportFormat(const std::string &formatStr, ExportFormat &format)
+{
+    std::string lower = formatStr;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "native" || lower == "deck")
+    {
+        format = ExportFormat::NATIVE;
+    }
+    else if (lower == "json")
+    {
+        format = ExportFormat::JSON;
+    }
+    else if (lower == "tsv")
+    {
+        format = ExportFormat::TSV;
+    }
+    else if (lower == "anki")
+    {
+        format = ExportFormat::ANKI;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+std::string exportFormatExtension(ExportFormat format)
+{
+    switch (format)
+    {
+    case ExportFormat::JSON:
+        return ".json";
+    case ExportFormat::TSV:
+        return ".tsv";
+    case ExportFormat::ANKI:
+        return ".txt";
+    default:
+        return ".deck";
+    }
+}
+
+
+/*------DECK EXPORTER------*/
+
+DeckExporter::DeckExporter(std::ostream &out) : m_out(out)
+{
+    m_buffer.reserve(bufferLimit);
+}
+
+void DeckExporter::beginLibrary()
+{
+}
+
+void DeckExporter::writeDeckTags(const std::vector<std::string> & /*tags*/)
+{
+}
+
+void DeckExporter::endDeck()
+{
+}
+
+void DeckExporter::endLibrary()
+{
+    flush();
+}
+
+void DeckExporter::flush()
+{
+    if (!m_buffer.empty())
+    {
+        m_out.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_buffer.clear();
+    }
+    m_out.flush();
+}
+
+uint64_t DeckExporter::bytesWritten() const
+{
+    return m_written;
+}
+
+void DeckExporter::write(const std::string &text)
+{
+    m_written += text.size();
+    if (m_buffer.size() + text.size() > bufferLimit)
+    {
+        flush();
+    }
+    // text larger than the buffer is passed straight through
+    if (text.size() > bufferLimit)
+    {
+        m_out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        return;
+    }
+    m_buffer.append(text);
+}
+
+void DeckExporter::write(char c)
+{
+    m_written++;
+    if (m_buffer.size() >= bufferLimit)
+    {
+        flush();
+    }
+    m_buffer.push_back(c);
+}
+
+
+/*------NATIVE------*/
+
+NativeDeckExporter::NativeDeckExporter(std::ostream &out, std::vector<CardSlot> *card_slots, size_t card_padding)
+    : DeckExporter(out), m_cardSlots(card_slots), m_cardPadding(card_padding)
+{
+}
+
+void NativeDeckExporter::beginDeck(const std::string &name)
+{
+    write(name);
+    write("\nV: " + std::to_string(deckFormatVersion) + "\n");
+}
+
+void NativeDeckExporter::writeDeckTags(const std::vector<std::string> &tags)
+{
+    if (!tags.empty())
+    {
+        write("DT: " + tagListToStr(tags));
+        write('\n');
+    }
+}
+
+void NativeDeckExporter::writeCard(const FlashCard &card)
+{
+    std::string text = card.stringCardAsTemplate();
+    if (m_cardPadding > 0)
+    {
+        padCardText(text, text.size() + m_cardPadding);
+    }
+    if (m_cardSlots != nullptr)
+    {
+        m_cardSlots->push_back(CardSlot{bytesWritten(), text.size()});
+    }
+    write(text);
+}
+
+
+/*------JSON------*/
+
+void JsonDeckExporter::beginLibrary()
+{
+    m_firstDeck = true;
+    write('[');
+}
+
+void JsonDeckExporter::beginDeck(const std::string &name)
+{
+    if (!m_firstDeck)
+    {
+        write(',');
+    }
+    m_firstDeck = false;
+    m_firstCard = true;
+    m_cardsOpen = false;
+    m_deckTags.clear();
+    write("\n{\"name\":");
+    writeJsonString(name);
+}
+
+void JsonDeckExporter::writeDeckTags(const std::vector<std::string> &tags)
+{
+    mergeTagList(m_deckTags, tags);
+}
+
+void JsonDeckExporter::openCards()
+{
+    if (!m_cardsOpen)
+    {
+        write(",\"cards\":[");
+        m_cardsOpen = true;
+    }
+}
+
+void JsonDeckExporter::writeCard(const FlashCard &card)
+{
+    openCards();
+    if (!m_firstCard)
+    {
+        write(',');
+    }
+    m_firstCard = false;
+    write("\n{\"question\":");
+    writeJsonString(card.question);
+    write(",\"answer\":");
+    writeJsonString(card.answer);
+    write(",\"difficulty\":\"" + cardDifficultyToStr(card.difficulty) + "\"");
+    write(",\"n_times_answered\":" + std::to_string(card.n_times_answered));
+    if (!card.tags.empty())
+    {
+        write(",\"tags\":");
+        writeJsonTags(card.tags);
+    }
+    write('}');
+}
+
+void JsonDeckExporter::endDeck()
+{
+    openCards();
+    write(']');
+    if (!m_deckTags.empty())
+    {
+        write(",\"tags\":");
+        writeJsonTags(m_deckTags);
+    }
+    write('}');
+}
+
+void JsonDeckExporter::writeJsonTags(const std::vector<std::string> &tags)
+{
+    write('[');
+    for (size_t i = 0; i < tags.size(); ++i)
+    {
+        if (i > 0)
+        {
+            write(',');
+        }
+        writeJsonString(tags[i]);
+    }
+    write(']');
+}
+
+void JsonDeckExporter::endLibrary()
+{
+    write("\n]\n");
+    DeckExporter::endLibrary();
+}
+
+void JsonDeckExporter::writeJsonString(const std::string &text)
+{
+    static const char hex[] = "0123456789abcdef";
+    write('"');
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            write("\\\"");
+            break;
+        case '\\':
+            write("\\\\");
+            break;
+        case '\n':
+            write("\\n");
+            break;
+        case '\r':
+            write("\\r");
+            break;
+        case '\t':
+            write("\\t");
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                write("\\u00");
+                write(hex[(c >> 4) & 0xF]);
+                write(hex[c & 0xF]);
+            }
+            else
+            {
+                // UTF-8 sequences are valid in JSON strings so are copied as is
+                write(c);
+            }
+        }
+    }
+    write('"');
+}
+
+
+/*------TSV------*/
+
+void TsvDeckExporter::beginLibrary()
+{
+    write("deck\tquestion\tanswer\tdifficulty\tn_times_answered\n");
+}
+
+void TsvDeckExporter::beginDeck(const std::string &name)
+{
+    m_deckName = name;
+}
+
+void TsvDeckExporter::writeCard(const FlashCard &card)
+{
+    writeTsvField(m_deckName);
+    write('\t');
+    writeTsvField(card.question);
+    write('\t');
+    writeTsvField(card.answer);
+    write('\t');
+    write(cardDifficultyToStr(card.difficulty));
+    write('\t');
+    write(std::to_string(card.n_times_answered));
+    write('\n');
+}
+
+void TsvDeckExporter::writeTsvField(const std::string &text)
+{
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '\t':
+            write("\\t");
+            break;
+        case '\n':
+            write("\\n");
+            break;
+        case '\r':
+            write("\\r");
+            break;
+        case '\\':
+            write("\\\\");
+            break;
+        default:
+            write(c);
+        }
+    }
+}
+
+
+/*------ANKI------*/
+
+void AnkiDeckExporter::beginLibrary()
+{
+    write("#separator:tab\n#html:false\n#deck column:3\n#tags column:4\n");
+}
+
+void AnkiDeckExporter::beginDeck(const std::string &name)
+{
+    m_deckName = name;
+    m_deckTags.clear();
+    m_cards.clear();
+}
+
+void AnkiDeckExporter::writeDeckTags(const std::vector<std::string> &tags)
+{
+    mergeTagList(m_deckTags, tags);
+}
+
+void AnkiDeckExporter::writeCard(const FlashCard &card)
+{
+    m_cards.push_back(card);
+}
+
+void AnkiDeckExporter::endDeck()
+{
+    for (const FlashCard &card : m_cards)
+    {
+        writeAnkiRow(card);
+    }
+    m_cards.clear();
+}
+
+void AnkiDeckExporter::writeAnkiRow(const FlashCard &card)
+{
+    writeAnkiField(card.question);
+    write('\t');
+    writeAnkiField(card.answer);
+    write('\t');
+    writeAnkiField(m_deckName);
+    write('\t');
+    // Anki tags are space separated so the difficulty makes a single tag
+    write("difficulty::" + cardDifficultyToStr(card.difficulty));
+    for (const std::string &tag : m_deckTags)
+    {
+        writeAnkiTag(tag);
+    }
+    for (const std::string &tag : card.tags)
+    {
+        writeAnkiTag(tag);
+    }
+    write('\n');
+}
+
+void AnkiDeckExporter::writeAnkiTag(const std::string &tag)
+{
+    write(' ');
+    for (char c : tag)
+    {
+        // the tags column is a single field so it cannot hold tabs or quotes either
+        write(c == ' ' || c == '\t' || c == '"' ? '_' : c);
+    }
+}
+
+void AnkiDeckExporter::writeAnkiField(const std::string &text)
+{
+    if (text.find_first_of("\t\n\r\"") == std::string::npos)
+    {
+        write(text);
+        return;
+    }
+    write('"');
+    for (char c : text)
+    {
+        if (c == '"')
+        {
+            write('"');
+        }
+        write(c);
+    }
+    write('"');
+}
+
+
+/*------EXPORT FUNCTIONS------*/
+
+std::unique_ptr<DeckExporter> createDeckExporter(ExportFormat format, std::ostream &out)
+{
+    switch (format)
+    {
+    case ExportFormat::JSON:
+        return std::make_unique<JsonDeckExporter>(out);
+    case ExportFormat::TSV:
+        return std::make_unique<TsvDeckExporter>(out);
+    case ExportFormat::ANKI:
+        return std::make_unique<AnkiDeckExporter>(out);
+    default:
+        return std::make_unique<NativeDeckExporter>(out);
+    }
+}
+
+// writes a single deck without the library begin/end calls
+static void writeDeck(const FlashCardDeck &deck, DeckExporter &exporter)
+{
+    exporter.beginDeck(deck.name);
+    exporter.writeDeckTags(deck.tags);
+    for (const FlashCard &card : deck.cards)
+    {
+        exporter.writeCard(card);
+    }
+    exporter.endDeck();
+}
+
+void exportDeck(const FlashCardDeck &deck, DeckExporter &exporter)
+{
+    exporter.beginLibrary();
+    writeDeck(deck, exporter);
+    exporter.endLibrary();
+}
+
+void exportDecks(const std::vector<FlashCardDeck> &decks, DeckExporter &exporter)
+{
+    exporter.beginLibrary();
+    for (const FlashCardDeck &deck : decks)
+    {
+        writeDeck(deck, exporter);
+    }
+    exporter.endLibrary();
+}
+
+bool exportDeckFile(const fs::path &deck_file, DeckExporter &exporter)
+{
+    // binary, as a compressed deck must be read byte for byte
+    std::ifstream inf{deck_file, std::ios::binary};
+    if (!inf)
+    {
+        return false;
+    }
+
+    bool named = false;
+    streamFlashCardDeck(
+        inf,
+        [&](const std::string &name) {
+            exporter.beginDeck(name);
+            named = true;
+        },
+        [&](FlashCard &card) { exporter.writeCard(card); },
+        [&](std::vector<std::string> &tags) { exporter.writeDeckTags(tags); });
+
+    // an empty file still counts as a deck with no name and no cards
+    if (!named)
+    {
+        exporter.beginDeck("");
+    }
+    exporter.endDeck();
+    return true;
+}
+
+size_t exportLibrary(const fs::path &deck_dir_path, DeckExporter &exporter)
+{
+    if (!fs::is_directory(deck_dir_path))
+    {
+        std::cerr << "Directory does not exist, or is not a directory";
+        throw 0;
+    }
+
+    // sort so that exports of the same library are reproducible
+    std::vector<fs::path> deck_files;
+    for (const auto &entry : fs::directory_iterator(deck_dir_path))
+    {
+        if (entry.is_regular_file() && entry.path().string().ends_with(".deck"))
+        {
+            deck_files.push_back(entry.path());
+        }
+    }
+    std::sort(deck_files.begin(), deck_files.end());
+
+    size_t n_exported{0};
+    exporter.beginLibrary();
+    for (const fs::path &deck_file : deck_files)
+    {
+        if (exportDeckFile(deck_file, exporter))
+        {
+            n_exported++;
+        }
+    }
+    exporter.endLibrary();
+    return n_exported;
+}
@@ -0,0 +1,344 @@
+/**
+ * @file deck_export.h
+ * @author Green Alligators
+ * @brief Streaming exporters that write flashcard decks to other formats
+ * @details Exporters receive a deck one card at a time, either from a loaded FlashCardDeck or directly from
+ * streamFlashCardDeck, and write to an output stream through a fixed size buffer. Exporting a whole library
+ * therefore only ever holds a single card in memory.
+ *
+ * Supported formats are the native deck template, JSON, TSV and Anki's plain text import format.
+ *
+ * @version 1.0.0
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef DECK_EXPORT_H
+#define DECK_EXPORT_H
+
+#include "deck.h"
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The file formats decks can be exported to
+ *
+ */
+enum class ExportFormat
+{
+    NATIVE,
+    JSON,
+    TSV,
+    ANKI
+};
+
+/**
+ * @brief Converts a format name ("native", "json", "tsv" or "anki") to an ExportFormat
+ *
+ * @param formatStr The name of the format, case insensitive
+ * @param format Set to the matching format when the name is recognised
+ * @return true if the name was recognised
+ */
+bool strToExportFormat(const std::string &formatStr, ExportFormat &format);
+
+/**
+ * @brief The file extension conventionally used for an export format, including the leading '.'
+ *
+ * @param format The export format
+ * @return std::string
+ */
+std::string exportFormatExtension(ExportFormat format);
+
+/**
+ * @brief Base class for streaming deck writers
+ * @details Output is accumulated in an internal buffer that is written to the stream whenever it grows past
+ * bufferLimit, so the memory used is bounded no matter how many cards are exported.
+ * Calls are made in the order beginLibrary, then for each deck beginDeck, writeDeckTags, writeCard..., endDeck and
+ * finally endLibrary.
+ */
+class DeckExporter
+{
+public:
+    /**
+     * @brief Construct a new Deck Exporter object
+     *
+     * @param out The stream to write the exported decks to
+     */
+    explicit DeckExporter(std::ostream &out);
+
+    virtual ~DeckExporter() = default;
+
+    /**
+     * @brief Called once before the first deck is written
+     *
+     */
+    virtual void beginLibrary();
+
+    /**
+     * @brief Called at the start of each deck
+     *
+     * @param name The name of the deck
+     */
+    virtual void beginDeck(const std::string &name) = 0;
+
+    /**
+     * @brief Called after beginDeck with the tags of the deck
+     * @details A deck file can have several deck tag lines, also between its cards, and this is called for each of
+     * them; the deck's tags are all of them together (see mergeTagList).
+     *
+     * @param tags Some of the deck's tags, may be empty
+     */
+    virtual void writeDeckTags(const std::vector<std::string> &tags);
+
+    /**
+     * @brief Called for every card of the current deck
+     *
+     * @param card The card to write
+     */
+    virtual void writeCard(const FlashCard &card) = 0;
+
+    /**
+     * @brief Called after the last card of the current deck
+     *
+     */
+    virtual void endDeck();
+
+    /**
+     * @brief Called once after the last deck, flushes any buffered output
+     *
+     */
+    virtual void endLibrary();
+
+    /**
+     * @brief Write any buffered output to the stream
+     *
+     */
+    void flush();
+
+    /**
+     * @brief The number of bytes written so far, including any still in the buffer
+     *
+     * @return uint64_t
+     */
+    uint64_t bytesWritten() const;
+
+protected:
+    /**
+     * @brief Append text to the output buffer, flushing it if it is full
+     *
+     * @param text The text to append
+     */
+    void write(const std::string &text);
+
+    /**
+     * @brief Append a single character to the output buffer, flushing it if it is full
+     *
+     * @param c The character to append
+     */
+    void write(char c);
+
+    /** the size in bytes the buffer may grow to before being written out */
+    static constexpr size_t bufferLimit{64 * 1024};
+
+private:
+    std::ostream &m_out;   ///< The stream being written to
+    std::string m_buffer;  ///< Output waiting to be written
+    uint64_t m_written{0}; ///< Bytes passed to write so far
+};
+
+/**
+ * @brief Writes decks in the native deck file template format
+ * @details A deck is written as its name and a "V: " format version line followed by each card as a Q/A/D/N block,
+ * the same as writeFlashCardDeck.
+ */
+class NativeDeckExporter : public DeckExporter
+{
+public:
+    /**
+     * @brief Construct a new Native Deck Exporter object
+     *
+     * @param out The stream to write the exported decks to
+     * @param card_slots If not null, the slot of each card written is appended to it, offsets are from the start
+     * of the output
+     * @param card_padding Bytes of padding to add to every card's slot
+     */
+    explicit NativeDeckExporter(std::ostream &out,
+                                std::vector<CardSlot> *card_slots = nullptr,
+                                size_t card_padding = 0);
+    void beginDeck(const std::string &name) override;
+    void writeDeckTags(const std::vector<std::string> &tags) override;
+    void writeCard(const FlashCard &card) override;
+
+private:
+    std::vector<CardSlot> *m_cardSlots; ///< Where card slots are recorded, may be null
+    size_t m_cardPadding;               ///< Padding added to each card
+};
+
+/**
+ * @brief Writes decks as a JSON array of deck objects
+ * @details Each deck is written as {"name": ..., "cards": [{"question", "answer", "difficulty",
+ * "n_times_answered", "tags"}, ...], "tags": [...]}. Tags are only written when there are some. The deck's tags come
+ * last so that tags found between its cards are still written once with the others.
+ */
+class JsonDeckExporter : public DeckExporter
+{
+public:
+    using DeckExporter::DeckExporter;
+    void beginLibrary() override;
+    void beginDeck(const std::string &name) override;
+    void writeDeckTags(const std::vector<std::string> &tags) override;
+    void writeCard(const FlashCard &card) override;
+    void endDeck() override;
+    void endLibrary() override;
+
+private:
+    /**
+     * @brief Write a string as a quoted JSON string literal
+     *
+     * @param text The raw text
+     */
+    void writeJsonString(const std::string &text);
+
+    /**
+     * @brief Write a list of tags as a JSON array of strings
+     *
+     * @param tags The tags
+     */
+    void writeJsonTags(const std::vector<std::string> &tags);
+
+    /**
+     * @brief Open the deck's "cards" array if it has not been opened yet
+     *
+     */
+    void openCards();
+
+    bool m_firstDeck = true;               ///< No separator is needed before the first deck
+    bool m_firstCard = true;               ///< No separator is needed before the first card of a deck
+    bool m_cardsOpen = false;              ///< The "cards" array of the current deck has been started
+    std::vector<std::string> m_deckTags{}; ///< Tags of the deck currently being written
+};
+
+/**
+ * @brief Writes decks as tab separated values
+ * @details A header row is followed by one row per card with the columns deck, question, answer, difficulty and
+ * n_times_answered. Tabs, newlines and backslashes in text are escaped as \\t, \\n and \\\\.
+ */
+class TsvDeckExporter : public DeckExporter
+{
+public:
+    using DeckExporter::DeckExporter;
+    void beginLibrary() override;
+    void beginDeck(const std::string &name) override;
+    void writeCard(const FlashCard &card) override;
+
+private:
+    /**
+     * @brief Write a field with tab, newline and backslash characters escaped
+     *
+     * @param text The raw text
+     */
+    void writeTsvField(const std::string &text);
+
+    std::string m_deckName{}; ///< Name of the deck currently being written
+};
+
+/**
+ * @brief Writes decks in Anki's plain text import format
+ * @details The file starts with Anki's header lines declaring a tab separator, plain text fields and the deck
+ * column. Each card is a row of front, back, deck and tags, where the tags are the card difficulty followed by the
+ * deck's and the card's own tags.
+ * Fields containing tabs, newlines or quotes are quoted with embedded quotes doubled. Every row carries all of the
+ * deck's tags, so a deck's cards are held until the deck ends, in case more deck tags follow them.
+ */
+class AnkiDeckExporter : public DeckExporter
+{
+public:
+    using DeckExporter::DeckExporter;
+    void beginLibrary() override;
+    void beginDeck(const std::string &name) override;
+    void writeDeckTags(const std::vector<std::string> &tags) override;
+    void writeCard(const FlashCard &card) override;
+    void endDeck() override;
+
+private:
+    /**
+     * @brief Write a card's row with the deck's tags
+     *
+     * @param card The card
+     */
+    void writeAnkiRow(const FlashCard &card);
+
+    /**
+     * @brief Write a field, quoting it if needed
+     *
+     * @param text The raw text
+     */
+    void writeAnkiField(const std::string &text);
+
+    /**
+     * @brief Write a tag, replacing the spaces Anki uses as a separator
+     *
+     * @param tag The tag
+     */
+    void writeAnkiTag(const std::string &tag);
+
+    std::string m_deckName{};              ///< Name of the deck currently being written
+    std::vector<std::string> m_deckTags{}; ///< Tags of the deck currently being written
+    std::vector<FlashCard> m_cards{};      ///< Cards of the deck currently being written, until it ends
+};
+
+/**
+ * @brief Create an exporter for the given format
+ *
+ * @param format The format to export to
+ * @param out The stream the exporter will write to
+ * @return std::unique_ptr<DeckExporter>
+ */
+std::unique_ptr<DeckExporter> createDeckExporter(ExportFormat format, std::ostream &out);
+
+/**
+ * @brief Export an already loaded deck
+ * @details Calls the complete beginLibrary ... endLibrary sequence on the exporter.
+ *
+ * @param deck The deck to export
+ * @param exporter The exporter to write with
+ */
+void exportDeck(const FlashCardDeck &deck, DeckExporter &exporter);
+
+/**
+ * @brief Export several already loaded decks into a single output
+ *
+ * @param decks The decks to export
+ * @param exporter The exporter to write with
+ */
+void exportDecks(const std::vector<FlashCardDeck> &decks, DeckExporter &exporter);
+
+/**
+ * @brief Export a deck file without loading it into a FlashCardDeck
+ * @details The file is parsed with streamFlashCardDeck and each card is passed to the exporter as it is read.
+ * Only beginDeck ... endDeck are called so several files can be exported into one library.
+ *
+ * @param deck_file The deck file to export
+ * @param exporter The exporter to write with
+ * @return true if the file could be opened
+ */
+bool exportDeckFile(const std::filesystem::path &deck_file, DeckExporter &exporter);
+
+/**
+ * @brief Export every ".deck" file in a directory
+ * @details Decks are streamed one at a time in filename order, calling the complete beginLibrary ...
+ * endLibrary sequence on the exporter.
+ *
+ * @param deck_dir_path The directory containing the deck files
+ * @param exporter The exporter to write with
+ * @return size_t The number of decks exported
+ */
+size_t exportLibrary(const std::filesystem::path &deck_dir_path, DeckExporter &exporter);
+
+#endif // DECK_EXPORT_H
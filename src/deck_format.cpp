@@ -0,0 +1,417 @@
+/**
+ * @file deck_format.cpp
+ * @author Green Alligators
+ * @brief Reading and writing the text of deck files
+ * @version 1.0.0
+ * @date 2024-10-23
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "deck_format.h"
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+
+namespace
+{
+/**
+ * @brief The kinds of line in a deck file, given by the key at the start of the line
+ *
+ */
+enum class LineKey : uint8_t
+{
+    NONE,
+    CARD_END,
+    QUESTION,
+    ANSWER,
+    DIFFICULTY,
+    ANSWERED,
+    TAGS,
+    SCHEDULE,
+    DECK_TAGS,
+    VERSION,
+    CONTINUATION
+};
+
+struct KeySpelling
+{
+    const char *text;
+    LineKey key;
+};
+
+// "-" matches any line starting with '-' as in version 1, "+" without its space allows an empty continuation line
+constexpr KeySpelling keySpellings[] = {
+    {"-", LineKey::CARD_END},    {"Q: ", LineKey::QUESTION}, {"A: ", LineKey::ANSWER},
+    {"D: ", LineKey::DIFFICULTY}, {"N: ", LineKey::ANSWERED}, {"T: ", LineKey::TAGS},
+    {"DT: ", LineKey::DECK_TAGS}, {"V: ", LineKey::VERSION},  {"+", LineKey::CONTINUATION},
+    {"+ ", LineKey::CONTINUATION}, {"S: ", LineKey::SCHEDULE},
+};
+
+/** state 0 rejects every byte, matching starts in state 1 */
+constexpr uint8_t rejectState{0};
+constexpr uint8_t startState{1};
+constexpr size_t maxKeyStates{32};
+
+/**
+ * @brief A DFA over the start of a line that recognises every key in keySpellings
+ *
+ */
+struct KeyTable
+{
+    std::array<std::array<uint8_t, 256>, maxKeyStates> next{};
+    std::array<LineKey, maxKeyStates> accepts{};
+};
+
+// build the trie of the key spellings, each node is a state of the DFA
+constexpr KeyTable buildKeyTable()
+{
+    KeyTable table{};
+    uint8_t n_states{startState + 1};
+    for (const KeySpelling &spelling : keySpellings)
+    {
+        uint8_t state = startState;
+        for (const char *c = spelling.text; *c != '\0'; ++c)
+        {
+            uint8_t &next = table.next[state][static_cast<unsigned char>(*c)];
+            if (next == rejectState)
+            {
+                next = n_states++;
+            }
+            state = next;
+        }
+        table.accepts[state] = spelling.key;
+    }
+    return table;
+}
+
+constexpr KeyTable keyTable = buildKeyTable();
+
+// the leading spaces and tabs of a value are not part of it, as in version 1
+std::string_view trimLeading(std::string_view value)
+{
+    size_t first = value.find_first_not_of(" \t");
+    return first == std::string_view::npos ? std::string_view{} : value.substr(first);
+}
+
+void sanitize(std::string &text, Utf8Report *text_repairs)
+{
+    Utf8Report repairs = sanitizeUtf8(text);
+    if (text_repairs != nullptr)
+    {
+        *text_repairs += repairs;
+    }
+}
+} // namespace
+
+
+DeckTextParser::DeckTextParser(std::function<void(const std::string &)> on_name,
+                               std::function<void(FlashCard &)> on_card,
+                               std::function<void(std::vector<std::string> &)> on_deck_tags,
+                               Utf8Report *text_repairs,
+                               std::vector<CardSlot> *card_slots)
+    : m_onName(std::move(on_name)), m_onCard(std::move(on_card)), m_onDeckTags(std::move(on_deck_tags)),
+      m_textRepairs(text_repairs), m_cardSlots(card_slots)
+{
+}
+
+void DeckTextParser::feed(std::string_view text)
+{
+    size_t start = 0;
+    while (start < text.size())
+    {
+        const void *newline = std::memchr(text.data() + start, '\n', text.size() - start);
+        if (newline == nullptr)
+        {
+            m_partial.append(text.substr(start));
+            return;
+        }
+        size_t end = static_cast<size_t>(static_cast<const char *>(newline) - text.data());
+        if (m_partial.empty())
+        {
+            parseLine(text.substr(start, end - start), true);
+        }
+        else
+        {
+            m_partial.append(text.substr(start, end - start));
+            parseLine(m_partial, true);
+            m_partial.clear();
+        }
+        start = end + 1;
+    }
+}
+
+void DeckTextParser::finish()
+{
+    if (!m_partial.empty())
+    {
+        parseLine(m_partial, false);
+        m_partial.clear();
+    }
+    // a card left open at the end of the file is only kept if it has some content, it has no "-" line to keep
+    // its slot in shape so it is never rewritten in place
+    if (m_card.question != "" || m_card.answer != "")
+    {
+        endCard(0);
+    }
+}
+
+int DeckTextParser::version() const
+{
+    return m_version;
+}
+
+uint64_t DeckTextParser::bytesParsed() const
+{
+    return m_lineStart + m_partial.size();
+}
+
+void DeckTextParser::endCard(uint64_t slot_end)
+{
+    if (m_cardSlots != nullptr)
+    {
+        CardSlot slot{};
+        if (slot_end != 0 && m_slotMovable)
+        {
+            slot.offset = m_slotStart;
+            slot.length = slot_end - slot.offset;
+        }
+        m_cardSlots->push_back(slot);
+    }
+    m_onCard(m_card);
+    m_card = FlashCard{};
+    m_lastText = nullptr;
+    m_slotOpen = false;
+    m_slotMovable = true;
+}
+
+void DeckTextParser::parseLine(std::string_view line, bool terminated)
+{
+    uint64_t line_start = m_lineStart;
+    m_lineStart += line.size() + (terminated ? 1 : 0);
+
+    // files written on Windows may have been read without newline translation
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+
+    // First line of the file is the deck name
+    if (m_lineCount++ == 0)
+    {
+        std::string name{line};
+        sanitize(name, m_textRepairs);
+        m_onName(name);
+        return;
+    }
+
+    // run the key DFA until it rejects, remembering the longest key matched
+    LineKey key = LineKey::NONE;
+    size_t key_length = 0;
+    uint8_t state = startState;
+    for (size_t i = 0; i < line.size(); ++i)
+    {
+        state = keyTable.next[state][static_cast<unsigned char>(line[i])];
+        if (state == rejectState)
+        {
+            break;
+        }
+        if (keyTable.accepts[state] != LineKey::NONE)
+        {
+            key = keyTable.accepts[state];
+            key_length = i + 1;
+        }
+    }
+    std::string_view value = line.substr(key_length);
+
+    // track where the card's slot starts, and whether it holds lines a rewrite of the card would drop
+    if (key != LineKey::CARD_END && key != LineKey::NONE && key != LineKey::DECK_TAGS && key != LineKey::VERSION)
+    {
+        if (!m_slotOpen)
+        {
+            m_slotStart = line_start;
+            m_slotOpen = true;
+        }
+    }
+    else if (m_slotOpen && key != LineKey::CARD_END && line.find_first_not_of(" \t") != std::string_view::npos)
+    {
+        m_slotMovable = false;
+    }
+
+    switch (key)
+    {
+    case LineKey::CARD_END:
+        if (!m_slotOpen)
+        {
+            m_slotStart = line_start;
+        }
+        endCard(m_lineStart);
+        break;
+    case LineKey::QUESTION:
+        assignText(m_card.question, trimLeading(value));
+        m_lastText = &FlashCard::question;
+        break;
+    case LineKey::ANSWER:
+        assignText(m_card.answer, trimLeading(value));
+        m_lastText = &FlashCard::answer;
+        break;
+    case LineKey::DIFFICULTY:
+        m_card.difficulty = strToCardDifficulty(std::string{trimLeading(value)});
+        break;
+    case LineKey::ANSWERED:
+        m_card.n_times_answered = std::stoi(std::string{value});
+        break;
+    case LineKey::TAGS: {
+        std::string tags{value};
+        sanitize(tags, m_textRepairs);
+        m_card.tags = strToTagList(tags);
+        break;
+    }
+    case LineKey::SCHEDULE:
+        // an unreadable schedule leaves the card new rather than failing the whole deck
+        strToSchedule(value, m_card.schedule);
+        break;
+    case LineKey::DECK_TAGS:
+        if (m_onDeckTags)
+        {
+            std::string tags_str{value};
+            sanitize(tags_str, m_textRepairs);
+            std::vector<std::string> deck_tags = strToTagList(tags_str);
+            m_onDeckTags(deck_tags);
+        }
+        break;
+    case LineKey::VERSION: {
+        // an unreadable version is ignored rather than failing the whole deck
+        std::string_view digits = trimLeading(value);
+        int version{};
+        if (std::from_chars(digits.data(), digits.data() + digits.size(), version).ec == std::errc{})
+        {
+            m_version = version;
+        }
+        break;
+    }
+    case LineKey::CONTINUATION:
+        if (m_lastText != nullptr)
+        {
+            assignText(m_scratch, value);
+            (m_card.*m_lastText).push_back('\n');
+            (m_card.*m_lastText).append(m_scratch);
+        }
+        break;
+    case LineKey::NONE:
+        // blank lines, comments and fields added by later versions
+        break;
+    }
+}
+
+void DeckTextParser::assignText(std::string &field, std::string_view value)
+{
+    if (m_version >= 2)
+    {
+        unescapeDeckText(value, field);
+    }
+    else
+    {
+        field.assign(value);
+    }
+    sanitize(field, m_textRepairs);
+}
+
+
+void unescapeDeckText(std::string_view value, std::string &out)
+{
+    out.clear();
+    out.reserve(value.size());
+    size_t start = 0;
+    while (true)
+    {
+        size_t slash = value.find('\\', start);
+        if (slash == std::string_view::npos || slash + 1 == value.size())
+        {
+            // a lone backslash at the end of the value is kept as written
+            out.append(value.substr(start));
+            return;
+        }
+        out.append(value.substr(start, slash - start));
+        char escaped = value[slash + 1];
+        switch (escaped)
+        {
+        case 'n':
+            out.push_back('\n');
+            break;
+        case 'r':
+            out.push_back('\r');
+            break;
+        case 't':
+            out.push_back('\t');
+            break;
+        case ' ':
+        case '\\':
+            out.push_back(escaped);
+            break;
+        default:
+            // unknown escapes are kept as written
+            out.push_back('\\');
+            out.push_back(escaped);
+            break;
+        }
+        start = slash + 2;
+    }
+}
+
+void appendDeckText(std::string &out, std::string_view key, const std::string &text)
+{
+    out.append(key);
+    size_t start = 0;
+    while (true)
+    {
+        size_t end = text.find('\n', start);
+        std::string_view line = std::string_view{text}.substr(start, end == std::string::npos ? end : end - start);
+        for (size_t i = 0; i < line.size(); ++i)
+        {
+            char c = line[i];
+            if (c == '\\')
+            {
+                out.append("\\\\");
+            }
+            else if (c == '\r')
+            {
+                out.append("\\r");
+            }
+            else if (i == 0 && start == 0 && (c == ' ' || c == '\t'))
+            {
+                // the reader trims leading whitespace from the first line of a field
+                out.append(c == ' ' ? "\\ " : "\\t");
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+        out.push_back('\n');
+        if (end == std::string::npos)
+        {
+            return;
+        }
+        out.append("+ ");
+        start = end + 1;
+    }
+}
+
+bool padCardText(std::string &text, uint64_t length)
+{
+    if (text.size() > length || !text.ends_with("-\n"))
+    {
+        return false;
+    }
+    size_t padding = static_cast<size_t>(length - text.size());
+    if (padding > 0)
+    {
+        std::string pad_line(padding - 1, ' ');
+        pad_line.push_back('\n');
+        text.insert(text.size() - 2, pad_line);
+    }
+    return true;
+}
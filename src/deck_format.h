@@ -0,0 +1,165 @@
+/**
+ * @file deck_format.h
+ * @author Green Alligators
+ * @brief Reading and writing the text of deck files
+ * @details A deck file is the deck name on the first line followed by "KEY: value" lines, with a "-" line closing
+ * each card. Version 2 of the format adds to version 1:
+ *
+ * - a "V: 2" line after the name
+ * - continuation lines, "+ text" adds a new line of text to the question or answer above it
+ * - escapes in question and answer values: "\\", "\n", "\r", "\t" and "\ " (a space that is not trimmed)
+ * - every field of a card is optional, and unknown "KEY: value" lines are skipped so fields can be added later
+ *
+ * A version 1 reader skips the "V:" and "+" lines, so it still reads a version 2 deck, seeing the first line of
+ * each multi-line field and escapes as written.
+ *
+ * The parser reads each line once: a table built from the keys recognises the key at the start of a line, and the
+ * value is then copied straight into the card.
+ *
+ * @version 1.0.0
+ * @date 2024-10-23
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef DECK_FORMAT_H
+#define DECK_FORMAT_H
+
+#include "deck.h"
+#include "utf8.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** The version of the deck format written by writeFlashCardDeck */
+constexpr int deckFormatVersion{2};
+
+/** Bytes of padding given to every card by rewriteFlashCardDeck, so a card that grew can still be saved in place */
+constexpr size_t cardSlotPadding{32};
+
+/**
+ * @brief Incremental parser for the text of a deck file
+ * @details Text can be fed in pieces of any size, lines split between pieces are joined before being parsed.
+ * Both versions of the format are read, escapes are only decoded after a "V: 2" line.
+ * The byte range of each card can be recorded so that a single card can later be rewritten in place.
+ */
+class DeckTextParser
+{
+public:
+    /**
+     * @brief Construct a new Deck Text Parser object
+     *
+     * @param on_name Called once with the deck name
+     * @param on_card Called for each card in file order
+     * @param on_deck_tags Called with the deck's tags if the deck has a "DT: " line, may be empty
+     * @param text_repairs If not null, the changes made by sanitizeUtf8 are added to it
+     * @param card_slots If not null, the slot of each card reported to on_card is appended to it
+     */
+    DeckTextParser(std::function<void(const std::string &)> on_name,
+                   std::function<void(FlashCard &)> on_card,
+                   std::function<void(std::vector<std::string> &)> on_deck_tags = nullptr,
+                   Utf8Report *text_repairs = nullptr,
+                   std::vector<CardSlot> *card_slots = nullptr);
+
+    /**
+     * @brief Parse the next piece of the deck text
+     *
+     * @param text The text following the previous piece
+     */
+    void feed(std::string_view text);
+
+    /**
+     * @brief Parse any final line without a newline and report a trailing card that has a question or answer
+     *
+     */
+    void finish();
+
+    /**
+     * @brief The format version given by the deck's "V: " line
+     *
+     * @return int 1 if the deck has no version line
+     */
+    int version() const;
+
+    /**
+     * @brief The number of bytes parsed so far
+     *
+     * @return uint64_t
+     */
+    uint64_t bytesParsed() const;
+
+private:
+    /**
+     * @brief Parse a single line, without its '\n'
+     *
+     * @param line The line
+     * @param terminated Whether the line was followed by a '\n'
+     */
+    void parseLine(std::string_view line, bool terminated);
+
+    /**
+     * @brief Hand over the current card and its slot, then start a new card
+     *
+     * @param slot_end The offset just past the end of the card, or 0 if it has no slot
+     */
+    void endCard(uint64_t slot_end);
+
+    /**
+     * @brief Set a question or answer from a value, decoding escapes in version 2 decks
+     *
+     * @param field The question or answer to set
+     * @param value The value as written in the file
+     */
+    void assignText(std::string &field, std::string_view value);
+
+    std::function<void(const std::string &)> m_onName;            ///< Receives the deck name
+    std::function<void(FlashCard &)> m_onCard;                    ///< Receives each finished card
+    std::function<void(std::vector<std::string> &)> m_onDeckTags; ///< Receives the deck tags
+    Utf8Report *m_textRepairs;                                    ///< Where text repairs are counted, may be null
+    std::vector<CardSlot> *m_cardSlots;                           ///< Where card slots are recorded, may be null
+
+    FlashCard m_card{};                   ///< The card currently being filled
+    std::string FlashCard::*m_lastText{}; ///< The question or answer a continuation line adds to
+    std::string m_partial{};              ///< The start of a line split between two pieces
+    std::string m_scratch{};              ///< Reused buffer for decoded continuation lines
+    size_t m_lineCount{0};                ///< The number of lines parsed so far
+    uint64_t m_lineStart{0};              ///< The offset of the next line to be parsed
+    uint64_t m_slotStart{0};              ///< The offset of the current card's first field line
+    bool m_slotOpen{false};               ///< A field line of the current card has been seen
+    bool m_slotMovable{true};             ///< The current card holds nothing that rewriting it would lose
+    int m_version{1};                     ///< The format version of the deck
+};
+
+/**
+ * @brief Decode the escapes of a version 2 question or answer value
+ *
+ * @param value The value as written in the file
+ * @param out Set to the decoded text
+ */
+void unescapeDeckText(std::string_view value, std::string &out);
+
+/**
+ * @brief Append a question or answer line, with any further lines of the text as continuation lines
+ * @details Backslashes, carriage returns and leading whitespace are escaped so the text reads back unchanged.
+ * Text without any of these is written exactly as in version 1.
+ *
+ * @param out The text to append to
+ * @param key The key including its ": ", e.g. "Q: "
+ * @param text The question or answer
+ */
+void appendDeckText(std::string &out, std::string_view key, const std::string &text);
+
+/**
+ * @brief Pad the text of a card, as made by FlashCard::stringCardAsTemplate, to fill a slot
+ * @details The padding is a line of spaces before the card's "-" line, which both format versions skip.
+ *
+ * @param text The card text, ending with "-\n"
+ * @param length The length of the slot
+ * @return true if the text fits in the slot
+ */
+bool padCardText(std::string &text, uint64_t length);
+
+#endif // DECK_FORMAT_H
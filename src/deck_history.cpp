@@ -0,0 +1,455 @@
+/**
+ * @file deck_history.cpp
+ * @author Green Alligators
+ * @brief Versioned history of the contents of each deck
+ * @version 1.0.0
+ * @date 2024-10-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "deck_history.h"
+#include "deck_export.h"
+#include "hash.h"
+#include "varint.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+
+namespace
+{
+constexpr std::string_view historyMagic{"SDHIST01"};
+
+enum RecordKind : uint8_t
+{
+    CHECKPOINT_RECORD = 1,
+    DELTA_RECORD = 2
+};
+
+int64_t secondsSinceEpoch()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// an op is a varint holding (count << 1) | 1 followed by the start of a run of cards copied from the base version,
+// or (length << 1) followed by the text of a new card
+void putCopy(std::string &ops, size_t start, size_t count)
+{
+    putVarint(ops, (static_cast<uint64_t>(count) << 1) | 1);
+    putVarint(ops, start);
+}
+
+void putInsert(std::string &ops, const std::string &card)
+{
+    putVarint(ops, static_cast<uint64_t>(card.size()) << 1);
+    ops.append(card);
+}
+
+std::string encodeCheckpoint(const std::string &header, const std::vector<std::string> &cards)
+{
+    std::string payload;
+    putBytes(payload, header);
+    putVarint(payload, cards.size());
+    for (const std::string &card : cards)
+    {
+        putInsert(payload, card);
+    }
+    return payload;
+}
+
+size_t varintSize(uint64_t value)
+{
+    size_t size = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+// the size encodeCheckpoint() would give, without building the copy of the whole deck
+size_t checkpointSize(const std::string &header, const std::vector<std::string> &cards)
+{
+    size_t size = varintSize(header.size()) + header.size() + varintSize(cards.size());
+    for (const std::string &card : cards)
+    {
+        size += varintSize(static_cast<uint64_t>(card.size()) << 1) + card.size();
+    }
+    return size;
+}
+
+std::string encodeDelta(const std::string &header,
+                        const std::vector<std::string> &base,
+                        const std::vector<std::string> &cards)
+{
+    // where each card text first appears in the base version
+    std::unordered_map<std::string_view, size_t> base_index;
+    base_index.reserve(base.size());
+    for (size_t i = 0; i < base.size(); ++i)
+    {
+        base_index.emplace(base[i], i);
+    }
+
+    std::string ops;
+    uint64_t n_ops{0};
+    size_t run_end = 0;
+    size_t i = 0;
+    while (i < cards.size())
+    {
+        // carry on from the end of the last run so repeated cards keep their order, otherwise look the card up
+        size_t start{};
+        if (run_end < base.size() && base[run_end] == cards[i])
+        {
+            start = run_end;
+        }
+        else
+        {
+            auto found = base_index.find(cards[i]);
+            if (found == base_index.end())
+            {
+                putInsert(ops, cards[i]);
+                n_ops++;
+                i++;
+                continue;
+            }
+            start = found->second;
+        }
+        size_t count = 1;
+        while (i + count < cards.size() && start + count < base.size() && base[start + count] == cards[i + count])
+        {
+            count++;
+        }
+        putCopy(ops, start, count);
+        n_ops++;
+        run_end = start + count;
+        i += count;
+    }
+
+    std::string payload;
+    putBytes(payload, header);
+    putVarint(payload, n_ops);
+    payload.append(ops);
+    return payload;
+}
+
+// apply a payload to the cards of the version before it, a checkpoint ignores them
+bool applyPayload(std::string_view payload, std::string &header, std::vector<std::string> &cards)
+{
+    uint64_t n_ops{};
+    if (!getBytes(payload, header) || !getVarint(payload, n_ops))
+    {
+        return false;
+    }
+    std::vector<std::string> result;
+    for (uint64_t op = 0; op < n_ops; ++op)
+    {
+        uint64_t value{};
+        if (!getVarint(payload, value))
+        {
+            return false;
+        }
+        if ((value & 1) != 0)
+        {
+            uint64_t count = value >> 1;
+            uint64_t start{};
+            if (!getVarint(payload, start) || start > cards.size() || count > cards.size() - start)
+            {
+                return false;
+            }
+            result.insert(result.end(), cards.begin() + start, cards.begin() + start + count);
+        }
+        else
+        {
+            uint64_t len = value >> 1;
+            if (len > payload.size())
+            {
+                return false;
+            }
+            result.emplace_back(payload.substr(0, static_cast<size_t>(len)));
+            payload.remove_prefix(static_cast<size_t>(len));
+        }
+    }
+    cards = std::move(result);
+    return true;
+}
+} // namespace
+
+
+DeckHistory::DeckHistory(fs::path history_file) : m_file(std::move(history_file))
+{
+    std::error_code ec;
+    uint64_t file_size = fs::file_size(m_file, ec);
+    if (ec)
+    {
+        return;
+    }
+    std::ifstream in{m_file, std::ios::binary};
+    std::string magic(historyMagic.size(), '\0');
+    if (!in.read(magic.data(), static_cast<std::streamsize>(magic.size())) || magic != historyMagic)
+    {
+        return;
+    }
+    m_validSize = historyMagic.size();
+
+    // read each record's fields and skip its payload, stopping at the first incomplete record
+    while (true)
+    {
+        int kind = in.get();
+        if (kind != CHECKPOINT_RECORD && kind != DELTA_RECORD)
+        {
+            break;
+        }
+        DeckVersion version{};
+        version.checkpoint = kind == CHECKPOINT_RECORD;
+        uint64_t time{};
+        uint64_t note_len{};
+        if (!getVarint(in, version.number) || !getVarint(in, time) || !getVarint(in, version.n_cards) ||
+            !getVarint(in, note_len) || note_len > file_size)
+        {
+            break;
+        }
+        version.time = static_cast<int64_t>(time);
+        version.note.resize(static_cast<size_t>(note_len));
+        if (!in.read(version.note.data(), static_cast<std::streamsize>(note_len)) ||
+            !getVarint(in, version.payload_size) || !getVarint(in, version.payload_hash))
+        {
+            break;
+        }
+        version.payload_offset = static_cast<uint64_t>(in.tellg());
+        uint64_t expected = m_versions.empty() ? 1 : m_versions.back().number + 1;
+        if (version.number != expected || version.payload_size > file_size - version.payload_offset ||
+            (m_versions.empty() && !version.checkpoint))
+        {
+            break;
+        }
+        in.seekg(static_cast<std::streamoff>(version.payload_offset + version.payload_size));
+        m_validSize = version.payload_offset + version.payload_size;
+        m_versions.push_back(std::move(version));
+    }
+}
+
+fs::path DeckHistory::historyFileFor(const fs::path &deck_file)
+{
+    return deck_file.parent_path() / ".history" / (deck_file.filename().string() + ".history");
+}
+
+DeckHistory::VersionText DeckHistory::versionTextOf(const FlashCardDeck &deck)
+{
+    VersionText version{};
+    std::ostringstream header;
+    NativeDeckExporter exporter{header};
+    exporter.beginDeck(deck.name);
+    exporter.writeDeckTags(deck.tags);
+    exporter.endLibrary();
+    version.header = header.str();
+    version.cards.reserve(deck.cards.size());
+    for (const FlashCard &card : deck.cards)
+    {
+        version.cards.push_back(card.stringCardAsTemplate());
+    }
+    return version;
+}
+
+bool DeckHistory::rebuildVersion(uint64_t number, VersionText &version) const
+{
+    if (number == 0 || number > m_versions.size())
+    {
+        return false;
+    }
+    if (m_latestLoaded && number == m_versions.size())
+    {
+        version = m_latest;
+        return true;
+    }
+
+    size_t last = static_cast<size_t>(number - 1);
+    size_t first = last;
+    while (!m_versions[first].checkpoint)
+    {
+        first--;
+    }
+
+    std::ifstream in{m_file, std::ios::binary};
+    version = VersionText{};
+    std::string payload;
+    for (size_t i = first; i <= last; ++i)
+    {
+        const DeckVersion &record = m_versions[i];
+        payload.resize(static_cast<size_t>(record.payload_size));
+        in.seekg(static_cast<std::streamoff>(record.payload_offset));
+        if (!in.read(payload.data(), static_cast<std::streamsize>(payload.size())) ||
+            fnv1a64(payload) != record.payload_hash || !applyPayload(payload, version.header, version.cards))
+        {
+            return false;
+        }
+    }
+    if (number == m_versions.size())
+    {
+        m_latest = version;
+        m_latestLoaded = true;
+    }
+    return true;
+}
+
+uint64_t DeckHistory::recordVersion(const FlashCardDeck &deck, const std::string &note)
+{
+    VersionText version = versionTextOf(deck);
+
+    // a delta needs the latest version, if it cannot be read the new version is written in full
+    VersionText latest{};
+    bool have_latest = !m_versions.empty() && rebuildVersion(m_versions.size(), latest);
+    if (have_latest && latest.header == version.header && latest.cards == version.cards)
+    {
+        return m_versions.back().number;
+    }
+
+    DeckVersion record{};
+    record.number = m_versions.size() + 1;
+    record.time = secondsSinceEpoch();
+    record.n_cards = version.cards.size();
+    record.note = note;
+
+    uint64_t last_checkpoint{0};
+    for (auto it = m_versions.rbegin(); it != m_versions.rend(); ++it)
+    {
+        if (it->checkpoint)
+        {
+            last_checkpoint = it->number;
+            break;
+        }
+    }
+    // the full checkpoint is only encoded when the interval forces one or the delta is no smaller
+    std::string payload;
+    record.checkpoint = !have_latest || record.number - last_checkpoint >= checkpointInterval;
+    if (!record.checkpoint)
+    {
+        payload = encodeDelta(version.header, latest.cards, version.cards);
+        record.checkpoint = payload.size() >= checkpointSize(version.header, version.cards);
+    }
+    if (record.checkpoint)
+    {
+        payload = encodeCheckpoint(version.header, version.cards);
+    }
+    record.payload_size = payload.size();
+    record.payload_hash = fnv1a64(payload);
+
+    std::string bytes;
+    bytes.push_back(static_cast<char>(record.checkpoint ? CHECKPOINT_RECORD : DELTA_RECORD));
+    putVarint(bytes, record.number);
+    putVarint(bytes, static_cast<uint64_t>(record.time));
+    putVarint(bytes, record.n_cards);
+    putBytes(bytes, record.note);
+    putVarint(bytes, record.payload_size);
+    putVarint(bytes, record.payload_hash);
+
+    std::error_code ec;
+    fs::create_directories(m_file.parent_path(), ec);
+    if (m_versions.empty())
+    {
+        // a new history, or one with nothing readable in it, starts again from the magic string
+        std::ofstream out{m_file, std::ios::binary | std::ios::trunc};
+        out.write(historyMagic.data(), static_cast<std::streamsize>(historyMagic.size()));
+        if (!out)
+        {
+            return 0;
+        }
+        m_validSize = historyMagic.size();
+    }
+    else if (fs::file_size(m_file, ec) != m_validSize)
+    {
+        // drop a record left incomplete by an interrupted write
+        fs::resize_file(m_file, m_validSize, ec);
+        if (ec)
+        {
+            return 0;
+        }
+    }
+
+    record.payload_offset = m_validSize + bytes.size();
+    bytes.append(payload);
+    std::ofstream out{m_file, std::ios::binary | std::ios::app};
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    out.flush();
+    if (!out)
+    {
+        return 0;
+    }
+
+    m_validSize += bytes.size();
+    m_versions.push_back(record);
+    m_latest = std::move(version);
+    m_latestLoaded = true;
+    return record.number;
+}
+
+const std::vector<DeckVersion> &DeckHistory::listVersions() const
+{
+    return m_versions;
+}
+
+bool DeckHistory::readVersionText(uint64_t number, std::string &text) const
+{
+    VersionText version{};
+    if (!rebuildVersion(number, version))
+    {
+        return false;
+    }
+    text = version.header;
+    for (const std::string &card : version.cards)
+    {
+        text.append(card);
+    }
+    return true;
+}
+
+bool DeckHistory::readVersion(uint64_t number, FlashCardDeck &deck) const
+{
+    std::string text{};
+    if (!readVersionText(number, text))
+    {
+        return false;
+    }
+    deck = parseFlashCardDeck(text);
+    return true;
+}
+
+
+uint64_t recordDeckHistory(const FlashCardDeck &deck, const std::string &note)
+{
+    if (deck.filename.empty())
+    {
+        return 0;
+    }
+    try
+    {
+        DeckHistory history{DeckHistory::historyFileFor(deck.filename)};
+        return history.recordVersion(deck, note);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Failed to record the history of " << deck.filename << ": " << e.what() << std::endl;
+        return 0;
+    }
+}
+
+bool moveDeckHistory(const fs::path &old_deck_file, const fs::path &new_deck_file)
+{
+    fs::path old_history = DeckHistory::historyFileFor(old_deck_file);
+    std::error_code ec;
+    if (!fs::exists(old_history, ec))
+    {
+        return true;
+    }
+    fs::path new_history = DeckHistory::historyFileFor(new_deck_file);
+    fs::create_directories(new_history.parent_path(), ec);
+    fs::rename(old_history, new_history, ec);
+    return !ec;
+}
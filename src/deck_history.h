@@ -0,0 +1,176 @@
+/**
+ * @file deck_history.h
+ * @author Green Alligators
+ * @brief Versioned history of the contents of each deck
+ * @details Every saved version of a deck is kept in a per-deck history file as a card-level delta against the
+ * version before it, so a version costs about as much as the cards that changed. Every checkpointInterval
+ * versions, or whenever a delta would be no smaller, the full version is written instead as a checkpoint, so
+ * reading any version applies at most checkpointInterval - 1 deltas to the checkpoint before it.
+ *
+ * The history of "Decks/name.deck" is kept in "Decks/.history/name.deck.history". The file starts with an 8 byte
+ * magic string followed by records that are only ever appended:
+ *
+ * - kind: 1 byte, 1 for a checkpoint, 2 for a delta
+ * - version number, time, number of cards: varints
+ * - note: varint length then the bytes
+ * - payload: varint length and varint FNV-1a hash, then the bytes
+ *
+ * A payload is the deck's header text (name, "V:" and "DT:" lines) followed by a count of operations that build
+ * the list of card texts, each either copying a run of cards from the previous version or inserting a new card.
+ * A checkpoint only inserts. A record cut short by a crash is ignored.
+ *
+ * @version 1.0.0
+ * @date 2024-10-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef DECK_HISTORY_H
+#define DECK_HISTORY_H
+
+#include "deck.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A recorded version of a deck
+ *
+ */
+struct DeckVersion
+{
+    /** version number, counting from 1 */
+    uint64_t number{};
+    /** seconds since the unix epoch when the version was recorded */
+    int64_t time{};
+    /** the number of cards in this version */
+    uint64_t n_cards{};
+    /** true if the version is stored in full rather than as a delta */
+    bool checkpoint{false};
+    /** what changed, e.g. "edited card 3" */
+    std::string note{};
+    /** where the record's payload starts in the history file */
+    uint64_t payload_offset{};
+    /** the size of the payload in bytes */
+    uint64_t payload_size{};
+    /** FNV-1a hash of the payload */
+    uint64_t payload_hash{};
+};
+
+/**
+ * @brief The history of one deck
+ *
+ */
+class DeckHistory
+{
+public:
+    /** a version is stored in full at least this often */
+    static constexpr uint64_t checkpointInterval{16};
+
+    /**
+     * @brief Open the history in a file, which is created by the first recorded version
+     *
+     * @param history_file The history file
+     */
+    explicit DeckHistory(std::filesystem::path history_file);
+
+    /**
+     * @brief The history file used for a deck file
+     *
+     * @param deck_file The deck file
+     * @return std::filesystem::path
+     */
+    static std::filesystem::path historyFileFor(const std::filesystem::path &deck_file);
+
+    /**
+     * @brief Record the deck's current contents as a new version
+     * @details Nothing is recorded if the contents are the same as the latest version.
+     *
+     * @param deck The deck
+     * @param note What changed
+     * @return uint64_t The number of the new or unchanged latest version, 0 if it could not be written
+     */
+    uint64_t recordVersion(const FlashCardDeck &deck, const std::string &note);
+
+    /**
+     * @brief List the recorded versions, oldest first
+     *
+     * @return const std::vector<DeckVersion>&
+     */
+    const std::vector<DeckVersion> &listVersions() const;
+
+    /**
+     * @brief Rebuild the deck file text of a version
+     *
+     * @param number The version number
+     * @param text Set to the text as writeFlashCardDeck would write it, without padding
+     * @return true if the version exists and could be read
+     */
+    bool readVersionText(uint64_t number, std::string &text) const;
+
+    /**
+     * @brief Rebuild a version of the deck
+     *
+     * @param number The version number
+     * @param deck Set to the deck, its filename is left empty
+     * @return true if the version exists and could be read
+     */
+    bool readVersion(uint64_t number, FlashCardDeck &deck) const;
+
+private:
+    /**
+     * @brief The contents of a version, as the text of its header and of each card
+     *
+     */
+    struct VersionText
+    {
+        std::string header{};
+        std::vector<std::string> cards{};
+    };
+
+    /**
+     * @brief Split a deck into its header and card texts
+     *
+     * @param deck The deck
+     * @return VersionText
+     */
+    static VersionText versionTextOf(const FlashCardDeck &deck);
+
+    /**
+     * @brief Rebuild a version from the checkpoint before it and the deltas after that
+     *
+     * @param number The version number
+     * @param version Set to the version
+     * @return true if the version exists and every record could be read
+     */
+    bool rebuildVersion(uint64_t number, VersionText &version) const;
+
+    std::filesystem::path m_file;        ///< The history file
+    std::vector<DeckVersion> m_versions; ///< Every complete record in the file, oldest first
+    uint64_t m_validSize{0};             ///< The size of the file up to the end of the last complete record
+    mutable VersionText m_latest{};      ///< The latest version once it has been rebuilt
+    mutable bool m_latestLoaded{false};  ///< Whether m_latest holds the latest version
+};
+
+/**
+ * @brief Record a version of a deck in the history next to its file
+ * @details Errors are reported on std::cerr and otherwise ignored so that a failing history never stops a save.
+ *
+ * @param deck The deck, its filename gives the history file
+ * @param note What changed
+ * @return uint64_t The version number, 0 on failure
+ */
+uint64_t recordDeckHistory(const FlashCardDeck &deck, const std::string &note);
+
+/**
+ * @brief Move the history of a deck file that has been renamed
+ *
+ * @param old_deck_file The old deck file
+ * @param new_deck_file The new deck file
+ * @return true if there was no history or it was moved
+ */
+bool moveDeckHistory(const std::filesystem::path &old_deck_file, const std::filesystem::path &new_deck_file);
+
+#endif // DECK_HISTORY_H
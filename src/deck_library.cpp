@@ -0,0 +1,277 @@
+/**
+ * @file deck_library.cpp
+ * @author Green Alligators
+ * @brief The decks of a directory held within a memory budget
+ * @version 1.0.0
+ * @date 2024-10-26
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "deck_library.h"
+#include <iostream>
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+
+namespace
+{
+size_t stringMemory(const std::string &str)
+{
+    // short strings live inside the string object itself
+    return str.capacity() > std::string{}.capacity() ? str.capacity() + 1 : 0;
+}
+
+size_t tagsMemory(const std::vector<std::string> &tags)
+{
+    size_t bytes = tags.capacity() * sizeof(std::string);
+    for (const std::string &tag : tags)
+    {
+        bytes += stringMemory(tag);
+    }
+    return bytes;
+}
+
+int64_t earliestDue(const std::vector<FlashCard> &cards)
+{
+    int64_t earliest = 0;
+    for (const FlashCard &card : cards)
+    {
+        if (card.schedule.due != 0 && (earliest == 0 || card.schedule.due < earliest))
+        {
+            earliest = card.schedule.due;
+        }
+    }
+    return earliest;
+}
+} // namespace
+
+
+size_t deckMemoryUsage(const FlashCardDeck &deck)
+{
+    size_t bytes = sizeof(FlashCardDeck) + stringMemory(deck.name) + tagsMemory(deck.tags);
+    bytes += deck.cards.capacity() * sizeof(FlashCard) + deck.card_slots.capacity() * sizeof(CardSlot);
+    for (const FlashCard &card : deck.cards)
+    {
+        bytes += stringMemory(card.question) + stringMemory(card.answer) + tagsMemory(card.tags);
+    }
+    return bytes;
+}
+
+
+DeckLibrary::DeckLibrary(size_t memory_budget) : m_memoryBudget(memory_budget), m_current(0)
+{
+}
+
+void DeckLibrary::load(const fs::path &deck_dir_path, DeckIoBackend &backend)
+{
+    // Check the deck directory exists
+    if (!fs::exists(deck_dir_path) || !fs::is_directory(deck_dir_path))
+    {
+        std::cerr << "Directory does not exist, or is not a directory";
+        throw 0;
+    }
+
+    std::vector<fs::path> deck_files = listDeckFiles(deck_dir_path);
+    m_entries.clear();
+    m_entries.resize(deck_files.size());
+    m_memoryUsed = 0;
+    m_current = m_entries.size();
+
+    // decks are parsed in parallel, but counted and evicted one at a time
+    std::mutex library_mutex;
+    std::vector<fs::file_time_type> read_times = stampDeckFiles(deck_files);
+    backend.readFiles(deck_files, [&](size_t i, std::string &contents, bool ok) {
+        FlashCardDeck deck = ok ? parseFlashCardDeck(contents) : FlashCardDeck{};
+        deck.filename = deck_files[i];
+        deck.indexed_time = read_times[i];
+
+        std::lock_guard<std::mutex> lock{library_mutex};
+        Entry &entry = m_entries[i];
+        entry.deck = std::move(deck);
+        entry.loaded = true;
+        entry.memory = 0;
+        touch(entry);
+        evictToBudget(m_entries.size());
+    });
+}
+
+void DeckLibrary::load(const fs::path &deck_dir_path)
+{
+    std::unique_ptr<DeckIoBackend> backend = createDefaultIoBackend();
+    load(deck_dir_path, *backend);
+}
+
+size_t DeckLibrary::size() const
+{
+    return m_entries.size();
+}
+
+bool DeckLibrary::empty() const
+{
+    return m_entries.empty();
+}
+
+const std::string &DeckLibrary::name(size_t index) const
+{
+    return m_entries.at(index).deck.name;
+}
+
+const fs::path &DeckLibrary::filename(size_t index) const
+{
+    return m_entries.at(index).deck.filename;
+}
+
+size_t DeckLibrary::cardCount(size_t index) const
+{
+    const Entry &entry = m_entries.at(index);
+    return entry.loaded ? entry.deck.cards.size() : entry.n_cards;
+}
+
+int64_t DeckLibrary::nextDue(size_t index) const
+{
+    const Entry &entry = m_entries.at(index);
+    return index == m_current && entry.loaded ? earliestDue(entry.deck.cards) : entry.next_due;
+}
+
+LeechCount DeckLibrary::leechCount(size_t index) const
+{
+    const Entry &entry = m_entries.at(index);
+    return index == m_current && entry.loaded ? countLeeches(entry.deck.cards) : entry.leeches;
+}
+
+bool DeckLibrary::isLoaded(size_t index) const
+{
+    return m_entries.at(index).loaded;
+}
+
+FlashCardDeck &DeckLibrary::deck(size_t index)
+{
+    Entry &entry = m_entries.at(index);
+
+    // the deck used last may have been edited through its reference since it was counted
+    if (m_current < m_entries.size() && m_current != index && m_entries[m_current].loaded)
+    {
+        touch(m_entries[m_current]);
+    }
+
+    if (!entry.loaded)
+    {
+        FlashCardDeck deck = readFlashCardDeck(entry.deck.filename);
+        deck.filename = entry.deck.filename;
+        if (deck.name.empty())
+        {
+            // the file has gone or is unreadable, keep showing the deck by the name it had
+            deck.name = entry.deck.name;
+        }
+        entry.deck = std::move(deck);
+        entry.loaded = true;
+        entry.memory = 0;
+        m_reloads++;
+    }
+    touch(entry);
+    m_current = index;
+    evictToBudget(index);
+    return entry.deck;
+}
+
+void DeckLibrary::add(FlashCardDeck deck)
+{
+    if (m_current < m_entries.size() && m_entries[m_current].loaded)
+    {
+        touch(m_entries[m_current]);
+    }
+    Entry entry{};
+    entry.deck = std::move(deck);
+    entry.loaded = true;
+    m_entries.push_back(std::move(entry));
+    m_current = m_entries.size() - 1;
+    touch(m_entries.back());
+    evictToBudget(m_current);
+}
+
+void DeckLibrary::erase(size_t index)
+{
+    Entry &entry = m_entries.at(index);
+    if (entry.loaded)
+    {
+        m_memoryUsed -= entry.memory;
+    }
+    bool had_current = m_current < m_entries.size() && m_current != index;
+    m_entries.erase(m_entries.begin() + static_cast<std::ptrdiff_t>(index));
+    if (!had_current)
+    {
+        m_current = m_entries.size();
+    }
+    else if (m_current > index)
+    {
+        m_current--;
+    }
+}
+
+size_t DeckLibrary::memoryUsed() const
+{
+    return m_memoryUsed;
+}
+
+size_t DeckLibrary::memoryBudget() const
+{
+    return m_memoryBudget;
+}
+
+void DeckLibrary::setMemoryBudget(size_t memory_budget)
+{
+    m_memoryBudget = memory_budget;
+    evictToBudget(m_current);
+}
+
+size_t DeckLibrary::reloadCount() const
+{
+    return m_reloads;
+}
+
+void DeckLibrary::touch(Entry &entry)
+{
+    size_t memory = deckMemoryUsage(entry.deck);
+    m_memoryUsed = m_memoryUsed - entry.memory + memory;
+    entry.memory = memory;
+    entry.n_cards = entry.deck.cards.size();
+    entry.next_due = earliestDue(entry.deck.cards);
+    entry.leeches = countLeeches(entry.deck.cards);
+    entry.last_used = ++m_clock;
+}
+
+void DeckLibrary::evictToBudget(size_t keep)
+{
+    // the library holds decks, not cards, so a scan for the oldest is cheap next to reading a deck back
+    while (m_memoryUsed > m_memoryBudget)
+    {
+        Entry *oldest = nullptr;
+        for (size_t i = 0; i < m_entries.size(); ++i)
+        {
+            Entry &entry = m_entries[i];
+            if (i != keep && entry.loaded && (oldest == nullptr || entry.last_used < oldest->last_used))
+            {
+                oldest = &entry;
+            }
+        }
+        if (oldest == nullptr)
+        {
+            return;
+        }
+        evict(*oldest);
+    }
+}
+
+void DeckLibrary::evict(Entry &entry)
+{
+    m_memoryUsed -= entry.memory;
+    entry.memory = 0;
+    entry.n_cards = entry.deck.cards.size();
+    entry.loaded = false;
+    // swap with empty vectors so the memory is actually given back
+    std::vector<FlashCard>{}.swap(entry.deck.cards);
+    std::vector<CardSlot>{}.swap(entry.deck.card_slots);
+    entry.deck.indexed_size = 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * @file deck_library.h
+ * @author Green Alligators
+ * @brief The decks of a directory held within a memory budget
+ * @details Scenes list every deck but only ever show or study one at a time. A DeckLibrary keeps the metadata of
+ * every deck (name, file, tags and number of cards) but only keeps the cards of the most recently used decks,
+ * up to a memory budget. The least recently used decks are evicted down to their metadata and read back from
+ * their files the next time they are used, so the memory used stays the same however large the library grows.
+ *
+ * Decks are saved to their files as soon as they are changed, so evicting a deck never loses anything.
+ *
+ * @version 1.0.0
+ * @date 2024-10-26
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef DECK_LIBRARY_H
+#define DECK_LIBRARY_H
+
+#include "deck.h"
+#include "deck_loader.h"
+#include "leech.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Estimate the memory held by a deck
+ * @details Counts the deck and its cards along with the capacity of their strings and vectors.
+ *
+ * @param deck The deck
+ * @return size_t Bytes
+ */
+size_t deckMemoryUsage(const FlashCardDeck &deck);
+
+/**
+ * @brief The decks of a directory, with the cards of the least recently used decks evicted to stay in a budget
+ *
+ */
+class DeckLibrary
+{
+public:
+    /** memory budget used when none is given */
+    static constexpr size_t defaultMemoryBudget{256 * 1024 * 1024};
+
+    /**
+     * @brief Construct an empty library
+     *
+     * @param memory_budget Bytes of cards to keep loaded, the most recently used deck is always kept
+     */
+    explicit DeckLibrary(size_t memory_budget = defaultMemoryBudget);
+
+    /**
+     * @brief Replace the library with the decks in a directory
+     * @details Decks are evicted as soon as they are parsed if they do not fit in the budget, so loading a large
+     * library never holds more than the budget and the decks being parsed.
+     *
+     * @param deck_dir_path The directory containing the deck files
+     * @param backend The backend used to read the files
+     */
+    void load(const std::filesystem::path &deck_dir_path, DeckIoBackend &backend);
+
+    /**
+     * @brief Replace the library with the decks in a directory, read with the default backend
+     *
+     * @param deck_dir_path The directory containing the deck files
+     */
+    void load(const std::filesystem::path &deck_dir_path);
+
+    /**
+     * @brief The number of decks
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+    /**
+     * @brief Whether the library has no decks
+     *
+     * @return true if there are no decks
+     */
+    bool empty() const;
+
+    /**
+     * @brief The name of a deck, without loading its cards
+     *
+     * @param index The deck
+     * @return const std::string&
+     */
+    const std::string &name(size_t index) const;
+
+    /**
+     * @brief The file of a deck, without loading its cards
+     *
+     * @param index The deck
+     * @return const std::filesystem::path&
+     */
+    const std::filesystem::path &filename(size_t index) const;
+
+    /**
+     * @brief The number of cards in a deck, without loading its cards
+     *
+     * @param index The deck
+     * @return size_t
+     */
+    size_t cardCount(size_t index) const;
+
+    /**
+     * @brief When the first scheduled card of a deck is due, without loading its cards
+     * @details Kept with the metadata each time the deck is counted. The deck used last may have been changed
+     * through its reference since then, so its cards are checked again.
+     *
+     * @param index The deck
+     * @return int64_t The earliest due time, or 0 if no card in the deck is scheduled
+     */
+    int64_t nextDue(size_t index) const;
+
+    /**
+     * @brief The leeches and suspended cards of a deck, without loading its cards
+     * @details Kept with the metadata like nextDue.
+     *
+     * @param index The deck
+     * @return LeechCount
+     */
+    LeechCount leechCount(size_t index) const;
+
+    /**
+     * @brief Whether the cards of a deck are loaded
+     *
+     * @param index The deck
+     * @return true if the deck is loaded
+     */
+    bool isLoaded(size_t index) const;
+
+    /**
+     * @brief Use a deck, reading it back from its file if it was evicted
+     * @details The deck becomes the most recently used and other decks may be evicted to stay within the budget.
+     * The reference stays valid, with all its cards, until a different deck is used or decks are added or removed.
+     *
+     * @param index The deck
+     * @return FlashCardDeck&
+     */
+    FlashCardDeck &deck(size_t index);
+
+    /**
+     * @brief Add a deck, which becomes the most recently used
+     *
+     * @param deck The deck
+     */
+    void add(FlashCardDeck deck);
+
+    /**
+     * @brief Remove a deck from the library, its file is not touched
+     *
+     * @param index The deck
+     */
+    void erase(size_t index);
+
+    /**
+     * @brief The estimated memory held by the loaded decks
+     *
+     * @return size_t Bytes
+     */
+    size_t memoryUsed() const;
+
+    /**
+     * @brief The memory budget
+     *
+     * @return size_t Bytes
+     */
+    size_t memoryBudget() const;
+
+    /**
+     * @brief Change the memory budget, evicting decks if the library is now over it
+     *
+     * @param memory_budget Bytes
+     */
+    void setMemoryBudget(size_t memory_budget);
+
+    /**
+     * @brief The number of times an evicted deck has been read back from its file
+     *
+     * @return size_t
+     */
+    size_t reloadCount() const;
+
+private:
+    /**
+     * @brief A deck and what is known about it while its cards are evicted
+     *
+     */
+    struct Entry
+    {
+        FlashCardDeck deck{};  ///< The deck, with no cards while it is evicted
+        size_t n_cards{0};     ///< The number of cards, also while evicted
+        int64_t next_due{0};   ///< The earliest due time of its cards, also while evicted
+        LeechCount leeches{};  ///< Its leeches and suspended cards, also while evicted
+        size_t memory{0};      ///< The memory held by the deck while it is loaded
+        uint64_t last_used{0}; ///< When the deck was last used, larger is more recent
+        bool loaded{false};    ///< Whether the deck's cards are in memory
+    };
+
+    /**
+     * @brief Mark a loaded deck as the most recently used and count its memory again
+     *
+     * @param entry The deck
+     */
+    void touch(Entry &entry);
+
+    /**
+     * @brief Evict the least recently used decks until the loaded decks fit in the budget
+     *
+     * @param keep The deck that must stay loaded, or size() for none
+     */
+    void evictToBudget(size_t keep);
+
+    /**
+     * @brief Drop a deck's cards, keeping its metadata
+     *
+     * @param entry The deck
+     */
+    void evict(Entry &entry);
+
+    std::vector<Entry> m_entries; ///< Every deck in directory order
+    size_t m_memoryBudget;        ///< Bytes of cards to keep loaded
+    size_t m_memoryUsed{0};       ///< Estimated bytes held by the loaded decks
+    uint64_t m_clock{0};          ///< Increases every time a deck is used
+    size_t m_current;             ///< The most recently used deck, size() if none
+    size_t m_reloads{0};          ///< Decks read back after being evicted
+};
+
+#endif // DECK_LIBRARY_H
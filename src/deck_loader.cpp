@@ -0,0 +1,178 @@
+/**
+ * @file deck_loader.cpp
+ * @author Green Alligators
+ * @brief Batched reading of deck files for library scans
+ * @version 1.0.0
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "deck_loader.h"
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+
+bool readFileContents(const fs::path &path, std::string &contents)
+{
+    std::ifstream inf{path, std::ios::binary | std::ios::ate};
+    if (!inf)
+    {
+        return false;
+    }
+    std::streamoff size = inf.tellg();
+    if (size < 0)
+    {
+        return false;
+    }
+    contents.resize(static_cast<size_t>(size));
+    inf.seekg(0);
+    inf.read(contents.data(), size);
+    return inf.gcount() == size;
+}
+
+
+void SerialIoBackend::readFiles(const std::vector<fs::path> &paths,
+                                const std::function<void(size_t, std::string &, bool)> &on_complete)
+{
+    std::string contents{};
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        bool ok = readFileContents(paths[i], contents);
+        on_complete(i, contents, ok);
+    }
+}
+
+
+ThreadPoolIoBackend::ThreadPoolIoBackend(unsigned int n_threads) : m_nThreads(n_threads)
+{
+    if (m_nThreads == 0)
+    {
+        m_nThreads = std::thread::hardware_concurrency();
+    }
+    if (m_nThreads == 0)
+    {
+        m_nThreads = 4;
+    }
+}
+
+void ThreadPoolIoBackend::readFiles(const std::vector<fs::path> &paths,
+                                    const std::function<void(size_t, std::string &, bool)> &on_complete)
+{
+    size_t n_workers = m_nThreads;
+    if (paths.size() < n_workers)
+    {
+        n_workers = paths.size();
+    }
+    // not worth starting threads for a single file
+    if (n_workers <= 1)
+    {
+        SerialIoBackend{}.readFiles(paths, on_complete);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error{};
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        // each worker reuses a single buffer for all the files it reads
+        std::string contents{};
+        size_t i;
+        while (!failed && (i = next.fetch_add(1)) < paths.size())
+        {
+            try
+            {
+                bool ok = readFileContents(paths[i], contents);
+                on_complete(i, contents, ok);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock{error_mutex};
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(n_workers - 1);
+    for (size_t t = 1; t < n_workers; ++t)
+    {
+        workers.emplace_back(worker);
+    }
+    // the calling thread does its share of the reads too
+    worker();
+    for (std::thread &t : workers)
+    {
+        t.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+
+std::unique_ptr<DeckIoBackend> createDefaultIoBackend()
+{
+    return std::make_unique<ThreadPoolIoBackend>();
+}
+
+
+std::vector<fs::path> listDeckFiles(const fs::path &deck_dir_path)
+{
+    std::vector<fs::path> deck_files;
+    for (const auto &entry : fs::directory_iterator(deck_dir_path))
+    {
+        if (entry.is_regular_file() && entry.path().string().ends_with(".deck"))
+        {
+            deck_files.push_back(entry.path());
+        }
+    }
+    return deck_files;
+}
+
+std::vector<fs::file_time_type> stampDeckFiles(const std::vector<fs::path> &deck_files)
+{
+    std::vector<fs::file_time_type> read_times(deck_files.size());
+    for (size_t i = 0; i < deck_files.size(); i++)
+    {
+        std::error_code ec;
+        read_times[i] = fs::last_write_time(deck_files[i], ec);
+    }
+    return read_times;
+}
+
+
+std::vector<FlashCardDeck> loadFlashCardDecks(const fs::path &deck_dir_path, DeckIoBackend &backend)
+{
+    // Check the deck directory exists
+    if (!fs::exists(deck_dir_path) || !fs::is_directory(deck_dir_path))
+    {
+        std::cerr << "Directory does not exist, or is not a directory";
+        throw 0;
+    }
+
+    std::vector<fs::path> deck_files = listDeckFiles(deck_dir_path);
+    // every deck gets its own slot so workers never touch the same element
+    std::vector<FlashCardDeck> deck_array(deck_files.size());
+    std::vector<fs::file_time_type> read_times = stampDeckFiles(deck_files);
+    backend.readFiles(deck_files, [&](size_t i, std::string &contents, bool ok) {
+        if (ok)
+        {
+            deck_array[i] = parseFlashCardDeck(contents);
+        }
+        deck_array[i].filename = deck_files[i];
+        deck_array[i].indexed_time = read_times[i];
+    });
+
+    return deck_array;
+}
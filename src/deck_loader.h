@@ -0,0 +1,125 @@
+/**
+ * @file deck_loader.h
+ * @author Green Alligators
+ * @brief Batched reading of deck files for library scans
+ * @details Reading a library one file at a time leaves the disk idle while each open/read round trip completes.
+ * An I/O backend instead takes the whole list of deck files and keeps several reads in flight, handing each
+ * file's contents to the parser as soon as it has been read.
+ *
+ * @version 1.0.0
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef DECK_LOADER_H
+#define DECK_LOADER_H
+
+#include "deck.h"
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Interface for reading a batch of files
+ *
+ */
+class DeckIoBackend
+{
+public:
+    virtual ~DeckIoBackend() = default;
+
+    /**
+     * @brief Read every file in paths
+     * @details on_complete is called once per file with its index into paths and its contents. Calls may come from
+     * several threads at once and in any order, but never twice for the same index. A file that cannot be read is
+     * reported with ok set to false. Exceptions thrown by on_complete are passed back to the caller of readFiles.
+     *
+     * @param paths The files to read
+     * @param on_complete Called with (index, contents, ok) as each read finishes
+     */
+    virtual void readFiles(const std::vector<std::filesystem::path> &paths,
+                           const std::function<void(size_t, std::string &, bool)> &on_complete) = 0;
+};
+
+/**
+ * @brief Reads files one after another on the calling thread
+ *
+ */
+class SerialIoBackend : public DeckIoBackend
+{
+public:
+    void readFiles(const std::vector<std::filesystem::path> &paths,
+                   const std::function<void(size_t, std::string &, bool)> &on_complete) override;
+};
+
+/**
+ * @brief Reads files concurrently using a pool of worker threads
+ * @details Each worker claims the next unread file, reads it in a single call and immediately hands it to
+ * on_complete, so parsing of one deck overlaps the reads of the others.
+ */
+class ThreadPoolIoBackend : public DeckIoBackend
+{
+public:
+    /**
+     * @brief Construct a new Thread Pool Io Backend object
+     *
+     * @param n_threads Number of worker threads, 0 picks one per hardware thread
+     */
+    explicit ThreadPoolIoBackend(unsigned int n_threads = 0);
+
+    void readFiles(const std::vector<std::filesystem::path> &paths,
+                   const std::function<void(size_t, std::string &, bool)> &on_complete) override;
+
+private:
+    unsigned int m_nThreads; ///< The number of worker threads to use
+};
+
+/**
+ * @brief Read the whole of a file into a string
+ *
+ * @param path The file to read
+ * @param contents Set to the file contents
+ * @return true if the file was read successfully
+ */
+bool readFileContents(const std::filesystem::path &path, std::string &contents);
+
+/**
+ * @brief Create the backend best suited to the current platform
+ *
+ * @return std::unique_ptr<DeckIoBackend>
+ */
+std::unique_ptr<DeckIoBackend> createDefaultIoBackend();
+
+/**
+ * @brief List the ".deck" files within a directory
+ *
+ * @param deck_dir_path The directory to search
+ * @return std::vector<std::filesystem::path>
+ */
+std::vector<std::filesystem::path> listDeckFiles(const std::filesystem::path &deck_dir_path);
+
+/**
+ * @brief Take the last write time of each deck file before it is read
+ * @details A deck's card slots are only trusted while its file keeps this time, so a write that lands during the
+ * read makes the deck fall back to a full rewrite instead of patching from stale slots.
+ *
+ * @param deck_files The deck files about to be read
+ * @return std::vector<std::filesystem::file_time_type> One time per file, the default time if it could not be read
+ */
+std::vector<std::filesystem::file_time_type> stampDeckFiles(const std::vector<std::filesystem::path> &deck_files);
+
+/**
+ * @brief Load all the decks in a directory through the given backend
+ * @details Behaves the same as loadFlashCardDecks(), decks are returned in directory order.
+ *
+ * @param deck_dir_path The directory containing the deck files
+ * @param backend The backend used to read the files
+ * @return std::vector<FlashCardDeck>
+ */
+std::vector<FlashCardDeck> loadFlashCardDecks(const std::filesystem::path &deck_dir_path, DeckIoBackend &backend);
+
+#endif // DECK_LOADER_H
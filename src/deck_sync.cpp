@@ -0,0 +1,518 @@
+/**
+ * @file deck_sync.cpp
+ * @author Green Alligators
+ * @brief Synchronising two deck libraries by transferring only the blocks that differ
+ * @version 1.0.0
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "deck_sync.h"
+#include "deck_backup.h"
+#include "deck_compress.h"
+#include "deck_export.h"
+#include "deck_loader.h"
+#include "hash.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+
+namespace
+{
+// the native text of a deck, exactly as writeFlashCardDeck would write it
+std::string deckText(const FlashCardDeck &deck)
+{
+    std::ostringstream oss;
+    NativeDeckExporter exporter{oss};
+    exportDeck(deck, exporter);
+    return oss.str();
+}
+
+// the order used to break ties, UNKNOWN is the easiest
+int difficultyRank(CardDifficulty difficulty)
+{
+    switch (difficulty)
+    {
+    case EASY:
+        return 1;
+    case MEDIUM:
+        return 2;
+    case HARD:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+// whether a card is the same in two copies of a deck, so it was not edited or studied in between
+bool sameCard(const FlashCard &a, const FlashCard &b)
+{
+    return a.question == b.question && a.answer == b.answer && a.difficulty == b.difficulty &&
+           a.n_times_answered == b.n_times_answered && a.tags == b.tags && a.schedule.due == b.schedule.due &&
+           a.schedule.reviewed == b.schedule.reviewed && a.schedule.lapses == b.schedule.lapses &&
+           a.schedule.failures == b.schedule.failures;
+}
+
+// the position in to of each card of from with the same question, repeated questions pair up in order
+std::vector<size_t> matchCards(const std::vector<FlashCard> &from, const std::vector<FlashCard> &to)
+{
+    std::unordered_map<std::string, std::vector<size_t>> positions;
+    for (size_t i = 0; i < to.size(); ++i)
+    {
+        positions[to[i].question].push_back(i);
+    }
+    std::unordered_map<std::string, size_t> n_used;
+    std::vector<size_t> matches(from.size(), SIZE_MAX);
+    for (size_t i = 0; i < from.size(); ++i)
+    {
+        auto found = positions.find(from[i].question);
+        size_t &used = n_used[from[i].question];
+        if (found != positions.end() && used < found->second.size())
+        {
+            matches[i] = found->second[used++];
+        }
+    }
+    return matches;
+}
+
+// a card only one copy has is kept, unless the other copy deleted it: it was in the base and is unchanged since
+bool keepUnmatched(const FlashCard &card, size_t base_position, const FlashCardDeck &base)
+{
+    return base_position == SIZE_MAX || !sameCard(card, base.cards[base_position]);
+}
+
+// where the state of the last sync with other is recorded in dir's backup store
+fs::path syncStatePath(const fs::path &dir, const fs::path &other)
+{
+    std::string key = sha256Hex(fs::weakly_canonical(other).generic_string()).substr(0, 16);
+    return DeckBackupStore::storeDirFor(dir) / ("sync-" + key);
+}
+
+// the backup snapshot of each deck file as it was after the last sync
+std::map<std::string, uint64_t> readSyncState(const fs::path &path)
+{
+    std::map<std::string, uint64_t> state;
+    std::ifstream in{path};
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream iss{line};
+        uint64_t id{};
+        std::string name;
+        if (iss >> id && iss.get() == ' ' && std::getline(iss, name))
+        {
+            state[name] = id;
+        }
+    }
+    return state;
+}
+
+void writeSyncState(const fs::path &path, const std::map<std::string, uint64_t> &state)
+{
+    fs::path tmp = path;
+    tmp += ".tmp";
+    std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+    for (const auto &[name, id] : state)
+    {
+        out << id << ' ' << name << '\n';
+    }
+    out.close();
+    std::error_code ec;
+    if (!out)
+    {
+        std::cerr << "Could not write " << tmp << std::endl;
+        fs::remove(tmp, ec);
+        return;
+    }
+    fs::rename(tmp, path, ec);
+}
+
+// send data to dest, which currently holds basis, as a delta and write the rebuilt file
+void transferFile(const std::string &data, const std::string &basis, const fs::path &dest, SyncReport &report)
+{
+    // the receiver signs its copy, the sender works out the delta and the receiver rebuilds
+    FileSignature signature = computeSignature(basis);
+    FileDelta delta = computeDelta(signature, data);
+    std::string rebuilt{};
+    if (!applyDelta(basis, signature.block_size, delta, rebuilt) || rebuilt != data)
+    {
+        std::cerr << "Sync produced a corrupt copy of " << dest;
+        throw 0;
+    }
+    report.literal_bytes += delta.literal_bytes;
+    report.matched_bytes += delta.matched_bytes;
+
+    if (fs::exists(dest))
+    {
+        backupDeckFile(dest);
+    }
+    fs::path tmp = dest;
+    tmp += ".sync";
+    {
+        std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+        out.write(rebuilt.data(), static_cast<std::streamsize>(rebuilt.size()));
+        if (!out)
+        {
+            std::cerr << "Could not write " << tmp;
+            throw 0;
+        }
+    }
+    fs::rename(tmp, dest);
+    backupDeckFile(dest);
+}
+} // namespace
+
+
+uint32_t weakChecksum(const char *data, size_t len)
+{
+    uint32_t a{0};
+    uint32_t b{0};
+    for (size_t i = 0; i < len; ++i)
+    {
+        a += static_cast<uint8_t>(data[i]);
+        b += a;
+    }
+    return (a & 0xFFFF) | ((b & 0xFFFF) << 16);
+}
+
+size_t syncBlockSize(size_t file_size)
+{
+    size_t block_size{256};
+    while (block_size < 16 * 1024 && block_size * block_size < file_size)
+    {
+        block_size *= 2;
+    }
+    return block_size;
+}
+
+FileSignature computeSignature(const std::string &data, size_t block_size)
+{
+    FileSignature signature{};
+    signature.block_size = block_size == 0 ? syncBlockSize(data.size()) : block_size;
+    signature.file_size = data.size();
+    for (size_t offset = 0; offset < data.size(); offset += signature.block_size)
+    {
+        size_t len = data.size() - offset;
+        if (len > signature.block_size)
+        {
+            len = signature.block_size;
+        }
+        std::string_view block{data.data() + offset, len};
+        signature.blocks.push_back({weakChecksum(block.data(), len), sha256Hex(block)});
+    }
+    return signature;
+}
+
+FileDelta computeDelta(const FileSignature &basis, const std::string &data)
+{
+    FileDelta delta{};
+    std::string literal{};
+
+    auto flushLiteral = [&]() {
+        if (!literal.empty())
+        {
+            delta.literal_bytes += literal.size();
+            delta.ops.push_back({0, 0, std::move(literal)});
+            literal.clear();
+        }
+    };
+    auto copyBlock = [&](size_t index, size_t len) {
+        flushLiteral();
+        delta.matched_bytes += len;
+        // runs of consecutive blocks become a single op
+        if (!delta.ops.empty() && delta.ops.back().block_count > 0 &&
+            delta.ops.back().first_block + delta.ops.back().block_count == index)
+        {
+            delta.ops.back().block_count++;
+        }
+        else
+        {
+            delta.ops.push_back({index, 1, ""});
+        }
+    };
+
+    const size_t bs = basis.block_size;
+    const size_t n = data.size();
+    // only full blocks can be found at arbitrary offsets, a short final block is checked at the end of the data
+    std::unordered_map<uint32_t, std::vector<size_t>> blocks_by_weak;
+    for (size_t i = 0; i < basis.blocks.size(); ++i)
+    {
+        if ((i + 1) * bs <= basis.file_size)
+        {
+            blocks_by_weak[basis.blocks[i].weak].push_back(i);
+        }
+    }
+
+    size_t pos{0};
+    if (bs > 0 && !blocks_by_weak.empty())
+    {
+        uint32_t a{0};
+        uint32_t b{0};
+        bool fresh = true;
+        while (pos + bs <= n)
+        {
+            if (fresh)
+            {
+                uint32_t sum = weakChecksum(data.data() + pos, bs);
+                a = sum & 0xFFFF;
+                b = sum >> 16;
+                fresh = false;
+            }
+
+            uint32_t weak = (a & 0xFFFF) | ((b & 0xFFFF) << 16);
+            auto found = blocks_by_weak.find(weak);
+            if (found != blocks_by_weak.end())
+            {
+                std::string strong = sha256Hex(std::string_view{data.data() + pos, bs});
+                bool matched = false;
+                for (size_t index : found->second)
+                {
+                    if (basis.blocks[index].strong == strong)
+                    {
+                        copyBlock(index, bs);
+                        matched = true;
+                        break;
+                    }
+                }
+                if (matched)
+                {
+                    pos += bs;
+                    fresh = true;
+                    continue;
+                }
+            }
+
+            // slide the window one byte
+            uint8_t out = static_cast<uint8_t>(data[pos]);
+            literal += data[pos];
+            pos++;
+            if (pos + bs <= n)
+            {
+                uint8_t in = static_cast<uint8_t>(data[pos + bs - 1]);
+                a = a - out + in;
+                b = b - static_cast<uint32_t>(bs) * out + a;
+            }
+        }
+    }
+
+    // the remaining bytes may be the basis' short final block
+    size_t remaining = n - pos;
+    if (remaining > 0 && !basis.blocks.empty() && basis.file_size % bs == remaining)
+    {
+        const BlockSignature &last = basis.blocks.back();
+        std::string_view tail{data.data() + pos, remaining};
+        if (last.weak == weakChecksum(tail.data(), remaining) && last.strong == sha256Hex(tail))
+        {
+            copyBlock(basis.blocks.size() - 1, remaining);
+            pos = n;
+        }
+    }
+    literal.append(data, pos, std::string::npos);
+    flushLiteral();
+    return delta;
+}
+
+bool applyDelta(const std::string &basis, size_t block_size, const FileDelta &delta, std::string &out)
+{
+    out.clear();
+    for (const DeltaOp &op : delta.ops)
+    {
+        if (op.block_count == 0)
+        {
+            out.append(op.literal);
+            continue;
+        }
+        size_t offset = op.first_block * block_size;
+        if (offset >= basis.size())
+        {
+            return false;
+        }
+        out.append(basis, offset, op.block_count * block_size);
+    }
+    return true;
+}
+
+FlashCardDeck mergeFlashCardDecks(const FlashCardDeck &ours, const FlashCardDeck &theirs, SyncReport &report)
+{
+    return mergeFlashCardDecks(FlashCardDeck{}, ours, theirs, report);
+}
+
+FlashCardDeck mergeFlashCardDecks(const FlashCardDeck &base,
+                                  const FlashCardDeck &ours,
+                                  const FlashCardDeck &theirs,
+                                  SyncReport &report)
+{
+    std::vector<size_t> our_in_theirs = matchCards(ours.cards, theirs.cards);
+    std::vector<size_t> our_in_base = matchCards(ours.cards, base.cards);
+    std::vector<size_t> their_in_base = matchCards(theirs.cards, base.cards);
+    std::vector<bool> their_matched(theirs.cards.size(), false);
+
+    FlashCardDeck merged{};
+    merged.name = ours.name;
+    merged.filename = ours.filename;
+    // deck tags added on either side are kept
+    merged.tags = ours.tags;
+    for (const std::string &tag : theirs.tags)
+    {
+        if (std::find(merged.tags.begin(), merged.tags.end(), tag) == merged.tags.end())
+        {
+            merged.tags.push_back(tag);
+        }
+    }
+    merged.cards.reserve(ours.cards.size());
+    for (size_t i = 0; i < ours.cards.size(); ++i)
+    {
+        const FlashCard &our_card = ours.cards[i];
+        if (our_in_theirs[i] == SIZE_MAX)
+        {
+            if (keepUnmatched(our_card, our_in_base[i], base))
+            {
+                merged.cards.push_back(our_card);
+                report.cards_added++;
+            }
+            else
+            {
+                report.cards_deleted++;
+            }
+            continue;
+        }
+        size_t j = our_in_theirs[i];
+        their_matched[j] = true;
+        const FlashCard &their_card = theirs.cards[j];
+
+        FlashCard card = our_card;
+        if (their_card.n_times_answered > our_card.n_times_answered)
+        {
+            card.n_times_answered = their_card.n_times_answered;
+            card.difficulty = their_card.difficulty;
+            card.answer = their_card.answer;
+            card.tags = their_card.tags;
+            card.schedule = their_card.schedule;
+        }
+        else if (their_card.n_times_answered == our_card.n_times_answered &&
+                 difficultyRank(their_card.difficulty) > difficultyRank(our_card.difficulty))
+        {
+            card.difficulty = their_card.difficulty;
+        }
+        if (our_card.n_times_answered != their_card.n_times_answered ||
+            our_card.difficulty != their_card.difficulty || our_card.answer != their_card.answer)
+        {
+            report.cards_merged++;
+        }
+        merged.cards.push_back(std::move(card));
+    }
+    for (size_t j = 0; j < theirs.cards.size(); ++j)
+    {
+        if (their_matched[j])
+        {
+            continue;
+        }
+        if (keepUnmatched(theirs.cards[j], their_in_base[j], base))
+        {
+            merged.cards.push_back(theirs.cards[j]);
+            report.cards_added++;
+        }
+        else
+        {
+            report.cards_deleted++;
+        }
+    }
+    return merged;
+}
+
+SyncReport syncDeckLibraries(const fs::path &local_dir, const fs::path &remote_dir)
+{
+    for (const fs::path &dir : {local_dir, remote_dir})
+    {
+        if (!fs::exists(dir) || !fs::is_directory(dir))
+        {
+            std::cerr << "Directory does not exist, or is not a directory";
+            throw 0;
+        }
+    }
+
+    // sorted so a sync always processes files in the same order
+    std::set<std::string> names;
+    for (const fs::path &dir : {local_dir, remote_dir})
+    {
+        for (const fs::path &deck_file : listDeckFiles(dir))
+        {
+            names.insert(deck_file.filename().string());
+        }
+    }
+
+    // what both libraries held after they were last synced, missing the first time they are
+    DeckBackupStore local_store{DeckBackupStore::storeDirFor(local_dir)};
+    std::map<std::string, uint64_t> base_state = readSyncState(syncStatePath(local_dir, remote_dir));
+    std::map<std::string, uint64_t> local_state{};
+    std::map<std::string, uint64_t> remote_state{};
+
+    SyncReport report{};
+    std::string local_contents{};
+    std::string remote_contents{};
+    std::string base_contents{};
+    for (const std::string &name : names)
+    {
+        report.files_scanned++;
+        fs::path local_file = local_dir / name;
+        fs::path remote_file = remote_dir / name;
+        bool have_local = fs::exists(local_file) && readFileContents(local_file, local_contents);
+        bool have_remote = fs::exists(remote_file) && readFileContents(remote_file, remote_contents);
+        auto base_id = base_state.find(name);
+        bool have_base = base_id != base_state.end() && local_store.readSnapshot(base_id->second, base_contents);
+
+        if (have_local != have_remote)
+        {
+            const std::string &contents = have_local ? local_contents : remote_contents;
+            const fs::path &file = have_local ? local_file : remote_file;
+            // deleted on the other side since the last sync and not changed on this one
+            if (have_base && contents == base_contents)
+            {
+                backupDeckFile(file);
+                fs::remove(file);
+                report.files_deleted++;
+                continue;
+            }
+            transferFile(contents, "", have_local ? remote_file : local_file, report);
+            report.files_copied++;
+        }
+        else if (local_contents == remote_contents)
+        {
+            report.files_unchanged++;
+        }
+        else
+        {
+            FlashCardDeck local_deck = parseFlashCardDeck(std::string{local_contents});
+            FlashCardDeck remote_deck = parseFlashCardDeck(std::string{remote_contents});
+            FlashCardDeck base_deck = have_base ? parseFlashCardDeck(base_contents) : FlashCardDeck{};
+            std::string merged = deckText(mergeFlashCardDecks(base_deck, local_deck, remote_deck, report));
+            // the merged deck is stored in the same form as the local one
+            if (local_deck.compressed)
+            {
+                merged = compressDeckText(merged);
+            }
+            if (merged != local_contents)
+            {
+                transferFile(merged, local_contents, local_file, report);
+            }
+            if (merged != remote_contents)
+            {
+                transferFile(merged, remote_contents, remote_file, report);
+            }
+            report.files_merged++;
+        }
+        local_state[name] = backupDeckFile(local_file);
+        remote_state[name] = backupDeckFile(remote_file);
+    }
+    writeSyncState(syncStatePath(local_dir, remote_dir), local_state);
+    writeSyncState(syncStatePath(remote_dir, local_dir), remote_state);
+    return report;
+}
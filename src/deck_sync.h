@@ -0,0 +1,207 @@
+/**
+ * @file deck_sync.h
+ * @author Green Alligators
+ * @brief Synchronising two deck libraries by transferring only the blocks that differ
+ * @details Files are compared the way rsync does it. The side receiving a file describes its current copy with a
+ * signature of per-block checksums, the sending side slides a rolling checksum over its version to find blocks the
+ * receiver already has, and only the bytes between matched blocks are transferred as literals. The receiver then
+ * rebuilds the file from its own blocks and the literals.
+ *
+ * When both libraries have changed the same deck the cards are merged before transfer, see mergeFlashCardDecks()
+ * for the conflict rule. Each library records which backup snapshot of every deck it held after the last sync, so
+ * the next sync can tell a deck or card deleted on one side from one added on the other.
+ *
+ * @version 1.0.0
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef DECK_SYNC_H
+#define DECK_SYNC_H
+
+#include "deck.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Checksums of one block of a file
+ *
+ */
+struct BlockSignature
+{
+    /** rolling checksum, cheap to compute at every offset */
+    uint32_t weak{};
+    /** SHA-256 of the block in hex, confirms a weak match */
+    std::string strong{};
+};
+
+/**
+ * @brief Description of a file that lets another copy be expressed as a delta against it
+ *
+ */
+struct FileSignature
+{
+    /** size of every block except possibly the last */
+    size_t block_size{};
+    /** size of the file in bytes */
+    size_t file_size{};
+    /** checksums of each block in order */
+    std::vector<BlockSignature> blocks{};
+};
+
+/**
+ * @brief One instruction for rebuilding a file
+ * @details Either copies block_count blocks of the basis file starting at first_block, or inserts literal.
+ *
+ */
+struct DeltaOp
+{
+    /** first basis block to copy, unused for literals */
+    size_t first_block{};
+    /** number of basis blocks to copy, 0 for a literal */
+    size_t block_count{};
+    /** bytes to insert when block_count is 0 */
+    std::string literal{};
+};
+
+/**
+ * @brief Instructions for turning a basis file into a new version
+ *
+ */
+struct FileDelta
+{
+    std::vector<DeltaOp> ops{};
+    /** bytes that have to be transferred */
+    size_t literal_bytes{};
+    /** bytes reused from the basis file */
+    size_t matched_bytes{};
+};
+
+/**
+ * @brief Totals for a library sync
+ *
+ */
+struct SyncReport
+{
+    /** deck files seen in either library */
+    size_t files_scanned{};
+    /** files that only existed on one side and were copied */
+    size_t files_copied{};
+    /** files deleted on one side since the last sync and removed from the other */
+    size_t files_deleted{};
+    /** files that existed on both sides with different contents */
+    size_t files_merged{};
+    /** files already identical on both sides */
+    size_t files_unchanged{};
+    /** cards whose statistics differed and were merged */
+    size_t cards_merged{};
+    /** cards that only existed in one copy of a deck */
+    size_t cards_added{};
+    /** cards deleted from one copy of a deck since the last sync and dropped from the other */
+    size_t cards_deleted{};
+    /** bytes that had to be transferred */
+    size_t literal_bytes{};
+    /** bytes rebuilt from blocks the receiver already had */
+    size_t matched_bytes{};
+};
+
+/**
+ * @brief The rolling checksum of a block (the rsync / Adler-32 style sum of bytes and sum of running sums)
+ *
+ * @param data Start of the block
+ * @param len Length of the block
+ * @return uint32_t
+ */
+uint32_t weakChecksum(const char *data, size_t len);
+
+/**
+ * @brief Pick a block size for a file, roughly the square root of its size
+ *
+ * @param file_size The size of the file
+ * @return size_t
+ */
+size_t syncBlockSize(size_t file_size);
+
+/**
+ * @brief Compute the block signature of a file's contents
+ *
+ * @param data The contents
+ * @param block_size Size of the blocks, 0 to use syncBlockSize()
+ * @return FileSignature
+ */
+FileSignature computeSignature(const std::string &data, size_t block_size = 0);
+
+/**
+ * @brief Express new contents as blocks of the signed basis plus literal bytes
+ *
+ * @param basis The signature of the receiver's copy
+ * @param data The new contents
+ * @return FileDelta
+ */
+FileDelta computeDelta(const FileSignature &basis, const std::string &data);
+
+/**
+ * @brief Rebuild new contents from the basis and a delta
+ *
+ * @param basis The receiver's copy the delta was computed against
+ * @param block_size The block size of the signature the delta was computed against
+ * @param delta The delta
+ * @param out Set to the rebuilt contents
+ * @return true if every copied block was inside the basis
+ */
+bool applyDelta(const std::string &basis, size_t block_size, const FileDelta &delta, std::string &out);
+
+/**
+ * @brief Merge two copies of the same deck
+ * @details Cards are matched by question, repeated questions are matched in order of appearance. Cards only in
+ * one copy are kept, those in ours first in our order followed by the rest of theirs. For matched cards:
+ * - n_times_answered is the larger of the two
+ * - difficulty, answer and schedule come from the copy that has been answered more often, a tie takes the harder
+ *   difficulty and our answer and schedule
+ *
+ * With no common base to tell deletions from additions this is a union, a card deleted from one copy comes back
+ * from the other.
+ *
+ * @param ours Our copy, its name is kept
+ * @param theirs The other copy
+ * @param report Counts of merged and added cards are added to it
+ * @return FlashCardDeck
+ */
+FlashCardDeck mergeFlashCardDecks(const FlashCardDeck &ours, const FlashCardDeck &theirs, SyncReport &report);
+
+/**
+ * @brief Merge two copies of the same deck that were both changed since a common version
+ * @details As mergeFlashCardDecks(ours, theirs), except that a card only in one copy is dropped when it is in the
+ * base and that copy has not changed it since, as the other copy deleted it. A card changed on one side and deleted
+ * on the other is kept.
+ *
+ * @param base The deck both copies had after the last sync, empty if there was none
+ * @param ours Our copy, its name is kept
+ * @param theirs The other copy
+ * @param report Counts of merged, added and deleted cards are added to it
+ * @return FlashCardDeck
+ */
+FlashCardDeck mergeFlashCardDecks(const FlashCardDeck &base,
+                                  const FlashCardDeck &ours,
+                                  const FlashCardDeck &theirs,
+                                  SyncReport &report);
+
+/**
+ * @brief Make two deck libraries identical
+ * @details Decks only in one library are copied to the other, unless they were synced before and the other library
+ * has since deleted them, in which case they are deleted here too. Decks in both that differ are merged against
+ * their version from the last sync and each side is updated with a delta against its current copy. Updated and
+ * deleted files are backed up first and written through a temporary file, so a sync can be undone from the backup
+ * store.
+ *
+ * @param local_dir One deck directory
+ * @param remote_dir The other deck directory
+ * @return SyncReport
+ */
+SyncReport syncDeckLibraries(const std::filesystem::path &local_dir, const std::filesystem::path &remote_dir);
+
+#endif // DECK_SYNC_H
@@ -0,0 +1,162 @@
+/**
+ * @file due_merge.cpp
+ * @author Green Alligators
+ * @brief Study the due cards of every deck in a library as one session
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "due_merge.h"
+#include "leech.h"
+#include "scheduler.h"
+#include <algorithm>
+
+
+DueMerge::DueMerge(DeckLibrary &library, int64_t now, size_t limit) : m_library(library), m_now(now), m_limit(limit)
+{
+    // only the library's metadata is read here, no deck is loaded
+    for (size_t i = 0; i < m_library.size(); ++i)
+    {
+        int64_t due = m_library.nextDue(i);
+        if (due != 0 && due <= m_now)
+        {
+            m_heap.push_back(Head{due, i});
+        }
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), laterHead);
+}
+
+bool DueMerge::next(DueCard &origin, FlashCard &card)
+{
+    while (m_taken < m_limit && !m_heap.empty())
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), laterHead);
+        Head head = m_heap.back();
+        m_heap.pop_back();
+
+        auto found = m_runs.find(head.deck);
+        bool opened = found == m_runs.end();
+        Run &run = opened ? open(head.deck) : found->second;
+        if (run.next >= run.cards.size())
+        {
+            continue;
+        }
+        // the metadata may be older than the deck, so a newly opened deck goes back in at its real due time
+        if (opened && run.origins[run.next].due != head.due)
+        {
+            m_heap.push_back(Head{run.origins[run.next].due, head.deck});
+            std::push_heap(m_heap.begin(), m_heap.end(), laterHead);
+            continue;
+        }
+
+        origin = run.origins[run.next];
+        card = std::move(run.cards[run.next]);
+        run.next++;
+        m_taken++;
+        if (run.next < run.cards.size())
+        {
+            m_heap.push_back(Head{run.origins[run.next].due, head.deck});
+            std::push_heap(m_heap.begin(), m_heap.end(), laterHead);
+        }
+        else
+        {
+            // keep the run so the deck is not opened again, but give back its cards
+            std::vector<FlashCard>{}.swap(run.cards);
+            std::vector<DueCard>{}.swap(run.origins);
+            run.next = 0;
+        }
+        return true;
+    }
+    return false;
+}
+
+const std::string &DueMerge::deckName(size_t deck) const
+{
+    return m_library.name(deck);
+}
+
+size_t DueMerge::decksOpened() const
+{
+    return m_runs.size();
+}
+
+void DueMerge::record(const DueCard &origin, const FlashCard &reviewed)
+{
+    m_pending[origin.deck].emplace_back(origin, reviewed);
+}
+
+size_t DueMerge::pendingCount() const
+{
+    size_t count = 0;
+    for (const auto &[deck, reviews] : m_pending)
+    {
+        count += reviews.size();
+    }
+    return count;
+}
+
+size_t DueMerge::writeBack()
+{
+    size_t saved = 0;
+    for (const auto &[deck_index, reviews] : m_pending)
+    {
+        FlashCardDeck &deck = m_library.deck(deck_index);
+        bool changed = false;
+        for (const auto &[origin, reviewed] : reviews)
+        {
+            if (origin.card >= deck.cards.size())
+            {
+                continue;
+            }
+            FlashCard &card = deck.cards[origin.card];
+            if (card.question != reviewed.question || card.answer != reviewed.answer)
+            {
+                continue;
+            }
+            card.difficulty = reviewed.difficulty;
+            card.n_times_answered = reviewed.n_times_answered;
+            card.schedule = reviewed.schedule;
+            // a review can make the card a leech
+            card.tags = reviewed.tags;
+            changed = true;
+        }
+        if (changed && writeFlashCardDeckWithChecks(deck, deck.filename, true))
+        {
+            saved++;
+        }
+    }
+    m_pending.clear();
+    return saved;
+}
+
+bool DueMerge::laterHead(const Head &a, const Head &b)
+{
+    return a.due != b.due ? a.due > b.due : a.deck > b.deck;
+}
+
+DueMerge::Run &DueMerge::open(size_t deck_index)
+{
+    const FlashCardDeck &deck = m_library.deck(deck_index);
+    std::vector<size_t> candidates{};
+    candidates.reserve(deck.cards.size());
+    for (size_t i = 0; i < deck.cards.size(); ++i)
+    {
+        if (!isSuspended(deck.cards[i]))
+        {
+            candidates.push_back(i);
+        }
+    }
+    DueQueue queue{deck.cards, candidates};
+
+    // no more cards are pulled than the session can still take
+    Run &run = m_runs[deck_index];
+    size_t card = 0;
+    while (run.cards.size() < m_limit - m_taken && queue.popDue(m_now, card))
+    {
+        run.origins.push_back(DueCard{deck_index, card, deck.cards[card].schedule.due});
+        run.cards.push_back(deck.cards[card]);
+    }
+    return run;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file due_merge.h
+ * @author Green Alligators
+ * @brief Study the due cards of every deck in a library as one session
+ * @details A DueMerge is a k-way merge of the due queues of every deck. Its heap holds one entry per deck, keyed on
+ * when that deck's next card is due, so the card that has been due the longest across the whole library is always on
+ * top.
+ *
+ * Decks are opened lazily. At first a deck's entry is keyed on the earliest due time the library keeps with its
+ * metadata, without loading the deck. Only when that entry reaches the top is the deck loaded and its due cards
+ * pulled from a DueQueue. A deck whose cards are not due before the session is full is never loaded, so a short
+ * session over thousands of decks only reads the decks it studies.
+ *
+ * Reviewed cards are held until writeBack(), which loads each deck they came from once, applies all of its reviews
+ * and saves it.
+ *
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef DUE_MERGE_H
+#define DUE_MERGE_H
+
+#include "deck.h"
+#include "deck_library.h"
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Where a card in a merged session came from
+ *
+ */
+struct DueCard
+{
+    size_t deck; ///< The deck's index in the library
+    size_t card; ///< The card's index in its deck
+    int64_t due; ///< When the card was due
+};
+
+/**
+ * @brief The due cards of every deck in a library, merged in order of when they are due
+ *
+ */
+class DueMerge
+{
+public:
+    /**
+     * @brief Start merging the cards of a library that are due
+     *
+     * @param library The decks, which must outlive the merge and not have decks added or removed while it is used
+     * @param now Cards due at or before this time are merged
+     * @param limit The most cards that will be taken, no more than this are pulled from any deck
+     */
+    DueMerge(DeckLibrary &library, int64_t now, size_t limit);
+
+    /**
+     * @brief Take the card that has been due the longest across every deck
+     *
+     * @param origin Set to where the card came from
+     * @param card Set to a copy of the card
+     * @return true if a card was taken, false once no card is due or the limit is reached
+     */
+    bool next(DueCard &origin, FlashCard &card);
+
+    /**
+     * @brief The name of a deck in the library, without loading it
+     *
+     * @param deck The deck's index in the library
+     * @return const std::string&
+     */
+    const std::string &deckName(size_t deck) const;
+
+    /**
+     * @brief The number of decks that have been loaded to pull their cards
+     *
+     * @return size_t
+     */
+    size_t decksOpened() const;
+
+    /**
+     * @brief Hold a reviewed card to be written back to its deck
+     *
+     * @param origin Where the card came from
+     * @param reviewed The card after its review
+     */
+    void record(const DueCard &origin, const FlashCard &reviewed);
+
+    /**
+     * @brief The number of reviewed cards not yet written back
+     *
+     * @return size_t
+     */
+    size_t pendingCount() const;
+
+    /**
+     * @brief Apply the reviewed cards to their decks and save each changed deck once
+     * @details A card is only updated if its deck still holds it at the same index with the same question and
+     * answer, so a deck edited during the session is not corrupted.
+     *
+     * @return size_t The number of decks saved
+     */
+    size_t writeBack();
+
+private:
+    /**
+     * @brief The due cards pulled from one deck, earliest first
+     *
+     */
+    struct Run
+    {
+        std::vector<FlashCard> cards{}; ///< Copies of the due cards
+        std::vector<DueCard> origins{}; ///< Where each card came from
+        size_t next{0};                 ///< The next card to take
+    };
+
+    /**
+     * @brief A deck in the merge heap
+     *
+     */
+    struct Head
+    {
+        int64_t due; ///< When the deck's next card is due
+        size_t deck; ///< The deck's index in the library
+    };
+
+    /**
+     * @brief The heap order: earliest due first, then by deck so ties do not depend on the heap's layout
+     *
+     * @return true if a leaves the heap after b
+     */
+    static bool laterHead(const Head &a, const Head &b);
+
+    /**
+     * @brief Load a deck and pull its due cards into a run
+     *
+     * @param deck The deck's index in the library
+     * @return Run& The deck's run
+     */
+    Run &open(size_t deck);
+
+    DeckLibrary &m_library;                                                 ///< The decks being studied
+    int64_t m_now;                                                          ///< Cards due by this time are merged
+    size_t m_limit;                                                         ///< The most cards to take
+    size_t m_taken{0};                                                      ///< Cards taken so far
+    std::vector<Head> m_heap;                                               ///< Min-heap with one entry per deck
+    std::unordered_map<size_t, Run> m_runs;                                 ///< The decks opened so far
+    std::map<size_t, std::vector<std::pair<DueCard, FlashCard>>> m_pending; ///< Reviews by deck, not yet saved
+};
+
+#endif // DUE_MERGE_H
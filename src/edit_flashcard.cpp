@@ -174,6 +174,7 @@ void EditFlashcardScene::handleInput()
                 deleteSelectedCard();
                 break;
             case key::key_esc: // Esc
+                recordEdits();
                 m_goBack();
                 break;
             default:
@@ -242,10 +243,17 @@ void EditFlashcardScene::editSelectedCard()
         card.answer = newAnswer;
 
 
-    //Save changes to file
-    writeFlashCardDeckWithChecks(m_deck, m_deck.filename, true);
-
-    window->drawText("Card updated successfully!", 2, 21);
+    //Save changes to file, only the edited card is rewritten when it still fits in its place in the file
+    if (saveEditedFlashCard(m_deck, m_selectedCardIndex))
+    {
+        if (std::find(m_editedCards.begin(), m_editedCards.end(), m_selectedCardIndex) == m_editedCards.end())
+            m_editedCards.push_back(m_selectedCardIndex);
+        window->drawText("Card updated successfully!", 2, 21);
+    }
+    else
+    {
+        window->drawText("Failed to update the deck file.", 2, 21);
+    }
     window->drawText("Press any key to continue...", 2, 22);
     drawLibrarianComment();
 
@@ -254,8 +262,24 @@ void EditFlashcardScene::editSelectedCard()
     m_needsRedraw = true;
 }
 
+void EditFlashcardScene::recordEdits()
+{
+    if (m_editedCards.empty())
+        return;
+
+    std::string note = m_editedCards.size() == 1 ? "edited card " : "edited cards ";
+    for (size_t i = 0; i < m_editedCards.size(); i++)
+    {
+        note += (i == 0 ? "" : ", ") + std::to_string(m_editedCards[i] + 1);
+    }
+    backupDeckFile(m_deck.filename);
+    recordDeckHistory(m_deck, note);
+    m_editedCards.clear();
+}
+
 void EditFlashcardScene::addNewCard()
 {
+    recordEdits();
     auto window = m_uiManager.getWindow();
     m_staticDrawn = false;
     window->clear();
@@ -299,8 +323,9 @@ void EditFlashcardScene::addNewCard()
     m_deck.cards.push_back(newCard);
 
     // Write the updated deck to the file
-    if (writeFlashCardDeckWithChecks(m_deck, m_deck.filename, true))
+    if (rewriteFlashCardDeck(m_deck))
     {
+        recordDeckHistory(m_deck, "added card " + std::to_string(m_deck.cards.size()));
         window->drawText("New card added successfully!", 2, 16);
         drawLibrarianComment();
     }
@@ -321,6 +346,8 @@ void EditFlashcardScene::deleteSelectedCard()
     if (m_deck.cards.empty())
         return;
 
+    // the pending edits refer to card numbers from before the delete
+    recordEdits();
     auto window = m_uiManager.getWindow();
     m_staticDrawn = false;
     window->clear();
@@ -333,14 +360,16 @@ void EditFlashcardScene::deleteSelectedCard()
     int key = _getch();
     if (key == 'Y' || key == 'y')
     {
+        std::string note = "deleted card " + std::to_string(m_selectedCardIndex + 1);
         m_deck.cards.erase(m_deck.cards.begin() + m_selectedCardIndex);
         if (m_selectedCardIndex >= m_deck.cards.size())
             m_selectedCardIndex = m_deck.cards.size() - 1;
 
         // Write the updated deck to the file
 
-        if (writeFlashCardDeckWithChecks(m_deck, m_deck.filename, true))
+        if (rewriteFlashCardDeck(m_deck))
         {
+            recordDeckHistory(m_deck, note);
             window->drawText("Card deleted successfully!", 2, 6);
             drawLibrarianComment();
         }
@@ -377,7 +406,8 @@ EditDeckScene::EditDeckScene(ConsoleUI::UIManager &uiManager,
 
 void EditDeckScene::loadDecks()
 {
-    m_decks = loadFlashCardDecks(m_settings.getDeckDir());
+    m_decks.setMemoryBudget(m_settings.getDeckMemoryBudget());
+    m_decks.load(m_settings.getDeckDir());
     m_selectedDeckIndex = 0;
     m_currentPage = 0;
     m_needsRedraw = true;
@@ -415,7 +445,7 @@ void EditDeckScene::drawBookshelf(std::shared_ptr<ConsoleUI::ConsoleWindow> wind
         {
             do
             {
-                bookshelfIndex = rand() % bookshelfOptions.size();
+                bookshelfIndex = static_cast<int>(rngStream(BOOKSHELF_STREAM).below(bookshelfOptions.size()));
             } while (bookshelfIndex == m_prevBookshelfIndex);
         }
 
@@ -463,7 +493,7 @@ void EditDeckScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
     // Draw deck list
     for (size_t i = 0; i < m_decks.size(); ++i)
     {
-        std::string deckText = (i == m_selectedDeckIndex ? "> " : "  ") + m_decks[i].name;
+        std::string deckText = (i == m_selectedDeckIndex ? "> " : "  ") + m_decks.name(i);
         window->drawText(deckText, 2, deckListY + static_cast<int>(i));
     }
 
@@ -472,7 +502,7 @@ void EditDeckScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
     // Draw selected deck contents with paging
     if (!m_decks.empty())
     {
-        const auto &selectedDeck = m_decks[m_selectedDeckIndex];
+        const auto &selectedDeck = m_decks.deck(m_selectedDeckIndex);
         int cardListX = window->getSize().X / 2;
         int cardListY = 5;
         m_maxCardsPerPage = (window->getSize().Y - cardListY - 5) / 5; // 5 lines per card, leave space for instructions
@@ -505,7 +535,8 @@ void EditDeckScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
 
     // Draw instructions
     window->drawText(
-        "Up/Down: Navigate Decks, Enter: Edit Deck, A: Add Deck, D: Delete Deck, R: Rename Deck, Escape: Go Back",
+        "Up/Down: Navigate Decks, Enter: Edit Deck, A: Add Deck, D: Delete Deck, R: Rename Deck, U: Restore Backup, H: History, "
+        "Z: Compress, Escape: Go Back",
         2,
         window->getSize().Y - 2);
 
@@ -554,9 +585,9 @@ void EditDeckScene::handleInput()
             case key::key_right: // Right arrow
                 if (!m_decks.empty() && std::chrono::steady_clock::now() - m_lastPageChangeTime >= m_pageChangeDelay)
                 {
-                    const auto &selectedDeck = m_decks[m_selectedDeckIndex];
                     size_t totalPages =
-                        (static_cast<int>(selectedDeck.cards.size()) + m_maxCardsPerPage - 1) / m_maxCardsPerPage;
+                        (static_cast<int>(m_decks.cardCount(m_selectedDeckIndex)) + m_maxCardsPerPage - 1) /
+                        m_maxCardsPerPage;
                     if (m_currentPage < totalPages - 1)
                     {
                         m_currentPage++;
@@ -577,8 +608,11 @@ void EditDeckScene::handleInput()
             case key::key_enter: // Enter
                 if (!m_decks.empty())
                 {
+                    // the deck as it is before editing starts the history, or catches up on changes made outside
+                    FlashCardDeck &deck = m_decks.deck(m_selectedDeckIndex);
+                    recordDeckHistory(deck, "opened for editing");
                     m_needsRedraw = true;
-                    m_openEditFlashcardScene(m_decks[m_selectedDeckIndex]);
+                    m_openEditFlashcardScene(deck);
                 }
                 break;
             case 'A':
@@ -596,6 +630,21 @@ void EditDeckScene::handleInput()
                 renameDeck();
                 m_needsRedraw = true;
                 break;
+            case 'U':
+            case 'u':
+                restoreDeck();
+                m_needsRedraw = true;
+                break;
+            case 'H':
+            case 'h':
+                showDeckHistory();
+                m_needsRedraw = true;
+                break;
+            case 'Z':
+            case 'z':
+                toggleDeckCompression();
+                m_needsRedraw = true;
+                break;
             case key::key_esc:
                 m_needsRedraw = true;
                 m_goBack();
@@ -638,7 +687,7 @@ void EditDeckScene::addNewDeck()
     FlashCardDeck newDeck{deckName, "", std::vector<FlashCard>{}};
     newDeck.filename = deckPath;
     writeFlashCardDeckWithChecks(newDeck, deckPath, false);
-    m_decks.push_back(newDeck);
+    m_decks.add(newDeck);
 
     // select this deck
     m_selectedDeckIndex = (int)m_decks.size() - 1;
@@ -664,13 +713,15 @@ void EditDeckScene::deleteDeck()
     int lib1_x_pos = window->getSize().X - static_cast<int>(window->getAsciiArtByName("lib1")->getWidth());
     window->drawAsciiArt("lib1", lib1_x_pos - 7, 6);
 
-    window->drawText("Are you sure you want to delete the deck '" + m_decks[m_selectedDeckIndex].name + "'?", 2, 4);
+    window->drawText("Are you sure you want to delete the deck '" + m_decks.name(m_selectedDeckIndex) + "'?", 2, 4);
     window->drawText("Type \"delete\" and press enter to confirm.", 2, 5);
     std::string key = window->getLine(2, 6, 6);
     if (key == "delete")
     {
-        fs::remove(m_decks[m_selectedDeckIndex].filename);
-        m_decks.erase(m_decks.begin() + m_selectedDeckIndex);
+        // make sure the latest version can be restored before the file goes
+        backupDeckFile(m_decks.filename(m_selectedDeckIndex));
+        fs::remove(m_decks.filename(m_selectedDeckIndex));
+        m_decks.erase(m_selectedDeckIndex);
         if (m_selectedDeckIndex >= m_decks.size())
             m_selectedDeckIndex = m_decks.size() - 1;
 
@@ -702,7 +753,7 @@ void EditDeckScene::renameDeck()
                          (window->getSize().X - static_cast<int>(window->getAsciiArtByName("lib1")->getWidth())) - 7,
                          6);
 
-    window->drawText("Enter the new name for the deck '" + m_decks[m_selectedDeckIndex].name + "' (max 30 characters):",
+    window->drawText("Enter the new name for the deck '" + m_decks.name(m_selectedDeckIndex) + "' (max 30 characters):",
                      2,
                      4);
     std::string newDeckName = window->getLine(2, 6, 30);
@@ -720,12 +771,25 @@ void EditDeckScene::renameDeck()
     std::string newDeckFilename = newDeckName;
     std::replace(newDeckFilename.begin(), newDeckFilename.end(), ' ', '_');
 
-    fs::path oldFilename = m_decks[m_selectedDeckIndex].filename;
+    FlashCardDeck &deck = m_decks.deck(m_selectedDeckIndex);
+    fs::path oldFilename = deck.filename;
     fs::path newFilename = oldFilename.parent_path() / (newDeckFilename + ".deck");
+    backupDeckFile(oldFilename);
+    recordDeckHistory(deck, "before rename");
     fs::rename(oldFilename, newFilename);
-    m_decks[m_selectedDeckIndex].name = newDeckName;
-    m_decks[m_selectedDeckIndex].filename = newFilename;
-    window->drawText("Deck renamed successfully!", 2, 8);
+    moveDeckHistory(oldFilename, newFilename);
+    deck.name = newDeckName;
+    deck.filename = newFilename;
+    // the name is also the first line of the file, rewriting it takes a backup of the renamed deck
+    if (rewriteFlashCardDeck(deck))
+    {
+        recordDeckHistory(deck, "renamed to " + newDeckName);
+        window->drawText("Deck renamed successfully!", 2, 8);
+    }
+    else
+    {
+        window->drawText("The deck file was renamed but its name could not be updated.", 2, 8);
+    }
     drawLibrarianComment();
 
     window->drawText("Press any key to continue...", 2, 10);
@@ -734,5 +798,228 @@ void EditDeckScene::renameDeck()
     m_needsRedraw = true;
 }
 
+void EditDeckScene::restoreDeck()
+{
+    auto window = m_uiManager.getWindow();
+    window->clear();
+    window->drawBorder();
+    window->drawCenteredText("Restore Deck Backup", 2);
+
+    DeckBackupStore store{DeckBackupStore::storeDirFor(m_settings.getDeckDir())};
+    std::vector<BackupSnapshot> snapshots = store.listSnapshots();
+    if (snapshots.empty())
+    {
+        window->drawText("There are no backups yet.", 2, 4);
+        drawLibrarianComment();
+        window->drawText("Press any key to continue...", 2, 6);
+        _getch();
+        m_needsRedraw = true;
+        return;
+    }
+
+    // show the most recent snapshots, newest first
+    const size_t maxShown = 10;
+    size_t n_shown = snapshots.size() < maxShown ? snapshots.size() : maxShown;
+    window->drawText("Recent backups:", 2, 4);
+    for (size_t i = 0; i < n_shown; ++i)
+    {
+        const BackupSnapshot &snapshot = snapshots[snapshots.size() - 1 - i];
+        std::time_t t = static_cast<std::time_t>(snapshot.time);
+        std::ostringstream line;
+        line << snapshot.id << ": " << snapshot.deck_file << "  "
+             << std::put_time(std::localtime(&t), "%Y-%m-%d %H:%M:%S") << "  " << snapshot.size << " bytes";
+        window->drawText(line.str(), 4, 5 + static_cast<int>(i));
+    }
+
+    int prompt_y = 6 + static_cast<int>(n_shown);
+    window->drawText("Enter the number of the backup to restore:", 2, prompt_y);
+    std::string input = window->getLine(2, prompt_y + 1, 10);
+    uint64_t id{0};
+    try
+    {
+        id = std::stoull(input);
+    }
+    catch (...)
+    {
+        id = 0;
+    }
+
+    auto match = std::find_if(snapshots.begin(), snapshots.end(), [id](const BackupSnapshot &snapshot) {
+        return snapshot.id == id;
+    });
+    if (input == "\x1B" || match == snapshots.end())
+    {
+        window->drawText("Restore aborted.", 2, prompt_y + 2);
+    }
+    else
+    {
+        fs::path dest = fs::path(m_settings.getDeckDir()) / match->deck_file;
+        // keep the version being replaced so the restore itself can be undone
+        backupDeckFile(dest);
+        if (store.restoreSnapshot(match->id, dest))
+        {
+            loadDecks();
+            window->drawText("Restored " + match->deck_file + " from backup " + std::to_string(match->id) + ".",
+                             2,
+                             prompt_y + 2);
+        }
+        else
+        {
+            window->drawText("The backup could not be restored.", 2, prompt_y + 2);
+        }
+    }
+    drawLibrarianComment();
+
+    window->drawText("Press any key to continue...", 2, prompt_y + 4);
+    _getch();
+
+    m_needsRedraw = true;
+}
+
+void EditDeckScene::showDeckHistory()
+{
+    if (m_decks.empty())
+        return;
+
+    auto window = m_uiManager.getWindow();
+    window->clear();
+    window->drawBorder();
+    window->drawCenteredText("Deck History - " + m_decks.name(m_selectedDeckIndex), 2);
+
+    DeckHistory history{DeckHistory::historyFileFor(m_decks.filename(m_selectedDeckIndex))};
+    const std::vector<DeckVersion> &versions = history.listVersions();
+    if (versions.empty())
+    {
+        window->drawText("This deck has no recorded versions yet.", 2, 4);
+        drawLibrarianComment();
+        window->drawText("Press any key to continue...", 2, 6);
+        _getch();
+        m_needsRedraw = true;
+        return;
+    }
+
+    // show the most recent versions, newest first
+    const size_t maxShown = 10;
+    size_t n_shown = versions.size() < maxShown ? versions.size() : maxShown;
+    window->drawText("Recent versions:", 2, 4);
+    for (size_t i = 0; i < n_shown; ++i)
+    {
+        const DeckVersion &version = versions[versions.size() - 1 - i];
+        std::time_t t = static_cast<std::time_t>(version.time);
+        std::ostringstream line;
+        line << version.number << ": " << std::put_time(std::localtime(&t), "%Y-%m-%d %H:%M:%S") << "  "
+             << version.n_cards << " cards  " << version.note;
+        window->drawText(line.str(), 4, 5 + static_cast<int>(i));
+    }
+
+    int prompt_y = 6 + static_cast<int>(n_shown);
+    window->drawText("Enter the number of the version to view:", 2, prompt_y);
+    std::string input = window->getLine(2, prompt_y + 1, 10);
+    uint64_t number{0};
+    try
+    {
+        number = std::stoull(input);
+    }
+    catch (...)
+    {
+        number = 0;
+    }
+
+    FlashCardDeck version{};
+    if (input == "\x1B" || !history.readVersion(number, version))
+    {
+        window->drawText("No version was chosen.", 2, prompt_y + 2);
+        drawLibrarianComment();
+        window->drawText("Press any key to continue...", 2, prompt_y + 4);
+        _getch();
+        m_needsRedraw = true;
+        return;
+    }
+
+    // list as many of the version's cards as fit on the screen
+    window->clear();
+    window->drawBorder();
+    window->drawCenteredText("Version " + std::to_string(number) + " - " + version.name, 2);
+    int cardListY = 4;
+    size_t maxCards = static_cast<size_t>(window->getSize().Y - cardListY - 4) / 3;
+    for (size_t i = 0; i < min(version.cards.size(), maxCards); ++i)
+    {
+        const auto &card = version.cards[i];
+        int yOffset = cardListY + static_cast<int>(i) * 3;
+        std::string truncatedQuestion = card.question.substr(0, window->getSize().X - 10);
+        std::string truncatedAnswer = card.answer.substr(0, window->getSize().X - 10);
+        window->drawText("Q: " + truncatedQuestion, 2, yOffset);
+        window->drawText("A: " + truncatedAnswer, 2, yOffset + 1);
+    }
+    if (version.cards.size() > maxCards)
+    {
+        window->drawText("... and " + std::to_string(version.cards.size() - maxCards) + " more cards",
+                         2,
+                         cardListY + static_cast<int>(maxCards) * 3);
+    }
+
+    window->drawText("R: Roll the deck back to this version, any other key: Go Back", 2, window->getSize().Y - 2);
+    int key = _getch();
+    if (key == 'R' || key == 'r')
+    {
+        FlashCardDeck &deck = m_decks.deck(m_selectedDeckIndex);
+        version.filename = deck.filename;
+        window->clear();
+        window->drawBorder();
+        window->drawCenteredText("Deck History", 2);
+        // the roll back is itself a new version, so it can be undone the same way
+        if (rewriteFlashCardDeck(version))
+        {
+            deck = version;
+            recordDeckHistory(deck, "rolled back to version " + std::to_string(number));
+            window->drawText("Rolled the deck back to version " + std::to_string(number) + ".", 2, 4);
+        }
+        else
+        {
+            window->drawText("The deck file could not be rewritten.", 2, 4);
+        }
+        drawLibrarianComment();
+        window->drawText("Press any key to continue...", 2, 6);
+        _getch();
+    }
+
+    m_needsRedraw = true;
+}
+
+void EditDeckScene::toggleDeckCompression()
+{
+    if (m_decks.empty())
+        return;
+
+    auto window = m_uiManager.getWindow();
+    window->clear();
+    window->drawBorder();
+    window->drawCenteredText("Compress Deck", 2);
+
+    FlashCardDeck &deck = m_decks.deck(m_selectedDeckIndex);
+    std::error_code ec;
+    uintmax_t oldSize = fs::file_size(deck.filename, ec);
+    deck.compressed = !deck.compressed;
+    if (rewriteFlashCardDeck(deck))
+    {
+        uintmax_t newSize = fs::file_size(deck.filename, ec);
+        window->drawText(std::string(deck.compressed ? "Compressed" : "Uncompressed") + " '" + deck.name + "': " +
+                             std::to_string(oldSize) + " bytes -> " + std::to_string(newSize) + " bytes",
+                         2,
+                         4);
+    }
+    else
+    {
+        deck.compressed = !deck.compressed;
+        window->drawText("The deck file could not be rewritten.", 2, 4);
+    }
+    drawLibrarianComment();
+
+    window->drawText("Press any key to continue...", 2, 6);
+    _getch();
+
+    m_needsRedraw = true;
+}
+
 
 } // namespace FlashcardEdit
@@ -14,12 +14,17 @@
 
 #include "artwork.h"
 #include "deck.h"
+#include "deck_backup.h"
+#include "deck_history.h"
+#include "deck_library.h"
 #include "menu.h"
 #include "settings_scene.h"
 #include "util.h"
 #include <algorithm>
 #include <conio.h>
+#include <ctime>
 #include <functional>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <memory>
@@ -102,15 +107,15 @@ public:
      * @brief Loads all flashcard decks from the file system.
      *
      * This function reads all .deck files from the "Decks/" directory
-     * and populates the m_decks vector with the loaded FlashCardDeck objects.
+     * into the m_decks library, within the deck memory budget from the settings.
      */
     void loadDecks();
 
     /**
-     * @brief Gets the vector of loaded flashcard decks.
-     * @return const std::vector<FlashCardDeck>& The vector of loaded flashcard decks.
+     * @brief Gets the library of loaded flashcard decks.
+     * @return const DeckLibrary& The library of loaded flashcard decks.
      */
-    const std::vector<FlashCardDeck> &getDecks() const
+    const DeckLibrary &getDecks() const
     {
         return m_decks;
     }
@@ -209,7 +214,7 @@ private:
     ConsoleUI::UIManager &m_uiManager;                             ///< Reference to the UI manager.
     std::function<void()> m_goBack;                                ///< Function to return to the previous scene.
     std::function<void(FlashCardDeck &)> m_openEditFlashcardScene; ///< Function to open the EditFlashcardScene.
-    std::vector<FlashCardDeck> m_decks;                            ///< Vector of all loaded flashcard decks.
+    DeckLibrary m_decks;                                           ///< All decks, cards kept within the memory budget.
     size_t m_selectedDeckIndex;                                    ///< Index of the currently selected deck.
     int m_currentPage;                                             ///< Current page number for deck content display.
     size_t m_maxCardsPerPage;                                      ///< Maximum number of cards displayed per page.
@@ -228,7 +233,7 @@ private:
      * @brief Adds a new flashcard deck.
      *
      * This function prompts the user for a deck name, creates a new .deck file,
-     * and adds the new deck to the m_decks vector.
+     * and adds the new deck to the m_decks library.
      */
     void addNewDeck();
 
@@ -236,18 +241,41 @@ private:
      * @brief Deletes the currently selected flashcard deck.
      *
      * This function removes the selected deck's .deck file from the file system
-     * and removes the deck from the m_decks vector.
+     * and removes the deck from the m_decks library.
      */
     void deleteDeck();
 
     /**
      * @brief Renames the currently selected flashcard deck.
      *
-     * This function prompts the user for a new deck name, renames the .deck file,
-     * and updates the deck's name in the m_decks vector.
+     * This function prompts the user for a new deck name, renames the .deck file and its history,
+     * and writes the new name to the file and to the deck in the m_decks library.
      */
     void renameDeck();
 
+    /**
+     * @brief Restores a deck file from the backup store.
+     *
+     * This function lists the most recent backups, including those of deleted or renamed decks,
+     * restores the one the user picks and reloads the decks.
+     */
+    void restoreDeck();
+
+    /**
+     * @brief Browses the recorded versions of the selected deck.
+     *
+     * This function lists the most recent versions from the deck's history, shows the cards of the one
+     * the user picks and can roll the deck back to it.
+     */
+    void showDeckHistory();
+
+    /**
+     * @brief Switches the selected deck between a text file and a compressed file.
+     *
+     * This function rewrites the deck's file in the other form and shows the file size before and after.
+     */
+    void toggleDeckCompression();
+
     /**
      * @brief Draws the librarian comment on the console window.
      */
@@ -314,6 +342,14 @@ public:
      */
     void setStaticDrawn(bool staticDrawn) override;
 
+    /**
+     * @brief Takes the backup snapshot and history entry for the cards edited since the last call.
+     *
+     * Editing a card only patches its slot in the deck file, so the whole-file snapshot and history
+     * entry are deferred until the editor is left or the deck is rewritten by an add or delete.
+     */
+    void recordEdits();
+
     /**
      * @brief Gets the flashcard deck being edited.
      * @return const FlashCardDeck& Reference to the flashcard deck.
@@ -422,15 +458,16 @@ private:
     size_t m_maxCardsPerPage;          ///< Maximum number of flashcards displayed per page.
     bool m_needsRedraw;                ///< Flag indicating if the scene needs redrawing.
 
-    bool m_staticDrawn = false; ///< Flag indicating if the static elements have been drawn.
-    StudySettings m_settings;   ///< Study settings object.
+    bool m_staticDrawn = false;        ///< Flag indicating if the static elements have been drawn.
+    StudySettings m_settings;          ///< Study settings object.
+    std::vector<size_t> m_editedCards; ///< Cards edited since the deck was last backed up, in edit order.
 
     /**
      * @brief Edits the currently selected flashcard.
      *
      * This function allows the user to modify the question, answer, and difficulty
      * of the selected flashcard. It updates the flashcard in the deck and saves
-     * changes to the file.
+     * changes to the file, in place when the card still fits in its slot.
      */
     void editSelectedCard();
 
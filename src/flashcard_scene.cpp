@@ -17,9 +17,11 @@ namespace FlashcardApp
 BrowseDecksScene::BrowseDecksScene(ConsoleUI::UIManager &uiManager,
                                    std::function<void()> goBack,
                                    std::function<void(const FlashCardDeck &)> openDeck,
-                                   StudySettings &studySettings)
-    : m_uiManager(uiManager), m_goBack(goBack), m_openDeck(openDeck), m_currentPage(0), m_maxCardsPerPage(0),
-      m_settings(studySettings)
+                                   StudySettings &studySettings,
+                                   std::function<void(DeckLibrary &)> studyAllDue,
+                                   std::function<void(const DeckLibrary &)> showStatistics)
+    : m_uiManager(uiManager), m_goBack(goBack), m_openDeck(openDeck), m_studyAllDue(studyAllDue),
+      m_showStatistics(showStatistics), m_currentPage(0), m_maxCardsPerPage(0), m_settings(studySettings)
 {
     //m_uiManager.clearAllMenus(); // Clear all menus before creating new ones
     loadDecks();
@@ -27,7 +29,8 @@ BrowseDecksScene::BrowseDecksScene(ConsoleUI::UIManager &uiManager,
 
 void BrowseDecksScene::loadDecks()
 {
-    m_decks = loadFlashCardDecks(m_settings.getDeckDir());
+    m_decks.setMemoryBudget(m_settings.getDeckMemoryBudget());
+    m_decks.load(m_settings.getDeckDir());
     m_selectedDeckIndex = 0;
     m_currentPage = 0;
     m_needsRedraw = true;
@@ -49,7 +52,7 @@ void BrowseDecksScene::drawBookshelf(std::shared_ptr<ConsoleUI::ConsoleWindow> w
         {
             do
             {
-                bookshelfIndex = rand() % bookshelfOptions.size();
+                bookshelfIndex = static_cast<int>(rngStream(BOOKSHELF_STREAM).below(bookshelfOptions.size()));
             } while (bookshelfIndex == m_prevBookshelfIndex);
         }
 
@@ -85,7 +88,10 @@ void BrowseDecksScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
         window->clear();
         window->drawBorder();
         window->drawCenteredText("Browse Decks", 2);
-        window->drawText("Use Up/Down to navigate, Enter to select, Escape to go back", 2, window->getSize().Y - 2);
+        window->drawText(
+            "Up/Down to navigate, Enter to select, A to study all due, S for statistics, Escape to go back",
+            2,
+            window->getSize().Y - 2);
         loadDecks();
         m_staticDrawn = true;
     }
@@ -111,7 +117,7 @@ void BrowseDecksScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
     int deckListY = 4;
     for (size_t i = 0; i < m_decks.size(); ++i)
     {
-        std::string deckText = (i == m_selectedDeckIndex ? "> " : "  ") + m_decks[i].name;
+        std::string deckText = (i == m_selectedDeckIndex ? "> " : "  ") + m_decks.name(i);
         window->drawText(deckText, 2, deckListY + static_cast<int>(i));
     }
 
@@ -120,7 +126,7 @@ void BrowseDecksScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
     // Draw selected deck contents with paging
     if (!m_decks.empty())
     {
-        const auto &selectedDeck = m_decks[m_selectedDeckIndex];
+        const auto &selectedDeck = m_decks.deck(m_selectedDeckIndex);
         int cardListX = window->getSize().X / 2;
         int cardListY = 5;
         m_maxCardsPerPage = (window->getSize().Y - cardListY - 5) / 5; // 5 lines per card, leave space for instructions
@@ -152,7 +158,9 @@ void BrowseDecksScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
     }
 
     // Draw instructions
-    window->drawText("Up/Down to navigate, Enter to select, Escape to go back", 2, window->getSize().Y - 2);
+    window->drawText("Up/Down to navigate, Enter to select, A to study all due, S for statistics, Escape to go back",
+                     2,
+                     window->getSize().Y - 2);
 
     m_needsRedraw = false;
 }
@@ -201,9 +209,9 @@ void BrowseDecksScene::handleInput()
             case key::key_right: // Right arrow
                 if (!m_decks.empty() && std::chrono::steady_clock::now() - m_lastPageChangeTime >= m_pageChangeDelay)
                 {
-                    const auto &selectedDeck = m_decks[m_selectedDeckIndex];
                     int totalPages =
-                        (static_cast<int>(selectedDeck.cards.size()) + m_maxCardsPerPage - 1) / m_maxCardsPerPage;
+                        (static_cast<int>(m_decks.cardCount(m_selectedDeckIndex)) + m_maxCardsPerPage - 1) /
+                        m_maxCardsPerPage;
                     if (m_currentPage < totalPages - 1)
                     {
                         m_currentPage++;
@@ -224,7 +232,7 @@ void BrowseDecksScene::handleInput()
             case key::key_enter: // Enter
                 if (!m_decks.empty())
                 {
-                    const auto &selectedDeck = m_decks[m_selectedDeckIndex];
+                    const auto &selectedDeck = m_decks.deck(m_selectedDeckIndex);
                     if (selectedDeck.cards.empty())
                     {
                         // Display error message if the selected deck is empty
@@ -245,6 +253,20 @@ void BrowseDecksScene::handleInput()
                     }
                 }
                 break;
+            case 'A':
+            case 'a':
+                if (m_studyAllDue)
+                {
+                    m_studyAllDue(m_decks);
+                }
+                break;
+            case 'S':
+            case 's':
+                if (m_showStatistics)
+                {
+                    m_showStatistics(m_decks);
+                }
+                break;
             case key::key_esc:
                 for (auto &scene : m_uiManager.getScenes())
                 {
@@ -263,6 +285,21 @@ void BrowseDecksScene::handleInput()
 
 /* -------EDIT -------------*/
 
+/**
+ * @brief Milliseconds between two moments of a review
+ *
+ * @return uint32_t 0 if either moment was not seen
+ */
+static uint32_t elapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    if (from == std::chrono::steady_clock::time_point{} || to < from)
+    {
+        return 0;
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+    return static_cast<uint32_t>(std::min<int64_t>(ms, UINT32_MAX));
+}
+
 FlashcardScene::FlashcardScene(ConsoleUI::UIManager &uiManager,
                                const FlashCardDeck &deck,
                                std::function<void()> goBack,
@@ -273,75 +310,195 @@ FlashcardScene::FlashcardScene(ConsoleUI::UIManager &uiManager,
       m_currentCardIndex(0), m_showAnswer(false), m_settings(studySettings), m_lastAnswerDisplayed(false), m_score(0)
 {
 
-    m_uiManager.clearMenu("difficulty");
     m_settings.startSession();
+    createDifficultyMenu();
+    openReviewLog();
+    openStudyQueue();
+}
+
+FlashcardScene::FlashcardScene(ConsoleUI::UIManager &uiManager,
+                               DeckLibrary &library,
+                               std::function<void()> goBack,
+                               std::function<void()> goToDeckSelection,
+                               std::function<void(const std::vector<int> &, int, bool)> showResults,
+                               StudySettings &studySettings)
+    : m_uiManager(uiManager), m_goBack(goBack), m_showResults(showResults), m_needsRedraw(true),
+      m_currentCardIndex(0), m_showAnswer(false), m_settings(studySettings), m_lastAnswerDisplayed(false), m_score(0)
+{
+    m_settings.startSession();
+    createDifficultyMenu();
+    openReviewLog();
+    m_dueMerge = std::make_unique<DueMerge>(library, scheduleNow(), m_settings.getFlashCardLimit());
+    initializeDueCards();
+}
+
+void FlashcardScene::createDifficultyMenu()
+{
+    m_uiManager.clearMenu("difficulty");
     // Menu for the card difficulty
     auto &menu = m_uiManager.createMenu("difficulty", true);
     menu.addButton("Easy", [this]() { selectDifficulty(EASY); });
     menu.addButton("Medium", [this]() { selectDifficulty(MEDIUM); });
     menu.addButton("Hard", [this]() { selectDifficulty(HARD); });
+}
 
-    initializeCardOrder();
+void FlashcardScene::openReviewLog()
+{
+    m_sessionId = static_cast<uint64_t>(reviewTimeNowMs());
+    m_reviewLog = std::make_unique<ReviewLogWriter>(reviewLogFileFor(m_settings.getDeckDir()));
+    m_reviewLogCheckpointAt = std::chrono::steady_clock::now();
 }
 
-void FlashcardScene::initializeCardOrder()
+bool FlashcardScene::checkpointReviewLog(std::chrono::steady_clock::time_point now)
 {
-    size_t numCardsToStudy = min(m_deck.cards.size(), m_settings.getFlashCardLimit());
-    m_cardOrder.clear();
+    if (m_reviewLog->pending() == 0 || now - m_reviewLogCheckpointAt < reviewLogCheckpointDelay)
+    {
+        return false;
+    }
+    m_reviewLogCheckpointAt = now;
+    return m_reviewLog->checkpoint();
+}
 
-    // Separate seen and unseen cards
-    std::vector<size_t> unseenCards;
-    std::vector<size_t> seenCards;
-    for (size_t i = 0; i < numCardsToStudy; ++i)
+void FlashcardScene::openStudyQueue()
+{
+    if (m_deck.filename.empty())
     {
-        if (m_deck.cards[i].n_times_answered == 0)
-        {
-            unseenCards.push_back(i);
-        }
-        else
-        {
-            seenCards.push_back(i);
-        }
+        initializeCardOrder();
+        return;
+    }
+    m_studyQueue = std::make_unique<StudyQueue>();
+    if (!m_studyQueue->load(m_deck))
+    {
+        m_studyQueue->build(m_deck, rngStream(STUDY_ORDER_STREAM));
     }
 
-    // Prioritize unseen cards
-    std::shuffle(unseenCards.begin(), unseenCards.end(), std::default_random_engine());
-    m_cardOrder = unseenCards;
+    std::string query = m_settings.getStudyQuery();
+    CardViewMode mode = m_settings.getStudyMode();
+    if (m_studyQueue->resumable(query, mode))
+    {
+        m_cardOrder = m_studyQueue->sessionOrder();
+        m_currentCardIndex = m_studyQueue->sessionPosition();
+        // the rest of the session is still planned again as cards are graded
+        m_rankedCards = m_cardOrder;
+        loadLatencies();
+        return;
+    }
+    // the front of the queue only serves a plain session with enough due and new cards, anything else ranks the deck
+    size_t numCardsToStudy = min(m_deck.cards.size(), m_settings.getFlashCardLimit());
+    size_t numRanked = min(m_deck.cards.size(), numCardsToStudy * planCandidatesPerCard);
+    if (query.empty())
+    {
+        m_studyQueue->planSession(m_deck, numRanked, scheduleNow(), mode, m_rankedCards);
+    }
+    if (!query.empty() || m_rankedCards.size() < numCardsToStudy)
+    {
+        initializeCardOrder();
+    }
+    else
+    {
+        loadLatencies();
+        planSession(0);
+    }
+    m_studyQueue->startSession(m_cardOrder, query, mode);
+}
+
+uint64_t FlashcardScene::cardReviewId(size_t cardIndex) const
+{
+    const std::string &deckName = m_dueMerge ? m_dueMerge->deckName(m_dueOrigins[cardIndex].deck) : m_deck.name;
+    return reviewCardId(deckName, m_deck.cards[cardIndex]);
+}
 
-    // Calculate weights for seen cards
-    std::vector<double> weights(seenCards.size());
-    for (size_t i = 0; i < seenCards.size(); ++i)
+void FlashcardScene::loadLatencies()
+{
+    std::vector<uint64_t> ids{};
+    ids.reserve(m_rankedCards.size());
+    for (size_t card : m_rankedCards)
     {
-        const auto &card = m_deck.cards[seenCards[i]];
-        weights[i] = (4 - card.difficulty) * (1 + log(card.n_times_answered + 1));
+        ids.push_back(cardReviewId(card));
     }
+    m_latency.load(reviewLogFileFor(m_settings.getDeckDir()), ids);
+}
 
-    // Normalize weights to create probability distribution
-    double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
-    for (auto &weight : weights)
+void FlashcardScene::planSession(size_t first)
+{
+    first = (std::min)(first, m_cardOrder.size());
+    auto elapsed = std::chrono::steady_clock::now() - m_settings.getSessionStart();
+    double budget = m_settings.getStudyDurationMin() * 60.0 - std::chrono::duration<double>(elapsed).count();
+    size_t limit = static_cast<size_t>((std::max)(m_settings.getFlashCardLimit(), 0));
+    // a session running slower than expected plans less for the rest of it, a faster one more
+    double pace = m_expectedSeconds > 0 ? std::clamp(m_actualSeconds / m_expectedSeconds, 0.25, 4.0) : 1.0;
+    int64_t now = scheduleNow();
+
+    std::vector<PlanCandidate> candidates{};
+    auto studied = m_cardOrder.begin() + static_cast<std::ptrdiff_t>(first);
+    for (size_t card : m_rankedCards)
+    {
+        if (std::find(m_cardOrder.begin(), studied, card) == studied)
+        {
+            double seconds = m_latency.estimate(cardReviewId(card)) * pace;
+            candidates.push_back(planCandidate(card, m_deck.cards[card], now, seconds));
+        }
+    }
+    std::vector<size_t> chosen{};
+    planTimedSession(candidates, budget, limit > first ? limit - first : 0, chosen);
+    if (first == 0 && chosen.empty() && !candidates.empty() && limit > 0)
     {
-        weight /= sum;
+        // however short the time, a session has a card
+        chosen.push_back(0);
     }
+    m_cardOrder.resize(first);
+    for (size_t c : chosen)
+    {
+        m_cardOrder.push_back(candidates[c].card);
+    }
+}
 
-    // Create discrete_distribution based on weights
-    std::discrete_distribution<> dist(weights.begin(), weights.end());
+void FlashcardScene::initializeCardOrder()
+{
+    size_t numCardsToStudy = min(m_deck.cards.size(), m_settings.getFlashCardLimit());
+    // more cards are ranked than can be studied, so the plan can swap slow cards for quicker ones
+    size_t numRanked = min(m_deck.cards.size(), numCardsToStudy * planCandidatesPerCard);
 
-    std::mt19937 m_rng{std::random_device{}()};
-    // Shuffle seen cards based on probability distribution
-    std::vector<size_t> shuffledSeenCards;
-    for (size_t i = 0; i < seenCards.size(); ++i)
+    // The study filter picks the candidate cards, without one (or if it matches nothing) every card is a candidate
+    std::vector<size_t> matches;
+    std::string queryError{};
+    if (m_settings.getStudyQuery().empty() || !queryDeckCards(m_deck, m_settings.getStudyQuery(), matches, queryError))
     {
-        shuffledSeenCards.push_back(seenCards[dist(m_rng)]);
+        matches.clear();
     }
+    selectStudyCards(m_deck,
+                     matches,
+                     numRanked,
+                     scheduleNow(),
+                     m_settings.getStudyMode(),
+                     rngStream(STUDY_ORDER_STREAM),
+                     m_rankedCards);
+    loadLatencies();
+    planSession(0);
+}
 
-    // Append seen cards to the card order
-    m_cardOrder.insert(m_cardOrder.end(), shuffledSeenCards.begin(), shuffledSeenCards.end());
-
-    // Limit the number of cards to study
-    if (m_cardOrder.size() > numCardsToStudy)
+void FlashcardScene::initializeDueCards()
+{
+    // the session's deck holds copies of the cards taken from the library, reviews go back through the merge
+    m_deck = FlashCardDeck{};
+    m_deck.name = "All due cards";
+    m_dueOrigins.clear();
+    CardViewMode mode = m_settings.getStudyMode();
+    DueCard origin{};
+    FlashCard card{};
+    while (m_dueMerge->next(origin, card))
     {
-        m_cardOrder.resize(numCardsToStudy);
+        if (mode == CLOZE_VIEW && !CardView{card, CLOZE_VIEW}.studiable())
+        {
+            continue;
+        }
+        m_deck.cards.push_back(std::move(card));
+        m_dueOrigins.push_back(origin);
     }
+    m_rankedCards.resize(m_deck.cards.size());
+    std::iota(m_rankedCards.begin(), m_rankedCards.end(), size_t{0});
+    loadLatencies();
+    planSession(0);
 }
 
 void FlashcardScene::update()
@@ -357,6 +514,7 @@ void FlashcardScene::update()
         }
         endSession(true);
     }
+    checkpointReviewLog(std::chrono::steady_clock::now());
     Sleep(10);
 }
 
@@ -386,7 +544,7 @@ void FlashcardScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
 
     if (m_currentCardIndex < m_cardOrder.size())
     {
-        const auto &card = m_deck.cards[m_cardOrder[m_currentCardIndex]];
+        CardView card = CardView::forStudy(m_deck.cards[m_cardOrder[m_currentCardIndex]], m_settings.getStudyMode());
 
         if (m_needsRedraw)
         {
@@ -399,8 +557,13 @@ void FlashcardScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
             // Draw the question box and text
             window->drawBox((window->getSize().X - textBoxWidth) / 2, 6, textBoxWidth, questionBoxHeight);
             window->drawCenteredText("Question:", 4);
-            window->drawWrappedText(card.question, (window->getSize().X - textBoxWidth) / 2 + 2, 8, textBoxWidth - 4);
+            window->drawWrappedText(card.question(), (window->getSize().X - textBoxWidth) / 2 + 2, 8, textBoxWidth - 4);
             window->drawCenteredText("Press SPACE to interact", window->getSize().Y * 4 / 5);
+            // the response time runs from the first time the question is on screen
+            if (m_questionShownAt == std::chrono::steady_clock::time_point{})
+            {
+                m_questionShownAt = std::chrono::steady_clock::now();
+            }
 
             m_needsRedraw = false;
         }
@@ -421,7 +584,7 @@ void FlashcardScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
                             textBoxWidth,
                             answerBoxHeight);
             window->drawCenteredText("Answer:", window->getSize().Y / 2 - 3);
-            window->drawWrappedText(card.answer,
+            window->drawWrappedText(card.answer(),
                                     (window->getSize().X - textBoxWidth) / 2 + 2,
                                     window->getSize().Y / 2 - answerBoxHeight / 2 + 4,
                                     textBoxWidth - 4);
@@ -452,6 +615,10 @@ void FlashcardScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
 
         std::string progress =
             "Card " + std::to_string(m_currentCardIndex + 1) + " of " + std::to_string(m_cardOrder.size());
+        if (m_leechesFound > 0)
+        {
+            progress += "   Leeches found: " + std::to_string(m_leechesFound);
+        }
         window->drawText(progress, 2, window->getSize().Y - 3);
         m_lastAnswerDisplayed = false;
     }
@@ -508,6 +675,7 @@ void FlashcardScene::handleInput()
                 }
                 else
                 {
+                    m_answerShownAt = std::chrono::steady_clock::now();
                     m_showAnswer = true;
                     m_lastAnswerDisplayed = true;
                     m_needsRedraw = true;
@@ -566,14 +734,65 @@ void FlashcardScene::selectDifficulty(CardDifficulty difficulty)
 
 void FlashcardScene::updateCardDifficulty(size_t cardIndex, CardDifficulty difficulty)
 {
+    auto gradedAt = std::chrono::steady_clock::now();
     auto &card = m_deck.cards[cardIndex];
+    int64_t oldDue = card.schedule.due;
+    uint32_t oldFailures = card.schedule.failures;
     card.difficulty = difficulty;
     card.n_times_answered++;
+    ReviewRating rating = ratingForDifficulty(difficulty);
+    reviewCard(card, rating, scheduleNow(), m_settings.getScheduler());
+    if (checkLeech(card,
+                   oldFailures,
+                   static_cast<uint32_t>(m_settings.getLeechThreshold()),
+                   m_settings.getLeechAction()))
+    {
+        m_leechesFound++;
+    }
+    if (m_studyQueue)
+    {
+        m_studyQueue->reschedule(cardIndex, oldDue, card.schedule.due);
+    }
+    if (m_dueMerge)
+    {
+        m_dueMerge->record(m_dueOrigins[cardIndex], card);
+    }
+
+    const std::string &deckName = m_dueMerge ? m_dueMerge->deckName(m_dueOrigins[cardIndex].deck) : m_deck.name;
+    ReviewRecord review{};
+    review.card_id = cardReviewId(cardIndex);
+    review.deck_id = reviewDeckId(deckName);
+    review.time_ms = reviewTimeNowMs();
+    review.session_id = m_sessionId;
+    review.due = card.schedule.due;
+    review.response_ms = elapsedMs(m_questionShownAt, m_answerShownAt);
+    review.grade_ms = elapsedMs(m_answerShownAt, gradedAt);
+    review.grade = static_cast<uint8_t>(rating);
+    // only buffered, so grading never waits on the disk
+    m_reviewLog->append(review);
+    m_lastReview = review;
+
+    // the card's actual time corrects its estimate and the session's pace, then the rest is planned again
+    uint64_t reviewMs = uint64_t{review.response_ms} + review.grade_ms;
+    if (reviewMs > 0)
+    {
+        double seconds = (std::min)(static_cast<double>(reviewMs) / 1000, maxCardSeconds);
+        m_expectedSeconds += m_latency.estimate(review.card_id);
+        m_actualSeconds += seconds;
+        m_latency.observe(review.card_id, seconds);
+    }
+    planSession(m_currentCardIndex + 1);
+    if (m_studyQueue)
+    {
+        m_studyQueue->startSession(m_cardOrder, m_settings.getStudyQuery(), m_settings.getStudyMode());
+    }
 }
 
 void FlashcardScene::nextCard()
 {
     m_currentCardIndex++;
+    m_questionShownAt = {};
+    m_answerShownAt = {};
     m_showAnswer = false;
     m_lastAnswerDisplayed = false;
     m_needsRedraw = true;
@@ -591,7 +810,18 @@ void FlashcardScene::endSession(bool sessionCompleted)
 
 void FlashcardScene::saveUpdatedDeck()
 {
-    writeFlashCardDeckWithChecks(m_deck, m_deck.filename, true);
+    if (m_dueMerge)
+    {
+        // each deck the session studied is saved once with all of its reviews
+        m_dueMerge->writeBack();
+    }
+    else if (writeFlashCardDeckWithChecks(m_deck, m_deck.filename, true) && m_studyQueue)
+    {
+        // saved after the deck, so the queue matches the deck file as it now is
+        m_studyQueue->setSessionPosition(m_currentCardIndex);
+        m_studyQueue->save(m_deck);
+    }
+    m_reviewLog->checkpoint();
     m_decksNeedReload = true;
 }
 
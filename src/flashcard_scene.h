@@ -12,7 +12,18 @@
 #pragma once
 
 #include "artwork.h"
+#include "card_query.h"
+#include "card_view.h"
 #include "deck.h"
+#include "deck_library.h"
+#include "due_merge.h"
+#include "review_log.h"
+#include "rng.h"
+#include "scheduler.h"
+#include "session_planner.h"
+#include "study_queue.h"
+#include "top_k.h"
+#include "weighted_sampler.h"
 #include "edit_flashcard.h"
 #include "menu.h"
 #include "settings_scene.h"
@@ -47,11 +58,15 @@ public:
      * @param uiManager The UI manager responsible for handling the user interface.
      * @param goBack A function to be called when the user wants to go back to the previous scene.
      * @param openDeck A function to be called when the user selects a deck to open.
+     * @param studyAllDue A function to be called when the user studies the due cards of every deck.
+     * @param showStatistics A function to be called when the user views the statistics of their reviews.
      */
     BrowseDecksScene(ConsoleUI::UIManager &uiManager,
                      std::function<void()> goBack,
                      std::function<void(const FlashCardDeck &)> openDeck,
-                     StudySettings &settings);
+                     StudySettings &settings,
+                     std::function<void(DeckLibrary &)> studyAllDue = nullptr,
+                     std::function<void(const DeckLibrary &)> showStatistics = nullptr);
 
     /**
      * @brief Initialize the scene.
@@ -89,7 +104,7 @@ public:
      * @brief Load available flashcard decks from storage.
      *
      * This function reads flashcard decks from the "Decks/" directory and
-     * populates the m_decks vector with the loaded decks.
+     * loads them into the m_decks library, within the deck memory budget from the settings.
      */
     void loadDecks();
 
@@ -106,17 +121,19 @@ public:
 
     void drawBookshelf(std::shared_ptr<ConsoleUI::ConsoleWindow> window);
 
-    std::vector<FlashCardDeck> m_decks; ///< Vector of loaded flashcard decks.
-    size_t m_selectedDeckIndex = 0;     ///< Index of the currently selected deck.
-    int m_currentPage = 0;              ///< Current page number when viewing deck contents.
+    DeckLibrary m_decks;            ///< All decks, cards kept within the memory budget.
+    size_t m_selectedDeckIndex = 0; ///< Index of the currently selected deck.
+    int m_currentPage = 0;          ///< Current page number when viewing deck contents.
 
 
 private:
     ConsoleUI::UIManager &m_uiManager;                     ///< Reference to the UI manager.
     std::function<void()> m_goBack;                        ///< Function to call when going back.
     std::function<void(const FlashCardDeck &)> m_openDeck; ///< Function to call when opening a deck.
-    bool m_needsRedraw = true;                             ///< Flag indicating if the scene needs to be redrawn.
-    int m_maxCardsPerPage = 0;                             ///< Maximum number of cards that can be displayed per page.
+    std::function<void(DeckLibrary &)> m_studyAllDue;          ///< Function to call when studying every due card.
+    std::function<void(const DeckLibrary &)> m_showStatistics; ///< Function to call when viewing the statistics.
+    bool m_needsRedraw = true;                                 ///< Flag indicating if the scene needs to be redrawn.
+    int m_maxCardsPerPage = 0;                                 ///< Maximum cards that can be displayed per page.
 
     bool m_staticDrawn = false;
     bool m_decksNeedReload = false;
@@ -154,6 +171,24 @@ public:
                    std::function<void()> goToDeckSelection,
                    std::function<void(const std::vector<int> &, int, bool)> showResults,
                    StudySettings &studySettings);
+
+    /**
+     * @brief Construct a FlashcardScene studying the due cards of every deck in a library.
+     *
+     * Cards are taken in order of when they fell due across all decks, only the decks they come from are loaded,
+     * and each deck is saved once with all of its reviews when the session ends.
+     *
+     * @param uiManager The UI manager responsible for handling the user interface.
+     * @param library The decks to study, which must outlive the scene.
+     * @param goBack A function to be called when the user wants to go back to the previous scene.
+     * @param showResults A function to be called when the study session ends, passing difficulty counts.
+     */
+    FlashcardScene(ConsoleUI::UIManager &uiManager,
+                   DeckLibrary &library,
+                   std::function<void()> goBack,
+                   std::function<void()> goToDeckSelection,
+                   std::function<void(const std::vector<int> &, int, bool)> showResults,
+                   StudySettings &studySettings);
     /**
      * @brief Initialize the scene.
      *
@@ -199,18 +234,66 @@ public:
     void updateCardDifficulty(size_t cardIndex, CardDifficulty difficulty);
     void initializeCardOrder();
 
+    /**
+     * @brief Choose the cards from the ranked cards that fit in the time left and the flashcard limit.
+     *
+     * @param first The position in the card order of the first card not yet studied, the cards before it are kept.
+     */
+    void planSession(size_t first);
+
+    /**
+     * @brief The id the review log knows a card of the session by.
+     *
+     * @param cardIndex The card's index in m_deck.
+     * @return uint64_t
+     */
+    uint64_t cardReviewId(size_t cardIndex) const;
+
+    /**
+     * @brief Write the reviews logged since the last checkpoint, once the checkpoint delay has passed.
+     * @details Called every frame by update() rather than as a card is graded, so grading never waits on the disk
+     * and a crash or a closed console loses at most the last few seconds of the session's reviews.
+     *
+     * @param now The current time.
+     * @return true if a checkpoint was written.
+     */
+    bool checkpointReviewLog(std::chrono::steady_clock::time_point now);
+
+    /** The longest the reviews of a session are only kept in memory. */
+    static constexpr std::chrono::seconds reviewLogCheckpointDelay{5};
+
+    /**
+     * @brief Take the cards due across every deck of the library being studied, up to the flashcard limit.
+     */
+    void initializeDueCards();
+
     /**
      * @brief Move to the next flashcard in the deck.
      */
     void nextCard();
 
 
-    std::vector<size_t> m_cardOrder; ///< Randomized order of flashcards for the session.
-    FlashCardDeck m_deck;            ///< The flashcard deck being studied.
-    size_t m_currentCardIndex = 0;   ///< Index of the current flashcard being shown.
-    bool m_showAnswer = false;       ///< Flag indicating whether the answer is currently visible.
+    std::vector<size_t> m_cardOrder;              ///< Randomized order of flashcards for the session.
+    std::vector<size_t> m_rankedCards;            ///< Every card the session may study, in ranked order.
+    LatencyModel m_latency;                       ///< How long each card is expected to take.
+    double m_expectedSeconds = 0;                 ///< Expected time of the timed reviews of the session.
+    double m_actualSeconds = 0;                   ///< Actual time of the timed reviews of the session.
+    FlashCardDeck m_deck;                         ///< The flashcard deck being studied.
+    std::unique_ptr<DueMerge> m_dueMerge;         ///< Merges the due cards of every deck, when studying a library.
+    std::vector<DueCard> m_dueOrigins;            ///< The deck each card of m_deck came from, when studying a library.
+    std::unique_ptr<StudyQueue> m_studyQueue;     ///< The deck's saved study queue, when studying a deck file.
+    std::unique_ptr<ReviewLogWriter> m_reviewLog; ///< Every review of the session is appended here.
+    uint64_t m_sessionId = 0;                     ///< Logged with each review, the time the session started.
+    size_t m_currentCardIndex = 0;                ///< Index of the current flashcard being shown.
+    size_t m_leechesFound = 0;                    ///< Cards that became leeches in the session.
+    bool m_showAnswer = false;                    ///< Flag indicating whether the answer is currently visible.
     bool m_lastAnswerDisplayed;
 
+    std::chrono::steady_clock::time_point m_questionShownAt{};       ///< When the current question was first drawn.
+    std::chrono::steady_clock::time_point m_answerShownAt{};         ///< When the current answer was revealed.
+    std::chrono::steady_clock::time_point m_reviewLogCheckpointAt{}; ///< When the review log was last written.
+    ReviewRecord m_lastReview{};                                     ///< The last review logged in the session.
+
 
 private:
     /**
@@ -220,6 +303,26 @@ private:
      */
     void selectDifficulty(CardDifficulty difficulty);
 
+    /**
+     * @brief Create the menu of difficulties shown with each answer.
+     */
+    void createDifficultyMenu();
+
+    /**
+     * @brief Open the review log of the deck directory and give the session its id.
+     */
+    void openReviewLog();
+
+    /**
+     * @brief Resume the deck's session left part way, or plan a new one from the deck's study queue.
+     */
+    void openStudyQueue();
+
+    /**
+     * @brief Estimate how long each ranked card takes from the latency file kept with the review log.
+     */
+    void loadLatencies();
+
 
     void saveUpdatedDeck();
     // int flashcard_limit = 10;
@@ -145,8 +145,6 @@ std::vector<PlayingCard> generateDeck(int numCards)
 {
     // compute the sum of all possibilities by looping over the cards
     // place them on a normal distribution
-    // seed the random number generator with the current time
-    std::srand(std::time(NULL));
     float sum = 0.0;
     float currentDist = 0.0;
     std::vector<float> distribution = {};
@@ -169,7 +167,7 @@ std::vector<PlayingCard> generateDeck(int numCards)
     for (int i = 0; i < numCards; i++)
     {
 
-        float type = std::rand() / (float)RAND_MAX;
+        float type = static_cast<float>(rngStream(GAME_DECK_STREAM).uniform());
         int index = -1;
         for (int j = 0; j < distribution.size(); j++)
         {
@@ -179,7 +177,7 @@ std::vector<PlayingCard> generateDeck(int numCards)
                 break;
             }
         } // add error handling here for -1
-        int value = (int)(std::rand() / (double)RAND_MAX * 30);
+        int value = static_cast<int>(rngStream(GAME_DECK_STREAM).below(30));
         PlayingCard card = PlayingCard((enum Type)index, value);
         hand.push_back(card);
     }
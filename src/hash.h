@@ -0,0 +1,94 @@
+/**
+ * @file hash.h
+ * @author Green Alligators
+ * @brief Hash functions used to identify and compare deck contents
+ * @details SHA-256 is used where contents are addressed by their hash and a collision would lose data. FNV-1a is
+ * a fast non-cryptographic hash for building ids and lookup keys.
+ *
+ * @version 1.0.0
+ * @date 2024-10-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef HASH_H
+#define HASH_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Incremental SHA-256 hasher
+ *
+ */
+class Sha256
+{
+public:
+    Sha256();
+
+    /**
+     * @brief Add data to the hash
+     *
+     * @param data The bytes to add
+     */
+    void update(std::string_view data);
+
+    /**
+     * @brief Finish the hash and return the 32 byte digest
+     * @details The hasher must not be updated again afterwards.
+     *
+     * @return std::array<uint8_t, 32>
+     */
+    std::array<uint8_t, 32> digest();
+
+    /**
+     * @brief Finish the hash and return the digest as 64 lowercase hex characters
+     *
+     * @return std::string
+     */
+    std::string hexDigest();
+
+private:
+    /**
+     * @brief Process one 64 byte block
+     *
+     * @param block The block to process
+     */
+    void transform(const uint8_t *block);
+
+    std::array<uint32_t, 8> m_state; ///< The running hash state
+    std::array<uint8_t, 64> m_block; ///< Bytes waiting for a full block
+    size_t m_blockLen = 0;           ///< Number of bytes in m_block
+    uint64_t m_totalLen = 0;         ///< Total number of bytes hashed
+};
+
+/**
+ * @brief SHA-256 of data as 64 lowercase hex characters
+ *
+ * @param data The bytes to hash
+ * @return std::string
+ */
+std::string sha256Hex(std::string_view data);
+
+/**
+ * @brief 64 bit FNV-1a hash
+ *
+ * @param data The bytes to hash
+ * @param seed Starting value, pass a previous result to hash several pieces
+ * @return uint64_t
+ */
+uint64_t fnv1a64(std::string_view data, uint64_t seed = 14695981039346656037ULL);
+
+/**
+ * @brief Convert bytes to lowercase hex
+ *
+ * @param data The bytes to convert
+ * @param len Number of bytes
+ * @return std::string
+ */
+std::string toHex(const uint8_t *data, size_t len);
+
+#endif // HASH_H
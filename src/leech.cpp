@@ -0,0 +1,85 @@
+/**
+ * @file leech.cpp
+ * @author Green Alligators
+ * @brief Finds leeches, cards that are forgotten again and again, as they are reviewed
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "leech.h"
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+
+bool sameTag(const std::string &a, const std::string &b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+void addTag(FlashCard &card, const std::string &tag)
+{
+    if (!cardHasTag(card, tag))
+    {
+        card.tags.push_back(tag);
+    }
+}
+
+} // namespace
+
+std::string leechActionToStr(LeechAction action)
+{
+    return action == SUSPEND_LEECH ? "Suspend" : "Tag only";
+}
+
+bool cardHasTag(const FlashCard &card, const std::string &tag)
+{
+    return std::any_of(card.tags.begin(), card.tags.end(), [&tag](const std::string &t) { return sameTag(t, tag); });
+}
+
+bool isSuspended(const FlashCard &card)
+{
+    // most cards have no tags, so this is usually a single comparison
+    return !card.tags.empty() && cardHasTag(card, suspendedTag);
+}
+
+bool isLeech(const FlashCard &card)
+{
+    return !card.tags.empty() && cardHasTag(card, leechTag);
+}
+
+bool checkLeech(FlashCard &card, uint32_t failures_before, uint32_t threshold, LeechAction action)
+{
+    uint32_t failures = card.schedule.failures;
+    if (threshold == 0 || failures <= failures_before || failures < threshold)
+    {
+        return false;
+    }
+    uint32_t every = (std::max)(threshold / 2, 1u);
+    if ((failures - threshold) % every != 0)
+    {
+        return false;
+    }
+    addTag(card, leechTag);
+    if (action == SUSPEND_LEECH)
+    {
+        addTag(card, suspendedTag);
+    }
+    return true;
+}
+
+LeechCount countLeeches(const std::vector<FlashCard> &cards)
+{
+    LeechCount count{};
+    for (const FlashCard &card : cards)
+    {
+        count.leeches += isLeech(card) ? 1 : 0;
+        count.suspended += isSuspended(card) ? 1 : 0;
+    }
+    return count;
+}
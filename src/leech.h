@@ -0,0 +1,114 @@
+/**
+ * @file leech.h
+ * @author Green Alligators
+ * @brief Finds leeches, cards that are forgotten again and again, as they are reviewed
+ * @details A card's failures, the times it was answered again whether or not it had been learnt, are counted in its
+ * schedule by the scheduler, so a card that is never learnt at all is found as well as one that keeps lapsing. When a
+ * review takes the failures to the leech threshold the card is tagged "leech", and again every half threshold after
+ * that while it keeps being forgotten. Depending on the leech action the card is also tagged
+ * "suspended". Suspended cards are never chosen for study; removing the tag from the deck file brings the card
+ * back.
+ *
+ * Only the reviewed card is looked at, so finding leeches costs nothing however large the deck is. The tags are
+ * saved with the deck, so leeches that are not suspended can be studied with the study filter "tag = leech".
+ *
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef LEECH_H
+#define LEECH_H
+
+#include "deck.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** Failures that make a card a leech, unless changed in the settings */
+constexpr uint32_t defaultLeechThreshold{8};
+
+/** The tag given to leeches */
+constexpr const char *leechTag{"leech"};
+
+/** The tag of cards that are not studied */
+constexpr const char *suspendedTag{"suspended"};
+
+/**
+ * @brief What happens to a card that becomes a leech
+ * \showenumvalues
+ *
+ */
+enum LeechAction
+{
+    TAG_LEECH,    ///< The card is only tagged
+    SUSPEND_LEECH ///< The card is tagged and suspended
+};
+
+/**
+ * @brief Convert a leech action to a name for display
+ *
+ * @param action The action
+ * @return std::string
+ */
+std::string leechActionToStr(LeechAction action);
+
+/**
+ * @brief Whether a card has a tag, not case sensitive
+ *
+ * @param card The card
+ * @param tag The tag
+ * @return true if the card has the tag
+ */
+bool cardHasTag(const FlashCard &card, const std::string &tag);
+
+/**
+ * @brief Whether a card is suspended and must not be studied
+ *
+ * @param card The card
+ * @return true if the card has the suspended tag
+ */
+bool isSuspended(const FlashCard &card);
+
+/**
+ * @brief Whether a card has been found to be a leech
+ *
+ * @param card The card
+ * @return true if the card has the leech tag
+ */
+bool isLeech(const FlashCard &card);
+
+/**
+ * @brief Check a card for becoming a leech, after it was reviewed
+ * @details A card is flagged when its failures went up in the review and reached the threshold, or a multiple of
+ * half the threshold beyond it.
+ *
+ * @param card The reviewed card
+ * @param failures_before The card's failures before the review
+ * @param threshold Failures that make a card a leech, 0 never flags a card
+ * @param action What to do with a leech
+ * @return true if the card was flagged in this review
+ */
+bool checkLeech(FlashCard &card, uint32_t lapses_before, uint32_t threshold, LeechAction action);
+
+/**
+ * @brief The leeches among some cards
+ *
+ */
+struct LeechCount
+{
+    size_t leeches{0};   ///< Cards tagged as leeches
+    size_t suspended{0}; ///< Cards suspended, leeches or not
+};
+
+/**
+ * @brief Count the leeches and suspended cards among some cards
+ *
+ * @param cards The cards
+ * @return LeechCount
+ */
+LeechCount countLeeches(const std::vector<FlashCard> &cards);
+
+#endif // LEECH_H
@@ -0,0 +1,471 @@
+/**
+ * @file review_log.cpp
+ * @author Green Alligators
+ * @brief Append-only log of every card review, stored by column
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "review_log.h"
+#include "hash.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+
+namespace
+{
+constexpr std::array<char, 8> reviewLogMagic{'S', 'D', 'R', 'E', 'V', 'L', 'O', 'G'};
+constexpr uint32_t reviewLogFormat{3};
+constexpr uint64_t fileHeaderBytes{16};
+constexpr uint64_t blockHeaderBytes{8};
+
+/** the columns of a block in the order they are stored, with the bytes per value */
+constexpr std::array<std::pair<ReviewColumn, uint64_t>, 8> columnLayout{{{CARD_ID_COLUMN, 8},
+                                                                         {DECK_ID_COLUMN, 8},
+                                                                         {TIME_COLUMN, 8},
+                                                                         {SESSION_COLUMN, 8},
+                                                                         {DUE_COLUMN, 8},
+                                                                         {RESPONSE_COLUMN, 4},
+                                                                         {GRADE_TIME_COLUMN, 4},
+                                                                         {GRADE_COLUMN, 1}}};
+
+constexpr uint64_t recordBytes{8 + 8 + 8 + 8 + 8 + 4 + 4 + 1};
+
+uint64_t blockOffset(uint32_t block_records, uint64_t block)
+{
+    return fileHeaderBytes + block * (blockHeaderBytes + block_records * recordBytes);
+}
+
+uint64_t columnOffset(uint32_t block_records, size_t column_index)
+{
+    uint64_t offset = blockHeaderBytes;
+    for (size_t c = 0; c < column_index; ++c)
+    {
+        offset += columnLayout[c].second * block_records;
+    }
+    return offset;
+}
+
+template <typename T>
+T toLittleEndian(T value)
+{
+    if constexpr (std::endian::native != std::endian::little)
+    {
+        std::array<char, sizeof(T)> bytes{};
+        std::memcpy(bytes.data(), &value, sizeof(T));
+        std::reverse(bytes.begin(), bytes.end());
+        std::memcpy(&value, bytes.data(), sizeof(T));
+    }
+    return value;
+}
+
+template <typename T>
+void writeValues(std::ostream &out, const T *values, size_t n)
+{
+    if constexpr (std::endian::native == std::endian::little)
+    {
+        out.write(reinterpret_cast<const char *>(values), static_cast<std::streamsize>(n * sizeof(T)));
+    }
+    else
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            T value = toLittleEndian(values[i]);
+            out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+    }
+}
+
+template <typename T>
+void readValues(std::istream &in, std::vector<T> &values, size_t n)
+{
+    values.resize(n);
+    in.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(n * sizeof(T)));
+    if constexpr (std::endian::native != std::endian::little)
+    {
+        for (T &value : values)
+        {
+            value = toLittleEndian(value);
+        }
+    }
+}
+
+void writeHeader(std::ostream &out)
+{
+    uint32_t fields[2]{reviewLogFormat, reviewLogBlockRecords};
+    out.write(reviewLogMagic.data(), reviewLogMagic.size());
+    writeValues(out, fields, 2);
+}
+
+bool readHeader(std::istream &in, uint32_t &block_records)
+{
+    std::array<char, 8> magic{};
+    std::vector<uint32_t> fields{};
+    in.seekg(0);
+    in.read(magic.data(), magic.size());
+    readValues(in, fields, 2);
+    if (!in || magic != reviewLogMagic || fields[0] != reviewLogFormat || fields[1] == 0)
+    {
+        return false;
+    }
+    block_records = fields[1];
+    return true;
+}
+
+/** every block but the last is full, so only the last block's count has to be read */
+uint64_t countRecords(std::istream &in, uint64_t file_size, uint32_t block_records)
+{
+    if (file_size <= fileHeaderBytes)
+    {
+        return 0;
+    }
+    uint64_t block_bytes = blockHeaderBytes + block_records * recordBytes;
+    uint64_t n_blocks = (file_size - fileHeaderBytes + block_bytes - 1) / block_bytes;
+    std::vector<uint32_t> count{};
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(blockOffset(block_records, n_blocks - 1)));
+    readValues(in, count, 1);
+    uint64_t last = in ? (std::min)(count[0], block_records) : 0;
+    in.clear();
+    return (n_blocks - 1) * block_records + last;
+}
+
+template <typename T>
+void eraseFront(std::vector<T> &values, size_t n)
+{
+    values.erase(values.begin(), values.begin() + static_cast<std::ptrdiff_t>((std::min)(n, values.size())));
+}
+} // namespace
+
+
+size_t ReviewColumns::size() const
+{
+    return (std::max)({card_ids.size(),
+                     deck_ids.size(),
+                     times_ms.size(),
+                     session_ids.size(),
+                     dues.size(),
+                     response_ms.size(),
+                     grade_ms.size(),
+                     grades.size()});
+}
+
+void ReviewColumns::clear()
+{
+    card_ids.clear();
+    deck_ids.clear();
+    times_ms.clear();
+    session_ids.clear();
+    dues.clear();
+    response_ms.clear();
+    grade_ms.clear();
+    grades.clear();
+}
+
+void ReviewColumns::push(const ReviewRecord &record)
+{
+    card_ids.push_back(record.card_id);
+    deck_ids.push_back(record.deck_id);
+    times_ms.push_back(record.time_ms);
+    session_ids.push_back(record.session_id);
+    dues.push_back(record.due);
+    response_ms.push_back(record.response_ms);
+    grade_ms.push_back(record.grade_ms);
+    grades.push_back(record.grade);
+}
+
+ReviewRecord ReviewColumns::record(size_t index) const
+{
+    ReviewRecord record{};
+    record.card_id = index < card_ids.size() ? card_ids[index] : 0;
+    record.deck_id = index < deck_ids.size() ? deck_ids[index] : 0;
+    record.time_ms = index < times_ms.size() ? times_ms[index] : 0;
+    record.session_id = index < session_ids.size() ? session_ids[index] : 0;
+    record.due = index < dues.size() ? dues[index] : 0;
+    record.response_ms = index < response_ms.size() ? response_ms[index] : 0;
+    record.grade_ms = index < grade_ms.size() ? grade_ms[index] : 0;
+    record.grade = index < grades.size() ? grades[index] : 0;
+    return record;
+}
+
+
+uint64_t reviewDeckId(const std::string &deck_name)
+{
+    return fnv1a64(deck_name);
+}
+
+uint64_t reviewCardId(const std::string &deck_name, const FlashCard &card)
+{
+    // the separator keeps "ab" + "c" apart from "a" + "bc"
+    uint64_t hash = reviewDeckId(deck_name);
+    hash = fnv1a64(std::string_view{"\0", 1}, hash);
+    return fnv1a64(card.question, hash);
+}
+
+int64_t reviewTimeNowMs()
+{
+    auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count();
+}
+
+fs::path reviewLogFileFor(const fs::path &deck_dir)
+{
+    return deck_dir / ".history" / "reviews.log";
+}
+
+
+ReviewLogWriter::ReviewLogWriter(fs::path log_file, size_t checkpoint_interval)
+    : m_file(std::move(log_file)), m_interval(std::max<size_t>(checkpoint_interval, 1))
+{
+    // count what is already logged, the file itself is only created by the first checkpoint
+    std::error_code ec;
+    if (fs::exists(m_file, ec))
+    {
+        open();
+    }
+}
+
+ReviewLogWriter::~ReviewLogWriter()
+{
+    checkpoint();
+}
+
+void ReviewLogWriter::append(const ReviewRecord &record)
+{
+    m_buffer.push(record);
+    if (m_buffer.size() >= m_interval)
+    {
+        checkpoint();
+    }
+}
+
+bool ReviewLogWriter::checkpoint()
+{
+    if (m_buffer.size() == 0)
+    {
+        return true;
+    }
+    if (!open())
+    {
+        return false;
+    }
+
+    const uint32_t block_records = reviewLogBlockRecords;
+    size_t n = m_buffer.size();
+    size_t done = 0;
+    while (done < n)
+    {
+        uint64_t block = m_written / block_records;
+        uint32_t slot = static_cast<uint32_t>(m_written % block_records);
+        size_t count = std::min<size_t>(n - done, block_records - slot);
+        uint64_t base = blockOffset(block_records, block);
+
+        for (size_t c = 0; c < columnLayout.size(); ++c)
+        {
+            uint64_t offset = base + columnOffset(block_records, c) + slot * columnLayout[c].second;
+            m_stream.seekp(static_cast<std::streamoff>(offset));
+            switch (columnLayout[c].first)
+            {
+            case CARD_ID_COLUMN:
+                writeValues(m_stream, m_buffer.card_ids.data() + done, count);
+                break;
+            case DECK_ID_COLUMN:
+                writeValues(m_stream, m_buffer.deck_ids.data() + done, count);
+                break;
+            case TIME_COLUMN:
+                writeValues(m_stream, m_buffer.times_ms.data() + done, count);
+                break;
+            case SESSION_COLUMN:
+                writeValues(m_stream, m_buffer.session_ids.data() + done, count);
+                break;
+            case DUE_COLUMN:
+                writeValues(m_stream, m_buffer.dues.data() + done, count);
+                break;
+            case RESPONSE_COLUMN:
+                writeValues(m_stream, m_buffer.response_ms.data() + done, count);
+                break;
+            case GRADE_TIME_COLUMN:
+                writeValues(m_stream, m_buffer.grade_ms.data() + done, count);
+                break;
+            default:
+                writeValues(m_stream, m_buffer.grades.data() + done, count);
+                break;
+            }
+        }
+        // the values must be on disk before the count that makes them part of the log
+        m_stream.flush();
+        uint32_t header[2]{slot + static_cast<uint32_t>(count), 0};
+        m_stream.seekp(static_cast<std::streamoff>(base));
+        writeValues(m_stream, header, 2);
+        m_stream.flush();
+
+        if (!m_stream)
+        {
+            std::cerr << "Could not write review log " << m_file << std::endl;
+            // keep what was not written, and count the file again before the next checkpoint
+            eraseFront(m_buffer.card_ids, done);
+            eraseFront(m_buffer.deck_ids, done);
+            eraseFront(m_buffer.times_ms, done);
+            eraseFront(m_buffer.session_ids, done);
+            eraseFront(m_buffer.dues, done);
+            eraseFront(m_buffer.response_ms, done);
+            eraseFront(m_buffer.grade_ms, done);
+            eraseFront(m_buffer.grades, done);
+            m_stream.close();
+            m_opened = false;
+            return false;
+        }
+        m_written += count;
+        done += count;
+    }
+    m_buffer.clear();
+    return true;
+}
+
+uint64_t ReviewLogWriter::size() const
+{
+    return m_written + m_buffer.size();
+}
+
+size_t ReviewLogWriter::pending() const
+{
+    return m_buffer.size();
+}
+
+bool ReviewLogWriter::open()
+{
+    if (m_opened)
+    {
+        return true;
+    }
+    std::error_code ec;
+    if (!fs::exists(m_file, ec))
+    {
+        if (m_file.has_parent_path())
+        {
+            fs::create_directories(m_file.parent_path(), ec);
+        }
+        std::ofstream create{m_file, std::ios::binary};
+        writeHeader(create);
+        if (!create)
+        {
+            std::cerr << "Could not create review log " << m_file << std::endl;
+            return false;
+        }
+    }
+
+    m_stream.open(m_file, std::ios::in | std::ios::out | std::ios::binary);
+    uint32_t block_records = 0;
+    if (!m_stream || !readHeader(m_stream, block_records) || block_records != reviewLogBlockRecords)
+    {
+        std::cerr << "Review log " << m_file << " is not a review log this version can append to" << std::endl;
+        m_stream.close();
+        return false;
+    }
+    m_written = countRecords(m_stream, fs::file_size(m_file, ec), block_records);
+    m_opened = true;
+    return true;
+}
+
+
+ReviewLogReader::ReviewLogReader(fs::path log_file) : m_stream(log_file, std::ios::binary)
+{
+    std::error_code ec;
+    m_ok = m_stream && readHeader(m_stream, m_blockRecords);
+    if (m_ok)
+    {
+        m_size = countRecords(m_stream, fs::file_size(log_file, ec), m_blockRecords);
+    }
+}
+
+bool ReviewLogReader::ok() const
+{
+    return m_ok;
+}
+
+uint64_t ReviewLogReader::size() const
+{
+    return m_size;
+}
+
+uint32_t ReviewLogReader::blockRecords() const
+{
+    return m_blockRecords;
+}
+
+size_t ReviewLogReader::blockCount() const
+{
+    return m_ok ? static_cast<size_t>((m_size + m_blockRecords - 1) / m_blockRecords) : 0;
+}
+
+bool ReviewLogReader::readBlock(size_t block, ReviewColumns &columns, unsigned column_mask)
+{
+    columns.clear();
+    if (block >= blockCount())
+    {
+        return false;
+    }
+    size_t n = static_cast<size_t>(std::min<uint64_t>(m_size - block * uint64_t{m_blockRecords}, m_blockRecords));
+    uint64_t base = blockOffset(m_blockRecords, block);
+
+    // each column is one contiguous read, the columns not asked for are skipped over
+    m_stream.clear();
+    for (size_t c = 0; c < columnLayout.size(); ++c)
+    {
+        if ((column_mask & columnLayout[c].first) == 0)
+        {
+            continue;
+        }
+        m_stream.seekg(static_cast<std::streamoff>(base + columnOffset(m_blockRecords, c)));
+        switch (columnLayout[c].first)
+        {
+        case CARD_ID_COLUMN:
+            readValues(m_stream, columns.card_ids, n);
+            break;
+        case DECK_ID_COLUMN:
+            readValues(m_stream, columns.deck_ids, n);
+            break;
+        case TIME_COLUMN:
+            readValues(m_stream, columns.times_ms, n);
+            break;
+        case SESSION_COLUMN:
+            readValues(m_stream, columns.session_ids, n);
+            break;
+        case DUE_COLUMN:
+            readValues(m_stream, columns.dues, n);
+            break;
+        case RESPONSE_COLUMN:
+            readValues(m_stream, columns.response_ms, n);
+            break;
+        case GRADE_TIME_COLUMN:
+            readValues(m_stream, columns.grade_ms, n);
+            break;
+        default:
+            readValues(m_stream, columns.grades, n);
+            break;
+        }
+    }
+    return static_cast<bool>(m_stream);
+}
+
+bool ReviewLogReader::scan(const std::function<void(const ReviewColumns &)> &visit, unsigned column_mask)
+{
+    ReviewColumns columns{};
+    for (size_t block = 0; block < blockCount(); ++block)
+    {
+        if (!readBlock(block, columns, column_mask))
+        {
+            return false;
+        }
+        visit(columns);
+    }
+    return m_ok;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file review_log.h
+ * @author Green Alligators
+ * @brief Append-only log of every card review, stored by column
+ * @details Each review of a card is appended to the log as a ReviewRecord so the full history of reviews is kept,
+ * not only the latest difficulty and count saved with the card.
+ *
+ * The log is stored by column so that a scan for analytics or scheduler training reads only the fields it needs.
+ * After a 16 byte header (the magic string "SDREVLOG", a format version and the number of records per block) the
+ * file is a sequence of fixed size blocks, each holding up to reviewLogBlockRecords records:
+ *
+ * - record count: 4 bytes, then 4 bytes reserved
+ * - card ids: 8 bytes each, for every record the block can hold
+ * - deck ids: 8 bytes each
+ * - times in milliseconds since the epoch: 8 bytes each
+ * - session ids: 8 bytes each
+ * - due times in seconds since the epoch: 8 bytes each
+ * - response times in milliseconds: 4 bytes each
+ * - grading times in milliseconds: 4 bytes each
+ * - grades: 1 byte each
+ *
+ * Every value is little-endian and every column starts on an 8 byte boundary, so a column of a block is a plain
+ * array at a fixed offset and the file can be mapped into memory and read in place. Only the last block is ever
+ * partly filled.
+ *
+ * A ReviewLogWriter buffers records in memory and writes them at a checkpoint, every checkpoint interval records
+ * and when it is destroyed. The values are written before the count that covers them, so a checkpoint cut short
+ * by a crash only loses the records it was writing.
+ *
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef REVIEW_LOG_H
+#define REVIEW_LOG_H
+
+#include "deck.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+/** The number of records in a full block of the log */
+constexpr uint32_t reviewLogBlockRecords{64 * 1024};
+
+/**
+ * @brief One review of a card
+ *
+ */
+struct ReviewRecord
+{
+    /** the card reviewed, see reviewCardId */
+    uint64_t card_id{0};
+    /** the card's deck, see reviewDeckId */
+    uint64_t deck_id{0};
+    /** when it was reviewed, milliseconds since the epoch */
+    int64_t time_ms{0};
+    /** the study session it was reviewed in */
+    uint64_t session_id{0};
+    /** when the review scheduled the card to be due next, seconds since the epoch as in CardSchedule */
+    int64_t due{0};
+    /** milliseconds from the question being shown to the answer being revealed, 0 if not measured */
+    uint32_t response_ms{0};
+    /** milliseconds from the answer being revealed to the card being graded, 0 if not measured */
+    uint32_t grade_ms{0};
+    /** the ReviewRating given */
+    uint8_t grade{0};
+};
+
+/**
+ * @brief The columns of the log, combined as a mask to choose which are read
+ * \showenumvalues
+ *
+ */
+enum ReviewColumn : unsigned
+{
+    CARD_ID_COLUMN = 1,
+    DECK_ID_COLUMN = 2,
+    TIME_COLUMN = 4,
+    SESSION_COLUMN = 8,
+    DUE_COLUMN = 16,
+    RESPONSE_COLUMN = 32,
+    GRADE_TIME_COLUMN = 64,
+    GRADE_COLUMN = 128,
+    ALL_REVIEW_COLUMNS = 255
+};
+
+/**
+ * @brief Reviews held by column, the form they are buffered and read in
+ * @details Columns that were not read are left empty.
+ *
+ */
+struct ReviewColumns
+{
+    std::vector<uint64_t> card_ids{};    ///< ReviewRecord::card_id of each review
+    std::vector<uint64_t> deck_ids{};    ///< ReviewRecord::deck_id of each review
+    std::vector<int64_t> times_ms{};     ///< ReviewRecord::time_ms of each review
+    std::vector<uint64_t> session_ids{}; ///< ReviewRecord::session_id of each review
+    std::vector<int64_t> dues{};         ///< ReviewRecord::due of each review
+    std::vector<uint32_t> response_ms{}; ///< ReviewRecord::response_ms of each review
+    std::vector<uint32_t> grade_ms{};    ///< ReviewRecord::grade_ms of each review
+    std::vector<uint8_t> grades{};       ///< ReviewRecord::grade of each review
+
+    /**
+     * @brief The number of reviews, the size of the longest column
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+    /**
+     * @brief Remove every review, keeping the memory of the columns
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Add a review to the end of every column
+     *
+     * @param record The review
+     */
+    void push(const ReviewRecord &record);
+
+    /**
+     * @brief Gather a review from the columns, any column not read gives 0
+     *
+     * @param index The review
+     * @return ReviewRecord
+     */
+    ReviewRecord record(size_t index) const;
+};
+
+/**
+ * @brief The id a deck is logged under, a hash of its name
+ *
+ * @param deck_name The name of the deck
+ * @return uint64_t
+ */
+uint64_t reviewDeckId(const std::string &deck_name);
+
+/**
+ * @brief The id a card is logged under
+ * @details A hash of the deck's name and the card's question, so it stays the same when the card's answer is
+ * corrected or its deck is reordered.
+ *
+ * @param deck_name The name of the card's deck
+ * @param card The card
+ * @return uint64_t
+ */
+uint64_t reviewCardId(const std::string &deck_name, const FlashCard &card);
+
+/**
+ * @brief The current time as logged with a review
+ *
+ * @return int64_t Milliseconds since the epoch
+ */
+int64_t reviewTimeNowMs();
+
+/**
+ * @brief The review log kept with the decks in a directory
+ *
+ * @param deck_dir The deck directory
+ * @return std::filesystem::path
+ */
+std::filesystem::path reviewLogFileFor(const std::filesystem::path &deck_dir);
+
+/**
+ * @brief Appends reviews to a log file, buffered and written at checkpoints
+ *
+ */
+class ReviewLogWriter
+{
+public:
+    /** records buffered before a checkpoint when no interval is given */
+    static constexpr size_t defaultCheckpointInterval{1024};
+
+    /**
+     * @brief Append to a log file, which is created at the first checkpoint if it does not exist
+     *
+     * @param log_file The log file
+     * @param checkpoint_interval Records buffered before they are written
+     */
+    explicit ReviewLogWriter(std::filesystem::path log_file, size_t checkpoint_interval = defaultCheckpointInterval);
+
+    /**
+     * @brief Write any buffered records
+     *
+     */
+    ~ReviewLogWriter();
+
+    ReviewLogWriter(const ReviewLogWriter &) = delete;
+    ReviewLogWriter &operator=(const ReviewLogWriter &) = delete;
+
+    /**
+     * @brief Add a review, writing a checkpoint if the buffer is full
+     *
+     * @param record The review
+     */
+    void append(const ReviewRecord &record);
+
+    /**
+     * @brief Write the buffered records to the file
+     *
+     * @return true if every buffered record was written
+     */
+    bool checkpoint();
+
+    /**
+     * @brief The number of records in the log, including those still buffered
+     *
+     * @return uint64_t
+     */
+    uint64_t size() const;
+
+    /**
+     * @brief The number of records buffered and not yet written
+     *
+     * @return size_t
+     */
+    size_t pending() const;
+
+private:
+    /**
+     * @brief Open the file, creating it or finding the end of the records already in it
+     *
+     * @return true if the file can be appended to
+     */
+    bool open();
+
+    std::filesystem::path m_file; ///< The log file
+    std::fstream m_stream;        ///< The open log file
+    bool m_opened{false};         ///< Whether m_stream is open and m_written counted
+    size_t m_interval;            ///< Records buffered before a checkpoint
+    uint64_t m_written{0};        ///< Records in the file
+    ReviewColumns m_buffer{};     ///< Records not yet written
+};
+
+/**
+ * @brief Reads a review log one block at a time, only the columns asked for
+ *
+ */
+class ReviewLogReader
+{
+public:
+    /**
+     * @brief Open a log file
+     *
+     * @param log_file The log file
+     */
+    explicit ReviewLogReader(std::filesystem::path log_file);
+
+    /**
+     * @brief Whether the file was opened and its header is valid
+     *
+     * @return true if the log can be read
+     */
+    bool ok() const;
+
+    /**
+     * @brief The number of records in the log
+     *
+     * @return uint64_t
+     */
+    uint64_t size() const;
+
+    /**
+     * @brief The number of records a block holds, from the header
+     *
+     * @return uint32_t
+     */
+    uint32_t blockRecords() const;
+
+    /**
+     * @brief The number of blocks in the log
+     *
+     * @return size_t
+     */
+    size_t blockCount() const;
+
+    /**
+     * @brief Read some columns of a block
+     *
+     * @param block The block
+     * @param columns Set to the block's reviews, its memory is reused
+     * @param column_mask The ReviewColumn values of the columns to read
+     * @return true if the block was read
+     */
+    bool readBlock(size_t block, ReviewColumns &columns, unsigned column_mask = ALL_REVIEW_COLUMNS);
+
+    /**
+     * @brief Read some columns of every block in order
+     *
+     * @param visit Called with the reviews of each block
+     * @param column_mask The ReviewColumn values of the columns to read
+     * @return true if every block was read
+     */
+    bool scan(const std::function<void(const ReviewColumns &)> &visit, unsigned column_mask = ALL_REVIEW_COLUMNS);
+
+private:
+    std::ifstream m_stream;     ///< The open log file
+    bool m_ok{false};           ///< Whether the header was valid
+    uint32_t m_blockRecords{0}; ///< Records per block, from the header
+    uint64_t m_size{0};         ///< Records in the log
+};
+
+#endif // REVIEW_LOG_H
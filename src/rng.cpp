@@ -0,0 +1,103 @@
+/**
+ * @file rng.cpp
+ * @author Green Alligators
+ * @brief The random number generators used throughout the program
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "rng.h"
+#include <random>
+
+namespace
+{
+
+uint64_t splitmix64(uint64_t &x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    uint64_t z = x;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+struct Streams
+{
+    bool seeded{false};
+    uint64_t seed{0};
+    std::array<Rng, RNG_STREAM_COUNT> streams;
+};
+
+Streams &streams()
+{
+    static Streams s;
+    return s;
+}
+
+} // namespace
+
+Rng::Rng(uint64_t seed)
+{
+    for (uint64_t &word : m_state)
+    {
+        word = splitmix64(seed);
+    }
+}
+
+Rng Rng::split()
+{
+    // the jump polynomial for 2^128 draws, from the xoshiro256** reference
+    static constexpr std::array<uint64_t, 4> jump{
+        0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL};
+
+    Rng skipped = *this;
+    std::array<uint64_t, 4> state{};
+    for (uint64_t word : jump)
+    {
+        for (int bit = 0; bit < 64; ++bit)
+        {
+            if (word & (uint64_t{1} << bit))
+            {
+                for (size_t i = 0; i < state.size(); ++i)
+                {
+                    state[i] ^= m_state[i];
+                }
+            }
+            (*this)();
+        }
+    }
+    m_state = state;
+    return skipped;
+}
+
+void seedRng(uint64_t seed)
+{
+    Streams &s = streams();
+    s.seed = seed;
+    s.seeded = true;
+    Rng root{seed};
+    for (Rng &stream : s.streams)
+    {
+        stream = root.split();
+    }
+}
+
+uint64_t rngSeed()
+{
+    // seeds the streams if nothing has drawn from them yet
+    rngStream(STUDY_ORDER_STREAM);
+    return streams().seed;
+}
+
+Rng &rngStream(RngStream stream)
+{
+    Streams &s = streams();
+    if (!s.seeded)
+    {
+        std::random_device device{};
+        seedRng((static_cast<uint64_t>(device()) << 32) ^ device());
+    }
+    return s.streams[stream];
+}
@@ -0,0 +1,170 @@
+/**
+ * @file rng.h
+ * @author Green Alligators
+ * @brief The random number generators used throughout the program
+ * @details Rng is xoshiro256**, a small and fast generator with 2^256 - 1 states. split() jumps a generator 2^128
+ * draws ahead and returns the part it skipped as a generator of its own, so generators split from one another never
+ * overlap.
+ *
+ * Every part of the program that needs random numbers draws from its own stream, see rngStream. The streams are
+ * split from one seed, so a seed given with seedRng makes every stream repeat exactly, for tests and benchmarks.
+ * Without one the seed is taken from std::random_device once, at the first draw, and no draw after that makes a
+ * system call.
+ *
+ * The streams belong to the UI thread. Work on other threads takes a generator of its own with split().
+ *
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef RNG_H
+#define RNG_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+/**
+ * @brief A xoshiro256** random number generator, usable with the standard distributions
+ *
+ */
+class Rng
+{
+public:
+    using result_type = uint64_t; ///< The type of number drawn
+
+    /**
+     * @brief A generator whose state is expanded from a seed with splitmix64
+     *
+     * @param seed The seed, the same seed gives the same numbers on every platform
+     */
+    explicit Rng(uint64_t seed = 0);
+
+    /**
+     * @brief The smallest number drawn
+     *
+     * @return result_type
+     */
+    static constexpr result_type (min)()
+    {
+        return 0;
+    }
+
+    /**
+     * @brief The largest number drawn
+     *
+     * @return result_type
+     */
+    static constexpr result_type (max)()
+    {
+        return (std::numeric_limits<result_type>::max)();
+    }
+
+    /**
+     * @brief Draw 64 random bits
+     *
+     * @return result_type
+     */
+    result_type operator()()
+    {
+        const uint64_t result = rotl(m_state[1] * 5, 7) * 9;
+        const uint64_t t = m_state[1] << 17;
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotl(m_state[3], 45);
+        return result;
+    }
+
+    /**
+     * @brief Draw a number uniformly from [0, 1) with 53 random bits
+     *
+     * @return double
+     */
+    double uniform()
+    {
+        return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+    }
+
+    /**
+     * @brief Draw a whole number uniformly from [0, n), without the bias of a modulo
+     * @details Draws are masked to the bits n needs and redrawn when n or more, fewer than two draws on average.
+     *
+     * @param n The number of values, 0 gives 0
+     * @return uint64_t
+     */
+    uint64_t below(uint64_t n)
+    {
+        if (n <= 1)
+        {
+            return 0;
+        }
+        const uint64_t mask = (max)() >> std::countl_zero(n - 1);
+        uint64_t x = (*this)() & mask;
+        while (x >= n)
+        {
+            x = (*this)() & mask;
+        }
+        return x;
+    }
+
+    /**
+     * @brief Split off a generator that never overlaps this one
+     * @details The returned generator has this generator's state, then this generator jumps 2^128 draws ahead.
+     *
+     * @return Rng
+     */
+    Rng split();
+
+private:
+    static constexpr uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    std::array<uint64_t, 4> m_state{}; ///< The generator's state, never all zero
+};
+
+/**
+ * @brief The parts of the program with a stream of random numbers of their own
+ * \showenumvalues
+ *
+ */
+enum RngStream
+{
+    STUDY_ORDER_STREAM = 0, ///< The order cards are studied in
+    QUOTE_STREAM,           ///< The quotes shown with results
+    GAME_DECK_STREAM,       ///< The playing cards dealt in the card duel
+    BOOKSHELF_STREAM,       ///< The bookshelf art shown while browsing decks
+    RNG_STREAM_COUNT        ///< The number of streams
+};
+
+/**
+ * @brief Seed every stream, so they repeat the same numbers from now on
+ *
+ * @param seed The seed
+ */
+void seedRng(uint64_t seed);
+
+/**
+ * @brief The seed the streams were last seeded with
+ *
+ * @return uint64_t
+ */
+uint64_t rngSeed();
+
+/**
+ * @brief The generator of one part of the program
+ *
+ * @param stream The part of the program
+ * @return Rng&
+ */
+Rng &rngStream(RngStream stream);
+
+#endif // RNG_H
@@ -0,0 +1,226 @@
+/**
+ * @file scheduler.cpp
+ * @author Green Alligators
+ * @brief Spaced repetition scheduling of flashcards
+ * @version 1.0.0
+ * @date 2024-10-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "scheduler.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+
+namespace
+{
+/** The default FSRS v4 weights */
+constexpr std::array<double, 17> fsrsWeights{
+    0.4, 0.6, 2.4, 5.8, 4.93, 0.94, 0.86, 0.01, 1.49, 0.14, 0.94, 2.18, 0.05, 0.34, 1.26, 0.29, 2.61};
+
+/** The chance of recall cards are scheduled for, FSRS stability is the interval that gives 90% */
+constexpr double fsrsRetention{0.9};
+
+constexpr float sm2StartEase{2.5F};
+constexpr float sm2MinEase{1.3F};
+
+void forgetCard(CardSchedule &schedule, int64_t now)
+{
+    if (schedule.reps > 0)
+    {
+        schedule.lapses++;
+    }
+    schedule.failures++;
+    schedule.reps = 0;
+    schedule.interval = 0;
+    schedule.reviewed = now;
+    schedule.due = now + relearnDelaySeconds;
+}
+
+void scheduleInterval(CardSchedule &schedule, double interval_days, int64_t now)
+{
+    schedule.interval = static_cast<float>((std::max)(1.0, std::round(interval_days)));
+    schedule.reviewed = now;
+    schedule.due = now + static_cast<int64_t>(schedule.interval) * secondsPerDay;
+}
+
+double fsrsInitialDifficulty(ReviewRating rating)
+{
+    return std::clamp(fsrsWeights[4] - (static_cast<int>(rating) - 3) * fsrsWeights[5], 1.0, 10.0);
+}
+} // namespace
+
+
+std::string schedulerAlgorithmToStr(SchedulerAlgorithm algorithm)
+{
+    return algorithm == FSRS_SCHEDULER ? "FSRS" : "SM-2";
+}
+
+ReviewRating ratingForDifficulty(CardDifficulty difficulty)
+{
+    switch (difficulty)
+    {
+    case EASY:
+        return EASY_RATING;
+    case HARD:
+        return AGAIN_RATING;
+    default:
+        return GOOD_RATING;
+    }
+}
+
+int64_t scheduleNow()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+void reviewSm2(CardSchedule &schedule, ReviewRating rating, int64_t now)
+{
+    if (schedule.ease == 0)
+    {
+        schedule.ease = sm2StartEase;
+    }
+    if (rating == AGAIN_RATING)
+    {
+        schedule.ease = (std::max)(sm2MinEase, schedule.ease - 0.2F);
+        forgetCard(schedule, now);
+        return;
+    }
+
+    // SM-2 grades recall from 0 to 5, a remembered card is 3 (hard) to 5 (easy)
+    schedule.reps++;
+    double interval = schedule.reps == 1 ? 1.0 : schedule.reps == 2 ? 6.0 : schedule.interval * schedule.ease;
+    float grade_gap = static_cast<float>(5 - (static_cast<int>(rating) + 1));
+    schedule.ease = (std::max)(sm2MinEase, schedule.ease + 0.1F - grade_gap * (0.08F + grade_gap * 0.02F));
+    scheduleInterval(schedule, interval, now);
+}
+
+void reviewFsrs(CardSchedule &schedule, ReviewRating rating, int64_t now)
+{
+    const auto &w = fsrsWeights;
+    int grade = static_cast<int>(rating);
+    if (schedule.stability <= 0)
+    {
+        // first review
+        schedule.stability = static_cast<float>(w[grade - 1]);
+        schedule.difficulty = static_cast<float>(fsrsInitialDifficulty(rating));
+    }
+    else
+    {
+        double stability = schedule.stability;
+        double difficulty = schedule.difficulty;
+        double recall = recallProbability(schedule, now);
+        if (rating == AGAIN_RATING)
+        {
+            stability = w[11] * std::pow(difficulty, -w[12]) * (std::pow(stability + 1, w[13]) - 1) *
+                        std::exp(w[14] * (1 - recall));
+        }
+        else
+        {
+            double hard_penalty = rating == HARD_RATING ? w[15] : 1.0;
+            double easy_bonus = rating == EASY_RATING ? w[16] : 1.0;
+            stability *= 1 + std::exp(w[8]) * (11 - difficulty) * std::pow(stability, -w[9]) *
+                                 (std::exp(w[10] * (1 - recall)) - 1) * hard_penalty * easy_bonus;
+        }
+        // difficulty moves with the rating and drifts back towards that of a new card rated good
+        difficulty -= w[6] * (grade - 3);
+        difficulty = w[7] * fsrsInitialDifficulty(GOOD_RATING) + (1 - w[7]) * difficulty;
+        schedule.stability = static_cast<float>((std::max)(stability, 0.01));
+        schedule.difficulty = static_cast<float>(std::clamp(difficulty, 1.0, 10.0));
+    }
+
+    if (rating == AGAIN_RATING)
+    {
+        forgetCard(schedule, now);
+        return;
+    }
+    schedule.reps++;
+    scheduleInterval(schedule, 9 * schedule.stability * (1 / fsrsRetention - 1), now);
+}
+
+void reviewCard(FlashCard &card, ReviewRating rating, int64_t now, SchedulerAlgorithm algorithm)
+{
+    if (algorithm == FSRS_SCHEDULER)
+    {
+        reviewFsrs(card.schedule, rating, now);
+    }
+    else
+    {
+        reviewSm2(card.schedule, rating, now);
+    }
+}
+
+double recallProbability(const CardSchedule &schedule, int64_t now)
+{
+    if (schedule.due == 0 || schedule.stability <= 0)
+    {
+        return 0;
+    }
+    double elapsed_days = static_cast<double>(std::max<int64_t>(0, now - schedule.reviewed)) / secondsPerDay;
+    return 1 / (1 + elapsed_days / (9 * schedule.stability));
+}
+
+
+DueQueue::DueQueue(const std::vector<FlashCard> &cards, const std::vector<size_t> &candidates) : m_cards(cards)
+{
+    for (size_t card : candidates)
+    {
+        if (m_cards[card].schedule.due != 0)
+        {
+            m_heap.push_back(Entry{m_cards[card].schedule.due, card});
+        }
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), laterEntry);
+}
+
+void DueQueue::push(size_t card)
+{
+    if (m_cards[card].schedule.due == 0)
+    {
+        return;
+    }
+    m_heap.push_back(Entry{m_cards[card].schedule.due, card});
+    std::push_heap(m_heap.begin(), m_heap.end(), laterEntry);
+}
+
+bool DueQueue::popDue(int64_t now, size_t &card)
+{
+    dropStale();
+    if (m_heap.empty() || m_heap.front().due > now)
+    {
+        return false;
+    }
+    card = m_heap.front().card;
+    std::pop_heap(m_heap.begin(), m_heap.end(), laterEntry);
+    m_heap.pop_back();
+    return true;
+}
+
+int64_t DueQueue::nextDueTime()
+{
+    dropStale();
+    return m_heap.empty() ? 0 : m_heap.front().due;
+}
+
+bool DueQueue::laterEntry(const Entry &a, const Entry &b)
+{
+    return a.due != b.due ? a.due > b.due : a.card > b.card;
+}
+
+size_t DueQueue::size() const
+{
+    return m_heap.size();
+}
+
+void DueQueue::dropStale()
+{
+    while (!m_heap.empty() && m_heap.front().due != m_cards[m_heap.front().card].schedule.due)
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), laterEntry);
+        m_heap.pop_back();
+    }
+}
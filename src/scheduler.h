@@ -0,0 +1,201 @@
+/**
+ * @file scheduler.h
+ * @author Green Alligators
+ * @brief Spaced repetition scheduling of flashcards
+ * @details After each review a card is given the time it is next due, worked out by one of two algorithms:
+ *
+ * - SM-2, the SuperMemo 2 algorithm: each card has an ease factor that grows when it is easy and shrinks when it
+ *   is hard, and the interval is multiplied by the ease after each successful review.
+ * - FSRS, the Free Spaced Repetition Scheduler: each card has a memory stability (the days until the chance of
+ *   recalling it falls to 90%) and a difficulty, updated from how likely the card was to be recalled when it was
+ *   reviewed. The default FSRS v4 weights are used.
+ *
+ * A card that is forgotten is due again after relearnDelaySeconds. The schedule is kept in FlashCard::schedule and
+ * saved with the deck.
+ *
+ * The cards due for review are kept in a DueQueue, a binary min-heap on the due time, so the next due card is found
+ * in O(log n) however many cards there are.
+ *
+ * @version 1.0.0
+ * @date 2024-10-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "deck.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** Seconds before a forgotten card is shown again */
+constexpr int64_t relearnDelaySeconds{10 * 60};
+
+/** Seconds in a day, intervals are in days */
+constexpr int64_t secondsPerDay{24 * 60 * 60};
+
+/**
+ * @brief How well a card was recalled when it was reviewed
+ * \showenumvalues
+ *
+ */
+enum ReviewRating
+{
+    AGAIN_RATING = 1,
+    HARD_RATING = 2,
+    GOOD_RATING = 3,
+    EASY_RATING = 4
+};
+
+/**
+ * @brief The algorithms that can schedule cards
+ *
+ */
+enum SchedulerAlgorithm
+{
+    SM2_SCHEDULER,
+    FSRS_SCHEDULER
+};
+
+/**
+ * @brief Convert a scheduler algorithm to a name for display
+ *
+ * @param algorithm The algorithm
+ * @return std::string
+ */
+std::string schedulerAlgorithmToStr(SchedulerAlgorithm algorithm);
+
+/**
+ * @brief The rating given by choosing a difficulty after studying a card
+ * @details The study menu offers Easy, Medium and Hard. Hard is the lowest choice and counts as forgetting the card.
+ *
+ * @param difficulty The difficulty chosen
+ * @return ReviewRating
+ */
+ReviewRating ratingForDifficulty(CardDifficulty difficulty);
+
+/**
+ * @brief Seconds since the epoch, the time used by card schedules
+ *
+ * @return int64_t
+ */
+int64_t scheduleNow();
+
+/**
+ * @brief Update a schedule after a review with the SM-2 algorithm
+ *
+ * @param schedule The card's schedule
+ * @param rating How well the card was recalled
+ * @param now When the card was reviewed
+ */
+void reviewSm2(CardSchedule &schedule, ReviewRating rating, int64_t now);
+
+/**
+ * @brief Update a schedule after a review with the FSRS algorithm
+ *
+ * @param schedule The card's schedule
+ * @param rating How well the card was recalled
+ * @param now When the card was reviewed
+ */
+void reviewFsrs(CardSchedule &schedule, ReviewRating rating, int64_t now);
+
+/**
+ * @brief Update a card's schedule after a review
+ *
+ * @param card The card
+ * @param rating How well the card was recalled
+ * @param now When the card was reviewed
+ * @param algorithm The algorithm to schedule it with
+ */
+void reviewCard(FlashCard &card, ReviewRating rating, int64_t now, SchedulerAlgorithm algorithm);
+
+/**
+ * @brief The chance a card is recalled at a time, as estimated by FSRS
+ *
+ * @param schedule The card's schedule
+ * @param now The time
+ * @return double From 0 to 1, 0 for a new card
+ */
+double recallProbability(const CardSchedule &schedule, int64_t now);
+
+/**
+ * @brief The scheduled cards of a deck ordered by when they are due
+ * @details The heap holds card indices and the due time each was pushed with. A card rescheduled after being
+ * pushed is pushed again, the entry with its old due time no longer matches the card and is skipped when it
+ * reaches the top. New cards are never in the queue.
+ *
+ */
+class DueQueue
+{
+public:
+    /**
+     * @brief Queue the scheduled cards among some of a deck's cards
+     * @details The heap is built in O(n).
+     *
+     * @param cards The deck's cards, which must outlive the queue
+     * @param candidates Indices of the cards to queue, new cards are left out
+     */
+    DueQueue(const std::vector<FlashCard> &cards, const std::vector<size_t> &candidates);
+
+    /**
+     * @brief Queue a card again after its schedule has changed
+     *
+     * @param card The card's index
+     */
+    void push(size_t card);
+
+    /**
+     * @brief Take the card that has been due the longest, if any card is due
+     *
+     * @param now The current time
+     * @param card Set to the card's index
+     * @return true if a card was due
+     */
+    bool popDue(int64_t now, size_t &card);
+
+    /**
+     * @brief When the next card is due
+     *
+     * @return int64_t The due time, or 0 if the queue is empty
+     */
+    int64_t nextDueTime();
+
+    /**
+     * @brief The number of entries in the queue, including any left behind by rescheduled cards
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+private:
+    /**
+     * @brief A card and the due time it was queued with
+     *
+     */
+    struct Entry
+    {
+        int64_t due;
+        size_t card;
+    };
+
+    /**
+     * @brief The heap order: earliest due first, then by card so the order does not depend on the heap's layout
+     *
+     * @return true if a leaves the heap after b
+     */
+    static bool laterEntry(const Entry &a, const Entry &b);
+
+    /**
+     * @brief Drop entries from the top of the heap that no longer match their card
+     *
+     */
+    void dropStale();
+
+    const std::vector<FlashCard> &m_cards; ///< The deck's cards
+    std::vector<Entry> m_heap;             ///< Min-heap on due time
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,225 @@
+/**
+ * @file scheduler_sim.cpp
+ * @author Green Alligators
+ * @brief Simulates years of study by synthetic learners to compare schedulers without waiting for real reviews
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "scheduler_sim.h"
+#include "session_planner.h"
+#include "study_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+
+/** The simulation starts at a fixed time so a seed always gives the same schedules */
+constexpr int64_t simulationStart{1'700'000'000};
+
+/** The outcome for one learner, added up in learner order */
+struct LearnerResult
+{
+    uint64_t reviews{0};
+    uint64_t recalled{0};
+    uint64_t due_reviews{0};
+    uint64_t new_reviews{0};
+    uint64_t backlog{0};
+    uint64_t cards_seen{0};
+    double final_recall_sum{0};
+};
+
+double normal(Rng &rng)
+{
+    // Box-Muller, 1 - u keeps the logarithm finite
+    double u = 1.0 - rng.uniform();
+    double v = rng.uniform();
+    return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * 3.14159265358979323846 * v);
+}
+
+void simulateLearner(const SimulationConfig &config, const CardSelectionPolicy &select, Rng &rng, LearnerResult &out)
+{
+    const SimLearner &learner = config.learner;
+    FlashCardDeck deck{};
+    deck.cards.assign(config.cards, FlashCard{"", "", UNKNOWN, 0});
+    // the learner's hidden memory of each card, which the scheduler never sees
+    std::vector<double> stability(config.cards, 0.0);
+    std::vector<int64_t> studied(config.cards, 0);
+    std::vector<size_t> order{};
+
+    for (size_t day = 0; day < config.days; ++day)
+    {
+        const int64_t now = simulationStart + static_cast<int64_t>(day) * secondsPerDay;
+        select(deck, config.cards_per_day, now, rng, order);
+        for (size_t i : order)
+        {
+            FlashCard &card = deck.cards[i];
+            CardDifficulty difficulty = MEDIUM;
+            if (card.n_times_answered == 0 && card.schedule.due == 0)
+            {
+                // a card seen for the first time is learnt, not recalled
+                stability[i] = learner.initial_stability * std::exp(learner.stability_spread * normal(rng));
+                out.new_reviews++;
+            }
+            else
+            {
+                double elapsed_days = static_cast<double>(now - studied[i]) / secondsPerDay;
+                double recall = forgettingCurveRecall(learner.curve, elapsed_days, stability[i]);
+                if (rng.uniform() < recall)
+                {
+                    stability[i] *= 1 + learner.growth * std::sqrt(1 - recall);
+                    difficulty = recall >= learner.easy_recall ? EASY : MEDIUM;
+                    out.recalled++;
+                }
+                else
+                {
+                    stability[i] = (std::max)(stability[i] * learner.lapse, 0.01);
+                    difficulty = HARD;
+                }
+                out.due_reviews += card.schedule.due != 0 && card.schedule.due <= now ? 1 : 0;
+            }
+            out.reviews++;
+            // graded just as a study session grades a card
+            card.difficulty = difficulty;
+            card.n_times_answered++;
+            reviewCard(card, ratingForDifficulty(difficulty), now, config.algorithm);
+            studied[i] = now;
+        }
+        for (const FlashCard &card : deck.cards)
+        {
+            out.backlog += card.schedule.due != 0 && card.schedule.due <= now ? 1 : 0;
+        }
+    }
+
+    const int64_t end = simulationStart + static_cast<int64_t>(config.days) * secondsPerDay;
+    for (size_t i = 0; i < deck.cards.size(); ++i)
+    {
+        if (deck.cards[i].n_times_answered > 0)
+        {
+            out.cards_seen++;
+            double elapsed_days = static_cast<double>(end - studied[i]) / secondsPerDay;
+            out.final_recall_sum += forgettingCurveRecall(learner.curve, elapsed_days, stability[i]);
+        }
+    }
+}
+
+} // namespace
+
+double forgettingCurveRecall(ForgettingCurve curve, double elapsed_days, double stability)
+{
+    double t = (std::max)(elapsed_days, 0.0) / (std::max)(stability, 1e-9);
+    return curve == EXPONENTIAL_CURVE ? std::pow(0.9, t) : 1 / (1 + t / 9);
+}
+
+CardSelectionPolicy sessionPlanPolicy(double budget_seconds)
+{
+    return [budget_seconds](
+               const FlashCardDeck &deck, size_t n_cards, int64_t now, Rng &rng, std::vector<size_t> &order) {
+        n_cards = (std::min)(n_cards, deck.cards.size());
+        size_t n_ranked = (std::min)(deck.cards.size(), n_cards * planCandidatesPerCard);
+
+        // the front of the queue serves the session if it has enough due and new cards, otherwise the deck is ranked
+        StudyQueue queue{};
+        queue.build(deck, rng);
+        std::vector<size_t> ranked{};
+        queue.planSession(deck, n_ranked, now, FORWARD_VIEW, ranked);
+        if (ranked.size() < n_cards)
+        {
+            selectStudyCards(deck, {}, n_ranked, now, FORWARD_VIEW, rng, ranked);
+        }
+
+        std::vector<PlanCandidate> candidates{};
+        candidates.reserve(ranked.size());
+        for (size_t card : ranked)
+        {
+            candidates.push_back(planCandidate(card, deck.cards[card], now, defaultCardSeconds));
+        }
+        double budget = budget_seconds > 0 ? budget_seconds : defaultCardSeconds * static_cast<double>(n_cards);
+        std::vector<size_t> chosen{};
+        planTimedSession(candidates, budget, n_cards, chosen);
+        if (chosen.empty() && !candidates.empty() && n_cards > 0)
+        {
+            // however short the time, a session has a card
+            chosen.push_back(0);
+        }
+        order.clear();
+        for (size_t c : chosen)
+        {
+            order.push_back(candidates[c].card);
+        }
+    };
+}
+
+SimulationReport simulateScheduler(const SimulationConfig &config)
+{
+    SimulationReport report{};
+    if (config.learners == 0)
+    {
+        return report;
+    }
+    CardSelectionPolicy select = config.select ? config.select : sessionPlanPolicy(config.minutes_per_day * 60);
+
+    // each learner's generator is split off in learner order, before any thread starts
+    std::vector<Rng> rngs{};
+    rngs.reserve(config.learners);
+    Rng root{config.seed};
+    for (size_t l = 0; l < config.learners; ++l)
+    {
+        rngs.push_back(root.split());
+    }
+    std::vector<LearnerResult> results(config.learners);
+
+    size_t n_workers = config.threads != 0 ? config.threads : (std::max)(std::thread::hardware_concurrency(), 1u);
+    n_workers = (std::min)(n_workers, config.learners);
+    auto rangeStart = [&config, n_workers](size_t worker) { return config.learners * worker / n_workers; };
+    auto work = [&](size_t worker) {
+        for (size_t l = rangeStart(worker); l < rangeStart(worker + 1); ++l)
+        {
+            simulateLearner(config, select, rngs[l], results[l]);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    workers.reserve(n_workers - 1);
+    for (size_t w = 1; w < n_workers; ++w)
+    {
+        workers.emplace_back(work, w);
+    }
+    // the calling thread does its share too
+    work(0);
+    for (std::thread &t : workers)
+    {
+        t.join();
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double final_recall_sum = 0;
+    for (const LearnerResult &result : results)
+    {
+        report.reviews += result.reviews;
+        report.recalled += result.recalled;
+        report.due_reviews += result.due_reviews;
+        report.new_reviews += result.new_reviews;
+        report.backlog += result.backlog;
+        report.cards_seen += result.cards_seen;
+        final_recall_sum += result.final_recall_sum;
+    }
+    report.learner_days = static_cast<uint64_t>(config.learners) * config.days;
+    uint64_t repeats = report.reviews - report.new_reviews;
+    report.retention = repeats == 0 ? 0 : static_cast<double>(report.recalled) / static_cast<double>(repeats);
+    report.final_recall = report.cards_seen == 0 ? 0 : final_recall_sum / static_cast<double>(report.cards_seen);
+    report.reviews_per_day =
+        report.learner_days == 0 ? 0 : static_cast<double>(report.reviews) / static_cast<double>(report.learner_days);
+    if (report.seconds > 0)
+    {
+        report.selections_per_second = static_cast<double>(report.learner_days) / report.seconds;
+        report.reviews_per_second = static_cast<double>(report.reviews) / report.seconds;
+    }
+    return report;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file scheduler_sim.h
+ * @author Green Alligators
+ * @brief Simulates years of study by synthetic learners to compare schedulers without waiting for real reviews
+ * @details Each simulated learner studies a deck once a day for a number of days. Every day the cards are chosen by
+ * a card selection policy, by default sessionPlanPolicy, the same plan a study session makes, and each card is
+ * graded and rescheduled with reviewCard just as in a session.
+ *
+ * Whether the learner recalls a card comes from a hidden memory model, not from the card's schedule. Each card has a
+ * true stability in days, drawn for each card around the learner's initial stability. The chance of recall after t
+ * days follows the learner's forgetting curve and is 90% when t equals the stability. A recall multiplies the
+ * stability by more the less likely it was, and a lapse cuts it back. A recalled card is graded Easy when it was
+ * recalled with at least the learner's easy recall chance and Medium otherwise, and a lapse is graded Hard.
+ *
+ * Learners are split between threads. Each learner draws from its own generator, split from the seed in learner
+ * order, and results are added up in learner order, so a seed gives the same report on any number of threads.
+ *
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef SCHEDULER_SIM_H
+#define SCHEDULER_SIM_H
+
+#include "deck.h"
+#include "rng.h"
+#include "scheduler.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief The shape of a simulated learner's forgetting curve
+ * \showenumvalues
+ *
+ */
+enum ForgettingCurve
+{
+    EXPONENTIAL_CURVE, ///< recall = 0.9^(t / stability)
+    POWER_CURVE        ///< recall = (1 + t / (9 stability))^-1, the curve FSRS assumes
+};
+
+/**
+ * @brief How a simulated learner remembers and forgets
+ *
+ */
+struct SimLearner
+{
+    ForgettingCurve curve{POWER_CURVE}; ///< The forgetting curve
+    double initial_stability{2.0};      ///< Days until recall falls to 90% after first seeing a card
+    double stability_spread{0.5};       ///< How much cards differ, the spread of log initial stability
+    double growth{3.0};                 ///< Stability gain of a recall that was sure to fail, none if sure to succeed
+    double lapse{0.5};                  ///< Stability kept after a lapse
+    double easy_recall{0.9};            ///< Recall chance from which a recalled card is graded Easy
+};
+
+/**
+ * @brief Chooses the cards to study: deck, number of cards, the time, a generator, then the cards to study
+ *
+ */
+using CardSelectionPolicy = std::function<void(const FlashCardDeck &, size_t, int64_t, Rng &, std::vector<size_t> &)>;
+
+/**
+ * @brief The cards a study session would plan: the front of the study queue, or the ranked deck when that is short,
+ * then the ones that fit in the day's study time
+ * @details Goes through StudyQueue::planSession, selectStudyCards and planTimedSession as a session without a study
+ * query does. The queue is built from the deck each day, and every card is expected to take defaultCardSeconds.
+ *
+ * @param budget_seconds The study time of each day, 0 for no limit
+ * @return CardSelectionPolicy
+ */
+CardSelectionPolicy sessionPlanPolicy(double budget_seconds);
+
+/**
+ * @brief What to simulate
+ *
+ */
+struct SimulationConfig
+{
+    SimLearner learner{};                        ///< How every learner remembers
+    SchedulerAlgorithm algorithm{SM2_SCHEDULER}; ///< The scheduler of reviewed cards
+    CardSelectionPolicy select{};                ///< Chooses the cards of each day, sessionPlanPolicy if empty
+    size_t learners{100};                        ///< The number of learners
+    size_t days{365};                            ///< Days each learner studies
+    size_t cards{500};                           ///< Cards in each learner's deck
+    size_t cards_per_day{15};                    ///< Cards studied each day at most
+    double minutes_per_day{0};                   ///< Study time of each day for the default policy, 0 for no limit
+    uint64_t seed{1};                            ///< Seed of every learner's generator
+    unsigned int threads{0};                     ///< Number of threads to use, 0 picks one per hardware thread
+};
+
+/**
+ * @brief The outcome of a simulation, over every learner
+ *
+ */
+struct SimulationReport
+{
+    uint64_t learner_days{0};        ///< Days simulated, over every learner
+    uint64_t reviews{0};             ///< Cards studied
+    uint64_t recalled{0};            ///< Cards recalled when studied
+    uint64_t due_reviews{0};         ///< Cards studied when they were due
+    uint64_t new_reviews{0};         ///< Cards studied for the first time
+    uint64_t backlog{0};             ///< Due cards left unstudied at the end of each day, summed over days
+    uint64_t cards_seen{0};          ///< Cards studied at least once by the end
+    double retention{0};             ///< Share of reviews recalled
+    double final_recall{0};          ///< Mean chance of recalling a card seen, at the end
+    double reviews_per_day{0};       ///< Mean cards studied a day
+    double seconds{0};               ///< Wall time of the simulation
+    double selections_per_second{0}; ///< Days of cards chosen a second, over every thread
+    double reviews_per_second{0};    ///< Cards simulated a second, over every thread
+};
+
+/**
+ * @brief The chance of recall on a forgetting curve
+ *
+ * @param curve The forgetting curve
+ * @param elapsed_days Days since the card was last studied
+ * @param stability Days until recall falls to 90%
+ * @return double
+ */
+double forgettingCurveRecall(ForgettingCurve curve, double elapsed_days, double stability);
+
+/**
+ * @brief Run a simulation
+ *
+ * @param config What to simulate
+ * @return SimulationReport
+ */
+SimulationReport simulateScheduler(const SimulationConfig &config);
+
+#endif // SCHEDULER_SIM_H
@@ -0,0 +1,346 @@
+/**
+ * @file session_planner.cpp
+ * @author Green Alligators
+ * @brief Chooses the cards of a study session to fit its time as well as its number of cards
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "session_planner.h"
+#include "review_log.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <fstream>
+#include <numeric>
+#include <optional>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr std::array<char, 8> latencyMagic{'S', 'D', 'L', 'A', 'T', 'E', 'N', 'C'};
+constexpr uint64_t latencyFormat{1};
+constexpr uint64_t latencyHeaderBytes{8 + 5 * 8};
+constexpr uint64_t latencyEntryBytes{2 * 8};
+
+/**
+ * @brief The header of a latency file
+ *
+ */
+struct LatencySummary
+{
+    uint64_t covered{0};     ///< Records of the log folded in
+    uint64_t reviews{0};     ///< Timed reviews
+    double total_seconds{0}; ///< Seconds of every timed review
+    uint64_t cards{0};       ///< Entries, one per timed card
+};
+
+void putFixed(std::string &out, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+uint64_t getFixed(const char *in)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        value |= uint64_t{static_cast<unsigned char>(in[i])} << (8 * i);
+    }
+    return value;
+}
+
+bool readSummary(std::istream &in, LatencySummary &summary)
+{
+    std::array<char, latencyHeaderBytes> header{};
+    in.read(header.data(), header.size());
+    if (!in || !std::equal(latencyMagic.begin(), latencyMagic.end(), header.begin()) ||
+        getFixed(&header[8]) != latencyFormat)
+    {
+        return false;
+    }
+    summary.covered = getFixed(&header[16]);
+    summary.reviews = getFixed(&header[24]);
+    summary.total_seconds = std::bit_cast<double>(getFixed(&header[32]));
+    summary.cards = getFixed(&header[40]);
+    return true;
+}
+
+bool readEntry(std::istream &in, uint64_t index, uint64_t &card_id, double &seconds)
+{
+    std::array<char, latencyEntryBytes> entry{};
+    in.seekg(static_cast<std::streamoff>(latencyHeaderBytes + index * latencyEntryBytes));
+    in.read(entry.data(), entry.size());
+    card_id = getFixed(&entry[0]);
+    seconds = std::bit_cast<double>(getFixed(&entry[8]));
+    return static_cast<bool>(in);
+}
+
+/** a binary search over the sorted entries, reading only the ones it compares */
+bool findEntry(std::istream &in, uint64_t cards, uint64_t card_id, double &seconds)
+{
+    uint64_t low = 0;
+    uint64_t high = cards;
+    while (low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        uint64_t id = 0;
+        if (!readEntry(in, mid, id, seconds))
+        {
+            return false;
+        }
+        if (id == card_id)
+        {
+            return true;
+        }
+        if (id < card_id)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return false;
+}
+
+/** the end of the run of reviews of the same card that starts at from */
+size_t cardReviewsEnd(const std::vector<std::pair<uint64_t, double>> &reviews, size_t from)
+{
+    size_t end = from;
+    while (end < reviews.size() && reviews[end].first == reviews[from].first)
+    {
+        end++;
+    }
+    return end;
+}
+
+/** a card's estimate after its newer reviews, taken in the order they were logged, as LatencyModel::observe */
+double foldEstimate(std::optional<double> estimate,
+                    const std::vector<std::pair<uint64_t, double>> &reviews,
+                    size_t from,
+                    size_t end)
+{
+    for (size_t i = from; i < end; ++i)
+    {
+        double seconds = reviews[i].second;
+        estimate = estimate ? *estimate + LatencyModel::recentWeight * (seconds - *estimate) : seconds;
+    }
+    return estimate.value_or(0);
+}
+
+} // namespace
+
+std::filesystem::path latencyFileFor(const std::filesystem::path &log_file)
+{
+    return log_file.parent_path() / "latency";
+}
+
+bool updateLatencyFile(const std::filesystem::path &log_file)
+{
+    fs::path dest = latencyFileFor(log_file);
+    std::ifstream old{dest, std::ios::binary};
+    LatencySummary summary{};
+    ReviewLogReader reader{log_file};
+    uint64_t logged = reader.ok() ? reader.size() : 0;
+    if (!readSummary(old, summary) || summary.covered > logged)
+    {
+        // rebuilt from the whole log
+        summary = LatencySummary{};
+    }
+    if (summary.covered == logged)
+    {
+        return true;
+    }
+
+    // the timed reviews logged since, each card's kept in the order they were logged
+    std::vector<std::pair<uint64_t, double>> newer{};
+    ReviewColumns columns{};
+    uint64_t block_records = reader.blockRecords();
+    for (size_t block = static_cast<size_t>(summary.covered / block_records); block < reader.blockCount(); ++block)
+    {
+        if (!reader.readBlock(block, columns, CARD_ID_COLUMN | RESPONSE_COLUMN | GRADE_TIME_COLUMN))
+        {
+            return false;
+        }
+        uint64_t first = block * block_records;
+        for (size_t i = static_cast<size_t>((std::max)(summary.covered, first) - first); i < columns.size(); ++i)
+        {
+            uint64_t ms = uint64_t{columns.response_ms[i]} + columns.grade_ms[i];
+            // reviews logged before they were timed have no time
+            if (ms == 0)
+            {
+                continue;
+            }
+            double seconds = (std::min)(static_cast<double>(ms) / 1000, maxCardSeconds);
+            newer.emplace_back(columns.card_ids[i], seconds);
+            summary.total_seconds += seconds;
+            summary.reviews++;
+        }
+    }
+    std::stable_sort(newer.begin(), newer.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    // merged with the old entries in card order, read through once
+    std::string entries{};
+    uint64_t cards = 0;
+    auto put = [&entries, &cards](uint64_t card_id, double seconds) {
+        putFixed(entries, card_id);
+        putFixed(entries, std::bit_cast<uint64_t>(seconds));
+        cards++;
+    };
+    size_t next = 0;
+    for (uint64_t e = 0; e <= summary.cards; ++e)
+    {
+        bool has_old = e < summary.cards;
+        uint64_t card_id = 0;
+        double seconds = 0;
+        if (has_old && !readEntry(old, e, card_id, seconds))
+        {
+            return false;
+        }
+        // cards that sort before this entry, or come after the last one, are new to the file
+        while (next < newer.size() && (!has_old || newer[next].first < card_id))
+        {
+            size_t end = cardReviewsEnd(newer, next);
+            put(newer[next].first, foldEstimate(std::nullopt, newer, next, end));
+            next = end;
+        }
+        if (has_old)
+        {
+            size_t end = next < newer.size() && newer[next].first == card_id ? cardReviewsEnd(newer, next) : next;
+            put(card_id, foldEstimate(seconds, newer, next, end));
+            next = end;
+        }
+    }
+    old.close();
+
+    std::string out(latencyMagic.begin(), latencyMagic.end());
+    putFixed(out, latencyFormat);
+    putFixed(out, logged);
+    putFixed(out, summary.reviews);
+    putFixed(out, std::bit_cast<uint64_t>(summary.total_seconds));
+    putFixed(out, cards);
+    out += entries;
+
+    fs::path tmp = dest;
+    tmp += ".tmp";
+    std::error_code ec;
+    fs::create_directories(dest.parent_path(), ec);
+    {
+        std::ofstream file{tmp, std::ios::binary | std::ios::trunc};
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!file)
+        {
+            return false;
+        }
+    }
+    fs::rename(tmp, dest, ec);
+    return !ec;
+}
+
+void LatencyModel::load(const std::filesystem::path &log_file, const std::vector<uint64_t> &card_ids)
+{
+    m_cards.clear();
+    m_totalSeconds = 0;
+    m_reviews = 0;
+    updateLatencyFile(log_file);
+    std::ifstream in{latencyFileFor(log_file), std::ios::binary};
+    LatencySummary summary{};
+    if (!readSummary(in, summary))
+    {
+        return;
+    }
+    m_totalSeconds = summary.total_seconds;
+    m_reviews = summary.reviews;
+    for (uint64_t card_id : card_ids)
+    {
+        double seconds = 0;
+        if (findEntry(in, summary.cards, card_id, seconds))
+        {
+            m_cards[card_id] = seconds;
+        }
+        in.clear();
+    }
+}
+
+void LatencyModel::observe(uint64_t card_id, double seconds)
+{
+    seconds = (std::min)(seconds, maxCardSeconds);
+    auto [estimate, first] = m_cards.try_emplace(card_id, seconds);
+    if (!first)
+    {
+        estimate->second += recentWeight * (seconds - estimate->second);
+    }
+    m_totalSeconds += seconds;
+    m_reviews++;
+}
+
+double LatencyModel::estimate(uint64_t card_id) const
+{
+    auto found = m_cards.find(card_id);
+    return found != m_cards.end() ? found->second : averageSeconds();
+}
+
+double LatencyModel::averageSeconds() const
+{
+    return m_reviews == 0 ? defaultCardSeconds : m_totalSeconds / static_cast<double>(m_reviews);
+}
+
+PlanCandidate planCandidate(size_t card, const FlashCard &flashcard, int64_t now, double seconds)
+{
+    PlanCandidate candidate{card, 2, 1.0, seconds};
+    const CardSchedule &schedule = flashcard.schedule;
+    if (schedule.due != 0 && schedule.due <= now)
+    {
+        // up to twice as much for a card a month overdue
+        double overdue_days = static_cast<double>(now - schedule.due) / secondsPerDay;
+        candidate.priority = 0;
+        candidate.value = 1.0 + (std::min)(overdue_days, 30.0) / 30.0;
+    }
+    else if (flashcard.n_times_answered == 0 && schedule.due == 0)
+    {
+        candidate.priority = 1;
+    }
+    return candidate;
+}
+
+void planTimedSession(const std::vector<PlanCandidate> &candidates,
+                      double budget_seconds,
+                      size_t max_cards,
+                      std::vector<size_t> &chosen)
+{
+    chosen.clear();
+    std::vector<size_t> by_density(candidates.size());
+    std::iota(by_density.begin(), by_density.end(), size_t{0});
+    // ties keep the ranked order
+    std::stable_sort(by_density.begin(), by_density.end(), [&candidates](size_t a, size_t b) {
+        const PlanCandidate &x = candidates[a];
+        const PlanCandidate &y = candidates[b];
+        return x.priority != y.priority ? x.priority < y.priority : x.value * y.seconds > y.value * x.seconds;
+    });
+
+    double used = 0;
+    for (size_t c : by_density)
+    {
+        if (chosen.size() == max_cards)
+        {
+            break;
+        }
+        if (used + candidates[c].seconds <= budget_seconds)
+        {
+            used += candidates[c].seconds;
+            chosen.push_back(c);
+        }
+    }
+    std::sort(chosen.begin(), chosen.end());
+}
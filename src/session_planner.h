@@ -0,0 +1,156 @@
+/**
+ * @file session_planner.h
+ * @author Green Alligators
+ * @brief Chooses the cards of a study session to fit its time as well as its number of cards
+ * @details How long each card takes is estimated from the review log: the time from the question being shown to the
+ * answer being revealed plus the time to grade it, averaged with more weight on recent reviews. A card that was
+ * never timed is expected to take as long as the average review.
+ *
+ * The estimates are kept next to the review log in a latency file, "Decks/.history/latency" for the log
+ * "Decks/.history/reviews.log", so a session never reads the whole log. After a header (the magic string
+ * "SDLATENC", a format version, the number of log records it covers, the number of timed reviews, their total
+ * seconds and the number of cards) it holds a fixed size entry per timed card, its review id and estimated seconds,
+ * sorted by id. Every value is 8 bytes little-endian, the seconds as the bits of a double. Loading a session first
+ * folds the reviews logged since the file was written into it, reading only the end of the log, then looks up each
+ * ranked card with a binary search, so only those cards' entries are read.
+ *
+ * The plan is a knapsack: each candidate card has a priority, due cards first, then new cards, then other seen cards,
+ * a value within its priority and an expected time, and the planner packs the most value into the time left and the
+ * cards left. It takes the cards of each priority in turn, those with the most value per second first, skipping any
+ * that no longer fit, which takes O(n log n) in the candidates. The chosen cards keep the order they were ranked in.
+ *
+ * As each card is graded its actual time updates its estimate and the pace of the session, how much slower or faster
+ * than expected the user is, and the rest of the session is planned again from the time left.
+ *
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef SESSION_PLANNER_H
+#define SESSION_PLANNER_H
+
+#include "deck.h"
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+/** Seconds a card is expected to take when there are no timed reviews at all */
+constexpr double defaultCardSeconds{10.0};
+
+/** Seconds a single review counts as at most, longer ones are taken to be breaks */
+constexpr double maxCardSeconds{120.0};
+
+/** Cards ranked for each card a session can take, so the plan can swap slow cards for quicker ones */
+constexpr size_t planCandidatesPerCard{2};
+
+/**
+ * @brief Estimates how long each card takes to study
+ *
+ */
+class LatencyModel
+{
+public:
+    /** The weight of the latest review in a card's estimate */
+    static constexpr double recentWeight{0.3};
+
+    /**
+     * @brief Learn the estimates of some cards from the latency file of a review log
+     * @details The latency file is brought up to date first, see updateLatencyFile. Every timed review counts
+     * towards the average. Replaces anything learnt before.
+     *
+     * @param log_file The review log
+     * @param card_ids The cards to estimate, see reviewCardId
+     */
+    void load(const std::filesystem::path &log_file, const std::vector<uint64_t> &card_ids);
+
+    /**
+     * @brief Add a timed review
+     *
+     * @param card_id The card reviewed
+     * @param seconds The time it took
+     */
+    void observe(uint64_t card_id, double seconds);
+
+    /**
+     * @brief The time a card is expected to take
+     *
+     * @param card_id The card
+     * @return double Seconds
+     */
+    double estimate(uint64_t card_id) const;
+
+    /**
+     * @brief The time the average review took
+     *
+     * @return double Seconds, defaultCardSeconds if no review was timed
+     */
+    double averageSeconds() const;
+
+private:
+    std::unordered_map<uint64_t, double> m_cards{}; ///< Estimated seconds of each timed card
+    double m_totalSeconds{0};                       ///< Seconds of every timed review
+    uint64_t m_reviews{0};                          ///< Timed reviews
+};
+
+/**
+ * @brief The latency file kept with a review log
+ *
+ * @param log_file The review log
+ * @return std::filesystem::path
+ */
+std::filesystem::path latencyFileFor(const std::filesystem::path &log_file);
+
+/**
+ * @brief Fold the reviews logged since a log's latency file was written into it
+ * @details Only the card, response and grading columns of the new records are read, and the file is rewritten
+ * only if there are any. A file that is missing, unreadable or covers more records than the log has is built again
+ * from the whole log.
+ *
+ * @param log_file The review log
+ * @return true if the latency file covers every record of the log
+ */
+bool updateLatencyFile(const std::filesystem::path &log_file);
+
+/**
+ * @brief A card that could be studied in a session
+ *
+ */
+struct PlanCandidate
+{
+    size_t card{0};    ///< The card's index
+    int priority{0};   ///< Cards of a lower priority are planned first
+    double value{0};   ///< How much studying it is worth among cards of its priority
+    double seconds{0}; ///< How long it is expected to take
+};
+
+/**
+ * @brief Make a card a candidate for a plan
+ * @details Due cards come first and are worth more the longer they are overdue, then new cards, then other seen
+ * cards.
+ *
+ * @param card The card's index
+ * @param flashcard The card
+ * @param now The current time
+ * @param seconds How long it is expected to take
+ * @return PlanCandidate
+ */
+PlanCandidate planCandidate(size_t card, const FlashCard &flashcard, int64_t now, double seconds);
+
+/**
+ * @brief Choose the candidates that fit in a session
+ *
+ * @param candidates The candidates, in the order they were ranked
+ * @param budget_seconds The time the session has left
+ * @param max_cards The number of cards the session can still take
+ * @param chosen Set to the positions in candidates of the chosen cards, in increasing order
+ */
+void planTimedSession(const std::vector<PlanCandidate> &candidates,
+                      double budget_seconds,
+                      size_t max_cards,
+                      std::vector<size_t> &chosen);
+
+#endif // SESSION_PLANNER_H
@@ -9,6 +9,8 @@
  *
  */
 #include "settings_scene.h"
+#include "card_query.h"
+#include <algorithm>
 #include <string>
 
 
@@ -21,11 +23,22 @@ std::filesystem::path StudySettings::getDeckDir()
     return m_deck_dir;
 }
 
+void StudySettings::setDeckDir(const std::filesystem::path &deck_dir)
+{
+    m_deck_dir = deck_dir;
+}
+
 void StudySettings::reset()
 {
     m_flashcard_limit = 15;
     m_study_duration_mins = 25;
     m_deck_dir = getAppPath().append("Decks/");
+    m_study_query.clear();
+    m_deck_memory_mib = 256;
+    m_study_mode = FORWARD_VIEW;
+    m_scheduler = SM2_SCHEDULER;
+    m_leech_threshold = static_cast<int>(defaultLeechThreshold);
+    m_leech_action = SUSPEND_LEECH;
 }
 
 
@@ -114,6 +127,76 @@ std::chrono::steady_clock::time_point StudySettings::getSessionStart()
     return m_session_start;
 }
 
+std::string StudySettings::getStudyQuery()
+{
+    return m_study_query;
+}
+
+void StudySettings::setStudyQuery(const std::string &query)
+{
+    m_study_query = query;
+}
+
+size_t StudySettings::getDeckMemoryBudget()
+{
+    return static_cast<size_t>(m_deck_memory_mib) * 1024 * 1024;
+}
+
+int StudySettings::getDeckMemoryMiB()
+{
+    return m_deck_memory_mib;
+}
+
+void StudySettings::setDeckMemoryMiB(int mib)
+{
+    m_deck_memory_mib = std::clamp(mib, 1, 1024 * 1024);
+}
+
+CardViewMode StudySettings::getStudyMode()
+{
+    return m_study_mode;
+}
+
+void StudySettings::setStudyMode(CardViewMode mode)
+{
+    m_study_mode = mode;
+}
+
+void StudySettings::nextStudyMode()
+{
+    m_study_mode = m_study_mode == CLOZE_VIEW ? FORWARD_VIEW : static_cast<CardViewMode>(m_study_mode + 1);
+}
+
+SchedulerAlgorithm StudySettings::getScheduler()
+{
+    return m_scheduler;
+}
+
+void StudySettings::setScheduler(SchedulerAlgorithm algorithm)
+{
+    m_scheduler = algorithm;
+}
+
+int StudySettings::getLeechThreshold()
+{
+    return m_leech_threshold;
+}
+
+void StudySettings::setLeechThreshold(int failures)
+{
+    m_leech_threshold = std::clamp(failures, 0, 99);
+}
+
+LeechAction StudySettings::getLeechAction()
+{
+    return m_leech_action;
+}
+
+void StudySettings::setLeechAction(LeechAction action)
+{
+    m_leech_action = action;
+}
+
 
 SettingsScene::SettingsScene(ConsoleUI::UIManager &uiManager,
                              std::function<void()> goBack,
@@ -126,6 +209,12 @@ SettingsScene::SettingsScene(ConsoleUI::UIManager &uiManager,
     menu.addButton(" Decrement Cards ", [this]() { decrementCards(); });
     menu.addButton(" Increment Time  ", [this]() { incrementStudyMins(); });
     menu.addButton(" Decrement Time  ", [this]() { decrementStudyMins(); });
+    menu.addButton("  Study Filter   ", [this]() { editStudyQuery(); });
+    menu.addButton("   Study Mode    ", [this]() { changeStudyMode(); });
+    menu.addButton("    Scheduler    ", [this]() { changeScheduler(); });
+    menu.addButton("   Deck Memory   ", [this]() { editDeckMemory(); });
+    menu.addButton(" Leech Threshold ", [this]() { editLeechThreshold(); });
+    menu.addButton("  Leech Action   ", [this]() { changeLeechAction(); });
     menu.addButton("    Defaults     ", [this]() { resetDefault(); });
     menu.addButton("      Back       ", [this]() { m_goBack(); });
 }
@@ -155,6 +244,17 @@ void SettingsScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
     window->drawCenteredText("Deck location: " + m_settings.getDeckDir().string(), 5);
     window->drawCenteredText("Number of Cards per Round: " + std::to_string(m_settings.getFlashCardLimit()), 6);
     window->drawCenteredText("Study time (mins): " + std::to_string(m_settings.getStudyDurationMin()), 7);
+    std::string query = m_settings.getStudyQuery();
+    // pad so a shorter filter fully replaces a longer one
+    window->drawCenteredText("  Study filter: " + (query.empty() ? std::string("all cards") : query) + "  ", 8);
+    window->drawCenteredText("  Deck memory (MiB): " + std::to_string(m_settings.getDeckMemoryMiB()) + "  ", 9);
+    window->drawCenteredText("     Study mode: " + cardViewModeToStr(m_settings.getStudyMode()) + "     ", 10);
+    window->drawCenteredText("  Scheduler: " + schedulerAlgorithmToStr(m_settings.getScheduler()) + "  ", 11);
+    int threshold = m_settings.getLeechThreshold();
+    std::string leeches = threshold == 0 ? std::string("off")
+                                         : std::to_string(threshold) + " failures, " +
+                                               leechActionToStr(m_settings.getLeechAction());
+    window->drawCenteredText("    Leeches: " + leeches + "    ", 12);
     // window->drawCenteredText("Playing the Game", window->getSize().Y / 2 - 2);
 
 
@@ -198,3 +298,109 @@ void SettingsScene::resetDefault()
 {
     m_settings.reset();
 }
+
+void SettingsScene::changeStudyMode()
+{
+    m_settings.nextStudyMode();
+}
+
+void SettingsScene::changeScheduler()
+{
+    m_settings.setScheduler(m_settings.getScheduler() == SM2_SCHEDULER ? FSRS_SCHEDULER : SM2_SCHEDULER);
+}
+
+void SettingsScene::changeLeechAction()
+{
+    m_settings.setLeechAction(m_settings.getLeechAction() == SUSPEND_LEECH ? TAG_LEECH : SUSPEND_LEECH);
+}
+
+void SettingsScene::editStudyQuery()
+{
+    auto window = m_uiManager.getWindow();
+    window->clear();
+    window->drawBorder();
+    window->drawCenteredText("Study Filter", 2);
+    window->drawText("Enter a filter for the cards to study, or leave it empty to study every card.", 2, 4);
+    window->drawText("e.g. difficulty>=MEDIUM and answered<3 and deck~\"cosc*\"", 2, 5);
+    window->drawText("Fields: difficulty, answered, deck, tag   Operators: = != < <= > >= ~ !~   and or not ( )", 2, 6);
+
+    std::string query = window->getLine(2, 8, 80);
+    if (query != "\x1B") // Esc key
+    {
+        // compile against no cards just to check the syntax
+        CardQuery compiled{};
+        std::string error{};
+        if (CardQuery::compile(query, CardColumns{}, compiled, error))
+        {
+            m_settings.setStudyQuery(query);
+            window->drawText("Study filter saved.", 2, 10);
+        }
+        else
+        {
+            window->drawText("Invalid filter: " + error, 2, 10);
+        }
+        window->drawText("Press any key to continue...", 2, 12);
+        _getch();
+    }
+
+    window->clear();
+    m_staticDrawn = false;
+}
+
+void SettingsScene::editDeckMemory()
+{
+    auto window = m_uiManager.getWindow();
+    window->clear();
+    window->drawBorder();
+    window->drawCenteredText("Deck Memory", 2);
+    window->drawText("Enter the MiB of cards to keep loaded, other decks are reloaded from disk when viewed.", 2, 4);
+
+    std::string input = window->getLine(2, 6, 8);
+    if (input != "\x1B") // Esc key
+    {
+        auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+        if (!input.empty() && input.size() <= 7 && std::all_of(input.begin(), input.end(), is_digit))
+        {
+            m_settings.setDeckMemoryMiB(std::stoi(input));
+            window->drawText("Deck memory set to " + std::to_string(m_settings.getDeckMemoryMiB()) + " MiB.", 2, 8);
+        }
+        else
+        {
+            window->drawText("Please enter a whole number of MiB.", 2, 8);
+        }
+        window->drawText("Press any key to continue...", 2, 10);
+        _getch();
+    }
+
+    window->clear();
+    m_staticDrawn = false;
+}
+
+void SettingsScene::editLeechThreshold()
+{
+    auto window = m_uiManager.getWindow();
+    window->clear();
+    window->drawBorder();
+    window->drawCenteredText("Leech Threshold", 2);
+    window->drawText("Enter the times a card can be forgotten before it is a leech, or 0 to not look for them.", 2, 4);
+
+    std::string input = window->getLine(2, 6, 2);
+    if (input != "\x1B") // Esc key
+    {
+        auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+        if (!input.empty() && std::all_of(input.begin(), input.end(), is_digit))
+        {
+            m_settings.setLeechThreshold(std::stoi(input));
+            window->drawText("Leech threshold set to " + std::to_string(m_settings.getLeechThreshold()) + ".", 2, 8);
+        }
+        else
+        {
+            window->drawText("Please enter a whole number of failed reviews.", 2, 8);
+        }
+        window->drawText("Press any key to continue...", 2, 10);
+        _getch();
+    }
+
+    window->clear();
+    m_staticDrawn = false;
+}
@@ -12,7 +12,10 @@
 #ifndef SETTINGS_SCENE_H
 #define SETTINGS_SCENE_H
 
+#include "card_view.h"
+#include "leech.h"
 #include "menu.h"
+#include "scheduler.h"
 #include "util.h"
 #include <functional>
 #include <iostream>
@@ -130,6 +133,112 @@ public:
      */
     std::filesystem::path getDeckDir();
 
+    /**
+     * @brief Set the directory the Deck files are stored in
+     * @details The review log and backups of the decks are kept in the same directory.
+     *
+     * @param deck_dir The directory
+     */
+    void setDeckDir(const std::filesystem::path &deck_dir);
+
+    /**
+     * @brief Get the card query used to choose which cards to study
+     *
+     * @return std::string Empty when every card may be studied
+     */
+    std::string getStudyQuery();
+
+    /**
+     * @brief Set the card query used to choose which cards to study
+     * @details The query is not checked here, see CardQuery::compile
+     *
+     * @param query The query, empty to study every card
+     */
+    void setStudyQuery(const std::string &query);
+
+    /**
+     * @brief Get the memory the cards of loaded decks may use before the least recently viewed are evicted
+     *
+     * @return size_t Bytes
+     */
+    size_t getDeckMemoryBudget();
+
+    /**
+     * @brief Get the deck memory budget in MiB
+     *
+     * @return int
+     */
+    int getDeckMemoryMiB();
+
+    /**
+     * @brief Set the deck memory budget
+     *
+     * @param mib The budget in MiB, from 1 to 1048576
+     */
+    void setDeckMemoryMiB(int mib);
+
+    /**
+     * @brief Get how cards are shown while studying
+     *
+     * @return CardViewMode
+     */
+    CardViewMode getStudyMode();
+
+    /**
+     * @brief Set how cards are shown while studying
+     *
+     * @param mode The study mode
+     */
+    void setStudyMode(CardViewMode mode);
+
+    /**
+     * @brief Change to the next study mode, wrapping around after the last
+     *
+     */
+    void nextStudyMode();
+
+    /**
+     * @brief Get the algorithm that schedules cards for review
+     *
+     * @return SchedulerAlgorithm
+     */
+    SchedulerAlgorithm getScheduler();
+
+    /**
+     * @brief Set the algorithm that schedules cards for review
+     *
+     * @param algorithm The algorithm
+     */
+    void setScheduler(SchedulerAlgorithm algorithm);
+
+    /**
+     * @brief Get the failed reviews that make a card a leech
+     *
+     * @return int 0 when leeches are not looked for
+     */
+    int getLeechThreshold();
+
+    /**
+     * @brief Set the failed reviews that make a card a leech
+     *
+     * @param failures The threshold, from 0 to 99, 0 to stop looking for leeches
+     */
+    void setLeechThreshold(int failures);
+
+    /**
+     * @brief Get what happens to a card that becomes a leech
+     *
+     * @return LeechAction
+     */
+    LeechAction getLeechAction();
+
+    /**
+     * @brief Set what happens to a card that becomes a leech
+     *
+     * @param action The action
+     */
+    void setLeechAction(LeechAction action);
+
 
 private:
     /**maximum number of flashcards to study per round */
@@ -142,6 +251,18 @@ private:
     boolean m_session_underway{false};
     /** the path to the Deck files */
     std::filesystem::path m_deck_dir = getAppPath().append("Decks/");
+    /** card query limiting which cards are studied, empty for all cards */
+    std::string m_study_query{};
+    /** MiB of cards kept loaded, see DeckLibrary */
+    int m_deck_memory_mib{256};
+    /** how cards are shown while studying */
+    CardViewMode m_study_mode{FORWARD_VIEW};
+    /** algorithm that schedules cards for review */
+    SchedulerAlgorithm m_scheduler{SM2_SCHEDULER};
+    /** failed reviews that make a card a leech, 0 for none */
+    int m_leech_threshold{static_cast<int>(defaultLeechThreshold)};
+    /** what happens to a card that becomes a leech */
+    LeechAction m_leech_action{SUSPEND_LEECH};
 };
 
 
@@ -211,6 +332,42 @@ public:
      */
     void resetDefault();
 
+    /**
+     * @brief Prompt for the card query used to choose which cards to study
+     *
+     */
+    void editStudyQuery();
+
+    /**
+     * @brief Prompt for the deck memory budget
+     *
+     */
+    void editDeckMemory();
+
+    /**
+     * @brief Change to the next study mode
+     *
+     */
+    void changeStudyMode();
+
+    /**
+     * @brief Switch between the scheduling algorithms
+     *
+     */
+    void changeScheduler();
+
+    /**
+     * @brief Prompt for the leech threshold
+     *
+     */
+    void editLeechThreshold();
+
+    /**
+     * @brief Switch between tagging and suspending leeches
+     *
+     */
+    void changeLeechAction();
+
     /**
      * @brief Handle user input for the scene
      *
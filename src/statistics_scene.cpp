@@ -0,0 +1,188 @@
+/**
+ * @file statistics_scene.cpp
+ * @author Green Alligators
+ * @brief Defines the UI scene showing statistics of every review ever made
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "statistics_scene.h"
+#include "review_log.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <utility>
+
+namespace FlashcardApp
+{
+
+namespace
+{
+
+std::string percent(uint64_t passed, uint64_t reviews)
+{
+    return reviews == 0 ? "-" : std::to_string((passed * 100 + reviews / 2) / reviews) + "%";
+}
+
+std::string duration(uint64_t ms)
+{
+    uint64_t minutes = ms / 60000;
+    return std::to_string(minutes / 60) + "h " + std::to_string(minutes % 60) + "m";
+}
+
+std::string padded(std::string text, size_t width)
+{
+    text.resize((std::max)(text.size(), width), ' ');
+    return text;
+}
+
+} // namespace
+
+StatisticsScene::StatisticsScene(ConsoleUI::UIManager &uiManager,
+                                 const DeckLibrary &library,
+                                 StudySettings &settings,
+                                 std::function<void()> goBack)
+    : m_uiManager(uiManager), m_goBack(goBack)
+{
+    m_uiManager.clearMenu("statistics");
+    auto &menu = m_uiManager.createMenu("statistics", true);
+    menu.addButton("Back", m_goBack);
+
+    auto start = std::chrono::steady_clock::now();
+    m_stats = computeStudyStats(reviewLogFileFor(settings.getDeckDir()), reviewTimeNowMs());
+    m_computeMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+                      .count();
+    formatLines(library);
+}
+
+void StatisticsScene::formatLines(const DeckLibrary &library)
+{
+    const StudyStats &s = m_stats;
+    m_lines.clear();
+    m_lines.push_back("Reviews: " + std::to_string(s.reviews) + "   Cards: " + std::to_string(s.cards) +
+                      "   Accuracy: " + percent(s.passed, s.reviews) + "   Time spent: " + duration(s.time_ms));
+    m_lines.push_back("Days studied: " + std::to_string(s.days_studied) +
+                      "   Streak: " + std::to_string(s.current_streak) + " days   Longest streak: " +
+                      std::to_string(s.longest_streak) + " days   Reviews today: " + std::to_string(s.reviews_today));
+    m_lines.emplace_back();
+
+    m_lines.emplace_back("Recall by time since the card's last review");
+    std::string labels = padded("  Interval", 12);
+    std::string recall = padded("  Recall", 12);
+    std::string reviews = padded("  Reviews", 12);
+    for (size_t b = 0; b < retentionBuckets; ++b)
+    {
+        labels += padded(retentionBucketLabel(b), 8);
+        recall += padded(percent(s.retention_passed[b], s.retention_reviews[b]), 8);
+        reviews += padded(std::to_string(s.retention_reviews[b]), 8);
+    }
+    m_lines.push_back(labels);
+    m_lines.push_back(recall);
+    m_lines.push_back(reviews);
+    m_lines.emplace_back();
+
+    // the log only has the decks' ids, so the names come from the decks still in the library
+    std::unordered_map<uint64_t, std::string> names{};
+    for (size_t i = 0; i < library.size(); ++i)
+    {
+        names.emplace(reviewDeckId(library.name(i)), library.name(i));
+    }
+    m_lines.emplace_back("Accuracy by deck");
+    for (size_t d = 0; d < (std::min)(s.decks.size(), decksShown); ++d)
+    {
+        auto name = names.find(s.decks[d].deck_id);
+        m_lines.push_back("  " + padded(name != names.end() ? name->second : "(removed deck)", 32) +
+                          padded(percent(s.decks[d].passed, s.decks[d].reviews), 6) +
+                          std::to_string(s.decks[d].reviews) + " reviews");
+    }
+    m_lines.emplace_back();
+
+    // counted from each deck's metadata, no deck is loaded
+    std::vector<std::pair<LeechCount, size_t>> leech_decks{};
+    LeechCount leeches{};
+    for (size_t i = 0; i < library.size(); ++i)
+    {
+        LeechCount count = library.leechCount(i);
+        leeches.leeches += count.leeches;
+        leeches.suspended += count.suspended;
+        if (count.leeches > 0)
+        {
+            leech_decks.emplace_back(count, i);
+        }
+    }
+    std::stable_sort(leech_decks.begin(), leech_decks.end(), [](const auto &a, const auto &b) {
+        return a.first.leeches > b.first.leeches;
+    });
+    m_lines.push_back("Leeches: " + std::to_string(leeches.leeches) + "   Suspended cards: " +
+                      std::to_string(leeches.suspended) + "   Study filter for them: tag = leech");
+    for (size_t d = 0; d < (std::min)(leech_decks.size(), leechDecksShown); ++d)
+    {
+        const auto &[count, deck] = leech_decks[d];
+        m_lines.push_back("  " + padded(library.name(deck), 32) + std::to_string(count.leeches) + " leeches, " +
+                          std::to_string(count.suspended) + " suspended");
+    }
+    m_lines.emplace_back();
+
+    m_lines.emplace_back("Cards due");
+    std::string forecast = "  ";
+    for (size_t day = 0; day < (std::min)(s.forecast.size(), forecastDaysShown); ++day)
+    {
+        std::string label = day == 0 ? "Today" : "+" + std::to_string(day) + "d";
+        forecast += padded(label + ": " + std::to_string(s.forecast[day]), 14);
+    }
+    m_lines.push_back(forecast);
+    m_lines.emplace_back();
+    m_lines.push_back("Computed from " + std::to_string(s.reviews) + " reviews in " + std::to_string(m_computeMs) +
+                      " ms");
+}
+
+void StatisticsScene::init()
+{
+    // No need for init
+}
+
+void StatisticsScene::update()
+{
+    // No continuous updates needed for this scene
+}
+
+void StatisticsScene::setStaticDrawn(bool staticDrawn)
+{
+    m_staticDrawn = staticDrawn;
+}
+
+void StatisticsScene::render(std::shared_ptr<ConsoleUI::ConsoleWindow> window)
+{
+    window->clear();
+    window->drawBorder();
+    window->drawCenteredText("Statistics", 2);
+
+    int y = 4;
+    for (const std::string &line : m_lines)
+    {
+        window->drawText(line, 4, y++);
+    }
+
+    auto windowSize = window->getSize();
+    m_uiManager.getMenu("statistics").draw((windowSize.X) / 2 - 4, windowSize.Y - 7);
+    window->drawText("Press ENTER to go back", windowSize.X / 2 - 11, windowSize.Y - 5);
+}
+
+void StatisticsScene::handleInput()
+{
+    if (_kbhit())
+    {
+        int key = _getch();
+
+        if (key == key::key_esc)
+        {
+            m_goBack();
+        }
+    }
+
+    m_uiManager.getMenu("statistics").handleInput();
+}
+
+} // namespace FlashcardApp
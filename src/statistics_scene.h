@@ -0,0 +1,104 @@
+/**
+ * @file statistics_scene.h
+ * @author Green Alligators
+ * @brief Defines the UI scene showing statistics of every review ever made
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef STATISTICS_SCENE_H
+#define STATISTICS_SCENE_H
+
+#include "deck_library.h"
+#include "menu.h"
+#include "settings_scene.h"
+#include "study_analytics.h"
+#include <conio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace FlashcardApp
+{
+
+/**
+ * @brief A scene showing the statistics of the review log kept with the decks
+ * @details The statistics are computed once, when the scene is created.
+ *
+ */
+class StatisticsScene : public ConsoleUI::Scene
+{
+public:
+    /** days of the forecast that are shown */
+    static constexpr size_t forecastDaysShown{7};
+    /** decks whose accuracy is shown, the most reviewed */
+    static constexpr size_t decksShown{6};
+    /** decks whose leeches are shown, those with the most */
+    static constexpr size_t leechDecksShown{3};
+
+    /**
+     * @brief Construct a new Statistics Scene object
+     *
+     * @param uiManager reference to the current UI mananger object
+     * @param library The decks, used to name the decks in the log and count their leeches
+     * @param settings The study settings, which give the deck directory the log is kept in
+     * @param goBack a function to go back a scene
+     */
+    StatisticsScene(ConsoleUI::UIManager &uiManager,
+                    const DeckLibrary &library,
+                    StudySettings &settings,
+                    std::function<void()> goBack);
+
+    /**
+     * @brief Initialise the scene
+     *
+     */
+    void init() override;
+
+    /**
+     * @brief function for continuous updates to the program state seperate from rendering and input handling
+     *
+     */
+    void update() override;
+
+    /**
+     * @brief renders the scene on the console window
+     * @param window shared pointer to the console window that is rendered on
+     */
+    void render(std::shared_ptr<ConsoleUI::ConsoleWindow> window) override;
+
+    /**
+     * @brief Handle the input for the scene
+     *
+     */
+    void handleInput() override;
+
+    /**
+     * @brief Sets the static drawn state of the scene.
+     * @param staticDrawn Boolean indicating whether the static elements have been drawn.
+     */
+    void setStaticDrawn(bool staticDrawn) override;
+
+    StudyStats m_stats;               ///< The statistics shown
+    std::vector<std::string> m_lines; ///< The statistics as lines of text
+    int64_t m_computeMs{0};           ///< Milliseconds taken to compute the statistics
+
+private:
+    /**
+     * @brief Write the statistics as lines of text
+     *
+     * @param library The decks, used to name the decks in the log
+     */
+    void formatLines(const DeckLibrary &library);
+
+    ConsoleUI::UIManager &m_uiManager; ///< Reference to the UI manager.
+    std::function<void()> m_goBack;    ///< function to return to the previous scene
+    bool m_staticDrawn = false;        ///< Flag indicating if the static elements have been drawn.
+};
+
+} // namespace FlashcardApp
+
+#endif // STATISTICS_SCENE_H
@@ -0,0 +1,283 @@
+/**
+ * @file study_analytics.cpp
+ * @author Green Alligators
+ * @brief Statistics over the whole review history: retention, per-deck accuracy, streaks, time spent and forecast
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "study_analytics.h"
+#include "review_log.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+
+constexpr int64_t dayMs{24 * 60 * 60 * 1000};
+
+/** every column but the session ids */
+constexpr unsigned statsColumns{CARD_ID_COLUMN | DECK_ID_COLUMN | TIME_COLUMN | DUE_COLUMN | RESPONSE_COLUMN |
+                                GRADE_TIME_COLUMN | GRADE_COLUMN};
+
+/** The reviews of one card within a range of blocks */
+struct CardSpan
+{
+    int64_t first_ms;    ///< Time of the first review
+    int64_t last_ms;     ///< Time of the latest review
+    int64_t due;         ///< Due time set by the latest review
+    uint8_t first_grade; ///< Grade of the first review
+};
+
+/** The statistics of a range of blocks, before they are merged */
+struct Partial
+{
+    bool ok{true};
+    uint64_t reviews{0};
+    uint64_t passed{0};
+    uint64_t time_ms{0};
+    std::array<uint64_t, retentionBuckets> retention_reviews{};
+    std::array<uint64_t, retentionBuckets> retention_passed{};
+    std::unordered_map<uint64_t, DeckStudyStats> decks{};
+    std::vector<std::pair<int64_t, uint64_t>> days{}; ///< Reviews of each day, in log order
+    std::unordered_map<uint64_t, CardSpan> cards{};
+};
+
+int64_t dayOf(int64_t ms)
+{
+    // rounds down for times before the epoch too
+    return ms / dayMs - (ms % dayMs < 0 ? 1 : 0);
+}
+
+void addRepeat(std::array<uint64_t, retentionBuckets> &reviews,
+               std::array<uint64_t, retentionBuckets> &passed,
+               int64_t interval_ms,
+               uint8_t grade)
+{
+    size_t bucket = retentionBucket(interval_ms);
+    reviews[bucket]++;
+    passed[bucket] += grade > AGAIN_RATING ? 1 : 0;
+}
+
+void reduceBlock(const ReviewColumns &columns, Partial &partial)
+{
+    const size_t n = columns.size();
+    const uint8_t *grades = columns.grades.data();
+    const uint32_t *response_ms = columns.response_ms.data();
+    const uint32_t *grade_ms = columns.grade_ms.data();
+
+    // plain loops over whole columns, which the compiler vectorises
+    uint64_t passed = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        passed += grades[i] > AGAIN_RATING ? 1 : 0;
+    }
+    uint64_t time_ms = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        time_ms += static_cast<uint64_t>(response_ms[i]) + grade_ms[i];
+    }
+    partial.reviews += n;
+    partial.passed += passed;
+    partial.time_ms += time_ms;
+
+    // the deck and day rarely change from one review to the next, so they are counted in runs
+    size_t run_start = 0;
+    for (size_t i = 1; i <= n; ++i)
+    {
+        if (i == n || columns.deck_ids[i] != columns.deck_ids[run_start])
+        {
+            uint64_t run_passed = 0;
+            for (size_t j = run_start; j < i; ++j)
+            {
+                run_passed += grades[j] > AGAIN_RATING ? 1 : 0;
+            }
+            DeckStudyStats &deck = partial.decks[columns.deck_ids[run_start]];
+            deck.reviews += i - run_start;
+            deck.passed += run_passed;
+            run_start = i;
+        }
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        int64_t day = dayOf(columns.times_ms[i]);
+        if (partial.days.empty() || partial.days.back().first != day)
+        {
+            partial.days.emplace_back(day, 0);
+        }
+        partial.days.back().second++;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        int64_t time = columns.times_ms[i];
+        auto [card, first] =
+            partial.cards.try_emplace(columns.card_ids[i], CardSpan{time, time, columns.dues[i], grades[i]});
+        if (!first)
+        {
+            addRepeat(partial.retention_reviews, partial.retention_passed, time - card->second.last_ms, grades[i]);
+            card->second.last_ms = time;
+            card->second.due = columns.dues[i];
+        }
+    }
+}
+
+void reduceBlocks(const std::filesystem::path &log_file, size_t first, size_t last, Partial &partial)
+{
+    // every thread reads through its own stream
+    ReviewLogReader reader{log_file};
+    ReviewColumns columns{};
+    for (size_t block = first; block < last && partial.ok; ++block)
+    {
+        partial.ok = reader.readBlock(block, columns, statsColumns);
+        if (partial.ok)
+        {
+            reduceBlock(columns, partial);
+        }
+    }
+}
+
+} // namespace
+
+size_t retentionBucket(int64_t interval_ms)
+{
+    uint64_t days = static_cast<uint64_t>((std::max)(interval_ms, int64_t{0}) / dayMs);
+    return (std::min)(static_cast<size_t>(std::bit_width(days)), retentionBuckets - 1);
+}
+
+std::string retentionBucketLabel(size_t bucket)
+{
+    if (bucket == 0)
+    {
+        return "<1d";
+    }
+    if (bucket == 1)
+    {
+        return "1d";
+    }
+    std::string low = std::to_string(uint64_t{1} << (bucket - 1));
+    if (bucket + 1 >= retentionBuckets)
+    {
+        return low + "d+";
+    }
+    return low + "-" + std::to_string((uint64_t{1} << bucket) - 1) + "d";
+}
+
+StudyStats computeStudyStats(const std::filesystem::path &log_file,
+                             int64_t now_ms,
+                             unsigned int n_threads,
+                             size_t forecast_days)
+{
+    StudyStats stats{};
+    stats.forecast.assign(forecast_days, 0);
+
+    size_t n_blocks = ReviewLogReader{log_file}.blockCount();
+    if (n_blocks == 0)
+    {
+        return stats;
+    }
+    size_t n_workers = n_threads != 0 ? n_threads : (std::max)(std::thread::hardware_concurrency(), 1u);
+    n_workers = (std::min)(n_workers, n_blocks);
+
+    // each worker takes a contiguous range of blocks, so its partial result follows log order
+    std::vector<Partial> partials(n_workers);
+    auto rangeStart = [n_blocks, n_workers](size_t worker) { return n_blocks * worker / n_workers; };
+    std::vector<std::thread> workers;
+    workers.reserve(n_workers - 1);
+    for (size_t w = 1; w < n_workers; ++w)
+    {
+        workers.emplace_back(
+            reduceBlocks, std::cref(log_file), rangeStart(w), rangeStart(w + 1), std::ref(partials[w]));
+    }
+    // the calling thread does its share too
+    reduceBlocks(log_file, rangeStart(0), rangeStart(1), partials[0]);
+    for (std::thread &t : workers)
+    {
+        t.join();
+    }
+
+    std::unordered_map<uint64_t, DeckStudyStats> decks{};
+    std::map<int64_t, uint64_t> days{};
+    std::unordered_map<uint64_t, CardSpan> cards{};
+    for (const Partial &partial : partials)
+    {
+        if (!partial.ok)
+        {
+            // the blocks after a bad block would pair reviews up wrongly
+            break;
+        }
+        stats.reviews += partial.reviews;
+        stats.passed += partial.passed;
+        stats.time_ms += partial.time_ms;
+        for (size_t b = 0; b < retentionBuckets; ++b)
+        {
+            stats.retention_reviews[b] += partial.retention_reviews[b];
+            stats.retention_passed[b] += partial.retention_passed[b];
+        }
+        for (const auto &[deck_id, deck] : partial.decks)
+        {
+            DeckStudyStats &merged = decks[deck_id];
+            merged.reviews += deck.reviews;
+            merged.passed += deck.passed;
+        }
+        for (const auto &[day, reviews] : partial.days)
+        {
+            days[day] += reviews;
+        }
+        // a card's first review in this range repeats its last review in the ranges before
+        for (const auto &[card_id, span] : partial.cards)
+        {
+            auto [card, first] = cards.try_emplace(card_id, span);
+            if (!first)
+            {
+                addRepeat(stats.retention_reviews, stats.retention_passed, span.first_ms - card->second.last_ms,
+                          span.first_grade);
+                card->second.last_ms = span.last_ms;
+                card->second.due = span.due;
+            }
+        }
+    }
+
+    for (const auto &[deck_id, deck] : decks)
+    {
+        stats.decks.push_back(DeckStudyStats{deck_id, deck.reviews, deck.passed});
+    }
+    std::sort(stats.decks.begin(), stats.decks.end(), [](const DeckStudyStats &a, const DeckStudyStats &b) {
+        return a.reviews != b.reviews ? a.reviews > b.reviews : a.deck_id < b.deck_id;
+    });
+
+    const int64_t today = dayOf(now_ms);
+    int64_t previous_day = 0;
+    uint64_t streak = 0;
+    for (const auto &[day, reviews] : days)
+    {
+        streak = streak != 0 && day == previous_day + 1 ? streak + 1 : 1;
+        stats.longest_streak = (std::max)(stats.longest_streak, streak);
+        previous_day = day;
+    }
+    stats.days_studied = days.size();
+    stats.current_streak = !days.empty() && previous_day >= today - 1 ? streak : 0;
+    auto found_today = days.find(today);
+    stats.reviews_today = found_today != days.end() ? found_today->second : 0;
+
+    stats.cards = cards.size();
+    for (const auto &[card_id, card] : cards)
+    {
+        if (card.due == 0)
+        {
+            continue;
+        }
+        int64_t day = (std::max)(dayOf(card.due * 1000) - today, int64_t{0});
+        if (day < static_cast<int64_t>(forecast_days))
+        {
+            stats.forecast[static_cast<size_t>(day)]++;
+        }
+    }
+    return stats;
+}
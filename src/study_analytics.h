@@ -0,0 +1,96 @@
+/**
+ * @file study_analytics.h
+ * @author Green Alligators
+ * @brief Statistics over the whole review history: retention, per-deck accuracy, streaks, time spent and forecast
+ * @details The statistics are computed from the review log by splitting its blocks between threads. Each thread reads
+ * only the columns the statistics need and reduces them a block at a time, with plain loops over each column that
+ * the compiler vectorises. The partial results are then merged in log order so reviews of a card that fall in
+ * different threads' blocks are still paired up.
+ *
+ * Days are counted in UTC.
+ *
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef STUDY_ANALYTICS_H
+#define STUDY_ANALYTICS_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/** The number of buckets of the retention curve, see retentionBucket */
+constexpr size_t retentionBuckets{10};
+
+/**
+ * @brief How often the cards of one deck were recalled
+ *
+ */
+struct DeckStudyStats
+{
+    uint64_t deck_id{0}; ///< The deck, see reviewDeckId
+    uint64_t reviews{0}; ///< Reviews of the deck's cards
+    uint64_t passed{0};  ///< Reviews graded better than Again
+};
+
+/**
+ * @brief Statistics of every review in a review log
+ *
+ */
+struct StudyStats
+{
+    uint64_t reviews{0};                                        ///< Reviews in the log
+    uint64_t passed{0};                                         ///< Reviews graded better than Again
+    uint64_t time_ms{0};                                        ///< Time spent answering and grading
+    uint64_t cards{0};                                          ///< Different cards reviewed
+    uint64_t days_studied{0};                                   ///< Days with at least one review
+    uint64_t reviews_today{0};                                  ///< Reviews on the current day
+    uint64_t current_streak{0};                                 ///< Days in a row studied, up to today or yesterday
+    uint64_t longest_streak{0};                                 ///< The most days in a row ever studied
+    std::array<uint64_t, retentionBuckets> retention_reviews{}; ///< Repeat reviews by retentionBucket
+    std::array<uint64_t, retentionBuckets> retention_passed{};  ///< Repeat reviews passed by retentionBucket
+    std::vector<DeckStudyStats> decks{};                        ///< Every deck reviewed, the most reviewed first
+    std::vector<uint64_t> forecast{}; ///< Cards due on each day from today, overdue cards count as due today
+};
+
+/**
+ * @brief The bucket of the retention curve for the time between two reviews of a card
+ * @details Bucket 0 is less than a day, bucket b holds from 2^(b-1) up to 2^b days and the last bucket holds
+ * everything longer.
+ *
+ * @param interval_ms Milliseconds since the card's previous review
+ * @return size_t
+ */
+size_t retentionBucket(int64_t interval_ms);
+
+/**
+ * @brief A short label for a bucket of the retention curve, such as "4-7d"
+ *
+ * @param bucket The bucket
+ * @return std::string
+ */
+std::string retentionBucketLabel(size_t bucket);
+
+/**
+ * @brief Compute the statistics of a review log
+ * @details A log that does not exist has no reviews. The forecast uses the due time logged with each card's latest
+ * review, so it counts cards that were since removed from their deck.
+ *
+ * @param log_file The review log, see reviewLogFileFor
+ * @param now_ms The current time in milliseconds since the epoch, which fixes today
+ * @param n_threads Number of threads to use, 0 picks one per hardware thread
+ * @param forecast_days The number of days to forecast
+ * @return StudyStats
+ */
+StudyStats computeStudyStats(const std::filesystem::path &log_file,
+                             int64_t now_ms,
+                             unsigned int n_threads = 0,
+                             size_t forecast_days = 30);
+
+#endif // STUDY_ANALYTICS_H
@@ -0,0 +1,380 @@
+/**
+ * @file study_queue.cpp
+ * @author Green Alligators
+ * @brief The study queue of a deck, kept with the deck and updated as each review comes in
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "study_queue.h"
+#include "leech.h"
+#include "top_k.h"
+#include "varint.h"
+#include "weighted_sampler.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr std::array<char, 8> queueMagic{'S', 'D', 'S', 'T', 'U', 'D', 'Y', 'Q'};
+constexpr uint64_t queueFormat{1};
+
+/**
+ * @brief The size and time of a deck file, which change whenever it is written
+ *
+ * @return true if the file exists
+ */
+bool deckFileStamp(const fs::path &deck_file, uint64_t &size, uint64_t &time)
+{
+    std::error_code ec;
+    size = fs::file_size(deck_file, ec);
+    if (ec)
+    {
+        return false;
+    }
+    time = static_cast<uint64_t>(fs::last_write_time(deck_file, ec).time_since_epoch().count());
+    return !ec;
+}
+
+bool getIndex(std::string_view &in, size_t n_cards, size_t &index)
+{
+    uint64_t value = 0;
+    if (!getVarint(in, value) || value >= n_cards)
+    {
+        return false;
+    }
+    index = static_cast<size_t>(value);
+    return true;
+}
+
+bool getCount(std::string_view &in, size_t limit, size_t &count)
+{
+    uint64_t value = 0;
+    if (!getVarint(in, value) || value > limit)
+    {
+        return false;
+    }
+    count = static_cast<size_t>(value);
+    return true;
+}
+
+} // namespace
+
+void selectStudyCards(const FlashCardDeck &deck,
+                      const std::vector<size_t> &candidates,
+                      size_t n_cards,
+                      int64_t now,
+                      CardViewMode mode,
+                      Rng &rng,
+                      std::vector<size_t> &order)
+{
+    bool every_card = candidates.empty();
+    size_t n_candidates = every_card ? deck.cards.size() : candidates.size();
+    TopK<std::pair<int, double>> best{n_cards};
+    for (size_t c = 0; c < n_candidates; ++c)
+    {
+        size_t i = every_card ? c : candidates[c];
+        const FlashCard &card = deck.cards[i];
+        // only cards with a marked span can be studied as cloze deletions
+        if (isSuspended(card) || (mode == CLOZE_VIEW && !CardView{card, CLOZE_VIEW}.studiable()))
+        {
+            continue;
+        }
+        if (card.schedule.due != 0 && card.schedule.due <= now)
+        {
+            best.offer({0, static_cast<double>(card.schedule.due)}, i);
+        }
+        else if (card.n_times_answered == 0 && card.schedule.due == 0)
+        {
+            best.offer({1, rng.uniform()}, i);
+        }
+        else
+        {
+            // scheduled cards that are not yet due count as seen
+            double weight = (4 - card.difficulty) * (1 + std::log(card.n_times_answered + 1));
+            best.offer({2, weightedSampleKey(weight, rng.uniform())}, i);
+        }
+    }
+    best.take(order);
+}
+
+fs::path StudyQueue::queueFileFor(const fs::path &deck_file)
+{
+    return deck_file.parent_path() / ".history" / (deck_file.filename().string() + ".queue");
+}
+
+void StudyQueue::build(const FlashCardDeck &deck, Rng &rng)
+{
+    m_scheduled.clear();
+    m_new.clear();
+    for (size_t i = 0; i < deck.cards.size(); ++i)
+    {
+        const FlashCard &card = deck.cards[i];
+        if (isSuspended(card))
+        {
+            continue;
+        }
+        if (card.schedule.due != 0)
+        {
+            m_scheduled.emplace_back(card.schedule.due, i);
+        }
+        else if (card.n_times_answered == 0)
+        {
+            m_new.push_back(i);
+        }
+    }
+    std::sort(m_scheduled.begin(), m_scheduled.end());
+    for (size_t i = m_new.size(); i > 1; --i)
+    {
+        std::swap(m_new[i - 1], m_new[static_cast<size_t>(rng.below(i))]);
+    }
+    m_order.clear();
+    m_position = 0;
+    m_query.clear();
+    m_mode = FORWARD_VIEW;
+}
+
+bool StudyQueue::load(const FlashCardDeck &deck)
+{
+    uint64_t size = 0;
+    uint64_t time = 0;
+    if (deck.filename.empty() || !deckFileStamp(deck.filename, size, time))
+    {
+        return false;
+    }
+    std::ifstream file{queueFileFor(deck.filename), std::ios::binary};
+    std::string bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    std::string_view in{bytes};
+    if (in.size() < queueMagic.size() || !std::equal(queueMagic.begin(), queueMagic.end(), in.begin()))
+    {
+        return false;
+    }
+    in.remove_prefix(queueMagic.size());
+
+    uint64_t format = 0;
+    uint64_t saved_size = 0;
+    uint64_t saved_time = 0;
+    uint64_t n_cards = 0;
+    if (!getVarint(in, format) || !getVarint(in, saved_size) || !getVarint(in, saved_time) ||
+        !getVarint(in, n_cards) || format != queueFormat || saved_size != size || saved_time != time ||
+        n_cards != deck.cards.size())
+    {
+        return false;
+    }
+
+    // nothing is kept unless the whole file reads back
+    const size_t n = deck.cards.size();
+    std::vector<std::pair<int64_t, size_t>> scheduled{};
+    std::vector<size_t> fresh{};
+    std::vector<size_t> order{};
+    std::string query{};
+    size_t count = 0;
+    uint64_t due = 0;
+    if (!getCount(in, n, count))
+    {
+        return false;
+    }
+    scheduled.resize(count);
+    for (auto &[card_due, card] : scheduled)
+    {
+        uint64_t delta = 0;
+        if (!getVarint(in, delta) || !getIndex(in, n, card))
+        {
+            return false;
+        }
+        due += delta;
+        card_due = static_cast<int64_t>(due);
+    }
+    if (!getCount(in, n, count))
+    {
+        return false;
+    }
+    fresh.resize(count);
+    for (size_t &card : fresh)
+    {
+        if (!getIndex(in, n, card))
+        {
+            return false;
+        }
+    }
+    uint64_t mode = 0;
+    uint64_t position = 0;
+    if (!getBytes(in, query) || !getVarint(in, mode) || mode > CLOZE_VIEW || !getCount(in, n, count))
+    {
+        return false;
+    }
+    order.resize(count);
+    for (size_t &card : order)
+    {
+        if (!getIndex(in, n, card))
+        {
+            return false;
+        }
+    }
+    if (!getVarint(in, position) || position > order.size())
+    {
+        return false;
+    }
+
+    m_scheduled = std::move(scheduled);
+    m_new = std::move(fresh);
+    m_order = std::move(order);
+    m_position = static_cast<size_t>(position);
+    m_query = std::move(query);
+    m_mode = static_cast<CardViewMode>(mode);
+    return true;
+}
+
+bool StudyQueue::save(const FlashCardDeck &deck) const
+{
+    uint64_t size = 0;
+    uint64_t time = 0;
+    if (deck.filename.empty() || !deckFileStamp(deck.filename, size, time))
+    {
+        return false;
+    }
+    std::string out(queueMagic.begin(), queueMagic.end());
+    putVarint(out, queueFormat);
+    putVarint(out, size);
+    putVarint(out, time);
+    putVarint(out, deck.cards.size());
+    putVarint(out, m_scheduled.size());
+    int64_t previous = 0;
+    for (const auto &[due, card] : m_scheduled)
+    {
+        putVarint(out, static_cast<uint64_t>(due - previous));
+        putVarint(out, card);
+        previous = due;
+    }
+    putVarint(out, m_new.size());
+    for (size_t card : m_new)
+    {
+        putVarint(out, card);
+    }
+    putBytes(out, m_query);
+    putVarint(out, static_cast<uint64_t>(m_mode));
+    putVarint(out, m_order.size());
+    for (size_t card : m_order)
+    {
+        putVarint(out, card);
+    }
+    putVarint(out, m_position);
+
+    fs::path dest = queueFileFor(deck.filename);
+    fs::path tmp = dest;
+    tmp += ".tmp";
+    std::error_code ec;
+    fs::create_directories(dest.parent_path(), ec);
+    {
+        std::ofstream file{tmp, std::ios::binary | std::ios::trunc};
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!file)
+        {
+            return false;
+        }
+    }
+    fs::rename(tmp, dest, ec);
+    return !ec;
+}
+
+bool StudyQueue::resumable(const std::string &query, CardViewMode mode) const
+{
+    return m_position < m_order.size() && m_query == query && m_mode == mode;
+}
+
+const std::vector<size_t> &StudyQueue::sessionOrder() const
+{
+    return m_order;
+}
+
+size_t StudyQueue::sessionPosition() const
+{
+    return m_position;
+}
+
+bool StudyQueue::planSession(const FlashCardDeck &deck,
+                             size_t n_cards,
+                             int64_t now,
+                             CardViewMode mode,
+                             std::vector<size_t> &order) const
+{
+    order.clear();
+    // a card suspended since the queue was built stays queued but is not studied
+    auto studiable = [&deck, mode](size_t card) {
+        return card < deck.cards.size() && !isSuspended(deck.cards[card]) &&
+               (mode != CLOZE_VIEW || CardView{deck.cards[card], CLOZE_VIEW}.studiable());
+    };
+    for (size_t i = 0; i < m_scheduled.size() && order.size() < n_cards && m_scheduled[i].first <= now; ++i)
+    {
+        if (studiable(m_scheduled[i].second))
+        {
+            order.push_back(m_scheduled[i].second);
+        }
+    }
+    for (size_t i = 0; i < m_new.size() && order.size() < n_cards; ++i)
+    {
+        if (studiable(m_new[i]))
+        {
+            order.push_back(m_new[i]);
+        }
+    }
+    return order.size() == n_cards;
+}
+
+void StudyQueue::startSession(const std::vector<size_t> &order, const std::string &query, CardViewMode mode)
+{
+    m_order = order;
+    m_position = 0;
+    m_query = query;
+    m_mode = mode;
+}
+
+void StudyQueue::setSessionPosition(size_t position)
+{
+    m_position = (std::min)(position, m_order.size());
+}
+
+void StudyQueue::reschedule(size_t card, int64_t old_due, int64_t new_due)
+{
+    if (old_due != 0)
+    {
+        auto entry = std::make_pair(old_due, card);
+        auto found = std::lower_bound(m_scheduled.begin(), m_scheduled.end(), entry);
+        if (found != m_scheduled.end() && *found == entry)
+        {
+            m_scheduled.erase(found);
+        }
+    }
+    else
+    {
+        // new cards are studied from the front, so the card is found early
+        auto found = std::find(m_new.begin(), m_new.end(), card);
+        if (found != m_new.end())
+        {
+            m_new.erase(found);
+        }
+    }
+    if (new_due != 0)
+    {
+        auto place = std::make_pair(new_due, card);
+        m_scheduled.insert(std::lower_bound(m_scheduled.begin(), m_scheduled.end(), place), place);
+    }
+}
+
+size_t StudyQueue::scheduledCount() const
+{
+    return m_scheduled.size();
+}
+
+size_t StudyQueue::newCount() const
+{
+    return m_new.size();
+}
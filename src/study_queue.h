@@ -0,0 +1,193 @@
+/**
+ * @file study_queue.h
+ * @author Green Alligators
+ * @brief The study queue of a deck, kept with the deck and updated as each review comes in
+ * @details A StudyQueue holds a deck's scheduled cards in due order and its new cards in a random order, so a
+ * session of due then new cards is read off the front of the queue instead of ranking the whole deck. Each review
+ * moves its card to its new place in the queue. The queue also keeps the order of the current session and how far
+ * through it the user got, so a session that was left part way resumes at the card it stopped on.
+ *
+ * The queue of "Decks/name.deck" is saved in "Decks/.history/name.deck.queue" each time the deck is saved after
+ * studying, together with the size and time of the deck file. A queue whose deck file has since changed, for
+ * example by editing the deck, no longer matches and is built again. The file is an 8 byte magic string followed by
+ * varints:
+ *
+ * - format, deck file size, deck file time, number of cards
+ * - scheduled cards: count, then for each the due time as a difference from the one before and the card
+ * - new cards: count, then each card
+ * - session: the study query as a varint length then its bytes, the study mode, the count and cards of the session
+ *   order, then the position reached
+ *
+ * @version 1.0.0
+ * @date 2024-10-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef STUDY_QUEUE_H
+#define STUDY_QUEUE_H
+
+#include "card_view.h"
+#include "deck.h"
+#include "rng.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Rank a deck's cards and choose the ones to study
+ * @details One pass over the candidates keeps the best cards in a heap of n_cards, so the deck is never sorted or
+ * copied. Suspended cards are left out (see leech.h). Cards due for review come first, the longest overdue first,
+ * then unseen cards in a random order, then seen cards drawn at random by weight without replacement (see
+ * weightedSampleKey). A seen card weighs (4 - difficulty) * (1 + log(answered + 1)), so the easier and the more
+ * often answered a card is, the more likely it is drawn, as in the original shuffle.
+ *
+ * @param deck The deck
+ * @param candidates Indices of the cards to choose from, empty for every card
+ * @param n_cards The number of cards to study
+ * @param now The current time
+ * @param mode The study mode, in CLOZE_VIEW only cards with a cloze can be studied
+ * @param rng Draws the random order of unseen cards and the weighted draw of seen cards
+ * @param order Set to the cards to study, in the order to study them
+ */
+void selectStudyCards(const FlashCardDeck &deck,
+                      const std::vector<size_t> &candidates,
+                      size_t n_cards,
+                      int64_t now,
+                      CardViewMode mode,
+                      Rng &rng,
+                      std::vector<size_t> &order);
+
+/**
+ * @brief A deck's cards in the order they come up for study, and the session in progress
+ *
+ */
+class StudyQueue
+{
+public:
+    /**
+     * @brief The file a deck's queue is saved in
+     *
+     * @param deck_file The deck file
+     * @return std::filesystem::path
+     */
+    static std::filesystem::path queueFileFor(const std::filesystem::path &deck_file);
+
+    /**
+     * @brief Build the queue from every card of a deck, with no session in progress
+     * @details Sorting the scheduled cards takes O(n log n).
+     *
+     * @param deck The deck
+     * @param rng Shuffles the new cards
+     */
+    void build(const FlashCardDeck &deck, Rng &rng);
+
+    /**
+     * @brief Load the queue saved for a deck
+     *
+     * @param deck The deck, as read from its file
+     * @return true if a queue was saved for the deck file as it is now
+     */
+    bool load(const FlashCardDeck &deck);
+
+    /**
+     * @brief Save the queue for a deck, after the deck itself was saved
+     *
+     * @param deck The deck
+     * @return true if the queue was saved
+     */
+    bool save(const FlashCardDeck &deck) const;
+
+    /**
+     * @brief Whether a session with this study query and mode was left part way
+     *
+     * @param query The study query
+     * @param mode The study mode
+     * @return true if the session can be resumed
+     */
+    bool resumable(const std::string &query, CardViewMode mode) const;
+
+    /**
+     * @brief The card order of the session
+     *
+     * @return const std::vector<size_t>&
+     */
+    const std::vector<size_t> &sessionOrder() const;
+
+    /**
+     * @brief The position in the session order of the next card to study
+     *
+     * @return size_t
+     */
+    size_t sessionPosition() const;
+
+    /**
+     * @brief Plan a session from the front of the queue: due cards, the longest overdue first, then new cards
+     * @details Takes time in the size of the session, not the deck.
+     *
+     * @param deck The deck
+     * @param n_cards The number of cards to study
+     * @param now The current time
+     * @param mode The study mode, in CLOZE_VIEW only cards with a cloze can be studied
+     * @param order Set to the cards of the session
+     * @return true if there were n_cards due and new cards, otherwise the session needs the rest of the deck ranked
+     */
+    bool planSession(const FlashCardDeck &deck,
+                     size_t n_cards,
+                     int64_t now,
+                     CardViewMode mode,
+                     std::vector<size_t> &order) const;
+
+    /**
+     * @brief Begin a new session
+     *
+     * @param order The card order of the session
+     * @param query The study query it was chosen with
+     * @param mode The study mode it was chosen with
+     */
+    void startSession(const std::vector<size_t> &order, const std::string &query, CardViewMode mode);
+
+    /**
+     * @brief Record how far through the session the user got
+     *
+     * @param position The position in the session order of the next card to study
+     */
+    void setSessionPosition(size_t position);
+
+    /**
+     * @brief Move a reviewed card to its place in the queue
+     * @details O(log n) to find the card, plus moving the cards after it along.
+     *
+     * @param card The card's index
+     * @param old_due The card's due time before the review, 0 if it was new
+     * @param new_due The card's due time after the review
+     */
+    void reschedule(size_t card, int64_t old_due, int64_t new_due);
+
+    /**
+     * @brief The number of scheduled cards
+     *
+     * @return size_t
+     */
+    size_t scheduledCount() const;
+
+    /**
+     * @brief The number of new cards
+     *
+     * @return size_t
+     */
+    size_t newCount() const;
+
+private:
+    std::vector<std::pair<int64_t, size_t>> m_scheduled{}; ///< Due time and card, sorted
+    std::vector<size_t> m_new{};                           ///< New cards in the order they will be studied
+    std::vector<size_t> m_order{};                         ///< The session's card order
+    size_t m_position{0};                                  ///< The next card of the session to study
+    std::string m_query{};                                 ///< The study query of the session
+    CardViewMode m_mode{FORWARD_VIEW};                     ///< The study mode of the session
+};
+
+#endif // STUDY_QUEUE_H
@@ -0,0 +1,311 @@
+/**
+ * @file tag_index.cpp
+ * @author Green Alligators
+ * @brief In-memory index of the cards in a library by tag, difficulty and deck
+ * @version 1.0.0
+ * @date 2024-10-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "tag_index.h"
+#include <algorithm>
+#include <cctype>
+
+
+namespace
+{
+std::string toLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+std::string toUpper(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::toupper(c); });
+    return text;
+}
+
+struct FilterToken
+{
+    /** the token text with any quotes removed */
+    std::string text{};
+    /** true for '(' and ')' */
+    bool paren = false;
+};
+
+// split a filter into words and parentheses, double quotes keep spaces and parentheses inside a word
+bool tokenizeFilter(const std::string &query, std::vector<FilterToken> &tokens)
+{
+    size_t i = 0;
+    while (i < query.size())
+    {
+        char c = query[i];
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            i++;
+        }
+        else if (c == '(' || c == ')')
+        {
+            tokens.push_back({std::string(1, c), true});
+            i++;
+        }
+        else
+        {
+            FilterToken token{};
+            while (i < query.size() && !std::isspace(static_cast<unsigned char>(query[i])) && query[i] != '(' &&
+                   query[i] != ')')
+            {
+                if (query[i] == '"')
+                {
+                    size_t close = query.find('"', i + 1);
+                    if (close == std::string::npos)
+                    {
+                        return false;
+                    }
+                    token.text.append(query, i + 1, close - i - 1);
+                    i = close + 1;
+                }
+                else
+                {
+                    token.text += query[i++];
+                }
+            }
+            tokens.push_back(token);
+        }
+    }
+    return true;
+}
+
+// recursive descent over the tokens, evaluating as it goes
+// or  := and ("OR" and)*
+// and := not (["AND"] not)*
+// not := "NOT" not | "(" or ")" | term
+class FilterParser
+{
+public:
+    FilterParser(const TagIndex &index, const std::vector<FilterToken> &tokens) : m_index(index), m_tokens(tokens)
+    {
+    }
+
+    bool parse(CompressedBitmap &result)
+    {
+        return parseOr(result) && m_pos == m_tokens.size();
+    }
+
+private:
+    bool isKeyword(const char *keyword) const
+    {
+        return m_pos < m_tokens.size() && !m_tokens[m_pos].paren && toUpper(m_tokens[m_pos].text) == keyword;
+    }
+
+    bool isParen(char paren) const
+    {
+        return m_pos < m_tokens.size() && m_tokens[m_pos].paren && m_tokens[m_pos].text[0] == paren;
+    }
+
+    bool parseOr(CompressedBitmap &result)
+    {
+        if (!parseAnd(result))
+        {
+            return false;
+        }
+        while (isKeyword("OR"))
+        {
+            m_pos++;
+            CompressedBitmap rhs{};
+            if (!parseAnd(rhs))
+            {
+                return false;
+            }
+            result = result | rhs;
+        }
+        return true;
+    }
+
+    bool parseAnd(CompressedBitmap &result)
+    {
+        if (!parseNot(result))
+        {
+            return false;
+        }
+        while (m_pos < m_tokens.size() && !isParen(')') && !isKeyword("OR"))
+        {
+            if (isKeyword("AND"))
+            {
+                m_pos++;
+            }
+            CompressedBitmap rhs{};
+            if (!parseNot(rhs))
+            {
+                return false;
+            }
+            result = result & rhs;
+        }
+        return true;
+    }
+
+    bool parseNot(CompressedBitmap &result)
+    {
+        if (m_pos >= m_tokens.size())
+        {
+            return false;
+        }
+        if (isKeyword("NOT"))
+        {
+            m_pos++;
+            CompressedBitmap operand{};
+            if (!parseNot(operand))
+            {
+                return false;
+            }
+            result = m_index.all().andNot(operand);
+            return true;
+        }
+        if (isParen('('))
+        {
+            m_pos++;
+            if (!parseOr(result) || !isParen(')'))
+            {
+                return false;
+            }
+            m_pos++;
+            return true;
+        }
+        if (m_tokens[m_pos].paren)
+        {
+            return false;
+        }
+        return parseTerm(m_tokens[m_pos++].text, result);
+    }
+
+    bool parseTerm(const std::string &term, CompressedBitmap &result)
+    {
+        size_t colon = term.find(':');
+        if (colon == std::string::npos)
+        {
+            return false;
+        }
+        std::string key = toLower(term.substr(0, colon));
+        std::string value = term.substr(colon + 1);
+        if (key == "tag")
+        {
+            result = m_index.tagged(value);
+        }
+        else if (key == "deck")
+        {
+            result = m_index.inDeck(value);
+        }
+        else if (key == "difficulty")
+        {
+            std::string upper = toUpper(value);
+            CardDifficulty difficulty = strToCardDifficulty(upper);
+            if (difficulty == UNKNOWN && upper != "UNKNOWN")
+            {
+                return false;
+            }
+            result = m_index.withDifficulty(difficulty);
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    const TagIndex &m_index;
+    const std::vector<FilterToken> &m_tokens;
+    size_t m_pos{0};
+};
+} // namespace
+
+
+TagIndex::TagIndex(const std::vector<FlashCardDeck> &decks)
+{
+    build(decks);
+}
+
+void TagIndex::build(const std::vector<FlashCardDeck> &decks)
+{
+    m_cards.clear();
+    m_nDecks = 0;
+    m_tags.clear();
+    m_decks.clear();
+    m_difficulties.fill(CompressedBitmap{});
+    m_all = CompressedBitmap{};
+    for (const FlashCardDeck &deck : decks)
+    {
+        addDeck(deck);
+    }
+}
+
+void TagIndex::addDeck(const FlashCardDeck &deck)
+{
+    // ids are handed out in increasing order so every bitmap is built by appending
+    uint32_t d = m_nDecks++;
+    uint32_t first = static_cast<uint32_t>(m_cards.size());
+    uint32_t id = first;
+    for (uint32_t c = 0; c < deck.cards.size(); ++c, ++id)
+    {
+        const FlashCard &card = deck.cards[c];
+        m_cards.push_back({d, c});
+        m_difficulties[card.difficulty].add(id);
+        for (const std::string &tag : card.tags)
+        {
+            m_tags[toLower(tag)].add(id);
+        }
+    }
+    m_all.addRange(first, id);
+    m_decks[toLower(deck.name)].addRange(first, id);
+    for (const std::string &tag : deck.tags)
+    {
+        m_tags[toLower(tag)].addRange(first, id);
+    }
+}
+
+const CompressedBitmap &TagIndex::tagged(const std::string &tag) const
+{
+    auto found = m_tags.find(toLower(tag));
+    return found == m_tags.end() ? m_none : found->second;
+}
+
+const CompressedBitmap &TagIndex::withDifficulty(CardDifficulty difficulty) const
+{
+    return m_difficulties[difficulty];
+}
+
+const CompressedBitmap &TagIndex::inDeck(const std::string &name) const
+{
+    auto found = m_decks.find(toLower(name));
+    return found == m_decks.end() ? m_none : found->second;
+}
+
+std::vector<std::string> TagIndex::tagNames() const
+{
+    std::vector<std::string> names;
+    names.reserve(m_tags.size());
+    for (const auto &[tag, cards] : m_tags)
+    {
+        names.push_back(tag);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+bool TagIndex::filter(const std::string &query, CompressedBitmap &result) const
+{
+    std::vector<FilterToken> tokens;
+    if (!tokenizeFilter(query, tokens))
+    {
+        return false;
+    }
+    FilterParser parser{*this, tokens};
+    CompressedBitmap matches{};
+    if (!parser.parse(matches))
+    {
+        return false;
+    }
+    result = std::move(matches);
+    return true;
+}
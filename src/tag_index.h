@@ -0,0 +1,158 @@
+/**
+ * @file tag_index.h
+ * @author Green Alligators
+ * @brief In-memory index of the cards in a library by tag, difficulty and deck
+ * @details Every card in the indexed decks gets an id, numbered deck by deck in card order. Each tag, difficulty
+ * and deck maps to a CompressedBitmap of the ids it applies to, so a filter is answered by combining a few bitmaps
+ * instead of visiting every card. A deck's tags apply to all of its cards. The study filter keeps one in its
+ * CardColumns and answers its difficulty and tag comparisons from it, see card_query.h.
+ *
+ * Filters are written as terms joined with AND, OR and NOT, with parentheses for grouping:
+ * - tag:geography
+ * - difficulty:HARD
+ * - deck:"World capitals"
+ *
+ * Terms next to each other without an operator are ANDed. Keywords, tags and deck names are not case sensitive.
+ *
+ * @version 1.0.0
+ * @date 2024-10-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef TAG_INDEX_H
+#define TAG_INDEX_H
+
+#include "bitmap.h"
+#include "deck.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The position of an indexed card
+ *
+ */
+struct CardRef
+{
+    /** index of the deck in the indexed vector */
+    uint32_t deck{};
+    /** index of the card within its deck */
+    uint32_t card{};
+};
+
+/**
+ * @brief Maps tags, difficulties and decks to the cards they apply to
+ *
+ */
+class TagIndex
+{
+public:
+    TagIndex() = default;
+
+    /**
+     * @brief Construct an index of the cards in some decks
+     *
+     * @param decks The decks to index
+     */
+    explicit TagIndex(const std::vector<FlashCardDeck> &decks);
+
+    /**
+     * @brief Replace the contents of the index with the cards of some decks
+     *
+     * @param decks The decks to index
+     */
+    void build(const std::vector<FlashCardDeck> &decks);
+
+    /**
+     * @brief Index the cards of one more deck, giving them the next ids
+     *
+     * @param deck The deck, it gets the next deck index
+     */
+    void addDeck(const FlashCardDeck &deck);
+
+    /**
+     * @brief The number of indexed cards
+     *
+     * @return size_t
+     */
+    size_t size() const
+    {
+        return m_cards.size();
+    }
+
+    /**
+     * @brief Where the card with an id is
+     *
+     * @param id A card id less than size()
+     * @return CardRef
+     */
+    CardRef cardRef(uint32_t id) const
+    {
+        return m_cards[id];
+    }
+
+    /**
+     * @brief The cards with a tag, on the card or its deck
+     *
+     * @param tag The tag
+     * @return const CompressedBitmap& Empty if no card has the tag
+     */
+    const CompressedBitmap &tagged(const std::string &tag) const;
+
+    /**
+     * @brief The cards with a difficulty
+     *
+     * @param difficulty The difficulty
+     * @return const CompressedBitmap&
+     */
+    const CompressedBitmap &withDifficulty(CardDifficulty difficulty) const;
+
+    /**
+     * @brief The cards in the decks with a name
+     *
+     * @param name The deck name
+     * @return const CompressedBitmap& Empty if there is no such deck
+     */
+    const CompressedBitmap &inDeck(const std::string &name) const;
+
+    /**
+     * @brief Every indexed card
+     *
+     * @return const CompressedBitmap&
+     */
+    const CompressedBitmap &all() const
+    {
+        return m_all;
+    }
+
+    /**
+     * @brief The names of all tags in the index, sorted
+     *
+     * @return std::vector<std::string>
+     */
+    std::vector<std::string> tagNames() const;
+
+    /**
+     * @brief Find the cards matching a filter
+     *
+     * @param query The filter, e.g. "tag:geography AND difficulty:HARD"
+     * @param result Set to the matching cards when the filter is valid
+     * @return true if the filter was understood
+     */
+    bool filter(const std::string &query, CompressedBitmap &result) const;
+
+private:
+    std::vector<CardRef> m_cards;                              ///< Location of each card by id
+    uint32_t m_nDecks{0};                                      ///< Decks indexed
+    std::unordered_map<std::string, CompressedBitmap> m_tags;  ///< Cards by lower case tag
+    std::unordered_map<std::string, CompressedBitmap> m_decks; ///< Cards by lower case deck name
+    std::array<CompressedBitmap, 4> m_difficulties;            ///< Cards by CardDifficulty
+    CompressedBitmap m_all;                                    ///< All cards
+    CompressedBitmap m_none;                                   ///< Returned for unknown tags and decks
+};
+
+#endif // TAG_INDEX_H
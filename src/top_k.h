@@ -0,0 +1,128 @@
+/**
+ * @file top_k.h
+ * @author Green Alligators
+ * @brief Selection of the k items with the smallest keys
+ * @details Items are offered one at a time and only the best k are kept, in a max-heap so the worst of them is
+ * the one to compare against and replace. Choosing k of n items takes O(n log k) time and O(k) memory, the items
+ * that are not chosen are never stored or sorted.
+ *
+ * @version 1.0.0
+ * @date 2024-10-29
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Keeps the k items with the smallest keys offered to it
+ *
+ * @tparam Key Ordered by operator<, smaller keys are better
+ */
+template <typename Key>
+class TopK
+{
+public:
+    /**
+     * @brief Construct an empty selection
+     *
+     * @param k The number of items to keep
+     */
+    explicit TopK(size_t k) : m_k(k)
+    {
+        m_heap.reserve(k);
+    }
+
+    /**
+     * @brief Offer an item, it is kept if its key is among the k smallest so far
+     *
+     * @param key The item's key
+     * @param item The item, usually an index
+     */
+    void offer(const Key &key, size_t item)
+    {
+        if (m_heap.size() < m_k)
+        {
+            m_heap.push_back(Entry{key, item});
+            std::push_heap(m_heap.begin(), m_heap.end(), worseFirst);
+        }
+        else if (m_k > 0 && key < m_heap.front().key)
+        {
+            // replace the worst item kept
+            std::pop_heap(m_heap.begin(), m_heap.end(), worseFirst);
+            m_heap.back() = Entry{key, item};
+            std::push_heap(m_heap.begin(), m_heap.end(), worseFirst);
+        }
+    }
+
+    /**
+     * @brief The number of items kept
+     *
+     * @return size_t At most k
+     */
+    size_t size() const
+    {
+        return m_heap.size();
+    }
+
+    /**
+     * @brief Take the items kept, leaving the selection empty
+     *
+     * @return std::vector<size_t> The items in order of their keys, smallest first
+     */
+    std::vector<size_t> take()
+    {
+        std::vector<size_t> items;
+        take(items);
+        return items;
+    }
+
+    /**
+     * @brief Take the items kept into a vector, reusing its memory, leaving the selection empty
+     *
+     * @param items Set to the items in order of their keys, smallest first
+     */
+    void take(std::vector<size_t> &items)
+    {
+        std::sort_heap(m_heap.begin(), m_heap.end(), worseFirst);
+        items.clear();
+        items.reserve(m_heap.size());
+        for (const Entry &entry : m_heap)
+        {
+            items.push_back(entry.item);
+        }
+        m_heap.clear();
+    }
+
+private:
+    /**
+     * @brief An item and its key
+     *
+     */
+    struct Entry
+    {
+        Key key;
+        size_t item;
+    };
+
+    /**
+     * @brief Heap order putting the largest key on top
+     *
+     * @return true if a's key is smaller than b's
+     */
+    static bool worseFirst(const Entry &a, const Entry &b)
+    {
+        return a.key < b.key;
+    }
+
+    size_t m_k;                ///< The number of items to keep
+    std::vector<Entry> m_heap; ///< Max-heap of the items kept
+};
+
+#endif // TOP_K_H
@@ -0,0 +1,110 @@
+/**
+ * @file utf8.h
+ * @author Green Alligators
+ * @brief Validation, repair and normalisation of UTF-8 deck text
+ * @details Deck files are plain text and may come from anywhere, so text is checked as it is loaded. Invalid byte
+ * sequences are replaced with U+FFFD and letters written as a base letter followed by a combining accent are
+ * composed into their precomposed form, so the same word always has the same bytes for display and search.
+ *
+ * Almost all deck text is ASCII, which is checked eight bytes at a time and needs no further work, so the checks
+ * add little to the cost of parsing.
+ *
+ * Composition covers the Latin letters of Unicode (U+00C0 to U+024F and U+1E00 to U+1EFF), which is where mixed
+ * normalisation forms show up in practice. It is not a complete implementation of NFC.
+ *
+ * @version 1.0.0
+ * @date 2024-10-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief What was changed while cleaning some text
+ *
+ */
+struct Utf8Report
+{
+    /** invalid byte sequences replaced with U+FFFD */
+    size_t invalid_sequences{0};
+    /** base letter and accent pairs composed into one character */
+    size_t compositions{0};
+
+    /**
+     * @brief Whether the text was changed
+     *
+     * @return true if anything was repaired or composed
+     */
+    bool changed() const
+    {
+        return invalid_sequences > 0 || compositions > 0;
+    }
+
+    Utf8Report &operator+=(const Utf8Report &other)
+    {
+        invalid_sequences += other.invalid_sequences;
+        compositions += other.compositions;
+        return *this;
+    }
+};
+
+/**
+ * @brief The length of the ASCII prefix of some text
+ *
+ * @param data The text
+ * @param size The number of bytes
+ * @return size_t The index of the first byte that is not ASCII, or size if there is none
+ */
+size_t asciiPrefixLength(const char *data, size_t size);
+
+/**
+ * @brief Find the first invalid UTF-8 sequence
+ * @details Overlong encodings, surrogates and code points above U+10FFFF are invalid.
+ *
+ * @param text The text
+ * @return size_t The byte offset of the first invalid sequence, or std::string::npos if the text is valid
+ */
+size_t findInvalidUtf8(const std::string &text);
+
+/**
+ * @brief Whether some text is valid UTF-8
+ *
+ * @param text The text
+ * @return true if the text is valid
+ */
+bool isValidUtf8(const std::string &text);
+
+/**
+ * @brief Replace every invalid sequence with U+FFFD
+ * @details Each maximal invalid subpart is replaced by a single replacement character, as recommended by the
+ * Unicode standard.
+ *
+ * @param text The text to repair
+ * @return size_t The number of sequences replaced
+ */
+size_t repairUtf8(std::string &text);
+
+/**
+ * @brief Compose base letters followed by combining accents into precomposed letters
+ *
+ * @param text Valid UTF-8 text
+ * @return size_t The number of compositions made
+ */
+size_t composeUtf8(std::string &text);
+
+/**
+ * @brief Repair and compose some text in place
+ * @details ASCII text is returned unchanged after a single fast scan.
+ *
+ * @param text The text to clean
+ * @return Utf8Report What was changed
+ */
+Utf8Report sanitizeUtf8(std::string &text);
+
+#endif // UTF8_H
@@ -230,18 +230,22 @@ std::vector<std::string> convertAsciiArtToLines(const std::string &asciiArt)
 
 std::string getFirstPhrase(const std::vector<std::pair<std::string, int>> &phrases)
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-
-    std::vector<int> weights;
+    uint64_t total = 0;
     for (const auto &pair : phrases)
     {
-        weights.push_back(pair.second);
+        total += static_cast<uint64_t>((std::max)(pair.second, 0));
     }
-
-    std::discrete_distribution<> dist(weights.begin(), weights.end());
-
-    return phrases[dist(gen)].first;
+    uint64_t pick = rngStream(QUOTE_STREAM).below(total);
+    for (const auto &pair : phrases)
+    {
+        uint64_t weight = static_cast<uint64_t>((std::max)(pair.second, 0));
+        if (pick < weight)
+        {
+            return pair.first;
+        }
+        pick -= weight;
+    }
+    return phrases.empty() ? std::string{} : phrases.back().first;
 }
 
 std::string getRandomPositiveQuote()
@@ -12,12 +12,12 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include "rng.h"
 #include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <random>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -0,0 +1,75 @@
+/**
+ * @file varint.cpp
+ * @author Green Alligators
+ * @brief Variable length integers for binary deck files
+ * @version 1.0.0
+ * @date 2024-10-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "varint.h"
+
+
+void putVarint(std::string &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void putBytes(std::string &out, std::string_view bytes)
+{
+    putVarint(out, bytes.size());
+    out.append(bytes);
+}
+
+bool getVarint(std::string_view &in, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && !in.empty(); shift += 7)
+    {
+        uint8_t c = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<uint64_t>(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool getVarint(std::istream &in, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int c = in.get();
+        if (c == std::char_traits<char>::eof())
+        {
+            return false;
+        }
+        value |= static_cast<uint64_t>(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool getBytes(std::string_view &in, std::string &out)
+{
+    uint64_t len{};
+    if (!getVarint(in, len) || len > in.size())
+    {
+        return false;
+    }
+    out.assign(in.substr(0, static_cast<size_t>(len)));
+    in.remove_prefix(static_cast<size_t>(len));
+    return true;
+}
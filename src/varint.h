@@ -0,0 +1,66 @@
+/**
+ * @file varint.h
+ * @author Green Alligators
+ * @brief Variable length integers for binary deck files
+ * @details Integers are written 7 bits at a time, lowest bits first, with the top bit of each byte set when more
+ * bytes follow, so small values take a single byte.
+ *
+ * @version 1.0.0
+ * @date 2024-10-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Append a varint
+ *
+ * @param out The bytes to append to
+ * @param value The value
+ */
+void putVarint(std::string &out, uint64_t value);
+
+/**
+ * @brief Append a varint length followed by the bytes
+ *
+ * @param out The bytes to append to
+ * @param bytes The bytes
+ */
+void putBytes(std::string &out, std::string_view bytes);
+
+/**
+ * @brief Read a varint from the front of some bytes
+ *
+ * @param in The bytes, the varint is removed from the front
+ * @param value Set to the value
+ * @return true if a complete varint was read
+ */
+bool getVarint(std::string_view &in, uint64_t &value);
+
+/**
+ * @brief Read a varint from a stream
+ *
+ * @param in The stream
+ * @param value Set to the value
+ * @return true if a complete varint was read
+ */
+bool getVarint(std::istream &in, uint64_t &value);
+
+/**
+ * @brief Read a varint length and that many bytes from the front of some bytes
+ *
+ * @param in The bytes, the length and bytes are removed from the front
+ * @param out Set to the bytes
+ * @return true if the length and all the bytes were there
+ */
+bool getBytes(std::string_view &in, std::string &out);
+
+#endif // VARINT_H
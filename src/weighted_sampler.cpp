@@ -0,0 +1,160 @@
+/**
+ * @file weighted_sampler.cpp
+ * @author Green Alligators
+ * @brief Random sampling of items by weight, with or without replacement
+ * @version 1.0.0
+ * @date 2024-10-29
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "weighted_sampler.h"
+#include "top_k.h"
+#include <cmath>
+#include <limits>
+
+
+double weightedSampleKey(double weight, double u)
+{
+    if (!(weight > 0))
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    // -log(1 - u) so that u = 0 gives a key of 0 rather than infinity
+    return -std::log1p(-u) / weight;
+}
+
+
+WeightedSampler::WeightedSampler(const std::vector<double> &weights)
+{
+    build(weights);
+}
+
+void WeightedSampler::build(const std::vector<double> &weights)
+{
+    size_t n = weights.size();
+    m_weights.assign(weights.begin(), weights.end());
+    m_total = 0;
+    m_maxWeight = 0;
+    m_positive = 0;
+    for (double &weight : m_weights)
+    {
+        if (!(weight > 0) || !std::isfinite(weight))
+        {
+            weight = 0;
+            continue;
+        }
+        m_total += weight;
+        m_maxWeight = (std::max)(m_maxWeight, weight);
+        m_positive++;
+    }
+
+    // Vose's alias method: every column holds at most two items, split so each column has an equal share
+    m_prob.assign(n, 0.0);
+    m_alias.assign(n, 0);
+    m_picked.assign(n, 0);
+    m_sampleNumber = 0;
+    m_small.clear();
+    m_large.clear();
+    if (m_positive == 0)
+    {
+        return;
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        m_prob[i] = m_weights[i] * static_cast<double>(n) / m_total;
+        (m_prob[i] < 1.0 ? m_small : m_large).push_back(static_cast<uint32_t>(i));
+    }
+    while (!m_small.empty() && !m_large.empty())
+    {
+        uint32_t small = m_small.back();
+        uint32_t large = m_large.back();
+        m_small.pop_back();
+        m_alias[small] = large;
+        m_prob[large] -= 1.0 - m_prob[small];
+        if (m_prob[large] < 1.0)
+        {
+            m_large.pop_back();
+            m_small.push_back(large);
+        }
+    }
+    // what is left is only short of 1 by rounding error
+    for (uint32_t i : m_large)
+    {
+        m_prob[i] = 1.0;
+    }
+    for (uint32_t i : m_small)
+    {
+        m_prob[i] = m_weights[i] > 0 ? 1.0 : 0.0;
+        m_alias[i] = i;
+    }
+}
+
+size_t WeightedSampler::size() const
+{
+    return m_weights.size();
+}
+
+size_t WeightedSampler::positiveCount() const
+{
+    return m_positive;
+}
+
+size_t WeightedSampler::draw(Rng &rng) const
+{
+    if (m_positive == 0)
+    {
+        return size();
+    }
+    while (true)
+    {
+        size_t i = static_cast<size_t>(rng.below(size()));
+        size_t item = rng.uniform() < m_prob[i] ? i : m_alias[i];
+        // a zero weight column left over from rounding error is drawn again
+        if (m_weights[item] > 0)
+        {
+            return item;
+        }
+    }
+}
+
+void WeightedSampler::sample(size_t k, Rng &rng, std::vector<size_t> &out)
+{
+    out.clear();
+    k = (std::min)(k, m_positive);
+    if (k == 0)
+    {
+        return;
+    }
+
+    // k items hold at most k * m_maxWeight, while that is under a quarter of the total at least 3 in 4 draws from
+    // the alias table are accepted
+    if (static_cast<double>(k) * m_maxWeight * 4 <= m_total)
+    {
+        if (++m_sampleNumber == 0)
+        {
+            std::fill(m_picked.begin(), m_picked.end(), 0);
+            m_sampleNumber = 1;
+        }
+        while (out.size() < k)
+        {
+            size_t item = draw(rng);
+            if (m_picked[item] != m_sampleNumber)
+            {
+                m_picked[item] = m_sampleNumber;
+                out.push_back(item);
+            }
+        }
+        return;
+    }
+
+    TopK<double> best{k};
+    for (size_t i = 0; i < m_weights.size(); ++i)
+    {
+        if (m_weights[i] > 0)
+        {
+            best.offer(weightedSampleKey(m_weights[i], rng.uniform()), i);
+        }
+    }
+    best.take(out);
+}
@@ -0,0 +1,111 @@
+/**
+ * @file weighted_sampler.h
+ * @author Green Alligators
+ * @brief Random sampling of items by weight, with or without replacement
+ * @details A WeightedSampler is built once from a list of weights in O(n) and can then be drawn from any number of
+ * times without allocating:
+ *
+ * - draw() picks one item with replacement in O(1) from an alias table (Vose's method).
+ * - sample() picks k distinct items, each draw choosing from the items not yet picked by weight. When the k
+ *   items can only hold a small share of the total weight, draws come from the alias table and items already
+ *   picked are rejected. Otherwise each item is given the key -log(u) / weight for a uniform u and the k smallest
+ *   keys are kept (Efraimidis and Spirakis), one pass over the weights in O(n log k). Both give the same
+ *   distribution.
+ *
+ * weightedSampleKey() gives the Efraimidis and Spirakis key on its own, so weighted items can be mixed into any
+ * top-k selection without building a sampler.
+ *
+ * Items with a weight of zero or less are never picked.
+ *
+ * @version 1.0.0
+ * @date 2024-10-29
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifndef WEIGHTED_SAMPLER_H
+#define WEIGHTED_SAMPLER_H
+
+#include "rng.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The key of a weighted item, the items with the k smallest keys are a sample of k without replacement
+ *
+ * @param weight The item's weight
+ * @param u A uniform random number in [0, 1)
+ * @return double The key, infinity for a weight of zero or less
+ */
+double weightedSampleKey(double weight, double u);
+
+/**
+ * @brief Draws items at random in proportion to their weights
+ *
+ */
+class WeightedSampler
+{
+public:
+    WeightedSampler() = default;
+
+    /**
+     * @brief Construct a sampler over some weights
+     *
+     * @param weights The weight of each item
+     */
+    explicit WeightedSampler(const std::vector<double> &weights);
+
+    /**
+     * @brief Replace the weights, reusing the memory of the previous ones
+     *
+     * @param weights The weight of each item
+     */
+    void build(const std::vector<double> &weights);
+
+    /**
+     * @brief The number of items
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+    /**
+     * @brief The number of items that can be picked, those with a positive weight
+     *
+     * @return size_t
+     */
+    size_t positiveCount() const;
+
+    /**
+     * @brief Pick one item with replacement
+     *
+     * @param rng The random number generator
+     * @return size_t The item, or size() if no item can be picked
+     */
+    size_t draw(Rng &rng) const;
+
+    /**
+     * @brief Pick distinct items without replacement
+     *
+     * @param k The number of items to pick, fewer are picked if fewer have a positive weight
+     * @param rng The random number generator
+     * @param out Set to the items in the order they were picked, its memory is reused
+     */
+    void sample(size_t k, Rng &rng, std::vector<size_t> &out);
+
+private:
+    std::vector<double> m_weights;   ///< The weight of each item, 0 for those that cannot be picked
+    std::vector<double> m_prob;      ///< Chance of keeping each column of the alias table
+    std::vector<uint32_t> m_alias;   ///< The item drawn when a column is not kept
+    std::vector<uint32_t> m_small;   ///< Scratch space for building the table
+    std::vector<uint32_t> m_large;   ///< Scratch space for building the table
+    std::vector<uint32_t> m_picked;  ///< Sample number each item was last picked in, for rejection
+    uint32_t m_sampleNumber{0};      ///< Increases with each call to sample
+    double m_total{0};               ///< Sum of the positive weights
+    double m_maxWeight{0};           ///< The largest weight
+    size_t m_positive{0};            ///< The number of positive weights
+};
+
+#endif // WEIGHTED_SAMPLER_H
@@ -0,0 +1,147 @@
+#include "card_query.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+static std::vector<FlashCardDeck> makeQueryDecks()
+{
+    FlashCard tagged{"Capital of France?", "Paris", HARD, 4};
+    tagged.tags = {"Geography"};
+    FlashCardDeck cosc{"COSC345",
+                       "",
+                       std::vector<FlashCard>{FlashCard("q0", "a0", EASY, 0),
+                                              FlashCard("q1", "a1", MEDIUM, 1),
+                                              FlashCard("q2", "a2", HARD, 5),
+                                              FlashCard("q3", "a3", UNKNOWN, 2)}};
+    cosc.tags = {"computing"};
+    FlashCardDeck other{"World quiz", "", std::vector<FlashCard>{tagged, FlashCard("q5", "a5", MEDIUM, 0)}};
+    return {cosc, other};
+}
+
+static std::vector<uint32_t> runQuery(const CardColumns &columns, const std::string &text)
+{
+    CardQuery query{};
+    std::string error{};
+    REQUIRE(CardQuery::compile(text, columns, query, error));
+    return query.select(columns);
+}
+
+TEST_CASE("Glob matching")
+{
+    REQUIRE(globMatch("cosc*", "COSC345"));
+    REQUIRE(globMatch("*345", "cosc345"));
+    REQUIRE(globMatch("c?sc*5", "cosc345"));
+    REQUIRE(globMatch("*", ""));
+    REQUIRE(globMatch("a*b*c", "aXXbYYbc"));
+    REQUIRE_FALSE(globMatch("cosc", "cosc345"));
+    REQUIRE_FALSE(globMatch("?", ""));
+    REQUIRE_FALSE(globMatch("a*b", "aXXc"));
+}
+
+TEST_CASE("Card columns")
+{
+    CardColumns columns = CardColumns::fromDecks(makeQueryDecks());
+    REQUIRE(columns.size() == 6);
+    REQUIRE(columns.deck_names == std::vector<std::string>{"COSC345", "World quiz"});
+    REQUIRE(columns.deck[4] == 1);
+    REQUIRE(columns.card[4] == 0);
+    REQUIRE(columns.answered[2] == 5);
+    // rows are the card ids of the index
+    REQUIRE(columns.index.size() == 6);
+    REQUIRE(columns.index.withDifficulty(HARD).toVector() == std::vector<uint32_t>{2, 4});
+    REQUIRE(columns.index.tagNames() == std::vector<std::string>{"computing", "geography"});
+    // deck tags apply to each card of the deck
+    REQUIRE(columns.index.tagged("computing").toVector() == std::vector<uint32_t>{0, 1, 2, 3});
+    REQUIRE(columns.index.tagged("geography").toVector() == std::vector<uint32_t>{4});
+}
+
+TEST_CASE("Compiled card queries")
+{
+    CardColumns columns = CardColumns::fromDecks(makeQueryDecks());
+
+    REQUIRE(runQuery(columns, "") == std::vector<uint32_t>{0, 1, 2, 3, 4, 5});
+    REQUIRE(runQuery(columns, "difficulty>=MEDIUM") == std::vector<uint32_t>{1, 2, 4, 5});
+    REQUIRE(runQuery(columns, "difficulty = unknown") == std::vector<uint32_t>{3});
+    REQUIRE(runQuery(columns, "difficulty<2") == std::vector<uint32_t>{0, 3});
+    REQUIRE(runQuery(columns, "answered<3") == std::vector<uint32_t>{0, 1, 3, 5});
+    REQUIRE(runQuery(columns, "difficulty>=MEDIUM and answered<3 and deck~\"cosc*\"") == std::vector<uint32_t>{1});
+    REQUIRE(runQuery(columns, "deck=\"world quiz\"") == std::vector<uint32_t>{4, 5});
+    REQUIRE(runQuery(columns, "deck!~cosc*") == std::vector<uint32_t>{4, 5});
+    REQUIRE(runQuery(columns, "tag=geography or answered=5") == std::vector<uint32_t>{2, 4});
+    REQUIRE(runQuery(columns, "tag~comp*") == std::vector<uint32_t>{0, 1, 2, 3});
+    REQUIRE(runQuery(columns, "tag!=computing") == std::vector<uint32_t>{4, 5});
+    REQUIRE(runQuery(columns, "not (difficulty=HARD or answered=0)") == std::vector<uint32_t>{1, 3});
+    REQUIRE(runQuery(columns, "deck=missing").empty());
+
+    CardQuery query{};
+    std::string error{};
+    REQUIRE_FALSE(CardQuery::compile("difficulty>=", columns, query, error));
+    REQUIRE_FALSE(error.empty());
+    REQUIRE_FALSE(CardQuery::compile("colour=red", columns, query, error));
+    REQUIRE(error == "Unknown field 'colour'");
+    REQUIRE_FALSE(CardQuery::compile("answered<lots", columns, query, error));
+    // values no card can have
+    REQUIRE_FALSE(CardQuery::compile("difficulty=4", columns, query, error));
+    REQUIRE(error == "Difficulty must be UNKNOWN, EASY, MEDIUM, HARD or 0 to 3, not '4'");
+    REQUIRE_FALSE(CardQuery::compile("difficulty>-1", columns, query, error));
+    REQUIRE_FALSE(CardQuery::compile("answered>=-2", columns, query, error));
+    REQUIRE(error == "The times a card was answered can not be negative, not '-2'");
+    REQUIRE(runQuery(columns, "difficulty=3") == runQuery(columns, "difficulty=HARD"));
+    REQUIRE_FALSE(CardQuery::compile("deck<3", columns, query, error));
+    REQUIRE_FALSE(CardQuery::compile("answered~3", columns, query, error));
+    REQUIRE_FALSE(CardQuery::compile("(answered<3", columns, query, error));
+    REQUIRE_FALSE(CardQuery::compile("answered<3)", columns, query, error));
+    REQUIRE_FALSE(CardQuery::compile("answered<3 and", columns, query, error));
+    REQUIRE_FALSE(CardQuery::compile("deck=\"open", columns, query, error));
+}
+
+TEST_CASE("Queries over many blocks")
+{
+    // enough cards to cross several evaluation blocks with a partial last block
+    FlashCardDeck big{"big", "", std::vector<FlashCard>{}};
+    for (int i = 0; i < 5000; ++i)
+    {
+        big.cards.push_back(FlashCard("q", "a", static_cast<CardDifficulty>(i % 4), i % 7));
+    }
+    CardColumns columns = CardColumns::fromDecks({big});
+    std::vector<uint32_t> rows = runQuery(columns, "difficulty=HARD and (answered>4 or answered=0)");
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < 5000; ++i)
+    {
+        if (i % 4 == HARD && (i % 7 > 4 || i % 7 == 0))
+        {
+            expected.push_back(i);
+        }
+    }
+    REQUIRE(rows == expected);
+
+    // a library past the first 65536 card ids, with tags on some of the cards
+    FlashCardDeck tagged{"tagged", "", std::vector<FlashCard>{}};
+    for (int i = 0; i < 70000; ++i)
+    {
+        tagged.cards.push_back(FlashCard("q", "a", static_cast<CardDifficulty>(i % 4), 0));
+        if (i % 3 == 0)
+        {
+            tagged.cards.back().tags = {"third"};
+        }
+    }
+    CardColumns library = CardColumns::fromDecks({big, tagged});
+    rows = runQuery(library, "tag=third and difficulty>=MEDIUM");
+    expected.clear();
+    for (uint32_t i = 0; i < 70000; ++i)
+    {
+        if (i % 3 == 0 && i % 4 >= MEDIUM)
+        {
+            expected.push_back(5000 + i);
+        }
+    }
+    REQUIRE(rows == expected);
+
+    std::vector<size_t> indices;
+    std::string error{};
+    REQUIRE(queryDeckCards(big, "answered=6 and difficulty=EASY", indices, error));
+    REQUIRE(indices.size() == 5000 / 28 + 1);
+    REQUIRE(indices[0] == 13);
+    REQUIRE_FALSE(queryDeckCards(big, "answered=", indices, error));
+}
@@ -0,0 +1,70 @@
+#include "card_view.h"
+#include "deck.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+TEST_CASE("Cloze spans")
+{
+    REQUIRE(countClozeSpans("") == 0);
+    REQUIRE(countClozeSpans("no spans here") == 0);
+    REQUIRE(countClozeSpans("{{one}}") == 1);
+    REQUIRE(countClozeSpans("{{one}} and {{two::hint}}") == 2);
+    REQUIRE(countClozeSpans("unclosed {{span") == 0);
+    REQUIRE(countClozeSpans("{{a}} then unclosed {{b") == 1);
+
+    std::string text = "{{Canberra::city}} is the capital of {{Australia}}.";
+    REQUIRE(renderCloze(text) == "Canberra is the capital of Australia.");
+    REQUIRE(renderCloze(text, 0) == "[city] is the capital of Australia.");
+    REQUIRE(renderCloze(text, 1) == "Canberra is the capital of [...].");
+    REQUIRE(renderCloze("unclosed {{span", 0) == "unclosed {{span");
+}
+
+TEST_CASE("Card views")
+{
+    FlashCard card{"What is the capital of Australia?", "Canberra", MEDIUM, 0};
+
+    SECTION("forward and reverse")
+    {
+        CardView forward{card, FORWARD_VIEW};
+        REQUIRE(forward.question() == card.question);
+        REQUIRE(forward.answer() == card.answer);
+
+        CardView reverse{card, REVERSE_VIEW};
+        REQUIRE(reverse.question() == "Canberra");
+        REQUIRE(reverse.answer() == "What is the capital of Australia?");
+        REQUIRE(&reverse.card() == &card);
+        REQUIRE(reverse.studiable());
+    }
+
+    SECTION("cards without spans cannot be studied as cloze")
+    {
+        REQUIRE_FALSE(CardView(card, CLOZE_VIEW).studiable());
+    }
+
+    SECTION("cloze in the question")
+    {
+        FlashCard cloze{"{{Canberra}} is the capital of {{Australia::country}}", "", EASY, 0};
+        CardView first = CardView::forStudy(cloze, CLOZE_VIEW);
+        REQUIRE(first.studiable());
+        REQUIRE(first.question() == "[...] is the capital of Australia");
+        REQUIRE(first.answer() == "Canberra is the capital of Australia");
+
+        // each review blanks the next span
+        cloze.n_times_answered = 1;
+        REQUIRE(CardView::forStudy(cloze, CLOZE_VIEW).question() == "Canberra is the capital of [country]");
+        cloze.n_times_answered = 2;
+        REQUIRE(CardView::forStudy(cloze, CLOZE_VIEW).question() == "[...] is the capital of Australia");
+
+        // marked cards read normally in the other views
+        REQUIRE(CardView(cloze, FORWARD_VIEW).question() == "Canberra is the capital of Australia");
+    }
+
+    SECTION("cloze in the answer keeps the question for context")
+    {
+        FlashCard cloze{"Where is the Opera House?", "In {{Sydney}}, Australia", EASY, 0};
+        CardView view{cloze, CLOZE_VIEW};
+        REQUIRE(view.question() == "Where is the Opera House? In [...], Australia");
+        REQUIRE(view.answer() == "In Sydney, Australia");
+    }
+}
@@ -0,0 +1,195 @@
+#include "deck_backup.h"
+#include "deck.h"
+#include "deck_loader.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// a fresh directory with no backup store in it
+static fs::path makeBackupTestDir(const std::string &name)
+{
+    fs::path dir = fs::temp_directory_path() / name;
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+static void writeFile(const fs::path &path, const std::string &contents)
+{
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    out << contents;
+}
+
+// a large deck file so it is split into many chunks
+static std::string makeDeckText(size_t n_cards)
+{
+    std::string text = "Backup deck\n";
+    for (size_t i = 0; i < n_cards; ++i)
+    {
+        text += "Q: question number " + std::to_string(i) + " about item " + std::to_string(i * 7919 % 1000) + "\n";
+        text += "A: answer number " + std::to_string(i) + "\nD: MEDIUM\nN: " + std::to_string(i % 5) + "\n-\n";
+    }
+    return text;
+}
+
+TEST_CASE("Content-defined chunking")
+{
+    std::string data = makeDeckText(5000);
+    std::vector<std::pair<size_t, size_t>> chunks = chunkBoundaries(data);
+    REQUIRE(chunks.size() > 1);
+
+    // chunks cover the data exactly and respect the size limits
+    size_t pos = 0;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        REQUIRE(chunks[i].first == pos);
+        REQUIRE(chunks[i].second <= DeckBackupStore::maxChunkSize);
+        if (i + 1 < chunks.size())
+        {
+            REQUIRE(chunks[i].second >= DeckBackupStore::minChunkSize);
+        }
+        pos += chunks[i].second;
+    }
+    REQUIRE(pos == data.size());
+
+    REQUIRE(chunkBoundaries("").empty());
+    REQUIRE(chunkBoundaries("tiny").size() == 1);
+
+    SECTION("An insertion only changes the chunks around it")
+    {
+        std::string edited = data;
+        edited.insert(data.size() / 2, "Q: a new card\nA: inserted\nD: EASY\nN: 0\n-\n");
+        std::vector<std::pair<size_t, size_t>> edited_chunks = chunkBoundaries(edited);
+
+        std::vector<std::string> original;
+        for (const auto &[offset, len] : chunks)
+        {
+            original.push_back(data.substr(offset, len));
+        }
+        size_t n_shared{0};
+        for (const auto &[offset, len] : edited_chunks)
+        {
+            if (std::find(original.begin(), original.end(), edited.substr(offset, len)) != original.end())
+            {
+                n_shared++;
+            }
+        }
+        REQUIRE(n_shared + 3 >= edited_chunks.size());
+    }
+}
+
+TEST_CASE("Snapshotting and restoring deck files")
+{
+    fs::path dir = makeBackupTestDir("studydungeon_backup_test");
+    fs::path deck_file = dir / "big.deck";
+    std::string original = makeDeckText(5000);
+    writeFile(deck_file, original);
+
+    DeckBackupStore store{DeckBackupStore::storeDirFor(dir)};
+    uint64_t first = store.snapshotFile(deck_file);
+    REQUIRE(first != 0);
+    size_t n_chunks = store.chunkCount();
+    REQUIRE(n_chunks > 1);
+
+    // an unchanged file does not make a new snapshot
+    REQUIRE(store.snapshotFile(deck_file) == first);
+    REQUIRE(store.listSnapshots("big.deck").size() == 1);
+
+    // a small edit only adds a few chunks
+    std::string edited = original;
+    edited.replace(edited.size() / 3, 8, "CHANGED!");
+    edited += "Q: extra\nA: card\nD: HARD\nN: 0\n-\n";
+    writeFile(deck_file, edited);
+    uint64_t second = store.snapshotFile(deck_file);
+    REQUIRE(second > first);
+    REQUIRE(store.chunkCount() <= n_chunks + 4);
+
+    std::string contents{};
+    REQUIRE(store.readSnapshot(first, contents));
+    REQUIRE(contents == original);
+    REQUIRE(store.readSnapshot(second, contents));
+    REQUIRE(contents == edited);
+
+    // the index is persisted and restores work after the file is gone
+    fs::remove(deck_file);
+    DeckBackupStore reopened{DeckBackupStore::storeDirFor(dir)};
+    std::vector<BackupSnapshot> snapshots = reopened.listSnapshots();
+    REQUIRE(snapshots.size() == 2);
+    REQUIRE(snapshots[0].id == first);
+    REQUIRE(snapshots[1].deck_file == "big.deck");
+    REQUIRE(snapshots[1].size == edited.size());
+
+    BackupSnapshot latest{};
+    REQUIRE(reopened.latestSnapshot("big.deck", latest));
+    REQUIRE(latest.id == second);
+    REQUIRE_FALSE(reopened.latestSnapshot("other.deck", latest));
+
+    REQUIRE(reopened.restoreSnapshot(first, deck_file));
+    REQUIRE(readFileContents(deck_file, contents));
+    REQUIRE(contents == original);
+    REQUIRE_FALSE(reopened.restoreSnapshot(12345, deck_file));
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Saving a deck records a backup")
+{
+    fs::path dir = makeBackupTestDir("studydungeon_backup_save_test");
+    FlashCardDeck deck{"Saved deck", "", std::vector<FlashCard>{FlashCard("q1", "a1", EASY, 0)}};
+    REQUIRE(writeFlashCardDeck(deck, dir / "saved.deck"));
+    deck.cards.push_back(FlashCard("q2", "a2", HARD, 1));
+    REQUIRE(writeFlashCardDeck(deck, dir / "saved.deck"));
+
+    // a save that could not be written is not recorded
+    fs::create_directories(dir / "blocked.deck");
+    REQUIRE_FALSE(writeFlashCardDeck(deck, dir / "blocked.deck"));
+    fs::remove(dir / "blocked.deck");
+
+    DeckBackupStore store{DeckBackupStore::storeDirFor(dir)};
+    std::vector<BackupSnapshot> snapshots = store.listSnapshots("saved.deck");
+    REQUIRE_FALSE(snapshots.empty());
+    REQUIRE(store.listSnapshots("blocked.deck").empty());
+
+    // the store sits next to the decks without being loaded as one
+    REQUIRE(loadFlashCardDecks(dir).size() == 1);
+
+    REQUIRE(store.snapshotLibrary(dir) == 1);
+    std::string contents{};
+    REQUIRE(store.readSnapshot(store.listSnapshots("saved.deck").back().id, contents));
+    REQUIRE(contents == "Saved deck\nV: 2\nQ: q1\nA: a1\nD: EASY\nN: 0\n-\nQ: q2\nA: a2\nD: HARD\nN: 1\n-\n");
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Backups made through other stores are picked up")
+{
+    fs::path dir = makeBackupTestDir("studydungeon_backup_shared_test");
+    writeFile(dir / "a.deck", makeDeckText(10));
+    writeFile(dir / "b.deck", makeDeckText(20));
+    REQUIRE(backupDeckFile(dir / "a.deck") == 1);
+
+    // the kept open store sees the snapshot another store added, so ids are not reused
+    DeckBackupStore other{DeckBackupStore::storeDirFor(dir)};
+    REQUIRE(other.snapshotFile(dir / "b.deck") == 2);
+    writeFile(dir / "a.deck", makeDeckText(30));
+    REQUIRE(backupDeckFile(dir / "a.deck") == 3);
+    REQUIRE(backupDeckFile(dir / "b.deck") == 2);
+
+    DeckBackupStore reopened{DeckBackupStore::storeDirFor(dir)};
+    std::vector<BackupSnapshot> snapshots = reopened.listSnapshots();
+    REQUIRE(snapshots.size() == 3);
+    REQUIRE(snapshots[2].deck_file == "a.deck");
+
+    // a removed store is started again
+    fs::remove_all(DeckBackupStore::storeDirFor(dir));
+    REQUIRE(backupDeckFile(dir / "a.deck") == 1);
+    REQUIRE(DeckBackupStore{DeckBackupStore::storeDirFor(dir)}.listSnapshots().size() == 1);
+
+    fs::remove_all(dir);
+}
@@ -0,0 +1,215 @@
+#include "deck_compress.h"
+#include "deck.h"
+#include "deck_export.h"
+#include "deck_loader.h"
+#include "varint.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// a deck of English-like cards, varied enough that it does not compress better than a real library
+static FlashCardDeck makeWordDeck(size_t n_cards)
+{
+    const std::vector<std::string> words = {
+        "the",     "capital", "of",      "which",    "river",   "flows",     "through", "country", "what",
+        "is",      "largest", "city",    "in",       "year",    "was",       "founded", "by",      "who",
+        "wrote",   "famous",  "novel",   "about",    "war",     "and",       "peace",   "element", "has",
+        "atomic",  "number",  "symbol",  "formula",  "for",     "area",      "circle",  "radius",  "how",
+        "many",    "bones",   "human",   "body",     "speed",   "light",     "vacuum",  "metres",  "second",
+        "painted", "ceiling", "chapel",  "composer", "symphony", "mountain", "highest", "ocean",   "deepest"};
+    std::mt19937 rng{1234};
+    auto sentence = [&](size_t n_words) {
+        std::string text;
+        for (size_t w = 0; w < n_words; ++w)
+        {
+            text += (w == 0 ? "" : " ") + words[rng() % words.size()];
+        }
+        return text;
+    };
+    FlashCardDeck deck{"Word deck", "", std::vector<FlashCard>{}};
+    for (size_t i = 0; i < n_cards; ++i)
+    {
+        FlashCard card{sentence(6 + rng() % 8) + "?", sentence(2 + rng() % 5) + " " + std::to_string(rng() % 2000),
+                       static_cast<CardDifficulty>(rng() % 4), static_cast<int>(rng() % 10)};
+        if (i % 3 == 0)
+        {
+            card.tags = {"general", "quiz"};
+        }
+        deck.cards.push_back(card);
+    }
+    return deck;
+}
+
+static std::string deckText(const FlashCardDeck &deck)
+{
+    std::ostringstream oss;
+    NativeDeckExporter exporter{oss};
+    exportDeck(deck, exporter);
+    return oss.str();
+}
+
+static void requireRoundTrip(const std::string &text)
+{
+    std::string compressed = compressDeckText(text);
+    REQUIRE(isCompressedDeck(compressed));
+    for (unsigned int n_threads : {1U, 4U})
+    {
+        std::string decompressed{};
+        REQUIRE(decompressDeckText(compressed, decompressed, n_threads));
+        REQUIRE(decompressed == text);
+    }
+
+    std::istringstream in{compressed.substr(8)};
+    std::string streamed{};
+    REQUIRE(streamCompressedDeck(in, [&streamed](std::string_view block) { streamed.append(block); }));
+    REQUIRE(streamed == text);
+}
+
+TEST_CASE("Compressed deck container")
+{
+    SECTION("any text round trips")
+    {
+        requireRoundTrip("");
+        requireRoundTrip("a");
+        requireRoundTrip("short deck\nQ: q\nA: a\n-\n");
+        requireRoundTrip(std::string(3 * deckBlockSize + 17, 'x'));
+        requireRoundTrip(std::string(deckBlockSize, '-'));
+
+        std::mt19937 rng{7};
+        std::string noise(deckBlockSize + 1000, '\0');
+        for (char &c : noise)
+        {
+            c = static_cast<char>(rng());
+        }
+        requireRoundTrip(noise);
+        // random bytes are stored, costing only the container header and block table
+        REQUIRE(compressDeckText(noise).size() < noise.size() + 32);
+    }
+
+    SECTION("deck text is at least 3 times smaller")
+    {
+        std::string text = deckText(makeWordDeck(5000));
+        REQUIRE(text.size() > 4 * deckBlockSize);
+        requireRoundTrip(text);
+        REQUIRE(compressDeckText(text).size() * 3 < text.size());
+    }
+
+    SECTION("damaged containers are rejected")
+    {
+        std::string text = deckText(makeWordDeck(2000));
+        std::string compressed = compressDeckText(text);
+        std::string out{};
+        REQUIRE_FALSE(decompressDeckText(compressed.substr(0, compressed.size() - 10), out));
+        REQUIRE_FALSE(decompressDeckText(text, out));
+
+        // flipped bytes must never read or write out of bounds, whether or not they are noticed
+        std::mt19937 rng{99};
+        for (int trial = 0; trial < 200; ++trial)
+        {
+            std::string damaged = compressed;
+            damaged[8 + rng() % (damaged.size() - 8)] ^= static_cast<char>(1 + rng() % 255);
+            decompressDeckText(damaged, out, 1);
+        }
+    }
+
+    SECTION("a table that cannot hold the text is rejected before it is allocated")
+    {
+        // 4096 blocks of 1 MiB, 4 GiB of text, from blocks of one byte each
+        // the magic string and version of a real container
+        std::string compressed = compressDeckText("").substr(0, 9);
+        putVarint(compressed, 1024 * 1024);
+        putVarint(compressed, uint64_t{4096} * 1024 * 1024);
+        putVarint(compressed, 4096);
+        for (int b = 0; b < 4096; ++b)
+        {
+            compressed.push_back(static_cast<char>(b % 3));
+            compressed.push_back(1);
+        }
+        compressed.append(4096, 'x');
+        std::string out{};
+        REQUIRE_FALSE(decompressDeckText(compressed, out));
+        REQUIRE(out.capacity() < 1024 * 1024);
+    }
+}
+
+TEST_CASE("Compressed deck files")
+{
+    fs::path dir = fs::temp_directory_path() / "sd_compress_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    FlashCardDeck deck = makeWordDeck(3000);
+    deck.filename = dir / "Word_deck.deck";
+    deck.compressed = true;
+    REQUIRE(rewriteFlashCardDeck(deck));
+    REQUIRE(deck.card_slots.empty());
+    REQUIRE(fs::file_size(deck.filename) * 3 < deckText(deck).size());
+
+    FlashCardDeck read = readFlashCardDeck(deck.filename);
+    REQUIRE(read.compressed);
+    REQUIRE(read.card_slots.empty());
+    REQUIRE(deckText(read) == deckText(deck));
+
+    std::vector<FlashCardDeck> loaded = loadFlashCardDecks(dir);
+    REQUIRE(loaded.size() == 1);
+    REQUIRE(loaded[0].compressed);
+    REQUIRE(deckText(loaded[0]) == deckText(deck));
+
+    // edits are saved by rewriting the compressed file, never patched in place
+    read.filename = deck.filename;
+    read.cards[10].answer = "an edited answer";
+    REQUIRE_FALSE(patchFlashCard(read, 10));
+    REQUIRE(saveEditedFlashCard(read, 10));
+    FlashCardDeck edited = readFlashCardDeck(deck.filename);
+    REQUIRE(edited.compressed);
+    REQUIRE(edited.cards[10].answer == "an edited answer");
+
+    // turning compression off writes a text deck again
+    edited.filename = deck.filename;
+    edited.compressed = false;
+    REQUIRE(rewriteFlashCardDeck(edited));
+    REQUIRE_FALSE(readFlashCardDeck(deck.filename).compressed);
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Compressed deck benchmark", "[.][benchmark]")
+{
+    std::string text = deckText(makeWordDeck(40000));
+    std::string compressed = compressDeckText(text);
+    std::cout << "text " << text.size() << " bytes, compressed " << compressed.size() << " bytes ("
+              << static_cast<double>(text.size()) / static_cast<double>(compressed.size()) << "x)" << std::endl;
+
+    BENCHMARK("compress")
+    {
+        return compressDeckText(text).size();
+    };
+    BENCHMARK("decompress, 1 thread")
+    {
+        std::string out{};
+        decompressDeckText(compressed, out, 1);
+        return out.size();
+    };
+    BENCHMARK("decompress, all threads")
+    {
+        std::string out{};
+        decompressDeckText(compressed, out);
+        return out.size();
+    };
+    BENCHMARK("parse text deck")
+    {
+        return parseFlashCardDeck(std::string{text}).cards.size();
+    };
+    BENCHMARK("decompress and parse compressed deck")
+    {
+        return parseFlashCardDeck(std::string{compressed}).cards.size();
+    };
+}
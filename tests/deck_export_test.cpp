@@ -0,0 +1,161 @@
+#include "deck_export.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+TEST_CASE("Export format names")
+{
+    ExportFormat format{};
+    REQUIRE(strToExportFormat("json", format));
+    REQUIRE(format == ExportFormat::JSON);
+    REQUIRE(strToExportFormat("TSV", format));
+    REQUIRE(format == ExportFormat::TSV);
+    REQUIRE(strToExportFormat("Anki", format));
+    REQUIRE(format == ExportFormat::ANKI);
+    REQUIRE(strToExportFormat("native", format));
+    REQUIRE(format == ExportFormat::NATIVE);
+    REQUIRE_FALSE(strToExportFormat("csv", format));
+
+    REQUIRE(exportFormatExtension(ExportFormat::JSON) == ".json");
+    REQUIRE(exportFormatExtension(ExportFormat::NATIVE) == ".deck");
+}
+
+TEST_CASE("Exporting loaded decks")
+{
+    FlashCard fc1 = FlashCard("What is \"2\"?", "Two\tor 2", EASY, 3);
+    FlashCard fc2 = FlashCard("Line\\break", "multi\nline", HARD, 0);
+    FlashCardDeck deck{"Export Deck", "", std::vector<FlashCard>{fc1, fc2}};
+    std::ostringstream oss;
+
+    SECTION("native matches the deck file template")
+    {
+        NativeDeckExporter exporter{oss};
+        exportDeck(deck, exporter);
+        REQUIRE(oss.str() == "Export Deck\nV: 2\n" + fc1.stringCardAsTemplate() + fc2.stringCardAsTemplate());
+    }
+
+    SECTION("json")
+    {
+        JsonDeckExporter exporter{oss};
+        exportDeck(deck, exporter);
+        REQUIRE(oss.str() == "[\n{\"name\":\"Export Deck\",\"cards\":["
+                             "\n{\"question\":\"What is \\\"2\\\"?\",\"answer\":\"Two\\tor 2\","
+                             "\"difficulty\":\"EASY\",\"n_times_answered\":3},"
+                             "\n{\"question\":\"Line\\\\break\",\"answer\":\"multi\\nline\","
+                             "\"difficulty\":\"HARD\",\"n_times_answered\":0}]}\n]\n");
+    }
+
+    SECTION("tsv")
+    {
+        TsvDeckExporter exporter{oss};
+        exportDeck(deck, exporter);
+        REQUIRE(oss.str() == "deck\tquestion\tanswer\tdifficulty\tn_times_answered\n"
+                             "Export Deck\tWhat is \"2\"?\tTwo\\tor 2\tEASY\t3\n"
+                             "Export Deck\tLine\\\\break\tmulti\\nline\tHARD\t0\n");
+    }
+
+    SECTION("anki")
+    {
+        AnkiDeckExporter exporter{oss};
+        exportDeck(deck, exporter);
+        REQUIRE(oss.str() == "#separator:tab\n#html:false\n#deck column:3\n#tags column:4\n"
+                             "\"What is \"\"2\"\"?\"\t\"Two\tor 2\"\tExport Deck\tdifficulty::EASY\n"
+                             "Line\\break\t\"multi\nline\"\tExport Deck\tdifficulty::HARD\n");
+    }
+
+    SECTION("several decks in one json document")
+    {
+        FlashCardDeck empty{"Empty", "", std::vector<FlashCard>{}};
+        auto exporter = createDeckExporter(ExportFormat::JSON, oss);
+        exportDecks(std::vector<FlashCardDeck>{empty, empty}, *exporter);
+        REQUIRE(oss.str() == "[\n{\"name\":\"Empty\",\"cards\":[]},\n{\"name\":\"Empty\",\"cards\":[]}\n]\n");
+    }
+
+    SECTION("tags")
+    {
+        FlashCard tagged = FlashCard("q", "a", MEDIUM, 1);
+        tagged.tags = {"two words", "x"};
+        FlashCardDeck tagged_deck{"Tagged", "", std::vector<FlashCard>{tagged}};
+        tagged_deck.tags = {"geo"};
+
+        JsonDeckExporter json{oss};
+        exportDeck(tagged_deck, json);
+        REQUIRE(oss.str() == "[\n{\"name\":\"Tagged\",\"cards\":["
+                             "\n{\"question\":\"q\",\"answer\":\"a\",\"difficulty\":\"MEDIUM\",\"n_times_answered\":1,"
+                             "\"tags\":[\"two words\",\"x\"]}],\"tags\":[\"geo\"]}\n]\n");
+
+        std::ostringstream anki_out;
+        AnkiDeckExporter anki{anki_out};
+        exportDeck(tagged_deck, anki);
+        REQUIRE(anki_out.str().ends_with("q\ta\tTagged\tdifficulty::MEDIUM geo two_words x\n"));
+
+        std::ostringstream native_out;
+        NativeDeckExporter native{native_out};
+        exportDeck(tagged_deck, native);
+        REQUIRE(native_out.str() == "Tagged\nV: 2\nDT: geo\nQ: q\nA: a\nD: MEDIUM\nN: 1\nT: two words, x\n-\n");
+    }
+}
+
+TEST_CASE("Streaming export from deck files")
+{
+    std::filesystem::path decks_dir = getAppPath().append("Decks");
+    std::filesystem::path example1_deck = decks_dir;
+    example1_deck.append("example1.deck");
+
+    SECTION("single file matches the loaded deck")
+    {
+        std::ostringstream streamed;
+        std::ostringstream loaded;
+        TsvDeckExporter streamedExporter{streamed};
+        streamedExporter.beginLibrary();
+        REQUIRE(exportDeckFile(example1_deck, streamedExporter));
+        streamedExporter.endLibrary();
+
+        TsvDeckExporter loadedExporter{loaded};
+        exportDeck(readFlashCardDeck(example1_deck), loadedExporter);
+        REQUIRE(streamed.str() == loaded.str());
+    }
+
+    SECTION("whole library")
+    {
+        std::ostringstream oss;
+        NativeDeckExporter exporter{oss};
+        size_t n_decks = exportLibrary(decks_dir, exporter);
+        REQUIRE(n_decks == loadFlashCardDecks(decks_dir).size());
+        REQUIRE(oss.str().find("test example deck 1\n") != std::string::npos);
+    }
+
+    SECTION("deck tags between the cards")
+    {
+        std::filesystem::path late_deck = std::filesystem::temp_directory_path() / "sd_export_late_tags.deck";
+        std::ofstream{late_deck, std::ios::binary} << "Late\nV: 2\nDT: geo\nQ: q1\nA: a1\n-\n"
+                                                      "DT: geo, late\nQ: q2\nA: a2\n-\n";
+        REQUIRE(readFlashCardDeck(late_deck).tags == std::vector<std::string>{"geo", "late"});
+
+        std::ostringstream json_out;
+        JsonDeckExporter json{json_out};
+        json.beginLibrary();
+        REQUIRE(exportDeckFile(late_deck, json));
+        json.endLibrary();
+        REQUIRE(json_out.str().ends_with("}],\"tags\":[\"geo\",\"late\"]}\n]\n"));
+
+        std::ostringstream anki_out;
+        AnkiDeckExporter anki{anki_out};
+        anki.beginLibrary();
+        REQUIRE(exportDeckFile(late_deck, anki));
+        anki.endLibrary();
+        REQUIRE(anki_out.str().ends_with("q1\ta1\tLate\tdifficulty::UNKNOWN geo late\n"
+                                         "q2\ta2\tLate\tdifficulty::UNKNOWN geo late\n"));
+        std::filesystem::remove(late_deck);
+    }
+
+    SECTION("missing file")
+    {
+        std::ostringstream oss;
+        NativeDeckExporter exporter{oss};
+        REQUIRE_FALSE(exportDeckFile(decks_dir / "does_not_exist.deck", exporter));
+    }
+}
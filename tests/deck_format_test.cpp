@@ -0,0 +1,186 @@
+#include "deck.h"
+#include "deck_export.h"
+#include "deck_format.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+// the line by line parser used before version 2, kept to compare results and speed against
+static FlashCardDeck legacyParseFlashCardDeck(const std::string &contents)
+{
+    FlashCardDeck deck;
+    std::istringstream in{contents};
+    int lineCount{0};
+    std::string strInput{};
+    FlashCard fc{};
+    while (std::getline(in, strInput))
+    {
+        if (!strInput.empty() && strInput.back() == '\r')
+        {
+            strInput.pop_back();
+        }
+        sanitizeUtf8(strInput);
+        if (lineCount == 0)
+        {
+            deck.name = strInput;
+        }
+        else
+        {
+            if (strInput.starts_with("-"))
+            {
+                deck.cards.push_back(fc);
+                fc = FlashCard{};
+            }
+            if (strInput.starts_with("Q: "))
+            {
+                fc.question = strInput.substr(strInput.find_first_not_of(" \t", 3));
+            }
+            if (strInput.starts_with("A: "))
+            {
+                fc.answer = strInput.substr(strInput.find_first_not_of(" \t", 3));
+            }
+            if (strInput.starts_with("D: "))
+            {
+                fc.difficulty = strToCardDifficulty(strInput.substr(strInput.find_first_not_of(" \t", 3)));
+            }
+            if (strInput.starts_with("N: "))
+            {
+                fc.n_times_answered = std::stoi(strInput.substr(2));
+            }
+            if (strInput.starts_with("T: "))
+            {
+                fc.tags = strToTagList(strInput.substr(3));
+            }
+            if (strInput.starts_with("DT: "))
+            {
+                deck.tags = strToTagList(strInput.substr(4));
+            }
+        }
+        lineCount++;
+    }
+    if (fc.question != "" || fc.answer != "")
+    {
+        deck.cards.push_back(fc);
+    }
+    return deck;
+}
+
+static std::string makeV1Deck(int n_cards)
+{
+    std::string text = "Benchmark deck\nDT: bench\n";
+    for (int i = 0; i < n_cards; ++i)
+    {
+        text += "Q: What is the capital of country number " + std::to_string(i) + "?\n";
+        text += "A: The capital city with the index " + std::to_string(i * 7) + "\n";
+        text += "D: MEDIUM\nN: " + std::to_string(i % 9) + "\n";
+        if (i % 4 == 0)
+        {
+            text += "T: geography, capitals\n";
+        }
+        text += "-\n";
+    }
+    return text;
+}
+
+static void requireSameCards(const FlashCardDeck &a, const FlashCardDeck &b)
+{
+    REQUIRE(a.name == b.name);
+    REQUIRE(a.tags == b.tags);
+    REQUIRE(a.cards.size() == b.cards.size());
+    for (size_t i = 0; i < a.cards.size(); ++i)
+    {
+        REQUIRE(a.cards[i].question == b.cards[i].question);
+        REQUIRE(a.cards[i].answer == b.cards[i].answer);
+        REQUIRE(a.cards[i].difficulty == b.cards[i].difficulty);
+        REQUIRE(a.cards[i].n_times_answered == b.cards[i].n_times_answered);
+        REQUIRE(a.cards[i].tags == b.cards[i].tags);
+    }
+}
+
+TEST_CASE("Reading version 1 decks")
+{
+    std::string v1 = makeV1Deck(50) + "Q: C:\\temp\nA:   indented\nD: HARD\n-\nQ: trailing\nA: card";
+    requireSameCards(parseFlashCardDeck(std::string{v1}), legacyParseFlashCardDeck(v1));
+
+    FlashCardDeck deck = parseFlashCardDeck(std::string{v1});
+    REQUIRE(deck.cards[50].question == "C:\\temp");
+    REQUIRE(deck.cards[50].answer == "indented");
+    REQUIRE(deck.cards.back().answer == "card");
+
+    SECTION("text split at any point parses the same")
+    {
+        for (size_t piece : {1, 3, 64})
+        {
+            FlashCardDeck fed;
+            DeckTextParser parser{[&fed](const std::string &name) { fed.name = name; },
+                                  [&fed](FlashCard &card) { fed.cards.push_back(card); },
+                                  [&fed](std::vector<std::string> &tags) { fed.tags = tags; }};
+            for (size_t i = 0; i < v1.size(); i += piece)
+            {
+                parser.feed(std::string_view{v1}.substr(i, piece));
+            }
+            parser.finish();
+            REQUIRE(parser.version() == 1);
+            requireSameCards(fed, deck);
+        }
+    }
+}
+
+TEST_CASE("Version 2 decks")
+{
+    SECTION("multi-line and escaped text")
+    {
+        FlashCardDeck deck = parseFlashCardDeck("Multi\nV: 2\n"
+                                                "Q: first line\n+ second line\n+\n+   indented\n"
+                                                "A: path C:\\\\temp\\nnext\\tcol\n-\n"
+                                                "Q: \\ spaced\nX: a field from a later version\n-\n");
+        REQUIRE(deck.cards.size() == 2);
+        REQUIRE(deck.cards[0].question == "first line\nsecond line\n\n  indented");
+        REQUIRE(deck.cards[0].answer == "path C:\\temp\nnext\tcol");
+        // fields left out take their defaults
+        REQUIRE(deck.cards[1].question == " spaced");
+        REQUIRE(deck.cards[1].answer == "");
+        REQUIRE(deck.cards[1].difficulty == UNKNOWN);
+        REQUIRE(deck.cards[1].n_times_answered == 0);
+    }
+
+    SECTION("escapes are not decoded in version 1 decks")
+    {
+        FlashCardDeck deck = parseFlashCardDeck("Old\nQ: a\\nb\nA: c\n-\n");
+        REQUIRE(deck.cards[0].question == "a\\nb");
+    }
+
+    SECTION("cards written as version 2 read back unchanged")
+    {
+        FlashCard tricky{"  leading\\slash\r\nsecond\n", "\tx\n\n  y", HARD, 4};
+        tricky.tags = {"a"};
+        FlashCardDeck deck{"Round trip", "", std::vector<FlashCard>{tricky, FlashCard("q", "a", EASY, 1)}};
+        std::ostringstream oss;
+        NativeDeckExporter exporter{oss};
+        exportDeck(deck, exporter);
+
+        requireSameCards(parseFlashCardDeck(oss.str()), deck);
+        // a version 1 reader still sees every card
+        FlashCardDeck old = legacyParseFlashCardDeck(oss.str());
+        REQUIRE(old.cards.size() == 2);
+        REQUIRE(old.cards[1].question == "q");
+    }
+}
+
+TEST_CASE("Deck parser benchmark", "[.][benchmark]")
+{
+    std::string v1 = makeV1Deck(20000);
+    requireSameCards(parseFlashCardDeck(std::string{v1}), legacyParseFlashCardDeck(v1));
+
+    BENCHMARK("line by line parser, version 1 deck")
+    {
+        return legacyParseFlashCardDeck(v1).cards.size();
+    };
+    BENCHMARK("DeckTextParser, version 1 deck")
+    {
+        return parseFlashCardDeck(std::string{v1}).cards.size();
+    };
+}
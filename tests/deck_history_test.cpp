@@ -0,0 +1,166 @@
+#include "deck_history.h"
+#include "deck.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// a fresh directory with no history in it
+static fs::path makeHistoryTestDir(const std::string &name)
+{
+    fs::path dir = fs::temp_directory_path() / name;
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+static FlashCardDeck makeHistoryDeck(size_t n_cards)
+{
+    FlashCardDeck deck{"History deck", "", std::vector<FlashCard>{}};
+    for (size_t i = 0; i < n_cards; ++i)
+    {
+        deck.cards.emplace_back("question " + std::to_string(i), "answer " + std::to_string(i), MEDIUM, 0);
+    }
+    return deck;
+}
+
+static void requireSameDeck(const FlashCardDeck &a, const FlashCardDeck &b)
+{
+    REQUIRE(a.name == b.name);
+    REQUIRE(a.tags == b.tags);
+    REQUIRE(a.cards.size() == b.cards.size());
+    for (size_t i = 0; i < a.cards.size(); ++i)
+    {
+        REQUIRE(a.cards[i].question == b.cards[i].question);
+        REQUIRE(a.cards[i].answer == b.cards[i].answer);
+        REQUIRE(a.cards[i].difficulty == b.cards[i].difficulty);
+        REQUIRE(a.cards[i].n_times_answered == b.cards[i].n_times_answered);
+    }
+}
+
+TEST_CASE("Deck history records versions as deltas")
+{
+    fs::path dir = makeHistoryTestDir("sd_history_test");
+    fs::path deck_file = dir / "History_deck.deck";
+    fs::path history_file = DeckHistory::historyFileFor(deck_file);
+    REQUIRE(history_file == dir / ".history" / "History_deck.deck.history");
+
+    FlashCardDeck deck = makeHistoryDeck(200);
+    deck.filename = deck_file;
+    std::vector<FlashCardDeck> saved;
+    {
+        DeckHistory history{history_file};
+        REQUIRE(history.recordVersion(deck, "created") == 1);
+        saved.push_back(deck);
+        // unchanged contents are not recorded again
+        REQUIRE(history.recordVersion(deck, "created") == 1);
+    }
+    uint64_t first_size = fs::file_size(history_file);
+
+    // edit, add, delete and rename through the free function, as the editor does
+    deck.cards[17].answer = "a better answer";
+    REQUIRE(recordDeckHistory(deck, "edited card 18") == 2);
+    saved.push_back(deck);
+    deck.cards.emplace_back("new question", "new answer", UNKNOWN, 0);
+    REQUIRE(recordDeckHistory(deck, "added a card") == 3);
+    saved.push_back(deck);
+    deck.cards.erase(deck.cards.begin() + 3);
+    REQUIRE(recordDeckHistory(deck, "deleted card 4") == 4);
+    saved.push_back(deck);
+    deck.name = "Renamed deck";
+    deck.tags = {"renamed"};
+    REQUIRE(recordDeckHistory(deck, "renamed") == 5);
+    saved.push_back(deck);
+
+    // each delta is far smaller than a full copy of the deck
+    REQUIRE(fs::file_size(history_file) - first_size < first_size / 4);
+
+    DeckHistory history{history_file};
+    const std::vector<DeckVersion> &versions = history.listVersions();
+    REQUIRE(versions.size() == 5);
+    REQUIRE(versions[0].checkpoint);
+    REQUIRE_FALSE(versions[1].checkpoint);
+    REQUIRE(versions[1].note == "edited card 18");
+    REQUIRE(versions[2].n_cards == 201);
+    for (size_t i = 0; i < saved.size(); ++i)
+    {
+        FlashCardDeck version;
+        REQUIRE(history.readVersion(i + 1, version));
+        requireSameDeck(version, saved[i]);
+    }
+    FlashCardDeck missing;
+    REQUIRE_FALSE(history.readVersion(6, missing));
+
+    SECTION("checkpoints bound the deltas read for any version")
+    {
+        DeckHistory long_history{history_file};
+        for (int i = 0; i < 40; ++i)
+        {
+            deck.cards[static_cast<size_t>(i)].n_times_answered = i + 1;
+            saved.push_back(deck);
+            REQUIRE(long_history.recordVersion(deck, "edit") == saved.size());
+        }
+        const std::vector<DeckVersion> &all = long_history.listVersions();
+        size_t since_checkpoint = 0;
+        for (const DeckVersion &version : all)
+        {
+            since_checkpoint = version.checkpoint ? 0 : since_checkpoint + 1;
+            REQUIRE(since_checkpoint < DeckHistory::checkpointInterval);
+        }
+        REQUIRE(all[DeckHistory::checkpointInterval].checkpoint);
+
+        DeckHistory reopened{history_file};
+        for (uint64_t number : {uint64_t{16}, uint64_t{17}, uint64_t{31}, uint64_t{45}})
+        {
+            FlashCardDeck version;
+            REQUIRE(reopened.readVersion(number, version));
+            requireSameDeck(version, saved[number - 1]);
+        }
+    }
+
+    SECTION("a version with every card changed is written as a checkpoint")
+    {
+        for (FlashCard &card : deck.cards)
+        {
+            card.answer += "!";
+        }
+        saved.push_back(deck);
+        REQUIRE(recordDeckHistory(deck, "edited every card") == 6);
+
+        DeckHistory reopened{history_file};
+        REQUIRE(reopened.listVersions().back().checkpoint);
+        FlashCardDeck version;
+        REQUIRE(reopened.readVersion(6, version));
+        requireSameDeck(version, saved[5]);
+    }
+
+    SECTION("a record cut short is ignored and overwritten")
+    {
+        uint64_t size = fs::file_size(history_file);
+        fs::resize_file(history_file, size - 5);
+        DeckHistory torn{history_file};
+        REQUIRE(torn.listVersions().size() == 4);
+        REQUIRE(torn.recordVersion(deck, "renamed again") == 5);
+
+        DeckHistory repaired{history_file};
+        REQUIRE(repaired.listVersions().size() == 5);
+        FlashCardDeck version;
+        REQUIRE(repaired.readVersion(5, version));
+        requireSameDeck(version, deck);
+    }
+
+    SECTION("history follows a renamed deck")
+    {
+        fs::path renamed = dir / "Renamed_deck.deck";
+        REQUIRE(moveDeckHistory(deck_file, renamed));
+        REQUIRE_FALSE(fs::exists(history_file));
+        DeckHistory moved{DeckHistory::historyFileFor(renamed)};
+        REQUIRE(moved.listVersions().size() == 5);
+    }
+
+    fs::remove_all(dir);
+}
@@ -0,0 +1,139 @@
+#include "deck_library.h"
+#include "deck.h"
+#include "deck_loader.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static FlashCardDeck makeDeck(const std::string &name, size_t n_cards)
+{
+    FlashCardDeck deck{name, "", std::vector<FlashCard>{}};
+    for (size_t i = 0; i < n_cards; ++i)
+    {
+        deck.cards.emplace_back(name + " question number " + std::to_string(i) + " which is long enough",
+                                name + " answer number " + std::to_string(i) + " which is also long enough",
+                                MEDIUM,
+                                static_cast<int>(i % 5));
+    }
+    return deck;
+}
+
+TEST_CASE("Deck library memory budget")
+{
+    fs::path dir = fs::temp_directory_path() / "sd_library_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    const size_t n_decks = 12;
+    std::vector<FlashCardDeck> decks{};
+    for (size_t i = 0; i < n_decks; ++i)
+    {
+        decks.push_back(makeDeck("Deck " + std::to_string(i), 200));
+        decks.back().filename = dir / ("Deck_" + std::to_string(i) + ".deck");
+        REQUIRE(writeFlashCardDeck(decks.back(), decks.back().filename));
+    }
+    size_t deck_memory = deckMemoryUsage(decks[0]);
+    REQUIRE(deck_memory > 200 * sizeof(FlashCard));
+
+    // room for three decks
+    DeckLibrary library{deck_memory * 3 + deck_memory / 2};
+    library.load(dir);
+    REQUIRE(library.size() == n_decks);
+    REQUIRE(library.memoryUsed() <= library.memoryBudget());
+
+    SECTION("metadata is kept for evicted decks")
+    {
+        size_t n_loaded = 0;
+        for (size_t i = 0; i < library.size(); ++i)
+        {
+            n_loaded += library.isLoaded(i) ? 1 : 0;
+            REQUIRE(library.cardCount(i) == 200);
+            REQUIRE(library.name(i).rfind("Deck ", 0) == 0);
+            REQUIRE(library.filename(i).parent_path() == dir);
+        }
+        REQUIRE(n_loaded <= 3);
+        REQUIRE(library.reloadCount() == 0);
+    }
+
+    SECTION("evicted decks are read back when used")
+    {
+        for (size_t pass = 0; pass < 2; ++pass)
+        {
+            for (size_t i = 0; i < library.size(); ++i)
+            {
+                FlashCardDeck &deck = library.deck(i);
+                REQUIRE(library.isLoaded(i));
+                REQUIRE(deck.cards.size() == 200);
+                REQUIRE(deck.cards[199].question == deck.name + " question number 199 which is long enough");
+                REQUIRE(deck.filename == library.filename(i));
+                REQUIRE(library.memoryUsed() <= library.memoryBudget());
+            }
+        }
+        REQUIRE(library.reloadCount() >= n_decks);
+
+        // the most recently used decks are the ones kept
+        library.deck(0);
+        library.deck(1);
+        size_t reloads = library.reloadCount();
+        library.deck(0);
+        library.deck(1);
+        REQUIRE(library.reloadCount() == reloads);
+    }
+
+    SECTION("edits are counted and survive eviction")
+    {
+        FlashCardDeck &deck = library.deck(4);
+        for (int i = 0; i < 200; ++i)
+        {
+            deck.cards.push_back(deck.cards[i]);
+        }
+        REQUIRE(rewriteFlashCardDeck(deck));
+
+        // switching decks counts the grown deck again before evicting
+        library.deck(5);
+        REQUIRE(library.memoryUsed() <= library.memoryBudget());
+        for (size_t i = 6; i < n_decks; ++i)
+        {
+            library.deck(i);
+        }
+        REQUIRE_FALSE(library.isLoaded(4));
+        REQUIRE(library.cardCount(4) == 400);
+        REQUIRE(library.deck(4).cards.size() == 400);
+    }
+
+    SECTION("a deck over the budget is kept while it is used")
+    {
+        library.setMemoryBudget(deck_memory / 2);
+        FlashCardDeck &deck = library.deck(7);
+        REQUIRE(library.isLoaded(7));
+        REQUIRE(deck.cards.size() == 200);
+        for (size_t i = 0; i < library.size(); ++i)
+        {
+            REQUIRE(library.isLoaded(i) == (i == 7));
+        }
+    }
+
+    SECTION("decks can be added and removed")
+    {
+        library.add(makeDeck("Added", 10));
+        REQUIRE(library.size() == n_decks + 1);
+        REQUIRE(library.name(n_decks) == "Added");
+        REQUIRE(library.isLoaded(n_decks));
+
+        size_t used = library.memoryUsed();
+        library.erase(n_decks);
+        REQUIRE(library.size() == n_decks);
+        REQUIRE(library.memoryUsed() < used);
+
+        library.deck(3);
+        library.erase(0);
+        REQUIRE(library.name(2) == library.deck(2).name);
+        REQUIRE(library.deck(2).cards.size() == 200);
+    }
+
+    fs::remove_all(dir);
+}
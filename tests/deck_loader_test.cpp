@@ -0,0 +1,141 @@
+#include "deck_loader.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// loading through different backends must give exactly the same decks
+static void requireSameDecks(const std::vector<FlashCardDeck> &a, const std::vector<FlashCardDeck> &b)
+{
+    REQUIRE(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        REQUIRE(a[i].name == b[i].name);
+        REQUIRE(a[i].filename == b[i].filename);
+        REQUIRE(a[i].cards.size() == b[i].cards.size());
+        for (size_t j = 0; j < a[i].cards.size(); ++j)
+        {
+            REQUIRE(a[i].cards[j].question == b[i].cards[j].question);
+            REQUIRE(a[i].cards[j].answer == b[i].cards[j].answer);
+            REQUIRE(a[i].cards[j].difficulty == b[i].cards[j].difficulty);
+            REQUIRE(a[i].cards[j].n_times_answered == b[i].cards[j].n_times_answered);
+        }
+    }
+}
+
+// a backend that rewrites every file just before reading it, as another program saving a deck mid-load would
+class WriteDuringReadBackend : public SerialIoBackend
+{
+public:
+    void readFiles(const std::vector<std::filesystem::path> &paths,
+                   const std::function<void(size_t, std::string &, bool)> &on_complete) override
+    {
+        for (const auto &path : paths)
+        {
+            std::string contents{};
+            REQUIRE(readFileContents(path, contents));
+            std::ofstream{path, std::ios::binary | std::ios::trunc} << contents;
+            std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds{1});
+        }
+        SerialIoBackend::readFiles(paths, on_complete);
+    }
+};
+
+TEST_CASE("Reading whole files")
+{
+    std::filesystem::path example1_deck = getAppPath().append("Decks").append("example1.deck");
+    std::string contents{};
+    REQUIRE(readFileContents(example1_deck, contents));
+    REQUIRE(contents.starts_with("test example deck 1\n"));
+    REQUIRE(contents.size() == std::filesystem::file_size(example1_deck));
+    REQUIRE_FALSE(readFileContents(example1_deck.parent_path() / "does_not_exist.deck", contents));
+}
+
+TEST_CASE("Parsing deck contents from memory")
+{
+    FlashCardDeck deck = parseFlashCardDeck("In memory\r\nQ: q1\r\nA: a1\r\nD: HARD\r\nN: 2\r\n-\r\nQ: q2\nA: a2\n");
+    REQUIRE(deck.name == "In memory");
+    REQUIRE(deck.cards.size() == 2);
+    REQUIRE(deck.cards[0].question == "q1");
+    REQUIRE(deck.cards[0].answer == "a1");
+    REQUIRE(deck.cards[0].difficulty == HARD);
+    REQUIRE(deck.cards[0].n_times_answered == 2);
+    REQUIRE(deck.cards[1].answer == "a2");
+}
+
+TEST_CASE("Library loading backends")
+{
+    SECTION("test decks")
+    {
+        std::filesystem::path decks_dir = getAppPath().append("Decks");
+        SerialIoBackend serial{};
+        ThreadPoolIoBackend pool{4};
+        requireSameDecks(loadFlashCardDecks(decks_dir, serial), loadFlashCardDecks(decks_dir, pool));
+        requireSameDecks(loadFlashCardDecks(decks_dir, serial), loadFlashCardDecks(decks_dir));
+    }
+
+    SECTION("many generated decks")
+    {
+        std::filesystem::path lib_dir = std::filesystem::temp_directory_path() / "studydungeon_loader_test";
+        std::filesystem::remove_all(lib_dir);
+        std::filesystem::create_directories(lib_dir);
+        for (int d = 0; d < 64; ++d)
+        {
+            FlashCardDeck deck{"deck " + std::to_string(d), "", std::vector<FlashCard>{}};
+            for (int c = 0; c < d; ++c)
+            {
+                deck.cards.push_back(FlashCard{"q" + std::to_string(c), "a" + std::to_string(c), MEDIUM, c});
+            }
+            REQUIRE(writeFlashCardDeck(deck, lib_dir / ("deck" + std::to_string(d) + ".deck")));
+        }
+        // files without the .deck suffix are skipped
+        std::ofstream{lib_dir / "notes.txt"} << "not a deck\n";
+
+        SerialIoBackend serial{};
+        ThreadPoolIoBackend pool{8};
+        std::vector<FlashCardDeck> decks = loadFlashCardDecks(lib_dir, pool);
+        REQUIRE(decks.size() == 64);
+        requireSameDecks(loadFlashCardDecks(lib_dir, serial), decks);
+        std::filesystem::remove_all(lib_dir);
+    }
+
+    SECTION("card slots are only trusted if the deck was not written while it was read")
+    {
+        std::filesystem::path lib_dir = std::filesystem::temp_directory_path() / "studydungeon_loader_stamp";
+        std::filesystem::remove_all(lib_dir);
+        std::filesystem::create_directories(lib_dir);
+        FlashCardDeck written{"Stamp", "", std::vector<FlashCard>{{"q1", "a1", MEDIUM, 0}, {"q2", "a2", MEDIUM, 0}}};
+        REQUIRE(writeFlashCardDeck(written, lib_dir / "stamp.deck"));
+
+        SerialIoBackend serial{};
+        std::vector<FlashCardDeck> decks = loadFlashCardDecks(lib_dir, serial);
+        REQUIRE(decks.size() == 1);
+        decks[0].cards[0].answer = "b1";
+        REQUIRE(patchFlashCard(decks[0], 0));
+
+        WriteDuringReadBackend writer{};
+        decks = loadFlashCardDecks(lib_dir, writer);
+        REQUIRE(decks.size() == 1);
+        REQUIRE(decks[0].cards[0].answer == "b1");
+        decks[0].cards[0].answer = "c1";
+        REQUIRE_FALSE(patchFlashCard(decks[0], 0));
+        std::filesystem::remove_all(lib_dir);
+    }
+
+    SECTION("errors while parsing are passed back to the caller")
+    {
+        std::filesystem::path lib_dir = std::filesystem::temp_directory_path() / "studydungeon_loader_error";
+        std::filesystem::remove_all(lib_dir);
+        std::filesystem::create_directories(lib_dir);
+        for (int d = 0; d < 8; ++d)
+        {
+            std::ofstream{lib_dir / ("bad" + std::to_string(d) + ".deck")} << "bad deck\nQ: q\nN: not a number\n-\n";
+        }
+        ThreadPoolIoBackend pool{4};
+        REQUIRE_THROWS(loadFlashCardDecks(lib_dir, pool));
+        std::filesystem::remove_all(lib_dir);
+    }
+}
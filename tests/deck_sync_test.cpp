@@ -0,0 +1,238 @@
+#include "deck_sync.h"
+#include "deck_backup.h"
+#include "deck_loader.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static fs::path makeSyncTestDir(const std::string &name)
+{
+    fs::path dir = fs::temp_directory_path() / name;
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+static std::string makeSyncDeckText(size_t n_cards)
+{
+    std::string text = "Sync deck\n";
+    for (size_t i = 0; i < n_cards; ++i)
+    {
+        text += "Q: sync question " + std::to_string(i) + "\nA: sync answer " + std::to_string(i * 31) +
+                "\nD: EASY\nN: 1\n-\n";
+    }
+    return text;
+}
+
+TEST_CASE("Rolling checksum")
+{
+    std::string data = "the quick brown fox jumps over the lazy dog";
+    const size_t len = 8;
+    uint32_t sum = weakChecksum(data.data(), len);
+    uint32_t a = sum & 0xFFFF;
+    uint32_t b = sum >> 16;
+    // rolling the window one byte at a time matches computing it from scratch
+    for (size_t pos = 1; pos + len <= data.size(); ++pos)
+    {
+        uint8_t out = static_cast<uint8_t>(data[pos - 1]);
+        uint8_t in = static_cast<uint8_t>(data[pos + len - 1]);
+        a = a - out + in;
+        b = b - static_cast<uint32_t>(len) * out + a;
+        REQUIRE(((a & 0xFFFF) | ((b & 0xFFFF) << 16)) == weakChecksum(data.data() + pos, len));
+    }
+}
+
+TEST_CASE("Deltas rebuild the new contents")
+{
+    std::string basis = makeSyncDeckText(2000);
+    FileSignature signature = computeSignature(basis);
+    REQUIRE(signature.file_size == basis.size());
+    REQUIRE(signature.blocks.size() == (basis.size() + signature.block_size - 1) / signature.block_size);
+
+    std::string rebuilt{};
+    SECTION("Identical contents are all matched")
+    {
+        FileDelta delta = computeDelta(signature, basis);
+        REQUIRE(delta.literal_bytes == 0);
+        REQUIRE(delta.matched_bytes == basis.size());
+        REQUIRE(delta.ops.size() == 1);
+        REQUIRE(applyDelta(basis, signature.block_size, delta, rebuilt));
+        REQUIRE(rebuilt == basis);
+    }
+    SECTION("Small edits only send the bytes around them")
+    {
+        std::string edited = basis;
+        edited.insert(basis.size() / 2, "Q: inserted\nA: card\nD: HARD\nN: 0\n-\n");
+        edited.erase(100, 10);
+        edited += "Q: appended\nA: card\nD: MEDIUM\nN: 0\n-\n";
+        FileDelta delta = computeDelta(signature, edited);
+        REQUIRE(delta.literal_bytes + delta.matched_bytes == edited.size());
+        REQUIRE(delta.literal_bytes < 4 * signature.block_size + 100);
+        REQUIRE(applyDelta(basis, signature.block_size, delta, rebuilt));
+        REQUIRE(rebuilt == edited);
+    }
+    SECTION("An empty basis sends everything")
+    {
+        FileSignature empty = computeSignature("");
+        FileDelta delta = computeDelta(empty, basis);
+        REQUIRE(delta.literal_bytes == basis.size());
+        REQUIRE(applyDelta("", empty.block_size, delta, rebuilt));
+        REQUIRE(rebuilt == basis);
+    }
+    SECTION("Copies past the end of the basis are rejected")
+    {
+        FileDelta delta{};
+        delta.ops.push_back({signature.blocks.size(), 1, ""});
+        REQUIRE_FALSE(applyDelta(basis, signature.block_size, delta, rebuilt));
+    }
+}
+
+TEST_CASE("Merging card statistics")
+{
+    FlashCardDeck ours{"Ours",
+                       "",
+                       std::vector<FlashCard>{FlashCard("q1", "a1", EASY, 3),
+                                              FlashCard("q2", "a2", EASY, 1),
+                                              FlashCard("q3", "a3", MEDIUM, 2),
+                                              FlashCard("only ours", "x", HARD, 0)}};
+    FlashCardDeck theirs{"Theirs",
+                         "",
+                         std::vector<FlashCard>{FlashCard("q1", "a1", HARD, 1),
+                                                FlashCard("q2", "a2 updated", HARD, 4),
+                                                FlashCard("q3", "a3", HARD, 2),
+                                                FlashCard("only theirs", "y", EASY, 0)}};
+    SyncReport report{};
+    FlashCardDeck merged = mergeFlashCardDecks(ours, theirs, report);
+    REQUIRE(merged.name == "Ours");
+    REQUIRE(merged.cards.size() == 5);
+    // more answers wins
+    REQUIRE(merged.cards[0].difficulty == EASY);
+    REQUIRE(merged.cards[0].n_times_answered == 3);
+    REQUIRE(merged.cards[1].difficulty == HARD);
+    REQUIRE(merged.cards[1].answer == "a2 updated");
+    REQUIRE(merged.cards[1].n_times_answered == 4);
+    // a tie takes the harder difficulty
+    REQUIRE(merged.cards[2].difficulty == HARD);
+    REQUIRE(merged.cards[3].question == "only ours");
+    REQUIRE(merged.cards[4].question == "only theirs");
+    REQUIRE(report.cards_merged == 3);
+    REQUIRE(report.cards_added == 2);
+}
+
+TEST_CASE("Merging against the last synced deck")
+{
+    FlashCardDeck base{"Base",
+                       "",
+                       std::vector<FlashCard>{FlashCard("q1", "a1", EASY, 1),
+                                              FlashCard("q2", "a2", EASY, 1),
+                                              FlashCard("q3", "a3", EASY, 1)}};
+    // we deleted q2 and q3, they studied q3 and added a card
+    FlashCardDeck ours{"Ours", "", std::vector<FlashCard>{FlashCard("q1", "a1", EASY, 1)}};
+    FlashCardDeck theirs{"Theirs",
+                         "",
+                         std::vector<FlashCard>{FlashCard("q1", "a1", EASY, 1),
+                                                FlashCard("q2", "a2", EASY, 1),
+                                                FlashCard("q3", "a3", HARD, 2),
+                                                FlashCard("new", "n", UNKNOWN, 0)}};
+    SyncReport report{};
+    FlashCardDeck merged = mergeFlashCardDecks(base, ours, theirs, report);
+    REQUIRE(merged.cards.size() == 3);
+    REQUIRE(merged.cards[0].question == "q1");
+    // a card changed on one side is kept even though the other deleted it
+    REQUIRE(merged.cards[1].question == "q3");
+    REQUIRE(merged.cards[1].n_times_answered == 2);
+    REQUIRE(merged.cards[2].question == "new");
+    REQUIRE(report.cards_deleted == 1);
+    REQUIRE(report.cards_added == 2);
+
+    // without a base nothing is deleted
+    SyncReport union_report{};
+    REQUIRE(mergeFlashCardDecks(ours, theirs, union_report).cards.size() == 4);
+    REQUIRE(union_report.cards_deleted == 0);
+}
+
+TEST_CASE("Syncing two libraries")
+{
+    fs::path local = makeSyncTestDir("studydungeon_sync_local");
+    fs::path remote = makeSyncTestDir("studydungeon_sync_remote");
+
+    std::ofstream{local / "local_only.deck"} << "Local\nQ: l\nA: l\nD: EASY\nN: 0\n-\n";
+    std::ofstream{remote / "remote_only.deck"} << "Remote\nQ: r\nA: r\nD: EASY\nN: 0\n-\n";
+    std::string shared = makeSyncDeckText(1000);
+    std::ofstream{local / "same.deck"} << shared;
+    std::ofstream{remote / "same.deck"} << shared;
+
+    // both sides studied a different card of the big deck
+    std::string local_big = shared;
+    std::string remote_big = shared;
+    local_big.replace(local_big.find("D: EASY\nN: 1"), 12, "D: HARD\nN: 2");
+    remote_big.replace(remote_big.rfind("D: EASY\nN: 1"), 12, "D: MEDIUM\nN: 5");
+    std::ofstream{local / "big.deck"} << local_big;
+    std::ofstream{remote / "big.deck"} << remote_big;
+
+    SyncReport report = syncDeckLibraries(local, remote);
+    REQUIRE(report.files_scanned == 4);
+    REQUIRE(report.files_copied == 2);
+    REQUIRE(report.files_unchanged == 1);
+    REQUIRE(report.files_merged == 1);
+    REQUIRE(report.cards_merged == 2);
+    REQUIRE(report.matched_bytes > report.literal_bytes);
+
+    std::vector<FlashCardDeck> local_decks = loadFlashCardDecks(local);
+    std::vector<FlashCardDeck> remote_decks = loadFlashCardDecks(remote);
+    REQUIRE(local_decks.size() == 4);
+    REQUIRE(remote_decks.size() == 4);
+    for (const char *name : {"local_only.deck", "remote_only.deck", "same.deck", "big.deck"})
+    {
+        std::string a{};
+        std::string b{};
+        REQUIRE(readFileContents(local / name, a));
+        REQUIRE(readFileContents(remote / name, b));
+        REQUIRE(a == b);
+    }
+
+    FlashCardDeck big = readFlashCardDeck(local / "big.deck");
+    REQUIRE(big.cards[0].difficulty == HARD);
+    REQUIRE(big.cards.back().difficulty == MEDIUM);
+    REQUIRE(big.cards.back().n_times_answered == 5);
+
+    // a second sync has nothing to do
+    SyncReport again = syncDeckLibraries(local, remote);
+    REQUIRE(again.files_unchanged == 4);
+    REQUIRE(again.literal_bytes == 0);
+
+    SECTION("Deletions are synced")
+    {
+        // a deck deleted here, a deck deleted there but studied here, and a card deleted there
+        fs::remove(local / "local_only.deck");
+        fs::remove(remote / "remote_only.deck");
+        std::ofstream{local / "remote_only.deck"} << "Remote\nQ: r\nA: r\nD: HARD\nN: 1\n-\n";
+        std::string remote_same = shared;
+        remote_same.erase(0, remote_same.find("Q: sync question 1\n"));
+        remote_same.insert(0, "Sync deck\nV: 2\n");
+        FlashCardDeck remote_deck = parseFlashCardDeck(std::string{remote_same});
+        REQUIRE(writeFlashCardDeck(remote_deck, remote / "same.deck"));
+
+        SyncReport deleted = syncDeckLibraries(local, remote);
+        REQUIRE(deleted.files_deleted == 1);
+        REQUIRE(deleted.files_copied == 1);
+        REQUIRE(deleted.cards_deleted == 1);
+        REQUIRE_FALSE(fs::exists(remote / "local_only.deck"));
+        REQUIRE(fs::exists(remote / "remote_only.deck"));
+        FlashCardDeck same = readFlashCardDeck(local / "same.deck");
+        REQUIRE(same.cards.size() == 999);
+        REQUIRE(same.cards[0].question == "sync question 1");
+
+        // the deleted deck can still be restored from the backups
+        DeckBackupStore store{DeckBackupStore::storeDirFor(remote)};
+        REQUIRE_FALSE(store.listSnapshots("local_only.deck").empty());
+    }
+
+    fs::remove_all(local);
+    fs::remove_all(remote);
+}
@@ -1,8 +1,12 @@
 #include "deck.h"
+#include "deck_backup.h"
+#include "deck_format.h"
+#include "deck_loader.h"
 #include <catch2/catch_test_macros.hpp>
 #include <sstream>
 
 #include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -101,21 +105,16 @@ TEST_CASE("Deck reading and writing")
 
     SECTION("writing")
     {
-        std::filesystem::path app_path = getAppPath();
-        std::filesystem::path decks_dir = app_path;
-        decks_dir.append("Decks");
-        std::filesystem::path new_deck = decks_dir;
-        new_deck.append("new.deck");
-        // std::cerr << "new deck path:" << new_deck << std::endl;
-
-        if (std::filesystem::exists(new_deck))
-        {
-            std::cerr << "REMOVING FILE Decks/new.deck" << std::endl;
-            std::filesystem::remove(new_deck);
-        }
+        // a directory of its own, so neither the deck nor its backup store is left in the app's deck directory
+        std::filesystem::path decks_dir = std::filesystem::temp_directory_path() / "sd_deck_write_test";
+        std::filesystem::remove_all(decks_dir);
+        std::filesystem::create_directories(decks_dir);
+        std::filesystem::path new_deck = decks_dir / "new.deck";
+
         REQUIRE(writeFlashCardDeckWithChecks(example_decks.at(1), new_deck, false));
         // force overwrite
         REQUIRE(writeFlashCardDeck(example_decks.at(1), new_deck));
+        std::filesystem::remove_all(decks_dir);
     }
 
     SECTION("reading")
@@ -147,7 +146,7 @@ TEST_CASE("Deck reading and writing")
         std::string c4 = fc4.stringCardAsTemplate();
         std::string c5 = fc5.stringCardAsTemplate();
         FlashCardDeck fd1{"test example deck 1", "", std::vector<FlashCard>{fc1, fc2, fc3, fc4, fc5}};
-        REQUIRE(oss.str() == fd1.name + "\n" + c1 + c2 + c3 + c4 + c5);
+        REQUIRE(oss.str() == fd1.name + "\nV: 2\n" + c1 + c2 + c3 + c4 + c5);
         oss.clear();
         oss.str("");
 
@@ -178,3 +177,128 @@ TEST_CASE("enum converters")
     REQUIRE(strToCardDifficulty("MEDIUM") == MEDIUM);
     REQUIRE(strToCardDifficulty("HARD") == HARD);
 }
+
+TEST_CASE("Deck and card tags")
+{
+    REQUIRE(strToTagList("geography,  capitals ,, europe").size() == 3);
+    REQUIRE(strToTagList("geography,  capitals ,, europe")[1] == "capitals");
+    REQUIRE(strToTagList("").empty());
+    REQUIRE(strToTagList(" , ").empty());
+    REQUIRE(tagListToStr({"geography", "capitals"}) == "geography, capitals");
+
+    FlashCard tagged{"q", "a", HARD, 2};
+    tagged.tags = {"one", "two words"};
+    REQUIRE(tagged.stringCardAsTemplate() == "Q: q\nA: a\nD: HARD\nN: 2\nT: one, two words\n-\n");
+    // cards without tags are written exactly as before
+    REQUIRE(FlashCard("q", "a", HARD, 2).stringCardAsTemplate() == "Q: q\nA: a\nD: HARD\nN: 2\n-\n");
+
+    FlashCardDeck deck{"Tagged", "", std::vector<FlashCard>{tagged, FlashCard("q2", "a2", EASY, 0)}};
+    deck.tags = {"geography"};
+    std::filesystem::path deck_file = std::filesystem::temp_directory_path() / "studydungeon_tagged.deck";
+    REQUIRE(writeFlashCardDeck(deck, deck_file));
+
+    std::ifstream inf{deck_file};
+    std::string line;
+    std::getline(inf, line);
+    std::getline(inf, line);
+    REQUIRE(line == "V: 2");
+    std::getline(inf, line);
+    REQUIRE(line == "DT: geography");
+    inf.close();
+
+    FlashCardDeck read = readFlashCardDeck(deck_file);
+    REQUIRE(read.tags == std::vector<std::string>{"geography"});
+    REQUIRE(read.cards.size() == 2);
+    REQUIRE(read.cards[0].tags == std::vector<std::string>{"one", "two words"});
+    REQUIRE(read.cards[1].tags.empty());
+    std::filesystem::remove(deck_file);
+}
+
+TEST_CASE("Saving an edited card in place")
+{
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "studydungeon_patch";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::filesystem::path deck_file = dir / "patch.deck";
+    std::ofstream{deck_file, std::ios::binary}
+        << "Patch\r\nDT: geo\r\nQ: What is the capital of France?\r\nA: Paris\r\nD: EASY\r\nN: 1\r\n-\r\n"
+        << "Q: second\nA: card\n-\nQ: no end\nA: line";
+
+    FlashCardDeck deck = readFlashCardDeck(deck_file);
+    deck.filename = deck_file;
+    REQUIRE(deck.cards.size() == 3);
+    REQUIRE(deck.card_slots.size() == 3);
+    REQUIRE(deck.indexed_size == std::filesystem::file_size(deck_file));
+    REQUIRE(deck.card_slots[0].offset == 16);
+    REQUIRE(deck.card_slots[1].offset == deck.card_slots[0].offset + deck.card_slots[0].length);
+    // the last card has no "-" line so it can only be saved by a rewrite
+    REQUIRE(deck.card_slots[2].length == 0);
+
+    SECTION("a card that fits is written over its slot")
+    {
+        deck.cards[0].answer = "Paris!";
+        deck.cards[0].difficulty = HARD;
+        REQUIRE(patchFlashCard(deck, 0));
+        REQUIRE(std::filesystem::file_size(deck_file) == deck.indexed_size);
+
+        FlashCardDeck read = readFlashCardDeck(deck_file);
+        REQUIRE(read.tags == std::vector<std::string>{"geo"});
+        REQUIRE(read.cards.size() == 3);
+        REQUIRE(read.cards[0].answer == "Paris!");
+        REQUIRE(read.cards[0].difficulty == HARD);
+        REQUIRE(read.cards[1].question == "second");
+        // padding stays inside the card's slot
+        REQUIRE(read.card_slots[0].length == deck.card_slots[0].length);
+
+        // the patch leaves the snapshot to the editor, which backs the file up when it is done with the deck
+        BackupSnapshot latest{};
+        REQUIRE_FALSE(DeckBackupStore{DeckBackupStore::storeDirFor(dir)}.latestSnapshot("patch.deck", latest));
+        REQUIRE(backupDeckFile(deck_file) != 0);
+        DeckBackupStore store{DeckBackupStore::storeDirFor(dir)};
+        REQUIRE(store.latestSnapshot("patch.deck", latest));
+        std::string backed_up{};
+        std::string contents{};
+        REQUIRE(store.readSnapshot(latest.id, backed_up));
+        REQUIRE(readFileContents(deck_file, contents));
+        REQUIRE(backed_up == contents);
+        deck.cards[0].answer = "Paris?";
+        REQUIRE(patchFlashCard(deck, 0));
+    }
+
+    SECTION("a card that outgrows its slot rewrites the deck with padding")
+    {
+        deck.cards[1].answer = "a much longer answer than the slot has room for";
+        REQUIRE_FALSE(patchFlashCard(deck, 1));
+        REQUIRE(saveEditedFlashCard(deck, 1));
+        REQUIRE(std::filesystem::file_size(deck_file) == deck.indexed_size);
+
+        // the rebuilt index allows growing a card by up to the padding
+        deck.cards[2].answer += std::string(cardSlotPadding, 'x');
+        REQUIRE(patchFlashCard(deck, 2));
+        FlashCardDeck read = readFlashCardDeck(deck_file);
+        REQUIRE(read.cards.size() == 3);
+        REQUIRE(read.cards[1].answer == deck.cards[1].answer);
+        REQUIRE(read.cards[2].answer == deck.cards[2].answer);
+    }
+
+    SECTION("the index is not used once the file has changed size")
+    {
+        std::ofstream{deck_file, std::ios::binary | std::ios::app} << "\n";
+        deck.cards[0].answer = "Lyon";
+        REQUIRE_FALSE(patchFlashCard(deck, 0));
+    }
+
+    SECTION("the index is not used once the file has been written")
+    {
+        // same size, other contents
+        std::string contents{};
+        REQUIRE(readFileContents(deck_file, contents));
+        contents.replace(contents.find("second"), 6, "SECOND");
+        std::ofstream{deck_file, std::ios::binary | std::ios::trunc} << contents;
+        std::filesystem::last_write_time(deck_file, deck.indexed_time + std::chrono::seconds{1});
+        deck.cards[0].answer = "Lyon";
+        REQUIRE_FALSE(patchFlashCard(deck, 0));
+    }
+
+    std::filesystem::remove_all(dir);
+}
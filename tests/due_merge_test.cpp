@@ -0,0 +1,141 @@
+#include "due_merge.h"
+#include "deck.h"
+#include "deck_library.h"
+#include "scheduler.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+TEST_CASE("Merged study of every due card in a library")
+{
+    fs::path dir = fs::temp_directory_path() / "sd_due_merge_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // deck d has a card due d * 10 + c seconds ago for every third deck, the rest have nothing due
+    const int64_t now = scheduleNow();
+    const size_t n_decks = 30;
+    for (size_t d = 0; d < n_decks; ++d)
+    {
+        FlashCardDeck deck{"Deck " + std::to_string(d), "", std::vector<FlashCard>{}};
+        for (size_t c = 0; c < 5; ++c)
+        {
+            deck.cards.emplace_back("Question " + std::to_string(d) + "." + std::to_string(c), "Answer", MEDIUM, 1);
+            deck.cards.back().schedule.due = d % 3 == 0 ? now - 1000 + static_cast<int64_t>(d * 10 + c) : now + 1000;
+        }
+        deck.filename = dir / ("Deck_" + std::to_string(d) + ".deck");
+        REQUIRE(writeFlashCardDeck(deck, deck.filename));
+    }
+
+    // room for only a few decks, the rest are evicted to their metadata
+    DeckLibrary library{4096};
+    library.load(dir);
+    REQUIRE(library.size() == n_decks);
+    size_t n_due_decks = 0;
+    for (size_t i = 0; i < library.size(); ++i)
+    {
+        n_due_decks += library.nextDue(i) != 0 && library.nextDue(i) <= now ? 1 : 0;
+    }
+    REQUIRE(n_due_decks == 10);
+
+    // the directory is listed in no particular order
+    auto indexOf = [&library](const std::string &name) {
+        size_t i = 0;
+        while (i < library.size() && library.name(i) != name)
+        {
+            i++;
+        }
+        return i;
+    };
+
+    SECTION("cards come out in due order across decks")
+    {
+        DueMerge merge{library, now, 1000};
+        DueCard origin{};
+        FlashCard card{};
+        std::vector<DueCard> taken{};
+        while (merge.next(origin, card))
+        {
+            REQUIRE(card.schedule.due == origin.due);
+            REQUIRE(card.question.rfind("Question ", 0) == 0);
+            taken.push_back(origin);
+        }
+        REQUIRE(taken.size() == 50);
+        for (size_t i = 1; i < taken.size(); ++i)
+        {
+            REQUIRE(taken[i - 1].due <= taken[i].due);
+        }
+        REQUIRE(merge.decksOpened() == 10);
+    }
+
+    SECTION("decks whose cards are not needed are never opened")
+    {
+        DueMerge merge{library, now, 7};
+        DueCard origin{};
+        FlashCard card{};
+        size_t n_taken = 0;
+        while (merge.next(origin, card))
+        {
+            n_taken++;
+        }
+        REQUIRE(n_taken == 7);
+        // the five cards of the first due deck then two of the next
+        REQUIRE(merge.decksOpened() == 2);
+    }
+
+    SECTION("reviews are written back to their decks")
+    {
+        DueMerge merge{library, now, 6};
+        DueCard origin{};
+        FlashCard card{};
+        while (merge.next(origin, card))
+        {
+            card.n_times_answered++;
+            reviewCard(card, GOOD_RATING, now, SM2_SCHEDULER);
+            merge.record(origin, card);
+        }
+        REQUIRE(merge.pendingCount() == 6);
+        REQUIRE(merge.writeBack() == 2);
+        REQUIRE(merge.pendingCount() == 0);
+
+        FlashCardDeck first = readFlashCardDeck(library.filename(indexOf("Deck 0")));
+        for (const FlashCard &reviewed : first.cards)
+        {
+            REQUIRE(reviewed.n_times_answered == 2);
+            REQUIRE(reviewed.schedule.due > now);
+        }
+        size_t second_index = indexOf("Deck 3");
+        FlashCardDeck second = readFlashCardDeck(library.filename(second_index));
+        REQUIRE(second.cards[0].n_times_answered == 2);
+        REQUIRE(second.cards[1].n_times_answered == 1);
+        REQUIRE(library.nextDue(second_index) == second.cards[1].schedule.due);
+
+        // a fresh merge no longer sees the reviewed cards
+        DueMerge again{library, now, 1000};
+        size_t n_left = 0;
+        while (again.next(origin, card))
+        {
+            n_left++;
+        }
+        REQUIRE(n_left == 44);
+    }
+
+    SECTION("a review is dropped if its card was changed")
+    {
+        DueMerge merge{library, now, 1};
+        DueCard origin{};
+        FlashCard card{};
+        REQUIRE(merge.next(origin, card));
+        library.deck(origin.deck).cards[origin.card].question = "Edited";
+        card.n_times_answered = 9;
+        merge.record(origin, card);
+        REQUIRE(merge.writeBack() == 0);
+        REQUIRE(library.deck(origin.deck).cards[origin.card].n_times_answered == 1);
+    }
+
+    fs::remove_all(dir);
+}
@@ -1,16 +1,46 @@
 #include "flashcard_scene.h"
+#include "leech.h"
 #include "menu.h"
+#include "review_log.h"
+#include "scheduler.h"
+#include "statistics_scene.h"
 #include "util.h"
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// a deck directory of its own for the review log a scene writes, removed at the end of the test
+struct TestDeckDir
+{
+    explicit TestDeckDir(const std::string &name) : path(fs::temp_directory_path() / name)
+    {
+        fs::remove_all(path);
+        fs::create_directories(path);
+        settings.setDeckDir(path);
+    }
+    ~TestDeckDir()
+    {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+    }
+
+    fs::path path;
+    StudySettings settings{};
+};
+
 
 TEST_CASE("FlashcardScene::updateCardDifficulty() updates card difficulty and times answered", "[flashcard_scene]")
 {
+    TestDeckDir deckDir{"sd_flashcard_update_test"};
     // Arrange
     ConsoleUI::UIManager uiManager;
     FlashCardDeck deck;
     deck.cards.push_back(FlashCard{"Question 1", "Answer 1", EASY, 0});
-    StudySettings studySettings;
+    StudySettings &studySettings = deckDir.settings;
     FlashcardApp::FlashcardScene
         scene(uiManager, deck, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, studySettings);
     size_t cardIndex = 0;
@@ -22,6 +52,286 @@ TEST_CASE("FlashcardScene::updateCardDifficulty() updates card difficulty and ti
     // Assert
     REQUIRE(scene.m_deck.cards[scene.m_cardOrder[cardIndex]].difficulty == newDifficulty);
     REQUIRE(scene.m_deck.cards[scene.m_cardOrder[cardIndex]].n_times_answered == 1);
+    REQUIRE(scene.m_deck.cards[scene.m_cardOrder[cardIndex]].schedule.due > scheduleNow());
+}
+
+TEST_CASE("FlashcardScene suspends a card that becomes a leech", "[flashcard_scene]")
+{
+    TestDeckDir deckDir{"sd_flashcard_leech_test"};
+    ConsoleUI::UIManager uiManager;
+    FlashCardDeck deck;
+    // a new card marked HARD every time is never learnt, so it never lapses
+    deck.cards.push_back(FlashCard{"Question 1", "Answer 1", UNKNOWN, 0});
+    StudySettings &studySettings = deckDir.settings;
+    FlashcardApp::FlashcardScene
+        scene(uiManager, deck, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, studySettings);
+
+    int threshold = studySettings.getLeechThreshold();
+    for (int i = 0; i < threshold; ++i)
+    {
+        REQUIRE_FALSE(isLeech(scene.m_deck.cards[0]));
+        scene.updateCardDifficulty(0, HARD);
+    }
+
+    REQUIRE(scene.m_deck.cards[0].schedule.lapses == 0);
+    REQUIRE(scene.m_deck.cards[0].schedule.failures == static_cast<uint32_t>(threshold));
+    REQUIRE(isLeech(scene.m_deck.cards[0]));
+    REQUIRE(isSuspended(scene.m_deck.cards[0]));
+    REQUIRE(scene.m_leechesFound == 1);
+}
+
+TEST_CASE("FlashcardScene plans a session to fit its study time", "[flashcard_scene]")
+{
+    TestDeckDir deckDir{"sd_flashcard_plan_test"};
+    ConsoleUI::UIManager uiManager;
+    FlashCardDeck deck{"Timed plan", "", std::vector<FlashCard>{}};
+    for (int i = 0; i < 20; ++i)
+    {
+        deck.cards.push_back(FlashCard{"Question " + std::to_string(i), "Answer", UNKNOWN, 0});
+    }
+    StudySettings &studySettings = deckDir.settings;
+    studySettings.setFlashCardLimit(10);
+    studySettings.setStudyDurationMin(1);
+    FlashcardApp::FlashcardScene
+        scene(uiManager, deck, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, studySettings);
+    REQUIRE(scene.m_rankedCards.size() == 20);
+    REQUIRE(!scene.m_cardOrder.empty());
+    REQUIRE(scene.m_cardOrder.size() <= 10);
+
+    // cards taking 20 seconds each, two fit in what is left of the minute
+    scene.m_latency = LatencyModel{};
+    for (size_t card : scene.m_rankedCards)
+    {
+        scene.m_latency.observe(scene.cardReviewId(card), 20);
+    }
+    scene.planSession(0);
+    REQUIRE(scene.m_cardOrder.size() == 2);
+    size_t first = scene.m_cardOrder[0];
+
+    // at twice the expected speed the rest of the session is planned again with more
+    scene.m_expectedSeconds = 10;
+    scene.m_actualSeconds = 5;
+    scene.planSession(1);
+    REQUIRE(scene.m_cardOrder.size() == 6);
+    REQUIRE(scene.m_cardOrder[0] == first);
+    REQUIRE(std::count(scene.m_cardOrder.begin(), scene.m_cardOrder.end(), first) == 1);
+
+    // and with nothing more when the user is too slow for another card
+    scene.m_actualSeconds = 40;
+    scene.planSession(1);
+    REQUIRE(scene.m_cardOrder.size() == 1);
+
+    // quicker cards are planned before slower ones
+    scene.m_latency = LatencyModel{};
+    for (size_t i = 0; i < scene.m_rankedCards.size(); ++i)
+    {
+        scene.m_latency.observe(scene.cardReviewId(scene.m_rankedCards[i]), i < 10 ? 20 : 1);
+    }
+    scene.m_expectedSeconds = 0;
+    scene.m_actualSeconds = 0;
+    scene.planSession(0);
+    REQUIRE(scene.m_cardOrder.size() == 10);
+    for (size_t card : scene.m_cardOrder)
+    {
+        REQUIRE(scene.m_latency.estimate(scene.cardReviewId(card)) == 1);
+    }
+}
+
+TEST_CASE("FlashcardScene logs how long a card took to answer and grade", "[flashcard_scene]")
+{
+    TestDeckDir deckDir{"sd_flashcard_timing_test"};
+    ConsoleUI::UIManager uiManager;
+    FlashCardDeck deck{"Timed", "", std::vector<FlashCard>{}};
+    deck.cards.push_back(FlashCard{"Question 1", "Answer 1", EASY, 0});
+    deck.cards.push_back(FlashCard{"Question 2", "Answer 2", EASY, 0});
+    StudySettings &studySettings = deckDir.settings;
+    FlashcardApp::FlashcardScene
+        scene(uiManager, deck, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, studySettings);
+
+    // question drawn 1.5 s ago, answer revealed 0.5 s ago
+    auto now = std::chrono::steady_clock::now();
+    scene.m_questionShownAt = now - std::chrono::milliseconds(1500);
+    scene.m_answerShownAt = now - std::chrono::milliseconds(500);
+    size_t card = scene.m_cardOrder[0];
+    scene.updateCardDifficulty(card, EASY);
+
+    REQUIRE(scene.m_lastReview.response_ms == 1000);
+    REQUIRE(scene.m_lastReview.grade_ms >= 500);
+    REQUIRE(scene.m_lastReview.grade_ms < 5000);
+    REQUIRE(scene.m_lastReview.grade == EASY_RATING);
+    REQUIRE(scene.m_lastReview.card_id == reviewCardId("Timed", scene.m_deck.cards[card]));
+
+    // the next card starts untimed, a card graded without being shown logs no times
+    scene.nextCard();
+    REQUIRE(scene.m_questionShownAt == std::chrono::steady_clock::time_point{});
+    scene.updateCardDifficulty(scene.m_cardOrder[1], HARD);
+    REQUIRE(scene.m_lastReview.response_ms == 0);
+    REQUIRE(scene.m_lastReview.grade_ms == 0);
+}
+
+TEST_CASE("FlashcardScene writes its reviews to the log every few seconds", "[flashcard_scene]")
+{
+    TestDeckDir deckDir{"sd_flashcard_checkpoint_test"};
+    ConsoleUI::UIManager uiManager;
+    FlashCardDeck deck{"Logged", "", std::vector<FlashCard>{}};
+    deck.cards.push_back(FlashCard{"Question 1", "Answer 1", EASY, 0});
+    deck.cards.push_back(FlashCard{"Question 2", "Answer 2", EASY, 0});
+    FlashcardApp::FlashcardScene
+        scene(uiManager, deck, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, deckDir.settings);
+    fs::path log_file = reviewLogFileFor(deckDir.path);
+
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(scene.checkpointReviewLog(start + std::chrono::hours(1)));
+    scene.updateCardDifficulty(scene.m_cardOrder[0], EASY);
+    // only buffered until the delay has passed
+    REQUIRE_FALSE(scene.checkpointReviewLog(scene.m_reviewLogCheckpointAt));
+    REQUIRE(ReviewLogReader{log_file}.size() == 0);
+    REQUIRE(scene.checkpointReviewLog(start + FlashcardApp::FlashcardScene::reviewLogCheckpointDelay));
+    REQUIRE(ReviewLogReader{log_file}.size() == 1);
+}
+
+TEST_CASE("FlashcardScene::initializeCardOrder() studies due cards first", "[flashcard_scene]")
+{
+    TestDeckDir deckDir{"sd_flashcard_due_test"};
+    ConsoleUI::UIManager uiManager;
+    FlashCardDeck deck;
+    for (int i = 0; i < 40; ++i)
+    {
+        deck.cards.push_back(FlashCard{"Question " + std::to_string(i), "Answer", MEDIUM, 0});
+    }
+    // cards deep in the deck that are overdue, the most overdue should be first
+    int64_t now = scheduleNow();
+    deck.cards[35].schedule.due = now - 100;
+    deck.cards[30].schedule.due = now - 5000;
+    deck.cards[20].schedule.due = now + 5000;
+    StudySettings &studySettings = deckDir.settings;
+    studySettings.setFlashCardLimit(5);
+    FlashcardApp::FlashcardScene
+        scene(uiManager, deck, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, studySettings);
+
+    REQUIRE(scene.m_cardOrder.size() == 5);
+    REQUIRE(scene.m_cardOrder[0] == 30);
+    REQUIRE(scene.m_cardOrder[1] == 35);
+    for (size_t i = 2; i < scene.m_cardOrder.size(); ++i)
+    {
+        REQUIRE(scene.m_cardOrder[i] != 20);
+    }
+}
+
+TEST_CASE("FlashcardScene::initializeCardOrder() picks from the whole deck", "[flashcard_scene]")
+{
+    TestDeckDir deckDir{"sd_flashcard_order_test"};
+    ConsoleUI::UIManager uiManager;
+    FlashCardDeck deck;
+    for (int i = 0; i < 10000; ++i)
+    {
+        deck.cards.push_back(FlashCard{"Question " + std::to_string(i), "Answer", MEDIUM, i % 2});
+    }
+    StudySettings &studySettings = deckDir.settings;
+    studySettings.setFlashCardLimit(15);
+    FlashcardApp::FlashcardScene
+        scene(uiManager, deck, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, studySettings);
+
+    // unseen cards are taken from anywhere in the deck, never twice
+    REQUIRE(scene.m_cardOrder.size() == 15);
+    std::vector<size_t> order = scene.m_cardOrder;
+    std::sort(order.begin(), order.end());
+    REQUIRE(std::adjacent_find(order.begin(), order.end()) == order.end());
+    REQUIRE(order.back() >= 15);
+    for (size_t i : order)
+    {
+        REQUIRE(scene.m_deck.cards[i].n_times_answered == 0);
+    }
+
+    // once every card has been seen they are drawn by weight, still without repeats
+    for (auto &card : scene.m_deck.cards)
+    {
+        card.n_times_answered = 1;
+    }
+    scene.initializeCardOrder();
+    order = scene.m_cardOrder;
+    std::sort(order.begin(), order.end());
+    REQUIRE(order.size() == 15);
+    REQUIRE(std::adjacent_find(order.begin(), order.end()) == order.end());
+}
+
+TEST_CASE("FlashcardScene studies the due cards of a whole library", "[flashcard_scene]")
+{
+    TestDeckDir deckDir{"sd_flashcard_library_test"};
+    ConsoleUI::UIManager uiManager;
+    int64_t now = scheduleNow();
+    DeckLibrary library{};
+    for (int d = 0; d < 3; ++d)
+    {
+        FlashCardDeck deck{"Deck " + std::to_string(d), "", std::vector<FlashCard>{}};
+        for (int c = 0; c < 4; ++c)
+        {
+            deck.cards.push_back(FlashCard{"Question " + std::to_string(c), "Answer", MEDIUM, 1});
+            deck.cards.back().schedule.due = c < 2 ? now - 100 * (d + 1) - c : now + 1000;
+        }
+        library.add(deck);
+    }
+    StudySettings &studySettings = deckDir.settings;
+    studySettings.setFlashCardLimit(5);
+    FlashcardApp::FlashcardScene
+        scene(uiManager, library, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, studySettings);
+
+    // the longest overdue cards come first, from whichever deck holds them
+    REQUIRE(scene.m_cardOrder.size() == 5);
+    REQUIRE(scene.m_dueOrigins.size() == 5);
+    REQUIRE(scene.m_dueOrigins[0].deck == 2);
+    REQUIRE(scene.m_dueOrigins[0].card == 1);
+    REQUIRE(scene.m_dueOrigins[4].deck == 0);
+    for (size_t i = 1; i < scene.m_dueOrigins.size(); ++i)
+    {
+        REQUIRE(scene.m_dueOrigins[i - 1].due <= scene.m_dueOrigins[i].due);
+    }
+
+    scene.updateCardDifficulty(scene.m_cardOrder[0], EASY);
+    REQUIRE(scene.m_dueMerge->pendingCount() == 1);
+}
+
+TEST_CASE("FlashcardScene keeps the study queue of a deck file", "[flashcard_scene]")
+{
+    TestDeckDir deckDir{"sd_flashcard_queue_test"};
+    fs::path dir = deckDir.path;
+    FlashCardDeck deck{"Queue deck", "", std::vector<FlashCard>{}};
+    for (int c = 0; c < 8; ++c)
+    {
+        deck.cards.push_back(FlashCard{"Question " + std::to_string(c), "Answer", EASY, 0});
+    }
+    deck.filename = dir / "Queue_deck.deck";
+    REQUIRE(writeFlashCardDeck(deck, deck.filename));
+
+    ConsoleUI::UIManager uiManager;
+    StudySettings &studySettings = deckDir.settings;
+    studySettings.setFlashCardLimit(5);
+    std::vector<size_t> studied{};
+    {
+        FlashcardApp::FlashcardScene
+            scene(uiManager, deck, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, studySettings);
+        REQUIRE(scene.m_cardOrder.size() == 5);
+        studied = scene.m_cardOrder;
+        // the last card ends the session, which saves the deck and then its queue
+        for (size_t i = 0; i < studied.size(); ++i)
+        {
+            scene.updateCardDifficulty(scene.m_cardOrder[scene.m_currentCardIndex], EASY);
+            scene.nextCard();
+        }
+    }
+    REQUIRE(fs::exists(StudyQueue::queueFileFor(deck.filename)));
+
+    // the next session starts with the cards not yet studied
+    FlashCardDeck saved = readFlashCardDeck(deck.filename);
+    saved.filename = deck.filename;
+    FlashcardApp::FlashcardScene
+        scene(uiManager, saved, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, studySettings);
+    REQUIRE(scene.m_currentCardIndex == 0);
+    REQUIRE(scene.m_studyQueue->newCount() == 3);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        REQUIRE(std::find(studied.begin(), studied.end(), scene.m_cardOrder[i]) == studied.end());
+    }
 }
 
 TEST_CASE("BrowseDecksScene::loadDecks() loads decks correctly", "[browse_decks_scene]")
@@ -42,15 +352,75 @@ TEST_CASE("BrowseDecksScene::loadDecks() loads decks correctly", "[browse_decks_
     REQUIRE(scene.m_currentPage == 0);
 }
 
+TEST_CASE("StatisticsScene shows the statistics of the review log", "[statistics_scene]")
+{
+    TestDeckDir deckDir{"sd_statistics_scene_test"};
+    const int64_t day_ms = 24 * 60 * 60 * 1000;
+    const int64_t now = reviewTimeNowMs();
+    const int64_t today = now - now % day_ms;
+    auto review = [&](uint64_t card, const std::string &deck, int64_t time_ms, uint8_t grade, int64_t due_ms) {
+        ReviewRecord record{};
+        record.card_id = card;
+        record.deck_id = reviewDeckId(deck);
+        record.time_ms = time_ms;
+        record.session_id = 1;
+        record.due = due_ms / 1000;
+        record.response_ms = 1000;
+        record.grade_ms = 500;
+        record.grade = grade;
+        return record;
+    };
+    {
+        ReviewLogWriter writer{reviewLogFileFor(deckDir.path)};
+        // card 1 is reviewed again after two days and is due in two days, card 2 is forgotten and due today
+        writer.append(review(1, "Stats deck", today - 2 * day_ms + 1000, GOOD_RATING, today + 2 * day_ms + 3600000));
+        writer.append(review(1, "Stats deck", today + 1000, GOOD_RATING, today + 2 * day_ms + 3600000));
+        writer.append(review(2, "Stats deck", today + 2000, AGAIN_RATING, today + 60000));
+        // a deck no longer in the library
+        writer.append(review(3, "Gone deck", today + 3000, EASY_RATING, today + 5 * day_ms + 60000));
+    }
+
+    DeckLibrary library{};
+    FlashCardDeck deck{"Stats deck", "", std::vector<FlashCard>{}};
+    deck.cards.push_back(FlashCard{"Q1", "A1", MEDIUM, 2});
+    deck.cards.push_back(FlashCard{"Q2", "A2", HARD, 5});
+    deck.cards[1].tags = {leechTag, suspendedTag};
+    library.add(deck);
+    ConsoleUI::UIManager uiManager;
+    FlashcardApp::StatisticsScene scene(uiManager, library, deckDir.settings, []() {});
+
+    REQUIRE(scene.m_stats.reviews == 4);
+    REQUIRE(scene.m_stats.cards == 3);
+    REQUIRE(scene.m_stats.passed == 3);
+    REQUIRE(scene.m_stats.retention_reviews[2] == 1);
+    REQUIRE(scene.m_stats.retention_passed[2] == 1);
+    std::vector<uint64_t> forecast(30, 0);
+    forecast[0] = forecast[2] = forecast[5] = 1;
+    REQUIRE(scene.m_stats.forecast == forecast);
+
+    auto has_line = [&scene](const std::string &line) {
+        return std::find(scene.m_lines.begin(), scene.m_lines.end(), line) != scene.m_lines.end();
+    };
+    REQUIRE(scene.m_lines[0] == "Reviews: 4   Cards: 3   Accuracy: 75%   Time spent: 0h 0m");
+    REQUIRE(scene.m_lines[1] == "Days studied: 2   Streak: 1 days   Longest streak: 1 days   Reviews today: 3");
+    REQUIRE(has_line("  Stats deck                      67%   3 reviews"));
+    REQUIRE(has_line("  (removed deck)                  100%  1 reviews"));
+    REQUIRE(has_line("Leeches: 1   Suspended cards: 1   Study filter for them: tag = leech"));
+    REQUIRE(has_line("  Today: 1      +1d: 0        +2d: 1        +3d: 0        "
+                     "+4d: 0        +5d: 1        +6d: 0        "));
+    REQUIRE(scene.m_lines.back().rfind("Computed from 4 reviews in ", 0) == 0);
+}
+
 
 TEST_CASE("FlashcardScene::nextCard() moves to the next card correctly", "[flashcard_scene]")
 {
+    TestDeckDir deckDir{"sd_flashcard_next_test"};
     // Arrange
     ConsoleUI::UIManager uiManager;
     FlashCardDeck deck;
     deck.cards.push_back(FlashCard{"Question 1", "Answer 1", EASY, 0});
     deck.cards.push_back(FlashCard{"Question 2", "Answer 2", MEDIUM, 1});
-    StudySettings studySettings;
+    StudySettings &studySettings = deckDir.settings;
     FlashcardApp::FlashcardScene
         scene(uiManager, deck, []() {}, []() {}, [](const std::vector<int> &, int, bool) {}, studySettings);
 
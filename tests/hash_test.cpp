@@ -0,0 +1,44 @@
+#include "hash.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+TEST_CASE("SHA-256 known digests")
+{
+    REQUIRE(sha256Hex("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    REQUIRE(sha256Hex("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    REQUIRE(sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    REQUIRE(sha256Hex(std::string(1000000, 'a')) ==
+            "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST_CASE("SHA-256 incremental updates match a single update")
+{
+    std::string data{};
+    for (int i = 0; i < 1000; ++i)
+    {
+        data += static_cast<char>(i * 7);
+    }
+    // split at awkward sizes so partial blocks are carried between updates
+    Sha256 hasher{};
+    size_t pos = 0;
+    size_t step = 1;
+    while (pos < data.size())
+    {
+        size_t len = (data.size() - pos) < step ? data.size() - pos : step;
+        hasher.update(std::string_view{data}.substr(pos, len));
+        pos += len;
+        step = step * 3 + 1;
+    }
+    REQUIRE(hasher.hexDigest() == sha256Hex(data));
+}
+
+TEST_CASE("FNV-1a")
+{
+    REQUIRE(fnv1a64("") == 14695981039346656037ULL);
+    REQUIRE(fnv1a64("a") == 0xaf63dc4c8601ec8cULL);
+    REQUIRE(fnv1a64("foobar") == 0x85944171f73967e8ULL);
+    // hashing in pieces gives the same result
+    REQUIRE(fnv1a64("bar", fnv1a64("foo")) == fnv1a64("foobar"));
+}
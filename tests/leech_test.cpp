@@ -0,0 +1,148 @@
+#include "leech.h"
+#include "deck_library.h"
+#include "scheduler.h"
+#include "study_queue.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <vector>
+
+static FlashCard failedCard(uint32_t failures)
+{
+    FlashCard card{"Q", "A", HARD, static_cast<int>(failures)};
+    card.schedule.failures = failures;
+    return card;
+}
+
+TEST_CASE("Leech detection")
+{
+    SECTION("a card is a leech when its failures reach the threshold")
+    {
+        FlashCard card = failedCard(8);
+        REQUIRE(checkLeech(card, 7, 8, TAG_LEECH));
+        CHECK(isLeech(card));
+        CHECK(!isSuspended(card));
+        CHECK(card.tags == std::vector<std::string>{"leech"});
+    }
+
+    SECTION("suspending a leech also tags it suspended")
+    {
+        FlashCard card = failedCard(8);
+        card.tags.push_back("geography");
+        REQUIRE(checkLeech(card, 7, 8, SUSPEND_LEECH));
+        CHECK(card.tags == std::vector<std::string>{"geography", "leech", "suspended"});
+        CHECK(isSuspended(card));
+    }
+
+    SECTION("only reviews that add a failure are checked")
+    {
+        FlashCard card = failedCard(8);
+        CHECK(!checkLeech(card, 8, 8, SUSPEND_LEECH));
+        card = failedCard(7);
+        CHECK(!checkLeech(card, 6, 8, SUSPEND_LEECH));
+        CHECK(card.tags.empty());
+    }
+
+    SECTION("a leech is flagged again every half threshold")
+    {
+        FlashCard card = failedCard(8);
+        REQUIRE(checkLeech(card, 7, 8, TAG_LEECH));
+        for (uint32_t failures = 9; failures <= 16; ++failures)
+        {
+            card.schedule.failures = failures;
+            CHECK(checkLeech(card, failures - 1, 8, TAG_LEECH) == (failures == 12 || failures == 16));
+        }
+        // the tag is never added twice
+        CHECK(card.tags.size() == 1);
+    }
+
+    SECTION("a threshold of 0 finds no leeches")
+    {
+        FlashCard card = failedCard(100);
+        CHECK(!checkLeech(card, 99, 0, SUSPEND_LEECH));
+    }
+
+    SECTION("tags are not case sensitive")
+    {
+        FlashCard card = failedCard(0);
+        card.tags = {"Suspended"};
+        CHECK(isSuspended(card));
+        CHECK(!isLeech(card));
+        CHECK(cardHasTag(card, "SUSPENDED"));
+    }
+
+    SECTION("forgetting a card again and again through the scheduler")
+    {
+        FlashCard card{"Q", "A", UNKNOWN, 0};
+        int64_t now = 1'700'000'000;
+        size_t flagged = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            reviewCard(card, GOOD_RATING, now, SM2_SCHEDULER);
+            uint32_t failures = card.schedule.failures;
+            reviewCard(card, AGAIN_RATING, now, SM2_SCHEDULER);
+            flagged += checkLeech(card, failures, defaultLeechThreshold, SUSPEND_LEECH) ? 1 : 0;
+        }
+        CHECK(card.schedule.lapses == 8);
+        CHECK(card.schedule.failures == 8);
+        CHECK(flagged == 1);
+        CHECK(isSuspended(card));
+    }
+
+    SECTION("a card that is never learnt")
+    {
+        FlashCard card{"Q", "A", UNKNOWN, 0};
+        int64_t now = 1'700'000'000;
+        size_t flagged = 0;
+        for (uint32_t i = 0; i < defaultLeechThreshold; ++i)
+        {
+            uint32_t failures = card.schedule.failures;
+            reviewCard(card, AGAIN_RATING, now, FSRS_SCHEDULER);
+            flagged += checkLeech(card, failures, defaultLeechThreshold, TAG_LEECH) ? 1 : 0;
+        }
+        CHECK(card.schedule.lapses == 0);
+        CHECK(flagged == 1);
+        CHECK(isLeech(card));
+    }
+}
+
+TEST_CASE("Suspended cards are not studied")
+{
+    FlashCardDeck deck{};
+    for (int i = 0; i < 10; ++i)
+    {
+        deck.cards.emplace_back("Q" + std::to_string(i), "A", UNKNOWN, 0);
+    }
+    deck.cards[2].tags = {"suspended"};
+    deck.cards[5].tags = {"leech", "suspended"};
+    deck.cards[7].tags = {"leech"};
+    deck.cards[5].schedule.due = 1000;
+    const int64_t now = 2000;
+    Rng rng{3};
+
+    std::vector<size_t> order{};
+    selectStudyCards(deck, {}, 10, now, FORWARD_VIEW, rng, order);
+    CHECK(order.size() == 8);
+    CHECK(std::find(order.begin(), order.end(), 2) == order.end());
+    CHECK(std::find(order.begin(), order.end(), 5) == order.end());
+    CHECK(std::find(order.begin(), order.end(), 7) != order.end());
+
+    StudyQueue queue{};
+    queue.build(deck, rng);
+    CHECK(queue.scheduledCount() == 0);
+    CHECK(queue.newCount() == 8);
+
+    // a card suspended after the queue was built is skipped when planning
+    deck.cards[0].tags = {"suspended"};
+    CHECK(!queue.planSession(deck, 8, now, FORWARD_VIEW, order));
+    CHECK(order.size() == 7);
+
+    LeechCount count = countLeeches(deck.cards);
+    CHECK(count.leeches == 2);
+    CHECK(count.suspended == 3);
+
+    DeckLibrary library{};
+    library.add(deck);
+    CHECK(library.leechCount(0).leeches == 2);
+    CHECK(library.leechCount(0).suspended == 3);
+}
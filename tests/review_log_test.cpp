@@ -0,0 +1,190 @@
+#include "review_log.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static ReviewRecord makeReview(uint64_t i)
+{
+    ReviewRecord review{};
+    review.card_id = i * 7919 % 1000;
+    review.deck_id = i % 13;
+    review.time_ms = 1'700'000'000'000 + static_cast<int64_t>(i) * 1000;
+    review.session_id = i / 50;
+    review.due = 1'700'000'000 + static_cast<int64_t>(i) * 86400;
+    review.response_ms = static_cast<uint32_t>(i % 9000);
+    review.grade_ms = static_cast<uint32_t>(i % 700);
+    review.grade = static_cast<uint8_t>(1 + i % 4);
+    return review;
+}
+
+static bool sameReview(const ReviewRecord &a, const ReviewRecord &b)
+{
+    return a.card_id == b.card_id && a.deck_id == b.deck_id && a.time_ms == b.time_ms &&
+           a.session_id == b.session_id && a.due == b.due && a.response_ms == b.response_ms &&
+           a.grade_ms == b.grade_ms && a.grade == b.grade;
+}
+
+TEST_CASE("Review log")
+{
+    fs::path dir = fs::temp_directory_path() / "sd_review_log_test";
+    fs::remove_all(dir);
+    fs::path file = reviewLogFileFor(dir);
+
+    SECTION("records are buffered until a checkpoint")
+    {
+        ReviewLogWriter writer{file, 10};
+        for (uint64_t i = 0; i < 25; ++i)
+        {
+            writer.append(makeReview(i));
+        }
+        REQUIRE(writer.size() == 25);
+        REQUIRE(writer.pending() == 5);
+        REQUIRE(ReviewLogReader{file}.size() == 20);
+        REQUIRE(writer.checkpoint());
+        REQUIRE(writer.pending() == 0);
+        REQUIRE(ReviewLogReader{file}.size() == 25);
+    }
+
+    SECTION("records read back across blocks and reopened writers")
+    {
+        const uint64_t n = reviewLogBlockRecords * 2 + 123;
+        {
+            ReviewLogWriter writer{file};
+            for (uint64_t i = 0; i < reviewLogBlockRecords + 5; ++i)
+            {
+                writer.append(makeReview(i));
+            }
+        }
+        {
+            // a new writer carries on from the end of the partly filled block
+            ReviewLogWriter writer{file, 4096};
+            REQUIRE(writer.size() == reviewLogBlockRecords + 5);
+            for (uint64_t i = reviewLogBlockRecords + 5; i < n; ++i)
+            {
+                writer.append(makeReview(i));
+            }
+        }
+
+        ReviewLogReader reader{file};
+        REQUIRE(reader.ok());
+        REQUIRE(reader.size() == n);
+        REQUIRE(reader.blockCount() == 3);
+        uint64_t i = 0;
+        bool all_same = true;
+        REQUIRE(reader.scan([&](const ReviewColumns &columns) {
+            for (size_t r = 0; r < columns.size(); ++r, ++i)
+            {
+                all_same = all_same && sameReview(columns.record(r), makeReview(i));
+            }
+        }));
+        REQUIRE(i == n);
+        REQUIRE(all_same);
+    }
+
+    SECTION("only the columns asked for are read")
+    {
+        {
+            ReviewLogWriter writer{file};
+            for (uint64_t i = 0; i < 1000; ++i)
+            {
+                writer.append(makeReview(i));
+            }
+        }
+        ReviewLogReader reader{file};
+        ReviewColumns columns{};
+        REQUIRE(reader.readBlock(0, columns, GRADE_COLUMN | RESPONSE_COLUMN));
+        REQUIRE(columns.size() == 1000);
+        REQUIRE(columns.card_ids.empty());
+        REQUIRE(columns.times_ms.empty());
+        REQUIRE(columns.grade_ms.empty());
+        REQUIRE(columns.grades[999] == makeReview(999).grade);
+        REQUIRE(columns.response_ms[999] == makeReview(999).response_ms);
+        REQUIRE(columns.record(999).card_id == 0);
+        REQUIRE_FALSE(reader.readBlock(1, columns));
+    }
+
+    SECTION("a checkpoint cut short leaves the earlier records")
+    {
+        {
+            ReviewLogWriter writer{file};
+            for (uint64_t i = 0; i < 100; ++i)
+            {
+                writer.append(makeReview(i));
+            }
+        }
+        // values written past the count, as if the count was never updated
+        {
+            std::ofstream out{file, std::ios::binary | std::ios::app};
+            out << std::string(64, 'x');
+        }
+        ReviewLogReader reader{file};
+        REQUIRE(reader.size() == 100);
+        ReviewLogWriter writer{file};
+        REQUIRE(writer.size() == 100);
+    }
+
+    SECTION("files that are not review logs are refused")
+    {
+        fs::create_directories(file.parent_path());
+        std::ofstream{file} << "not a review log at all";
+        REQUIRE_FALSE(ReviewLogReader{file}.ok());
+        ReviewLogWriter writer{file};
+        writer.append(makeReview(0));
+        REQUIRE_FALSE(writer.checkpoint());
+    }
+
+    SECTION("card ids depend on the deck and question")
+    {
+        FlashCard card{"Question", "Answer", EASY, 0};
+        FlashCard corrected{"Question", "Corrected answer", HARD, 3};
+        FlashCard other{"Other question", "Answer", EASY, 0};
+        REQUIRE(reviewCardId("Deck", card) == reviewCardId("Deck", corrected));
+        REQUIRE(reviewCardId("Deck", card) != reviewCardId("Deck", other));
+        REQUIRE(reviewCardId("Deck", card) != reviewCardId("Other deck", card));
+        REQUIRE(reviewDeckId("Deck") != reviewDeckId("Other deck"));
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Review log benchmark", "[.][benchmark]")
+{
+    fs::path dir = fs::temp_directory_path() / "sd_review_log_bench";
+    fs::remove_all(dir);
+    fs::path file = reviewLogFileFor(dir);
+    {
+        ReviewLogWriter writer{file, 64 * 1024};
+        for (uint64_t i = 0; i < 5'000'000; ++i)
+        {
+            writer.append(makeReview(i));
+        }
+    }
+    ReviewLogReader reader{file};
+
+    BENCHMARK("scan grades of 5M reviews")
+    {
+        uint64_t sum = 0;
+        reader.scan(
+            [&sum](const ReviewColumns &columns) {
+                for (uint8_t grade : columns.grades)
+                {
+                    sum += grade;
+                }
+            },
+            GRADE_COLUMN);
+        return sum;
+    };
+    BENCHMARK("scan every column of 5M reviews")
+    {
+        uint64_t sum = 0;
+        reader.scan([&sum](const ReviewColumns &columns) { sum += columns.size(); });
+        return sum;
+    };
+    fs::remove_all(dir);
+}
@@ -0,0 +1,108 @@
+#include "rng.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <random>
+#include <vector>
+
+TEST_CASE("Random number generators")
+{
+    SECTION("the same seed gives the same numbers")
+    {
+        Rng a{42};
+        Rng b{42};
+        Rng c{43};
+        bool same = true;
+        bool differs = false;
+        for (int i = 0; i < 1000; ++i)
+        {
+            uint64_t x = a();
+            same = same && x == b();
+            differs = differs || x != c();
+        }
+        REQUIRE(same);
+        REQUIRE(differs);
+    }
+
+    SECTION("a split generator does not repeat its parent")
+    {
+        Rng parent{7};
+        Rng copy = parent;
+        Rng child = parent.split();
+        std::vector<uint64_t> from_child{};
+        std::vector<uint64_t> from_parent{};
+        for (int i = 0; i < 100; ++i)
+        {
+            from_child.push_back(child());
+            from_parent.push_back(parent());
+        }
+        // the child carries on where the parent was, the parent has jumped ahead
+        REQUIRE(from_child[0] == copy());
+        REQUIRE(from_child != from_parent);
+    }
+
+    SECTION("draws are in range and evenly spread")
+    {
+        Rng rng{2024};
+        std::array<int, 6> counts{};
+        bool in_range = true;
+        for (int i = 0; i < 60000; ++i)
+        {
+            uint64_t x = rng.below(6);
+            double u = rng.uniform();
+            in_range = in_range && x < 6 && u >= 0.0 && u < 1.0;
+            counts[x < 6 ? x : 0]++;
+        }
+        REQUIRE(in_range);
+        for (int count : counts)
+        {
+            REQUIRE(count > 9500);
+            REQUIRE(count < 10500);
+        }
+        REQUIRE(rng.below(0) == 0);
+        REQUIRE(rng.below(1) == 0);
+    }
+
+    SECTION("a seed makes every stream repeat")
+    {
+        seedRng(99);
+        REQUIRE(rngSeed() == 99);
+        std::array<uint64_t, RNG_STREAM_COUNT> first{};
+        for (int s = 0; s < RNG_STREAM_COUNT; ++s)
+        {
+            first[s] = rngStream(static_cast<RngStream>(s))();
+        }
+        seedRng(99);
+        for (int s = 0; s < RNG_STREAM_COUNT; ++s)
+        {
+            REQUIRE(rngStream(static_cast<RngStream>(s))() == first[s]);
+        }
+        REQUIRE(first[STUDY_ORDER_STREAM] != first[QUOTE_STREAM]);
+    }
+}
+
+TEST_CASE("Random number generator benchmark", "[.][benchmark]")
+{
+    Rng rng{1};
+    std::mt19937 mt{1};
+
+    BENCHMARK("1M draws from Rng")
+    {
+        uint64_t sum = 0;
+        for (int i = 0; i < 1'000'000; ++i)
+        {
+            sum += rng();
+        }
+        return sum;
+    };
+    BENCHMARK("1M draws from std::mt19937")
+    {
+        uint64_t sum = 0;
+        for (int i = 0; i < 1'000'000; ++i)
+        {
+            sum += mt();
+        }
+        return sum;
+    };
+}
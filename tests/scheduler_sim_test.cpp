@@ -0,0 +1,148 @@
+#include "scheduler_sim.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <vector>
+
+TEST_CASE("Forgetting curves")
+{
+    for (ForgettingCurve curve : {EXPONENTIAL_CURVE, POWER_CURVE})
+    {
+        CHECK(forgettingCurveRecall(curve, 0, 5) == 1.0);
+        CHECK(std::abs(forgettingCurveRecall(curve, 5, 5) - 0.9) < 1e-12);
+        CHECK(forgettingCurveRecall(curve, 10, 5) < forgettingCurveRecall(curve, 5, 5));
+        CHECK(forgettingCurveRecall(curve, 5, 10) > forgettingCurveRecall(curve, 5, 5));
+    }
+    // the power curve has a longer tail
+    CHECK(forgettingCurveRecall(POWER_CURVE, 100, 1) > forgettingCurveRecall(EXPONENTIAL_CURVE, 100, 1));
+}
+
+TEST_CASE("Scheduler simulation")
+{
+    SimulationConfig config{};
+    config.learners = 8;
+    config.days = 120;
+    config.cards = 200;
+    config.cards_per_day = 10;
+    config.seed = 42;
+
+    SECTION("every learner studies every day")
+    {
+        SimulationReport report = simulateScheduler(config);
+        CHECK(report.learner_days == 8 * 120);
+        CHECK(report.reviews == 8 * 120 * 10);
+        CHECK(report.reviews_per_day == 10.0);
+        CHECK(report.new_reviews <= 8 * 200);
+        CHECK(report.cards_seen == report.new_reviews);
+        CHECK(report.due_reviews <= report.reviews - report.new_reviews);
+        CHECK(report.retention > 0.5);
+        CHECK(report.retention < 1.0);
+        CHECK(report.final_recall > 0.0);
+        CHECK(report.final_recall < 1.0);
+    }
+
+    SECTION("a seed gives the same report on any number of threads")
+    {
+        config.threads = 1;
+        SimulationReport one = simulateScheduler(config);
+        config.threads = 4;
+        SimulationReport four = simulateScheduler(config);
+        CHECK(one.reviews == four.reviews);
+        CHECK(one.recalled == four.recalled);
+        CHECK(one.due_reviews == four.due_reviews);
+        CHECK(one.new_reviews == four.new_reviews);
+        CHECK(one.backlog == four.backlog);
+        CHECK(one.final_recall == four.final_recall);
+
+        config.seed = 43;
+        CHECK(simulateScheduler(config).recalled != one.recalled);
+    }
+
+    SECTION("a learner who forgets more recalls less")
+    {
+        SimulationReport strong = simulateScheduler(config);
+        config.learner.initial_stability = 0.2;
+        config.learner.growth = 1.0;
+        SimulationReport weak = simulateScheduler(config);
+        CHECK(weak.retention < strong.retention);
+    }
+
+    SECTION("the default policy plans the day's study time")
+    {
+        // a minute a day fits six cards of defaultCardSeconds
+        config.minutes_per_day = 1;
+        SimulationReport report = simulateScheduler(config);
+        CHECK(report.reviews == 8 * 120 * 6);
+        CHECK(report.reviews_per_day == 6.0);
+    }
+
+    SECTION("a custom selection policy")
+    {
+        // always the first cards of the deck, whether due or not
+        config.select = [](const FlashCardDeck &, size_t n_cards, int64_t, Rng &, std::vector<size_t> &order) {
+            order.clear();
+            for (size_t i = 0; i < n_cards; ++i)
+            {
+                order.push_back(i);
+            }
+        };
+        SimulationReport report = simulateScheduler(config);
+        CHECK(report.reviews == 8 * 120 * 10);
+        CHECK(report.new_reviews == 8 * 10);
+        CHECK(report.cards_seen == 8 * 10);
+        // studied every day, so each card is nearly always recalled
+        CHECK(report.retention > 0.9);
+    }
+
+    SECTION("no learners")
+    {
+        config.learners = 0;
+        CHECK(simulateScheduler(config).reviews == 0);
+    }
+}
+
+TEST_CASE("The session plan policy")
+{
+    const int64_t now = 1'700'000'000;
+    FlashCardDeck deck{};
+    deck.cards.assign(20, FlashCard{"", "", UNKNOWN, 0});
+    for (size_t i = 10; i < 15; ++i)
+    {
+        deck.cards[i].n_times_answered = 1;
+        deck.cards[i].schedule.due = now - static_cast<int64_t>(i) * 3600;
+    }
+    Rng rng{7};
+    std::vector<size_t> order{};
+
+    // due cards are planned before new ones, the longest overdue first
+    sessionPlanPolicy(0)(deck, 5, now, rng, order);
+    CHECK(order == std::vector<size_t>{14, 13, 12, 11, 10});
+
+    // the rest of a longer session is new cards
+    sessionPlanPolicy(0)(deck, 8, now, rng, order);
+    REQUIRE(order.size() == 8);
+    for (size_t i = 5; i < order.size(); ++i)
+    {
+        CHECK(deck.cards[order[i]].n_times_answered == 0);
+    }
+
+    // a budget too short for any card still plans one
+    sessionPlanPolicy(1)(deck, 8, now, rng, order);
+    CHECK(order.size() == 1);
+}
+
+TEST_CASE("Scheduler simulation benchmark", "[.][benchmark]")
+{
+    // a year of study by 100 learners, 36500 days of card selection
+    SimulationConfig config{};
+    BENCHMARK("a year of 100 learners with SM-2")
+    {
+        return simulateScheduler(config).reviews;
+    };
+    config.algorithm = FSRS_SCHEDULER;
+    BENCHMARK("a year of 100 learners with FSRS")
+    {
+        return simulateScheduler(config).reviews;
+    };
+}
@@ -0,0 +1,201 @@
+#include "scheduler.h"
+#include "deck.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+constexpr int64_t startTime{1'700'000'000};
+
+TEST_CASE("SM-2 scheduling")
+{
+    CardSchedule schedule{};
+    int64_t now = startTime;
+
+    SECTION("intervals grow by the ease")
+    {
+        reviewSm2(schedule, GOOD_RATING, now);
+        REQUIRE(schedule.interval == 1);
+        REQUIRE(schedule.due == now + secondsPerDay);
+        REQUIRE(schedule.ease == 2.5F);
+        now = schedule.due;
+        reviewSm2(schedule, GOOD_RATING, now);
+        REQUIRE(schedule.interval == 6);
+        now = schedule.due;
+        reviewSm2(schedule, GOOD_RATING, now);
+        REQUIRE(schedule.interval == 15);
+        REQUIRE(schedule.reps == 3);
+        REQUIRE(schedule.lapses == 0);
+    }
+
+    SECTION("easy and hard change the ease")
+    {
+        reviewSm2(schedule, EASY_RATING, now);
+        REQUIRE(schedule.ease > 2.5F);
+        CardSchedule hard{};
+        reviewSm2(hard, HARD_RATING, now);
+        REQUIRE(hard.ease < 2.5F);
+        for (int i = 0; i < 20; ++i)
+        {
+            reviewSm2(hard, HARD_RATING, now);
+        }
+        REQUIRE(hard.ease >= 1.3F);
+    }
+
+    SECTION("forgetting a learnt card is a lapse")
+    {
+        reviewSm2(schedule, GOOD_RATING, now);
+        reviewSm2(schedule, GOOD_RATING, now);
+        reviewSm2(schedule, AGAIN_RATING, now);
+        REQUIRE(schedule.lapses == 1);
+        REQUIRE(schedule.reps == 0);
+        REQUIRE(schedule.due == now + relearnDelaySeconds);
+        REQUIRE(schedule.ease < 2.5F);
+
+        // relearning starts the intervals again
+        reviewSm2(schedule, GOOD_RATING, now);
+        REQUIRE(schedule.interval == 1);
+    }
+}
+
+TEST_CASE("FSRS scheduling")
+{
+    CardSchedule schedule{};
+    int64_t now = startTime;
+
+    reviewFsrs(schedule, GOOD_RATING, now);
+    REQUIRE(schedule.stability == 2.4F);
+    REQUIRE(schedule.difficulty > 1);
+    REQUIRE(schedule.difficulty < 10);
+    REQUIRE(schedule.interval == 2);
+
+    // reviewing when due makes the memory more stable each time
+    float stability = schedule.stability;
+    for (int i = 0; i < 4; ++i)
+    {
+        now = schedule.due;
+        REQUIRE(recallProbability(schedule, now) > 0.85);
+        reviewFsrs(schedule, GOOD_RATING, now);
+        REQUIRE(schedule.stability > stability);
+        stability = schedule.stability;
+    }
+    REQUIRE(schedule.interval > 10);
+
+    // easy gives a longer interval than hard
+    CardSchedule easy = schedule;
+    CardSchedule hard = schedule;
+    reviewFsrs(easy, EASY_RATING, schedule.due);
+    reviewFsrs(hard, HARD_RATING, schedule.due);
+    REQUIRE(easy.interval > hard.interval);
+    REQUIRE(easy.difficulty < hard.difficulty);
+
+    // forgetting drops the stability and counts a lapse
+    reviewFsrs(schedule, AGAIN_RATING, schedule.due);
+    REQUIRE(schedule.stability < stability);
+    REQUIRE(schedule.lapses == 1);
+    REQUIRE(schedule.due == schedule.reviewed + relearnDelaySeconds);
+}
+
+TEST_CASE("Due queue")
+{
+    std::vector<FlashCard> cards(6);
+    cards[0].schedule.due = startTime + 50;
+    cards[1].schedule.due = startTime - 10;
+    cards[2].schedule.due = 0; // new
+    cards[3].schedule.due = startTime - 300;
+    cards[4].schedule.due = startTime + 1;
+    cards[5].schedule.due = startTime - 10;
+    DueQueue queue{cards, {0, 1, 2, 3, 4, 5}};
+    REQUIRE(queue.size() == 5);
+
+    size_t card{};
+    REQUIRE(queue.popDue(startTime, card));
+    REQUIRE(card == 3);
+    REQUIRE(queue.popDue(startTime, card));
+    REQUIRE(card == 1);
+
+    // a card rescheduled while queued is found at its new time
+    cards[5].schedule.due = startTime + 20;
+    queue.push(5);
+    REQUIRE_FALSE(queue.popDue(startTime, card));
+    REQUIRE(queue.nextDueTime() == startTime + 1);
+    REQUIRE(queue.popDue(startTime + 30, card));
+    REQUIRE(card == 4);
+    REQUIRE(queue.popDue(startTime + 30, card));
+    REQUIRE(card == 5);
+    REQUIRE_FALSE(queue.popDue(startTime + 30, card));
+    REQUIRE(queue.popDue(startTime + 50, card));
+    REQUIRE(card == 0);
+    REQUIRE(queue.nextDueTime() == 0);
+
+    SECTION("many cards leave in due order")
+    {
+        std::mt19937 rng{5};
+        std::vector<FlashCard> many(20000);
+        std::vector<size_t> all(many.size());
+        for (size_t i = 0; i < many.size(); ++i)
+        {
+            many[i].schedule.due = startTime + static_cast<int64_t>(rng() % 100000);
+            all[i] = i;
+        }
+        DueQueue big{many, all};
+        int64_t last = 0;
+        size_t n_due = 0;
+        while (big.popDue(startTime + 50000, card))
+        {
+            REQUIRE(many[card].schedule.due >= last);
+            last = many[card].schedule.due;
+            n_due++;
+        }
+        REQUIRE(last <= startTime + 50000);
+        REQUIRE(n_due > 9000);
+        REQUIRE(n_due < 11000);
+    }
+}
+
+TEST_CASE("Schedules are saved with the deck")
+{
+    CardSchedule schedule{};
+    reviewFsrs(schedule, GOOD_RATING, startTime);
+    reviewSm2(schedule, EASY_RATING, startTime + 5);
+    schedule.lapses = 3;
+    schedule.failures = 5;
+
+    CardSchedule read{};
+    REQUIRE(strToSchedule(scheduleToStr(schedule), read));
+    REQUIRE(read.due == schedule.due);
+    REQUIRE(read.reviewed == schedule.reviewed);
+    REQUIRE(read.interval == schedule.interval);
+    REQUIRE(read.ease == schedule.ease);
+    REQUIRE(read.stability == schedule.stability);
+    REQUIRE(read.difficulty == schedule.difficulty);
+    REQUIRE(read.reps == schedule.reps);
+    REQUIRE(read.lapses == 3);
+    REQUIRE(read.failures == 5);
+    REQUIRE_FALSE(strToSchedule("12 34 garbage", read));
+    // written before failures were counted
+    REQUIRE(strToSchedule("12 34 1 2.5 0 0 1 2", read));
+    REQUIRE(read.failures == 2);
+
+    fs::path dir = fs::temp_directory_path() / "sd_scheduler_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    FlashCardDeck deck{"Scheduled", "", std::vector<FlashCard>{}};
+    deck.cards.push_back(FlashCard{"new card", "a", UNKNOWN, 0});
+    deck.cards.push_back(FlashCard{"scheduled card", "b", EASY, 2});
+    deck.cards[1].schedule = schedule;
+    deck.filename = dir / "Scheduled.deck";
+    REQUIRE(writeFlashCardDeck(deck, deck.filename));
+
+    FlashCardDeck loaded = readFlashCardDeck(deck.filename);
+    REQUIRE(loaded.cards.size() == 2);
+    REQUIRE(loaded.cards[0].schedule.due == 0);
+    REQUIRE(loaded.cards[1].schedule.due == schedule.due);
+    REQUIRE(loaded.cards[1].schedule.stability == schedule.stability);
+    REQUIRE(loaded.cards[0].stringCardAsTemplate().find("S: ") == std::string::npos);
+    fs::remove_all(dir);
+}
@@ -0,0 +1,183 @@
+#include "session_planner.h"
+#include "review_log.h"
+#include "scheduler.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static bool near(double a, double b)
+{
+    return std::abs(a - b) < 1e-9;
+}
+
+TEST_CASE("Card latency estimates")
+{
+    LatencyModel model{};
+    CHECK(model.averageSeconds() == defaultCardSeconds);
+    CHECK(model.estimate(1) == defaultCardSeconds);
+
+    model.observe(1, 20);
+    CHECK(near(model.estimate(1), 20));
+    // later reviews move the estimate part of the way
+    model.observe(1, 10);
+    CHECK(near(model.estimate(1), 17));
+    CHECK(near(model.averageSeconds(), 15));
+    // a card never timed is expected to take the average
+    CHECK(near(model.estimate(2), 15));
+    // a review left on the screen does not count for more than the cap
+    model.observe(3, 1000);
+    CHECK(model.estimate(3) == maxCardSeconds);
+
+    SECTION("loaded from the review log")
+    {
+        fs::path dir = fs::temp_directory_path() / "sd_session_planner_test";
+        fs::remove_all(dir);
+        fs::path file = reviewLogFileFor(dir);
+        {
+            ReviewLogWriter writer{file};
+            ReviewRecord review{};
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                review.card_id = 7;
+                review.response_ms = 4000;
+                review.grade_ms = 1000;
+                writer.append(review);
+                review.card_id = 8;
+                review.response_ms = 14000 + 2000 * i;
+                writer.append(review);
+            }
+            // not timed
+            review.card_id = 7;
+            review.response_ms = 0;
+            review.grade_ms = 0;
+            writer.append(review);
+        }
+        LatencyModel loaded{};
+        loaded.load(file, {7});
+        CHECK(near(loaded.estimate(7), 5));
+        // card 8 was not asked for, so it only counts towards the average
+        CHECK(near(loaded.averageSeconds(), (4 * 5 + 15 + 17 + 19 + 21) / 8.0));
+        CHECK(near(loaded.estimate(8), loaded.averageSeconds()));
+        REQUIRE(fs::exists(latencyFileFor(file)));
+
+        // later reviews are folded into the latency file, cards new to it sort before and after the old ones
+        {
+            ReviewLogWriter writer{file};
+            ReviewRecord review{};
+            review.response_ms = 9000;
+            review.grade_ms = 1000;
+            for (uint64_t card : {3, 7, 9})
+            {
+                review.card_id = card;
+                writer.append(review);
+            }
+        }
+        loaded.load(file, {3, 7, 8, 9});
+        CHECK(near(loaded.estimate(3), 10));
+        CHECK(near(loaded.estimate(7), 6.5));
+        CHECK(near(loaded.estimate(8), 17.934));
+        CHECK(near(loaded.estimate(9), 10));
+        CHECK(near(loaded.averageSeconds(), (4 * 5 + 15 + 17 + 19 + 21 + 3 * 10) / 11.0));
+
+        // a log that was replaced by a shorter one is read again from the start
+        fs::remove(file);
+        {
+            ReviewLogWriter writer{file};
+            ReviewRecord review{};
+            review.card_id = 8;
+            review.response_ms = 2000;
+            writer.append(review);
+        }
+        loaded.load(file, {7, 8});
+        CHECK(near(loaded.estimate(8), 2));
+        CHECK(near(loaded.estimate(7), 2));
+        CHECK(near(loaded.averageSeconds(), 2));
+        fs::remove_all(dir);
+    }
+}
+
+TEST_CASE("Planning a timed session")
+{
+    const int64_t now = 1'700'000'000;
+
+    SECTION("due cards come first, then new cards, then seen cards")
+    {
+        FlashCard fresh{"Q", "A", UNKNOWN, 0};
+        FlashCard seen{"Q", "A", MEDIUM, 3};
+        FlashCard due = seen;
+        due.schedule.due = now - 15 * secondsPerDay;
+        FlashCard waiting = seen;
+        waiting.schedule.due = now + secondsPerDay;
+
+        CHECK(planCandidate(0, due, now, 5).priority == 0);
+        CHECK(near(planCandidate(0, due, now, 5).value, 1.5));
+        CHECK(planCandidate(0, fresh, now, 5).priority == 1);
+        CHECK(planCandidate(0, seen, now, 5).priority == 2);
+        CHECK(planCandidate(0, waiting, now, 5).priority == 2);
+    }
+
+    std::vector<PlanCandidate> candidates{
+        {10, 0, 1.0, 30}, {11, 0, 1.0, 10}, {12, 1, 1.0, 10}, {13, 1, 1.0, 5}, {14, 2, 1.0, 5}};
+    std::vector<size_t> chosen{};
+
+    SECTION("everything fits")
+    {
+        planTimedSession(candidates, 1000, 10, chosen);
+        CHECK(chosen == std::vector<size_t>{0, 1, 2, 3, 4});
+    }
+
+    SECTION("the card limit")
+    {
+        planTimedSession(candidates, 1000, 3, chosen);
+        CHECK(chosen == std::vector<size_t>{0, 1, 3});
+    }
+
+    SECTION("a card that does not fit is skipped for ones that do")
+    {
+        // the slow due card does not fit after the quick one, the rest of the time goes to quicker cards
+        planTimedSession(candidates, 35, 10, chosen);
+        CHECK(chosen == std::vector<size_t>{1, 2, 3, 4});
+    }
+
+    SECTION("no time left")
+    {
+        planTimedSession(candidates, 0, 10, chosen);
+        CHECK(chosen.empty());
+        planTimedSession(candidates, 1000, 0, chosen);
+        CHECK(chosen.empty());
+    }
+
+    SECTION("more value per second is planned first")
+    {
+        std::vector<PlanCandidate> due{{0, 0, 2.0, 20}, {1, 0, 1.0, 5}, {2, 0, 1.5, 10}};
+        planTimedSession(due, 16, 10, chosen);
+        CHECK(chosen == std::vector<size_t>{1, 2});
+    }
+}
+
+TEST_CASE("Session planner benchmark", "[.][benchmark]")
+{
+    // a deck's worth of candidates, far more than any session ranks
+    std::vector<PlanCandidate> candidates{};
+    for (size_t i = 0; i < 10'000; ++i)
+    {
+        candidates.push_back({i, static_cast<int>(i % 3), 1.0 + static_cast<double>(i % 7) / 7, 3.0 + i % 11});
+    }
+    std::vector<size_t> chosen{};
+    BENCHMARK("plan 10k candidates")
+    {
+        planTimedSession(candidates, 25 * 60, 90, chosen);
+        return chosen.size();
+    };
+    std::vector<PlanCandidate> session(candidates.begin(), candidates.begin() + 30);
+    BENCHMARK("re-plan a session of 30 ranked cards")
+    {
+        planTimedSession(session, 25 * 60, 15, chosen);
+        return chosen.size();
+    };
+}
@@ -14,9 +14,26 @@ TEST_CASE("Settings initialisation with defaults")
     {
         test_settings.setFlashCardLimit(33);
         test_settings.setStudyDurationMin(32);
+        test_settings.setStudyQuery("answered<3");
+        test_settings.setDeckMemoryMiB(8);
+        test_settings.setStudyMode(CLOZE_VIEW);
         test_settings.reset();
         REQUIRE(test_settings.getStudyDurationMin() == default_n_min);
         REQUIRE(test_settings.getFlashCardLimit() == default_fc_limit);
+        REQUIRE(test_settings.getStudyQuery().empty());
+        REQUIRE(test_settings.getDeckMemoryMiB() == 256);
+        REQUIRE(test_settings.getDeckMemoryBudget() == 256U * 1024 * 1024);
+        REQUIRE(test_settings.getStudyMode() == FORWARD_VIEW);
+    }
+
+    SECTION("study modes cycle")
+    {
+        test_settings.nextStudyMode();
+        REQUIRE(test_settings.getStudyMode() == REVERSE_VIEW);
+        test_settings.nextStudyMode();
+        REQUIRE(test_settings.getStudyMode() == CLOZE_VIEW);
+        test_settings.nextStudyMode();
+        REQUIRE(test_settings.getStudyMode() == FORWARD_VIEW);
     }
 }
 
@@ -0,0 +1,187 @@
+#include "study_analytics.h"
+#include "review_log.h"
+#include "scheduler.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+constexpr int64_t testDayMs{24 * 60 * 60 * 1000};
+constexpr int64_t testDay0Ms{20000 * testDayMs};
+
+static ReviewRecord makeReview(uint64_t card, uint64_t deck, int64_t time_ms, uint8_t grade, int64_t due)
+{
+    ReviewRecord review{};
+    review.card_id = card;
+    review.deck_id = deck;
+    review.time_ms = time_ms;
+    review.session_id = 1;
+    review.due = due;
+    review.response_ms = 1000;
+    review.grade_ms = 500;
+    review.grade = grade;
+    return review;
+}
+
+// a review every 20 seconds of 5000 cards in 12 decks, 1 in 8 forgotten
+static ReviewRecord makeHistoryReview(uint64_t i)
+{
+    uint64_t card = i * 7919 % 5000;
+    return makeReview(card,
+                      card % 12,
+                      testDay0Ms + static_cast<int64_t>(i) * 20'000,
+                      static_cast<uint8_t>(i % 8 == 0 ? AGAIN_RATING : GOOD_RATING),
+                      testDay0Ms / 1000 + static_cast<int64_t>(i % 97) * 86400);
+}
+
+TEST_CASE("Retention buckets")
+{
+    REQUIRE(retentionBucket(-5) == 0);
+    REQUIRE(retentionBucket(testDayMs - 1) == 0);
+    REQUIRE(retentionBucket(testDayMs) == 1);
+    REQUIRE(retentionBucket(3 * testDayMs) == 2);
+    REQUIRE(retentionBucket(4 * testDayMs) == 3);
+    REQUIRE(retentionBucket(10000 * testDayMs) == retentionBuckets - 1);
+    REQUIRE(retentionBucketLabel(0) == "<1d");
+    REQUIRE(retentionBucketLabel(1) == "1d");
+    REQUIRE(retentionBucketLabel(3) == "4-7d");
+    REQUIRE(retentionBucketLabel(retentionBuckets - 1) == "256d+");
+}
+
+TEST_CASE("Study statistics of a review log")
+{
+    fs::path dir = fs::temp_directory_path() / "sd_study_analytics_test";
+    fs::remove_all(dir);
+    fs::path file = reviewLogFileFor(dir);
+    const int64_t now_ms = testDay0Ms + 10 * testDayMs + testDayMs / 2;
+    const int64_t now_s = now_ms / 1000;
+
+    SECTION("a missing log has no reviews")
+    {
+        StudyStats stats = computeStudyStats(file, now_ms);
+        REQUIRE(stats.reviews == 0);
+        REQUIRE(stats.decks.empty());
+        REQUIRE(stats.forecast.size() == 30);
+    }
+
+    SECTION("every statistic of a small history")
+    {
+        {
+            ReviewLogWriter writer{file};
+            writer.append(makeReview(1, 10, testDay0Ms, GOOD_RATING, 0));
+            writer.append(makeReview(1, 10, testDay0Ms + testDayMs, AGAIN_RATING, 0));
+            writer.append(makeReview(1, 10, testDay0Ms + 3 * testDayMs, GOOD_RATING, now_s + 2 * 86400));
+            writer.append(makeReview(2, 20, testDay0Ms + 9 * testDayMs, HARD_RATING, 0));
+            writer.append(makeReview(2, 20, testDay0Ms + 9 * testDayMs + 3'600'000, EASY_RATING, now_s - 100));
+            writer.append(makeReview(3, 20, testDay0Ms + 10 * testDayMs, AGAIN_RATING, now_s + 40 * 86400));
+        }
+        StudyStats stats = computeStudyStats(file, now_ms);
+        REQUIRE(stats.reviews == 6);
+        REQUIRE(stats.passed == 4);
+        REQUIRE(stats.time_ms == 9000);
+        REQUIRE(stats.cards == 3);
+
+        REQUIRE(stats.days_studied == 5);
+        REQUIRE(stats.reviews_today == 1);
+        REQUIRE(stats.current_streak == 2);
+        REQUIRE(stats.longest_streak == 2);
+
+        REQUIRE(stats.retention_reviews[0] == 1);
+        REQUIRE(stats.retention_passed[0] == 1);
+        REQUIRE(stats.retention_reviews[1] == 1);
+        REQUIRE(stats.retention_passed[1] == 0);
+        REQUIRE(stats.retention_reviews[2] == 1);
+        REQUIRE(stats.retention_passed[2] == 1);
+
+        REQUIRE(stats.decks.size() == 2);
+        for (const DeckStudyStats &deck : stats.decks)
+        {
+            REQUIRE(deck.reviews == 3);
+            REQUIRE(deck.passed == 2);
+        }
+
+        // the overdue card counts today and the card due in 40 days is past the forecast
+        REQUIRE(stats.forecast[0] == 1);
+        REQUIRE(stats.forecast[2] == 1);
+        uint64_t forecast_total = 0;
+        for (uint64_t due : stats.forecast)
+        {
+            forecast_total += due;
+        }
+        REQUIRE(forecast_total == 2);
+
+        // a day without study breaks the current streak
+        REQUIRE(computeStudyStats(file, now_ms + 2 * testDayMs).current_streak == 0);
+    }
+
+    SECTION("the result does not depend on the number of threads")
+    {
+        const uint64_t n = reviewLogBlockRecords * 3 + 17;
+        {
+            ReviewLogWriter writer{file, 64 * 1024};
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                writer.append(makeHistoryReview(i));
+            }
+        }
+        StudyStats one = computeStudyStats(file, now_ms, 1);
+        StudyStats four = computeStudyStats(file, now_ms, 4);
+        REQUIRE(one.reviews == n);
+        REQUIRE(one.cards == 5000);
+        REQUIRE(four.reviews == one.reviews);
+        REQUIRE(four.passed == one.passed);
+        REQUIRE(four.time_ms == one.time_ms);
+        REQUIRE(four.cards == one.cards);
+        REQUIRE(four.days_studied == one.days_studied);
+        REQUIRE(four.longest_streak == one.longest_streak);
+        REQUIRE(four.retention_reviews == one.retention_reviews);
+        REQUIRE(four.retention_passed == one.retention_passed);
+        REQUIRE(four.forecast == one.forecast);
+        REQUIRE(four.decks.size() == 12);
+        REQUIRE(four.decks.size() == one.decks.size());
+        for (size_t d = 0; d < one.decks.size(); ++d)
+        {
+            REQUIRE(four.decks[d].deck_id == one.decks[d].deck_id);
+            REQUIRE(four.decks[d].reviews == one.decks[d].reviews);
+            REQUIRE(four.decks[d].passed == one.decks[d].passed);
+        }
+        // every review but the first of each card repeats an earlier one
+        uint64_t repeats = 0;
+        for (uint64_t reviews : one.retention_reviews)
+        {
+            repeats += reviews;
+        }
+        REQUIRE(repeats == n - 5000);
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Study statistics benchmark", "[.][benchmark]")
+{
+    fs::path dir = fs::temp_directory_path() / "sd_study_analytics_bench";
+    fs::remove_all(dir);
+    fs::path file = reviewLogFileFor(dir);
+    {
+        // as many reviews as years of a few hundred a day
+        ReviewLogWriter writer{file, 64 * 1024};
+        for (uint64_t i = 0; i < 1'000'000; ++i)
+        {
+            writer.append(makeHistoryReview(i));
+        }
+    }
+    const int64_t now_ms = testDay0Ms + 400 * testDayMs;
+
+    BENCHMARK("statistics of 1M reviews")
+    {
+        return computeStudyStats(file, now_ms).reviews;
+    };
+    BENCHMARK("statistics of 1M reviews on one thread")
+    {
+        return computeStudyStats(file, now_ms, 1).reviews;
+    };
+    fs::remove_all(dir);
+}
@@ -0,0 +1,120 @@
+#include "study_queue.h"
+#include "deck.h"
+#include "scheduler.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+TEST_CASE("Study queue of a deck")
+{
+    fs::path dir = fs::temp_directory_path() / "sd_study_queue_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // cards 0-9 are new, 10-19 were due 100 - i seconds ago so the last is the longest overdue, 20-29 are not due
+    const int64_t now = scheduleNow();
+    FlashCardDeck deck{"Queue deck", "", std::vector<FlashCard>{}};
+    for (int i = 0; i < 30; ++i)
+    {
+        deck.cards.emplace_back("Question " + std::to_string(i), "Answer", EASY, i < 10 ? 0 : 1);
+        if (i >= 10)
+        {
+            deck.cards.back().schedule.due = i < 20 ? now - 100 + i : now + 1000 + i;
+        }
+    }
+    deck.filename = dir / "Queue_deck.deck";
+    REQUIRE(writeFlashCardDeck(deck, deck.filename));
+    Rng rng{3};
+
+    SECTION("a session is due cards in due order then new cards")
+    {
+        StudyQueue queue{};
+        queue.build(deck, rng);
+        REQUIRE(queue.scheduledCount() == 20);
+        REQUIRE(queue.newCount() == 10);
+        std::vector<size_t> order{};
+        REQUIRE(queue.planSession(deck, 15, now, FORWARD_VIEW, order));
+        REQUIRE(order.size() == 15);
+        for (size_t i = 0; i < 10; ++i)
+        {
+            REQUIRE(order[i] == 10 + i);
+        }
+        for (size_t i = 10; i < 15; ++i)
+        {
+            REQUIRE(order[i] < 10);
+        }
+        // not enough due and new cards to fill a session of 25
+        REQUIRE_FALSE(queue.planSession(deck, 25, now, FORWARD_VIEW, order));
+    }
+
+    SECTION("a reviewed card moves to its new place")
+    {
+        StudyQueue queue{};
+        queue.build(deck, rng);
+        std::vector<size_t> order{};
+        REQUIRE(queue.planSession(deck, 1, now, FORWARD_VIEW, order));
+        REQUIRE(order[0] == 10);
+        queue.reschedule(10, deck.cards[10].schedule.due, now + 5000);
+        REQUIRE(queue.planSession(deck, 1, now, FORWARD_VIEW, order));
+        REQUIRE(order[0] == 11);
+
+        // a new card leaves the new cards once it is scheduled
+        REQUIRE(queue.planSession(deck, 10, now, FORWARD_VIEW, order));
+        size_t first_new = order[9];
+        queue.reschedule(first_new, 0, now - 1000);
+        REQUIRE(queue.newCount() == 9);
+        REQUIRE(queue.planSession(deck, 1, now, FORWARD_VIEW, order));
+        REQUIRE(order[0] == first_new);
+    }
+
+    SECTION("a session left part way is saved and resumed")
+    {
+        StudyQueue queue{};
+        queue.build(deck, rng);
+        std::vector<size_t> order{};
+        REQUIRE(queue.planSession(deck, 12, now, FORWARD_VIEW, order));
+        queue.startSession(order, "", FORWARD_VIEW);
+        queue.reschedule(order[0], deck.cards[order[0]].schedule.due, now + 7000);
+        queue.setSessionPosition(1);
+        REQUIRE(queue.save(deck));
+
+        StudyQueue loaded{};
+        REQUIRE(loaded.load(deck));
+        REQUIRE(loaded.resumable("", FORWARD_VIEW));
+        REQUIRE_FALSE(loaded.resumable("tag:other", FORWARD_VIEW));
+        REQUIRE_FALSE(loaded.resumable("", REVERSE_VIEW));
+        REQUIRE(loaded.sessionOrder() == order);
+        REQUIRE(loaded.sessionPosition() == 1);
+        REQUIRE(loaded.scheduledCount() == queue.scheduledCount());
+        REQUIRE(loaded.newCount() == queue.newCount());
+        std::vector<size_t> next{};
+        REQUIRE(loaded.planSession(deck, 1, now, FORWARD_VIEW, next));
+        REQUIRE(next[0] == 11);
+
+        // a finished session is not resumed
+        loaded.setSessionPosition(order.size());
+        REQUIRE_FALSE(loaded.resumable("", FORWARD_VIEW));
+    }
+
+    SECTION("a queue is not loaded once its deck file changed")
+    {
+        StudyQueue queue{};
+        queue.build(deck, rng);
+        REQUIRE(queue.save(deck));
+        deck.cards.emplace_back("Another question", "Answer", EASY, 0);
+        REQUIRE(writeFlashCardDeck(deck, deck.filename));
+        StudyQueue loaded{};
+        REQUIRE_FALSE(loaded.load(deck));
+
+        FlashCardDeck unsaved{"Unsaved", "", std::vector<FlashCard>{}};
+        REQUIRE_FALSE(loaded.load(unsaved));
+        REQUIRE_FALSE(queue.save(unsaved));
+    }
+
+    fs::remove_all(dir);
+}
@@ -0,0 +1,182 @@
+#include "tag_index.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <vector>
+
+// a reference std::set implementation to compare the bitmaps against
+static std::set<uint32_t> toSet(const CompressedBitmap &bitmap)
+{
+    std::vector<uint32_t> ids = bitmap.toVector();
+    return std::set<uint32_t>(ids.begin(), ids.end());
+}
+
+TEST_CASE("Compressed bitmap operations")
+{
+    CompressedBitmap sparse{};
+    CompressedBitmap dense{};
+    std::set<uint32_t> sparse_ref;
+    std::set<uint32_t> dense_ref;
+    // ids across several containers, the dense set switches to bitmap containers
+    for (uint32_t i = 0; i < 300000; i += 37)
+    {
+        sparse.add(i);
+        sparse_ref.insert(i);
+    }
+    for (uint32_t i = 0; i < 300000; ++i)
+    {
+        if (i % 3 != 0)
+        {
+            dense.add(i);
+            dense_ref.insert(i);
+        }
+    }
+    // out of order and repeated adds
+    sparse.add(5);
+    sparse.add(5);
+    sparse_ref.insert(5);
+    REQUIRE(sparse.cardinality() == sparse_ref.size());
+    REQUIRE(dense.cardinality() == dense_ref.size());
+    REQUIRE(dense.containers()[0].isBitmap());
+    REQUIRE_FALSE(sparse.containers()[0].isBitmap());
+    REQUIRE(sparse.contains(37));
+    REQUIRE(sparse.contains(5));
+    REQUIRE_FALSE(sparse.contains(6));
+    REQUIRE_FALSE(dense.contains(3));
+
+    std::set<uint32_t> and_ref;
+    std::set<uint32_t> or_ref = dense_ref;
+    std::set<uint32_t> not_ref = sparse_ref;
+    for (uint32_t id : sparse_ref)
+    {
+        if (dense_ref.count(id))
+        {
+            and_ref.insert(id);
+            not_ref.erase(id);
+        }
+        or_ref.insert(id);
+    }
+    REQUIRE(toSet(sparse & dense) == and_ref);
+    REQUIRE(toSet(dense & sparse) == and_ref);
+    REQUIRE(toSet(sparse | dense) == or_ref);
+    REQUIRE(toSet(sparse.andNot(dense)) == not_ref);
+    REQUIRE(toSet(dense.andNot(dense)).empty());
+    REQUIRE((dense & dense) == dense);
+    REQUIRE((sparse | CompressedBitmap{}) == sparse);
+
+    SECTION("Ranges")
+    {
+        CompressedBitmap range{};
+        range.addRange(65530, 200000);
+        range.addRange(10, 20);
+        REQUIRE(range.cardinality() == (200000 - 65530) + 10);
+        REQUIRE(range.contains(10));
+        REQUIRE_FALSE(range.contains(20));
+        REQUIRE(range.contains(65535));
+        REQUIRE(range.contains(199999));
+        REQUIRE_FALSE(range.contains(200000));
+
+        CompressedBitmap added{};
+        for (uint32_t i = 65530; i < 200000; ++i)
+        {
+            added.add(i);
+        }
+        for (uint32_t i = 10; i < 20; ++i)
+        {
+            added.add(i);
+        }
+        REQUIRE(added == range);
+    }
+
+    SECTION("Masks of ranges")
+    {
+        // ranges crossing container boundaries, of both representations
+        for (const CompressedBitmap *bitmap : {&sparse, &dense})
+        {
+            for (uint32_t begin : {0u, 65000u, 131000u, 299500u})
+            {
+                std::vector<uint8_t> mask(1024, 7);
+                bitmap->fillMask(begin, begin + 1024, mask.data());
+                for (uint32_t i = 0; i < 1024; ++i)
+                {
+                    REQUIRE(mask[i] == (bitmap->contains(begin + i) ? 1 : 0));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Filtering cards by tag")
+{
+    FlashCard paris{"Capital of France?", "Paris", HARD, 1};
+    paris.tags = {"Capitals"};
+    FlashCard nile{"Longest river?", "Nile", EASY, 0};
+    nile.tags = {"rivers"};
+    FlashCard rome{"Capital of Italy?", "Rome", EASY, 3};
+    rome.tags = {"capitals", "europe"};
+    FlashCardDeck geography{"World geography", "", std::vector<FlashCard>{paris, nile, rome}};
+    geography.tags = {"geography"};
+    FlashCardDeck maths{"Maths", "", std::vector<FlashCard>{FlashCard("1+1", "2", HARD, 0)}};
+
+    TagIndex index{std::vector<FlashCardDeck>{geography, maths}};
+    REQUIRE(index.size() == 4);
+    REQUIRE(index.cardRef(3).deck == 1);
+    REQUIRE(index.cardRef(2).card == 2);
+    REQUIRE(index.tagNames() == std::vector<std::string>{"capitals", "europe", "geography", "rivers"});
+
+    auto ids = [&index](const std::string &query) {
+        CompressedBitmap result{};
+        REQUIRE(index.filter(query, result));
+        return result.toVector();
+    };
+    REQUIRE(ids("tag:geography") == std::vector<uint32_t>{0, 1, 2});
+    REQUIRE(ids("tag:CAPITALS") == std::vector<uint32_t>{0, 2});
+    REQUIRE(ids("tag:geography AND difficulty:HARD") == std::vector<uint32_t>{0});
+    REQUIRE(ids("tag:geography difficulty:easy") == std::vector<uint32_t>{1, 2});
+    REQUIRE(ids("tag:rivers OR deck:maths") == std::vector<uint32_t>{1, 3});
+    REQUIRE(ids("difficulty:HARD AND NOT tag:capitals") == std::vector<uint32_t>{3});
+    REQUIRE(ids("(tag:rivers OR tag:europe) AND difficulty:EASY") == std::vector<uint32_t>{1, 2});
+    REQUIRE(ids("deck:\"World geography\" AND NOT (tag:rivers)") == std::vector<uint32_t>{0, 2});
+    REQUIRE(ids("tag:missing").empty());
+
+    CompressedBitmap result{};
+    REQUIRE_FALSE(index.filter("", result));
+    REQUIRE_FALSE(index.filter("geography", result));
+    REQUIRE_FALSE(index.filter("colour:red", result));
+    REQUIRE_FALSE(index.filter("difficulty:impossible", result));
+    REQUIRE_FALSE(index.filter("(tag:rivers", result));
+    REQUIRE_FALSE(index.filter("tag:rivers)", result));
+    REQUIRE_FALSE(index.filter("tag:rivers OR", result));
+    REQUIRE_FALSE(index.filter("deck:\"unterminated", result));
+}
+
+TEST_CASE("Filtering a million card library")
+{
+    // 1000 decks of 1000 cards, every tenth deck tagged and a third of the cards hard
+    std::vector<FlashCardDeck> decks(1000);
+    for (size_t d = 0; d < decks.size(); ++d)
+    {
+        decks[d].name = "deck " + std::to_string(d);
+        if (d % 10 == 0)
+        {
+            decks[d].tags = {"geography"};
+        }
+        decks[d].cards.resize(1000);
+        for (size_t c = 0; c < decks[d].cards.size(); ++c)
+        {
+            decks[d].cards[c].difficulty = c % 3 == 0 ? HARD : EASY;
+        }
+    }
+    TagIndex index{decks};
+    REQUIRE(index.size() == 1000000);
+
+    CompressedBitmap result{};
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE(index.filter("tag:geography AND difficulty:HARD", result));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    REQUIRE(result.cardinality() == 100 * 334);
+    // generous enough for an unoptimised build, an optimised build takes microseconds
+    REQUIRE(elapsed < std::chrono::milliseconds(500));
+}
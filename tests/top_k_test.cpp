@@ -0,0 +1,57 @@
+#include "top_k.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+TEST_CASE("Top k selection")
+{
+    SECTION("keeps the smallest keys in order")
+    {
+        TopK<int> best{3};
+        for (int key : {50, 10, 40, 30, 20, 60})
+        {
+            best.offer(key, static_cast<size_t>(key / 10));
+        }
+        REQUIRE(best.size() == 3);
+        REQUIRE(best.take() == std::vector<size_t>{1, 2, 3});
+        REQUIRE(best.size() == 0);
+    }
+
+    SECTION("fewer items than k")
+    {
+        TopK<double> best{10};
+        best.offer(2.5, 7);
+        best.offer(1.5, 8);
+        REQUIRE(best.take() == std::vector<size_t>{8, 7});
+    }
+
+    SECTION("k of zero keeps nothing")
+    {
+        TopK<int> best{0};
+        best.offer(1, 1);
+        REQUIRE(best.take().empty());
+    }
+
+    SECTION("matches a full sort")
+    {
+        std::mt19937 rng{11};
+        std::vector<std::pair<int, double>> keys(5000);
+        TopK<std::pair<int, double>> best{25};
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            keys[i] = {static_cast<int>(rng() % 3), static_cast<double>(rng()) / (rng.max)()};
+            best.offer(keys[i], i);
+        }
+        std::vector<size_t> order(keys.size());
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+        order.resize(25);
+        REQUIRE(best.take() == order);
+    }
+}
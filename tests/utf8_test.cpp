@@ -0,0 +1,97 @@
+#include "deck.h"
+#include "utf8.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+TEST_CASE("ASCII prefix length")
+{
+    std::string ascii(100, 'a');
+    REQUIRE(asciiPrefixLength(ascii.data(), ascii.size()) == 100);
+    REQUIRE(asciiPrefixLength(ascii.data(), 0) == 0);
+    for (size_t pos : {0, 7, 8, 63, 99})
+    {
+        std::string text = ascii;
+        text[pos] = '\xC3';
+        REQUIRE(asciiPrefixLength(text.data(), text.size()) == pos);
+    }
+}
+
+TEST_CASE("UTF-8 validation")
+{
+    REQUIRE(isValidUtf8(""));
+    REQUIRE(isValidUtf8("plain text"));
+    REQUIRE(isValidUtf8("caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80"));
+    REQUIRE(findInvalidUtf8("ab\x80") == 2);
+    // truncated sequence at the end
+    REQUIRE(findInvalidUtf8("caf\xC3") == 3);
+    // overlong encoding of '/'
+    REQUIRE_FALSE(isValidUtf8("\xC0\xAF"));
+    REQUIRE_FALSE(isValidUtf8("\xE0\x80\xAF"));
+    // UTF-16 surrogate
+    REQUIRE_FALSE(isValidUtf8("\xED\xA0\x80"));
+    // above U+10FFFF
+    REQUIRE_FALSE(isValidUtf8("\xF4\x90\x80\x80"));
+    REQUIRE(isValidUtf8("\xF4\x8F\xBF\xBF"));
+}
+
+TEST_CASE("UTF-8 repair")
+{
+    std::string text = "ok";
+    REQUIRE(repairUtf8(text) == 0);
+    REQUIRE(text == "ok");
+
+    text = "a\xFF" "b";
+    REQUIRE(repairUtf8(text) == 1);
+    REQUIRE(text == "a\xEF\xBF\xBD" "b");
+
+    // a truncated three byte sequence is one maximal subpart and becomes a single replacement
+    text = "x\xE2\x82y\x80";
+    REQUIRE(repairUtf8(text) == 2);
+    REQUIRE(text == "x\xEF\xBF\xBDy\xEF\xBF\xBD");
+    REQUIRE(isValidUtf8(text));
+}
+
+TEST_CASE("Composing accents")
+{
+    // e followed by U+0301 COMBINING ACUTE ACCENT
+    std::string text = "cafe\xCC\x81";
+    REQUIRE(composeUtf8(text) == 1);
+    REQUIRE(text == "caf\xC3\xA9");
+
+    // already composed text is unchanged
+    REQUIRE(composeUtf8(text) == 0);
+    REQUIRE(text == "caf\xC3\xA9");
+
+    // a + U+0323 DOT BELOW + U+0302 CIRCUMFLEX composes twice to U+1EAD
+    text = "a\xCC\xA3\xCC\x82";
+    REQUIRE(composeUtf8(text) == 2);
+    REQUIRE(text == "\xE1\xBA\xAD");
+
+    // an accent with no precomposed form is kept
+    text = "q\xCC\x81";
+    REQUIRE(composeUtf8(text) == 0);
+    REQUIRE(text == "q\xCC\x81");
+}
+
+TEST_CASE("Sanitizing deck text")
+{
+    std::string text = "Capital of France?";
+    Utf8Report report = sanitizeUtf8(text);
+    REQUIRE_FALSE(report.changed());
+
+    text = "Zu\xCC\x88rich \xFF";
+    report = sanitizeUtf8(text);
+    REQUIRE(report.invalid_sequences == 1);
+    REQUIRE(report.compositions == 1);
+    REQUIRE(text == "Z\xC3\xBCrich \xEF\xBF\xBD");
+
+    FlashCardDeck deck = parseFlashCardDeck("Caf\xC3\xA9s\nQ: cafe\xCC\x81?\nA: bad \xC3\n-\nQ: plain\nA: text\n-\n");
+    REQUIRE(deck.name == "Caf\xC3\xA9s");
+    REQUIRE(deck.cards.size() == 2);
+    REQUIRE(deck.cards[0].question == "caf\xC3\xA9?");
+    REQUIRE(deck.cards[0].answer == "bad \xEF\xBF\xBD");
+    REQUIRE(deck.cards[1].question == "plain");
+    REQUIRE(deck.text_repairs.invalid_sequences == 1);
+    REQUIRE(deck.text_repairs.compositions == 1);
+}
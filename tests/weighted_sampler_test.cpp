@@ -0,0 +1,151 @@
+#include "weighted_sampler.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// the share of draws that picked each item is within tolerance of its share of the weight
+static void requireProportions(const std::vector<double> &weights, const std::vector<size_t> &counts, size_t n_draws)
+{
+    double total = 0;
+    for (double weight : weights)
+    {
+        total += (std::max)(weight, 0.0);
+    }
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+        double expected = (std::max)(weights[i], 0.0) / total;
+        double seen = static_cast<double>(counts[i]) / static_cast<double>(n_draws);
+        REQUIRE(std::abs(seen - expected) < 0.01);
+    }
+}
+
+TEST_CASE("Weighted sampler")
+{
+    Rng rng{2024};
+    std::vector<double> weights{1, 2, 0, 4, 8, -3, 1};
+
+    SECTION("draws with replacement in proportion to weight")
+    {
+        WeightedSampler sampler{weights};
+        REQUIRE(sampler.size() == 7);
+        REQUIRE(sampler.positiveCount() == 5);
+        std::vector<size_t> counts(weights.size(), 0);
+        const size_t n_draws = 200000;
+        for (size_t d = 0; d < n_draws; ++d)
+        {
+            counts[sampler.draw(rng)]++;
+        }
+        REQUIRE(counts[2] == 0);
+        REQUIRE(counts[5] == 0);
+        requireProportions(weights, counts, n_draws);
+    }
+
+    SECTION("samples are distinct and never hold unpickable items")
+    {
+        WeightedSampler sampler{weights};
+        std::vector<size_t> out;
+        for (size_t k : {0, 1, 3, 5, 10})
+        {
+            sampler.sample(k, rng, out);
+            REQUIRE(out.size() == std::min<size_t>(k, 5));
+            std::vector<size_t> sorted = out;
+            std::sort(sorted.begin(), sorted.end());
+            REQUIRE(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+            REQUIRE(std::find(out.begin(), out.end(), 2) == out.end());
+            REQUIRE(std::find(out.begin(), out.end(), 5) == out.end());
+        }
+    }
+
+    SECTION("the first item of a sample is picked by weight")
+    {
+        // few heavy items take the key pass, many light ones take the rejection pass
+        std::vector<double> light(400);
+        for (size_t i = 0; i < light.size(); ++i)
+        {
+            light[i] = 1.0 + static_cast<double>(i % 4);
+        }
+        for (const std::vector<double> *w : {&weights, &light})
+        {
+            WeightedSampler sampler{*w};
+            std::vector<size_t> counts(w->size(), 0);
+            std::vector<size_t> out;
+            const size_t n_samples = 100000;
+            for (size_t s = 0; s < n_samples; ++s)
+            {
+                sampler.sample(3, rng, out);
+                counts[out[0]]++;
+            }
+            requireProportions(*w, counts, n_samples);
+        }
+    }
+
+    SECTION("sampling every item gives them all")
+    {
+        std::vector<double> many(10000, 1.0);
+        many[17] = 0;
+        WeightedSampler sampler{many};
+        std::vector<size_t> out;
+        sampler.sample(many.size(), rng, out);
+        REQUIRE(out.size() == many.size() - 1);
+        std::sort(out.begin(), out.end());
+        REQUIRE(std::adjacent_find(out.begin(), out.end()) == out.end());
+    }
+
+    SECTION("empty and all zero weights")
+    {
+        WeightedSampler empty{};
+        REQUIRE(empty.draw(rng) == 0);
+        WeightedSampler zeros{std::vector<double>(5, 0.0)};
+        REQUIRE(zeros.draw(rng) == 5);
+        std::vector<size_t> out{1, 2};
+        zeros.sample(3, rng, out);
+        REQUIRE(out.empty());
+    }
+
+    SECTION("keys order items by weight")
+    {
+        REQUIRE(weightedSampleKey(2.0, 0.5) < weightedSampleKey(1.0, 0.5));
+        REQUIRE(std::isinf(weightedSampleKey(0.0, 0.5)));
+        REQUIRE(weightedSampleKey(1.0, 0.0) == 0.0);
+    }
+}
+
+TEST_CASE("Weighted sampler benchmark", "[.][benchmark]")
+{
+    Rng rng{1};
+    std::vector<double> weights(2'000'000);
+    for (double &weight : weights)
+    {
+        weight = 1.0 + static_cast<double>(rng() % 1000) / 100.0;
+    }
+    WeightedSampler sampler{};
+    std::vector<size_t> out;
+
+    BENCHMARK("build over 2M weights")
+    {
+        sampler.build(weights);
+        return sampler.size();
+    };
+    BENCHMARK("draw 1000 with replacement")
+    {
+        size_t sum = 0;
+        for (int d = 0; d < 1000; ++d)
+        {
+            sum += sampler.draw(rng);
+        }
+        return sum;
+    };
+    BENCHMARK("sample 15 without replacement")
+    {
+        sampler.sample(15, rng, out);
+        return out.size();
+    };
+    BENCHMARK("sample 500000 without replacement")
+    {
+        sampler.sample(500000, rng, out);
+        return out.size();
+    };
+}